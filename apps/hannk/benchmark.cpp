@@ -1,6 +1,7 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include "HalideRuntime.h"
 
@@ -12,14 +13,22 @@
 
 namespace hannk {
 
-void run_benchmark(const std::string &filename, const InterpreterOptions &options) {
+void run_benchmark(const std::string &filename, InterpreterOptions options, int batch_size, bool report_throughput, bool weight_cache) {
     if (!options.trace) {
         // In trace mode, don't send *anything* to stdout
         std::cout << filename;
+        if (report_throughput) {
+            std::cout << " (batch " << batch_size << ")";
+        }
     }
 
-    std::vector<char> buffer = read_entire_file(filename);
-    std::unique_ptr<OpGroup> model = parse_tflite_model_from_buffer(buffer.data());
+    // The constant tensors of the model point into the file.
+    MappedFile buffer(filename);
+    std::unique_ptr<OpGroup> model = parse_tflite_model_from_buffer(buffer.data(), batch_size);
+
+    if (weight_cache) {
+        options.weight_cache_path = filename + ".hannk_weights";
+    }
 
     if (options.verbosity >= 1) {
         model->dump(std::cout);
@@ -34,7 +43,11 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
 
     if (!options.trace) {
         auto result = Halide::Tools::benchmark([&]() { interpreter.execute(); });
-        std::cout << ": " << result.wall_time * 1e6 << " us" << std::endl;
+        std::cout << ": " << result.wall_time * 1e6 << " us";
+        if (report_throughput) {
+            std::cout << ", " << batch_size / result.wall_time << " inferences/s";
+        }
+        std::cout << std::endl;
 
         halide_profiler_report(nullptr);
         halide_profiler_reset();
@@ -51,6 +64,8 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
 // from other targets where we compile the file into an executable.
 __attribute__((visibility("default"))) int main(int argc, char **argv) {
     hannk::InterpreterOptions options;
+    std::vector<int> batch_sizes;
+    bool weight_cache = false;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--verbose")) {
@@ -61,6 +76,26 @@ __attribute__((visibility("default"))) int main(int argc, char **argv) {
             options.trace = true;
             continue;
         }
+        if (!strcmp(argv[i], "--inter_op_parallelism")) {
+            options.inter_op_parallelism = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--weight_cache")) {
+            weight_cache = true;
+            continue;
+        }
+        if (!strncmp(argv[i], "--batch_sizes=", 14)) {
+            std::istringstream sizes(argv[i] + 14);
+            std::string size;
+            while (std::getline(sizes, size, ',')) {
+                batch_sizes.push_back(std::atoi(size.c_str()));
+                if (batch_sizes.back() < 1) {
+                    HLOG(ERROR) << "Invalid batch size: " << size << ".\n";
+                    exit(1);
+                }
+            }
+            continue;
+        }
         if (argv[i][0] == '-') {
             HLOG(ERROR) << "Unknown flag: " << argv[i] << ".\n";
             exit(1);
@@ -72,11 +107,18 @@ __attribute__((visibility("default"))) int main(int argc, char **argv) {
         exit(1);
     }
 
+    const bool report_throughput = !batch_sizes.empty();
+    if (batch_sizes.empty()) {
+        batch_sizes.push_back(1);
+    }
+
     for (int i = 1; i < argc; i++) {
         if (!strncmp(argv[i], "--", 2)) {
             continue;
         }
-        hannk::run_benchmark(argv[i], options);
+        for (int batch_size : batch_sizes) {
+            hannk::run_benchmark(argv[i], options, batch_size, report_throughput, weight_cache);
+        }
     }
 
     std::cout << "Done!\n";
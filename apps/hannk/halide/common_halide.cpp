@@ -1,4 +1,5 @@
 #include "halide/common_halide.h"
+#include "interpreter/elementwise_program.h"
 
 using namespace Halide;
 using namespace Halide::ConciseCasts;
@@ -247,4 +248,64 @@ Expr quantize_and_relu_u8(const Expr &x, const Expr &multiplier, const Expr &shi
     }
 }
 
+Func interpret_elementwise_program(const std::vector<Expr> &inputs, ImageParam program, const Type &intermediate_type,
+                                   const std::vector<Var> &vars, const Var &slot) {
+    Type unsigned_intermediate = intermediate_type.with_code(halide_type_uint);
+    const int q = intermediate_type.bits() - (intermediate_type.is_int() ? 1 : 0);
+
+    auto at = [&](Expr s) {
+        std::vector<Expr> args(vars.begin(), vars.end());
+        args.push_back(std::move(s));
+        return args;
+    };
+
+    std::vector<Var> pure_args = vars;
+    pure_args.push_back(slot);
+    Func scratch("scratch");
+    scratch(pure_args) = undef(intermediate_type);
+
+    // Load the inputs into the scratch memory.
+    const int input_count = inputs.size();
+    for (int i = 0; i < input_count; i++) {
+        scratch(at(-i - 1)) = cast(intermediate_type, inputs[i]);
+    }
+
+    // scratch slot 0 is a constant 0.
+    scratch(at(0)) = cast(intermediate_type, 0);
+
+    RDom r(0, ElementwiseAssembler::OpCodeCount, 0, program.dim(1).extent());
+    Expr op = program(0, r.y);
+    Expr arg1 = program(1, r.y);
+    Expr arg2 = program(2, r.y);
+    Expr arg3 = cast(intermediate_type, program(3, r.y));
+    Expr arg4 = cast(intermediate_type, program(4, r.y));
+
+    Expr instruction_slot = r.y + 1;
+
+    const int max_input = input_count - 1;
+    Expr input1 = scratch(at(unsafe_promise_clamped(i32(arg1), -max_input - 1, instruction_slot)));
+    Expr input2 = scratch(at(unsafe_promise_clamped(i32(arg2), -max_input - 1, instruction_slot)));
+
+    std::vector<Expr> instructions = {
+        scratch(at(instruction_slot)),
+        saturating_add(input1, input2 + arg3),
+        saturating_sub(input1, input2 + arg3),
+        saturating_add(multiply_2x_high(input1, input2 + arg3), arg4),
+        rounding_mul_shift_right(input1, input2 + arg3, cast(unsigned_intermediate, arg4)),
+        rounding_shift_right(input1, input2 + arg3),
+        min(input1, input2 + arg3),
+        max(input1, input2 + arg3),
+        clamp(input1, arg3, arg4),
+        rounding_shift_right(approx_logistic(q, input1, input2 + arg3, intermediate_type), q - arg4),
+        rounding_shift_right(approx_tanh(q, input1, input2 + arg3, intermediate_type), q - arg4),
+    };
+    r.where(r.x == op);
+    scratch(at(instruction_slot)) = mux(r.x, instructions);
+
+    program.dim(0).set_min(0).set_extent(ElementwiseAssembler::InstructionSize).set_stride(1);
+    program.dim(1).set_min(0).set_stride(ElementwiseAssembler::InstructionSize);
+
+    return scratch;
+}
+
 }  // namespace hannk
@@ -71,6 +71,16 @@ Halide::Expr quantize_i16(const Halide::Expr &x, const Halide::Expr &multiplier,
 Halide::Expr quantize_and_relu_u8(const Halide::Expr &x, const Halide::Expr &multiplier, const Halide::Expr &shift, const Halide::Expr &zero,
                                   const Halide::Expr &min, const Halide::Expr &max, const Halide::Target &target);
 
+// Interpret the elementwise program (see interpreter/elementwise_program.h) on
+// the given inputs, which are defined in terms of vars. The result is a Func
+// indexed by vars and then slot, where slot -i - 1 is input i, slot 0 is 0,
+// and slot i + 1 is the result of instruction i. Update i of the result
+// loads input i, update inputs.size() stores the 0, and the last update runs
+// the program, with the RVar over the opcodes first.
+Halide::Func interpret_elementwise_program(const std::vector<Halide::Expr> &inputs, Halide::ImageParam program,
+                                           const Halide::Type &intermediate_type,
+                                           const std::vector<Halide::Var> &vars, const Halide::Var &slot);
+
 }  // namespace hannk
 
 #endif  // HANNK_COMMON_HALIDE_H
@@ -42,6 +42,15 @@ public:
     // to load vectors, so making this value larger helps for big reductions.
     GeneratorParam<int> unroll_reduction_{"unroll_reduction", 4};
 
+    // When true, the convolution is followed by an elementwise program (see
+    // elementwise_program.h), applied to the result before it is narrowed to
+    // the output, to avoid a separate elementwise op writing the output to
+    // memory and reading it back. Input 0 of the program is the convolution
+    // requantized with output_multiplier and output_shift, and input 1 is
+    // the addend. The output zero point and min/max are applied to the
+    // result of the program. Requires a uint8 output.
+    GeneratorParam<bool> elementwise_epilogue_{"elementwise_epilogue", false};
+
     // Unsigned 8-bit input tensor, indexed by c, x, y, b.
     Input<Buffer<uint8_t, 4>> input_{"input"};
     Input<uint8_t> input_zero_{"input_zero"};
@@ -72,12 +81,21 @@ public:
 
     Output<Buffer<void, 4>> output_{"output"};
 
+    // Only present if elementwise_epilogue is true. The addend is indexed
+    // like the output.
+    Input<Buffer<uint8_t, 4>> *addend_ = nullptr;
+    Input<Buffer<int16_t, 2>> *epilogue_ = nullptr;
+
     void configure() {
         if (use_8bit_multiply(target)) {
             filter_.set_type(UInt(8));
         } else {
             filter_.set_type(Int(16));
         }
+        if (elementwise_epilogue_) {
+            addend_ = add_input<Buffer<uint8_t, 4>>("addend");
+            epilogue_ = add_input<Buffer<int16_t, 2>>("epilogue");
+        }
     }
 
     void generate() {
@@ -150,7 +168,16 @@ public:
 
         // Saturate and narrow the output.
         Expr output;
-        if (output_.type() == halide_type_of<uint8_t>()) {
+        Func epilogue("epilogue");
+        Var slot("slot");
+        if (elementwise_epilogue_) {
+            Expr convolved_i16 = quantize_i16(convolved(c, x, y, b), output_multiplier_, output_shift_, target);
+            epilogue = interpret_elementwise_program({convolved_i16, (*addend_)(c, x, y, b)}, *epilogue_,
+                                                     Int(32), {c, x, y, b}, slot);
+            output = epilogue(c, x, y, b, epilogue_->dim(1).extent());
+            output = saturating_add(output, i32(output_zero_));
+            output = u8(clamp(output, i32(output_min_), i32(output_max_)));
+        } else if (output_.type() == halide_type_of<uint8_t>()) {
             output = quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_, output_zero_,
                                           output_min_, output_max_, target);
         } else {
@@ -313,6 +340,21 @@ public:
                 .specialize(stride_x_ == 1 && filter_depth == unroll_reduction && is_interleaved(input_, unroll_reduction));
         }
 
+        if (elementwise_epilogue_) {
+            // The epilogue is computed in registers at the innermost loop of
+            // each output tile, like the output itself. Limit the length of
+            // the program so the scratch slots fit in registers.
+            const int max_epilogue_instructions = 8;
+            add_requirement(epilogue_->dim(1).extent() <= max_epilogue_instructions,
+                            "The elementwise epilogue has too many instructions.");
+            interpret_as_tensor(*addend_);
+            epilogue
+                .bound_extent(slot, max_epilogue_instructions + 3)
+                .store_in(MemoryType::Register)
+                .update(3)
+                .unroll(epilogue.rvars(3)[0]);
+        }
+
         // TODO: Pad this outside and let it constant fold.
         bias_.in().compute_root().store_in(MemoryType::Stack);
     }
@@ -19,6 +19,10 @@ public:
     // x of the input, instead of the x dimension of the buffer.
     GeneratorParam<bool> shallow_{"shallow", false};
 
+    // When true, the convolution is followed by an elementwise program, as
+    // for the Conv generator.
+    GeneratorParam<bool> elementwise_epilogue_{"elementwise_epilogue", false};
+
     // Unsigned 8-bit input tensor, indexed by ci, x, y, b.
     Input<Buffer<uint8_t, 4>> input_{"input"};
     Input<uint8_t> input_zero_{"input_zero"};
@@ -53,6 +57,18 @@ public:
 
     Output<Buffer<uint8_t, 4>> output_{"output"};
 
+    // Only present if elementwise_epilogue is true. The addend is indexed
+    // like the output.
+    Input<Buffer<uint8_t, 4>> *addend_ = nullptr;
+    Input<Buffer<int16_t, 2>> *epilogue_ = nullptr;
+
+    void configure() {
+        if (elementwise_epilogue_) {
+            addend_ = add_input<Buffer<uint8_t, 4>>("addend");
+            epilogue_ = add_input<Buffer<int16_t, 2>>("epilogue");
+        }
+    }
+
     void generate() {
         // The algorithm.
 
@@ -130,9 +146,20 @@ public:
         convolved(c, x, y, b) = offset_c(filter_c);
         convolved(c, x, y, b) += i32(filter_zeroed_rdxy) * i32(input_rdxy);
 
-        output_(c, x, y, b) =
-            quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_,
-                                 output_zero_, output_min_, output_max_, target);
+        Func epilogue("epilogue");
+        Var slot("slot");
+        if (elementwise_epilogue_) {
+            Expr convolved_i16 = quantize_i16(convolved(c, x, y, b), output_multiplier_, output_shift_, target);
+            epilogue = interpret_elementwise_program({convolved_i16, (*addend_)(c, x, y, b)}, *epilogue_,
+                                                     Int(32), {c, x, y, b}, slot);
+            Expr output = epilogue(c, x, y, b, epilogue_->dim(1).extent());
+            output = saturating_add(output, i32(output_zero_));
+            output_(c, x, y, b) = u8(clamp(output, i32(output_min_), i32(output_max_)));
+        } else {
+            output_(c, x, y, b) =
+                quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_,
+                                     output_zero_, output_min_, output_max_, target);
+        }
 
         // Schedule.
         interpret_as_tensor(input_);
@@ -235,6 +262,18 @@ public:
         bias_bounded.compute_at(filter_compute_at)
             .store_in(MemoryType::Stack)
             .vectorize(c, vector_size, TailStrategy::PredicateLoads);
+
+        if (elementwise_epilogue_) {
+            const int max_epilogue_instructions = 8;
+            add_requirement(epilogue_->dim(1).extent() <= max_epilogue_instructions,
+                            "The elementwise epilogue has too many instructions.");
+            interpret_as_tensor(*addend_);
+            epilogue
+                .bound_extent(slot, max_epilogue_instructions + 3)
+                .store_in(MemoryType::Register)
+                .update(3)
+                .unroll(epilogue.rvars(3)[0]);
+        }
     }
 };
 
@@ -1,7 +1,6 @@
 #include "Halide.h"
 #include "halide/common_halide.h"
 #include "halide/constants.h"
-#include "interpreter/elementwise_program.h"
 
 using namespace Halide;
 using namespace Halide::ConciseCasts;
@@ -133,50 +132,13 @@ public:
     void generate() {
         Var x("x"), y("y"), u("u");
 
-        Type intermediate_type = intermediate_type_;
-        Type unsigned_intermediate = intermediate_type.with_code(halide_type_uint);
-        const int q = intermediate_type.bits() - (intermediate_type.is_int() ? 1 : 0);
-
-        Func scratch("scratch");
-        scratch(x, y, u) = undef(intermediate_type_);
-
-        // Load the inputs into the scratch memory.
+        // Load the inputs and run the program.
         const int input_count = inputs_.size();
+        std::vector<Expr> inputs;
         for (int i = 0; i < input_count; i++) {
-            scratch(x, y, -i - 1) = cast(intermediate_type, inputs_[i](x, y));
+            inputs.push_back(inputs_[i](x, y));
         }
-
-        // scratch slot 0 is a constant 0.
-        scratch(x, y, 0) = cast(intermediate_type, 0);
-
-        RDom r(0, ElementwiseAssembler::OpCodeCount, 0, program_.dim(1).extent());
-        Expr op = program_(0, r.y);
-        Expr arg1 = program_(1, r.y);
-        Expr arg2 = program_(2, r.y);
-        Expr arg3 = cast(intermediate_type, program_(3, r.y));
-        Expr arg4 = cast(intermediate_type, program_(4, r.y));
-
-        Expr slot = r.y + 1;
-
-        const int max_input = input_count - 1;
-        Expr input1 = scratch(x, y, unsafe_promise_clamped(i32(arg1), -max_input - 1, slot));
-        Expr input2 = scratch(x, y, unsafe_promise_clamped(i32(arg2), -max_input - 1, slot));
-
-        std::vector<Expr> instructions = {
-            scratch(x, y, slot),
-            saturating_add(input1, input2 + arg3),
-            saturating_sub(input1, input2 + arg3),
-            saturating_add(multiply_2x_high(input1, input2 + arg3), arg4),
-            rounding_mul_shift_right(input1, input2 + arg3, cast(unsigned_intermediate, arg4)),
-            rounding_shift_right(input1, input2 + arg3),
-            min(input1, input2 + arg3),
-            max(input1, input2 + arg3),
-            clamp(input1, arg3, arg4),
-            rounding_shift_right(approx_logistic(q, input1, input2 + arg3, intermediate_type), q - arg4),
-            rounding_shift_right(approx_tanh(q, input1, input2 + arg3, intermediate_type), q - arg4),
-        };
-        r.where(r.x == op);
-        scratch(x, y, slot) = mux(r.x, instructions);
+        Func scratch = interpret_elementwise_program(inputs, program_, intermediate_type_, {x, y}, u);
 
         std::vector<Type> output_types;
         if (((Type)output1_type_).bits() > 0) {
@@ -221,10 +183,7 @@ public:
             .bound_extent(u, input_count + slots + 1)
             .store_in(MemoryType::Register)
             .update(input_count + 1)
-            .unroll(r.x);
-
-        program_.dim(0).set_min(0).set_extent(ElementwiseAssembler::InstructionSize).set_stride(1);
-        program_.dim(1).set_min(0).set_stride(ElementwiseAssembler::InstructionSize);
+            .unroll(scratch.rvars(input_count + 1)[0]);
     }
 };
 
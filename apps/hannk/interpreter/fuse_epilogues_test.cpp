@@ -0,0 +1,206 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "interpreter/interpreter.h"
+#include "interpreter/ops.h"
+#include "interpreter/transforms.h"
+
+using namespace hannk;
+
+// Check that fusing elementwise ops into the convs that produce their
+// inputs doesn't change the results of a model at all.
+
+namespace {
+
+// The op following the conv.
+enum class Elementwise {
+    Add,
+    Sub,
+    Relu,
+    Relu6,
+};
+
+struct TestCase {
+    const char *name;
+    bool depthwise;
+    ActivationFunction conv_activation;
+    Elementwise elementwise;
+    // Which input of a binary op the conv is.
+    int conv_input;
+    ActivationFunction binary_activation;
+    float conv_output_scale;
+    float output_scale;
+    // Whether the elementwise op should be fused.
+    bool expect_fused;
+};
+
+QuantizationInfo uniform(float scale, int32_t zero) {
+    QuantizationInfo q;
+    q.scale = {scale};
+    q.zero = {zero};
+    return q;
+}
+
+TensorPtr make_tensor(const std::string &name, halide_type_t type, const std::vector<int> &shape,
+                      QuantizationInfo quantization) {
+    HalideBuffer<void> buffer(type, nullptr, shape);
+    return std::make_shared<Tensor>(name, std::move(buffer), std::move(quantization));
+}
+
+template<typename T>
+TensorPtr make_constant(const std::string &name, const std::vector<int> &shape, QuantizationInfo quantization,
+                        int min, int max, unsigned seed) {
+    HalideBuffer<T> buffer(shape);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(min, max);
+    buffer.for_each_value([&](T &x) { x = (T)dist(rng); });
+    TensorPtr result = std::make_shared<Tensor>(name, std::move(buffer), std::move(quantization));
+    result->set_constant();
+    return result;
+}
+
+std::unique_ptr<OpGroup> make_model(const TestCase &t) {
+    const int channels = t.depthwise ? 8 : 16;
+    const float input_scale = 0.05f;
+    const float filter_scale = 0.01f;
+
+    TensorPtr input = make_tensor("input", halide_type_of<uint8_t>(), {8, 7, 6, 1}, uniform(input_scale, 120));
+    TensorPtr filter = make_constant<uint8_t>("filter", {t.depthwise ? channels : 8, 3, 3, t.depthwise ? 1 : channels},
+                                              uniform(filter_scale, 130), 0, 255, 1);
+    TensorPtr bias = make_constant<int32_t>("bias", {channels}, uniform(input_scale * filter_scale, 0), -1000, 1000, 2);
+    TensorPtr conv_output = make_tensor("conv_output", halide_type_of<uint8_t>(), {channels, 5, 4, 1},
+                                        uniform(t.conv_output_scale, 100));
+    TensorPtr output = make_tensor("output", halide_type_of<uint8_t>(), {channels, 5, 4, 1},
+                                   uniform(t.output_scale, 128));
+
+    std::vector<OpPtr> ops;
+    if (t.depthwise) {
+        ops.push_back(make_op<DepthwiseConv2DOp>(input, filter, bias, conv_output, 1, std::array<int, 2>{1, 1},
+                                                 std::array<int, 2>{1, 1}, Padding::Valid, t.conv_activation));
+    } else {
+        ops.push_back(make_op<ConvOp>(input, filter, bias, conv_output, std::array<int, 2>{1, 1},
+                                      std::array<int, 2>{1, 1}, Padding::Valid, t.conv_activation));
+    }
+
+    std::vector<TensorPtr> inputs = {input};
+    switch (t.elementwise) {
+    case Elementwise::Add:
+    case Elementwise::Sub: {
+        TensorPtr other = make_tensor("other", halide_type_of<uint8_t>(), {channels, 5, 4, 1}, uniform(0.08f, 110));
+        inputs.push_back(other);
+        const TensorPtr &a = t.conv_input == 0 ? conv_output : other;
+        const TensorPtr &b = t.conv_input == 0 ? other : conv_output;
+        ops.push_back(make_op<BinaryOp>(a, b, output, t.elementwise == Elementwise::Add ? BinaryOp::Add : BinaryOp::Sub,
+                                        t.binary_activation));
+        break;
+    }
+    case Elementwise::Relu:
+        ops.push_back(make_op<UnaryOp>(conv_output, output, UnaryOp::Relu));
+        break;
+    case Elementwise::Relu6:
+        ops.push_back(make_op<UnaryOp>(conv_output, output, UnaryOp::Relu6));
+        break;
+    }
+
+    return make_op<OpGroup>(std::move(inputs), std::vector<TensorPtr>{output}, std::move(ops));
+}
+
+class CountElementwiseOps : public OpVisitor {
+    using OpVisitor::visit;
+
+    void visit(const BinaryOp *op) override {
+        count++;
+    }
+    void visit(const UnaryOp *op) override {
+        count++;
+    }
+
+public:
+    int count = 0;
+};
+
+bool run(const TestCase &t, bool fuse, HalideBuffer<uint8_t> &result) {
+    InterpreterOptions options;
+    options.fuse_elementwise_epilogues = fuse;
+    Interpreter interpreter(make_model(t), options);
+    if (!interpreter.prepare()) {
+        std::cout << t.name << ": prepare() failed\n";
+        return false;
+    }
+    unsigned seed = 3;
+    for (TensorPtr i : interpreter.inputs()) {
+        HalideBuffer<uint8_t> buf = i->buffer<uint8_t>();
+        std::mt19937 rng(seed++);
+        buf.for_each_value([&](uint8_t &x) { x = (uint8_t)rng(); });
+    }
+    interpreter.execute();
+    result = interpreter.outputs()[0]->buffer<uint8_t>().copy();
+    return true;
+}
+
+bool test(const TestCase &t) {
+    // Check that the op was (or wasn't) fused.
+    OpPtr fused = fuse_elementwise_epilogues(make_model(t));
+    if (!fused) {
+        std::cout << t.name << ": fuse_elementwise_epilogues() failed\n";
+        return false;
+    }
+    CountElementwiseOps counter;
+    fused->accept(&counter);
+    if ((counter.count == 0) != t.expect_fused) {
+        std::cout << t.name << ": the elementwise op was " << (t.expect_fused ? "not " : "") << "fused\n";
+        return false;
+    }
+
+    HalideBuffer<uint8_t> with_fusion, without_fusion;
+    if (!run(t, true, with_fusion) || !run(t, false, without_fusion)) {
+        return false;
+    }
+    bool ok = true;
+    with_fusion.for_each_element([&](const int *pos) {
+        if (ok && with_fusion(pos) != without_fusion(pos)) {
+            std::cout << t.name << ": output(" << pos[0] << ", " << pos[1] << ", " << pos[2] << ", " << pos[3]
+                      << ") is " << (int)with_fusion(pos) << " fused, and " << (int)without_fusion(pos)
+                      << " unfused\n";
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const ActivationFunction none = ActivationFunction::None;
+    const ActivationFunction relu = ActivationFunction::Relu;
+    const ActivationFunction relu6 = ActivationFunction::Relu6;
+
+    const TestCase cases[] = {
+        // name, depthwise, conv_activation, elementwise, conv_input, binary_activation,
+        // conv_output_scale, output_scale, expect_fused
+        {"residual add", false, none, Elementwise::Add, 0, none, 0.15f, 0.1f, true},
+        {"residual add, conv second", false, none, Elementwise::Add, 1, none, 0.15f, 0.1f, true},
+        {"add after relu", false, relu, Elementwise::Add, 0, relu6, 0.15f, 0.1f, true},
+        {"conv - other", false, none, Elementwise::Sub, 0, none, 0.15f, 0.1f, true},
+        {"other - conv", false, none, Elementwise::Sub, 1, relu, 0.15f, 0.1f, true},
+        {"relu", false, none, Elementwise::Relu, 0, none, 0.15f, 0.15f, true},
+        {"relu6, requantized", false, none, Elementwise::Relu6, 0, none, 0.15f, 0.03f, true},
+        {"depthwise add", true, relu, Elementwise::Add, 1, none, 0.15f, 0.1f, true},
+        {"depthwise relu", true, none, Elementwise::Relu, 0, none, 0.15f, 0.15f, true},
+        // The multiplier of the conv result doesn't fit in 16 bits, so the
+        // add is left alone.
+        {"add multiplier overflow", false, none, Elementwise::Add, 0, none, 1.0f, 0.02f, false},
+        {"relu multiplier overflow", false, none, Elementwise::Relu, 0, none, 1.0f, 0.02f, false},
+    };
+
+    for (const TestCase &t : cases) {
+        if (!test(t)) {
+            return -1;
+        }
+    }
+
+    std::cout << "Success!\n";
+    return 0;
+}
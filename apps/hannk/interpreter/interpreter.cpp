@@ -218,6 +218,109 @@ void do_check_op_order(const Op *root) {
 }
 #endif
 
+// A range of memory that an op reads or writes.
+struct MemoryAccess {
+    // Tensors that share storage always overlap.
+    const void *storage = nullptr;
+    // The memory itself, if it is known at prepare() time.
+    const uint8_t *begin = nullptr, *end = nullptr;
+    bool is_write = false;
+
+    bool conflicts_with(const MemoryAccess &other) const {
+        if (!is_write && !other.is_write) {
+            return false;
+        }
+        if (storage == other.storage) {
+            return true;
+        }
+        return begin && other.begin && begin < other.end && other.begin < end;
+    }
+};
+
+void add_memory_access(const TensorPtr &t, bool is_write, std::vector<MemoryAccess> &accesses) {
+    if (!t || t->is_constant()) {
+        return;
+    }
+    MemoryAccess a;
+    a.is_write = is_write;
+    if (t->is_dynamic()) {
+        // Dynamic tensors are allocated as they are produced, and never
+        // share storage.
+        a.storage = t.get();
+    } else {
+        a.storage = t->storage().get();
+        if (!t->is_external() && t->is_allocated()) {
+            // Tensors in the arena with disjoint lifetimes may share memory,
+            // so the ops that use them must not run concurrently.
+            a.begin = t->raw_buffer()->begin();
+            a.end = t->raw_buffer()->end();
+        }
+    }
+    accesses.push_back(a);
+}
+
+// Group the ops of a model into levels, such that no op reads or writes
+// memory written by another op in the same level. Executing the levels in
+// order, and the ops of each level in any order, gives the same results as
+// executing the ops in order. Returns an empty list if the ops can't be
+// analyzed.
+std::vector<std::vector<Op *>> find_op_levels(Op *root) {
+    OpGroup *group = dynamic_cast<OpGroup *>(root);
+    if (!group) {
+        return {};
+    }
+
+    const int n = group->op_count();
+    std::vector<std::vector<MemoryAccess>> accesses(n);
+    for (int i = 0; i < n; i++) {
+        Op *op = group->op(i);
+        if (dynamic_cast<OpGroup *>(op)) {
+            // The intermediates of a nested group aren't visible here.
+            return {};
+        }
+        for (int j = 0; j < op->input_count(); j++) {
+            add_memory_access(op->input(j), false, accesses[i]);
+        }
+        for (int j = 0; j < op->output_count(); j++) {
+            add_memory_access(op->output(j), true, accesses[i]);
+        }
+    }
+
+    const auto conflict = [&](int i, int j) {
+        for (const MemoryAccess &a : accesses[i]) {
+            for (const MemoryAccess &b : accesses[j]) {
+                if (a.conflicts_with(b)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    // Each op goes in the level after the last one containing an earlier op
+    // it conflicts with.
+    std::vector<int> level(n, 0);
+    std::vector<std::vector<Op *>> result;
+    for (int j = 0; j < n; j++) {
+        for (int i = j - 1; i >= 0; i--) {
+            if (level[i] >= level[j] && conflict(i, j)) {
+                level[j] = level[i] + 1;
+            }
+        }
+        if (level[j] >= (int)result.size()) {
+            result.resize(level[j] + 1);
+        }
+        result[level[j]].push_back(group->op(j));
+    }
+    return result;
+}
+
+int execute_op_task(void *user_context, int idx, uint8_t *closure) {
+    Op *const *ops = (Op *const *)closure;
+    ops[idx]->execute();
+    return 0;
+}
+
 }  // namespace
 
 bool Interpreter::prepare() {
@@ -253,12 +356,31 @@ bool Interpreter::prepare() {
     }
     dump_model("Model after pad_for_ops():", 3);
 
+    if (options_.fuse_elementwise_epilogues) {
+        model_ = fuse_elementwise_epilogues(std::move(model_));
+        if (!model_) {
+            HLOG(ERROR) << "fuse_elementwise_epilogues() failed.";
+            return false;
+        }
+        dump_model("Model after fuse_elementwise_epilogues():", 3);
+    }
+
     model_ = in_place(std::move(model_));
     dump_model("Model after in_place():", 3);
 
-    model_ = fold_constants(std::move(model_));
+    if (!options_.weight_cache_path.empty()) {
+        weight_cache_ = std::make_unique<WeightCache>(options_.weight_cache_path, op_implementation_target());
+    }
+
+    model_ = fold_constants(std::move(model_), weight_cache_.get());
     dump_model("Model after fold_constants():", 3);
 
+    // The data added to the cache is only valid until the model is
+    // transformed further. Failing to save it isn't fatal.
+    if (weight_cache_ && !weight_cache_->save()) {
+        HLOG(WARNING) << "Unable to save the weight cache: " << options_.weight_cache_path;
+    }
+
     model_ = flatten_groups(std::move(model_));
     dump_model("Model after flatten_groups:", 3);
 
@@ -285,6 +407,20 @@ bool Interpreter::prepare() {
 
     dump_model("Model after all transformations:", 2);
 
+    if (options_.inter_op_parallelism) {
+        // This must come after arena allocation, as tensors whose memory
+        // is reused must not be in use at the same time.
+        op_levels_ = find_op_levels(model_.get());
+        if (options_.verbosity >= 1) {
+            size_t widest = 0;
+            for (const auto &l : op_levels_) {
+                widest = std::max(widest, l.size());
+            }
+            HLOG(INFO) << "Inter-op parallelism: " << op_levels_.size() << " levels, at most "
+                       << widest << " ops per level";
+        }
+    }
+
     prepared_ = true;
     return true;
 }
@@ -294,7 +430,17 @@ void Interpreter::execute() {
         HLOG(ERROR) << "Must call prepare() before execute()";
         return;
     }
-    model_->execute();
+    if (op_levels_.empty()) {
+        model_->execute();
+        return;
+    }
+    for (const auto &ops : op_levels_) {
+        if (ops.size() == 1) {
+            ops[0]->execute();
+        } else {
+            halide_do_par_for(nullptr, execute_op_task, 0, (int)ops.size(), (uint8_t *)ops.data());
+        }
+    }
 }
 
 TensorPtr Interpreter::get_tensor(const std::string &name) {
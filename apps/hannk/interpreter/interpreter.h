@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "interpreter/model.h"
+#include "interpreter/weight_cache.h"
 
 namespace hannk {
 
@@ -14,14 +15,35 @@ struct InterpreterOptions {
 
     // Whether to enable tracing.
     bool trace = false;
+
+    // Whether to run ops that don't depend on each other concurrently,
+    // on the Halide thread pool, rather than strictly in order.
+    bool inter_op_parallelism = false;
+
+    // If not empty, the path of a file in which to cache the tiled conv
+    // filters computed by prepare(), so later calls to prepare() (in any
+    // process) can map them from the file rather than computing them.
+    std::string weight_cache_path;
+
+    // Whether to fuse elementwise ops into the convs that produce their
+    // inputs. Fusion doesn't change the results; this is mostly useful for
+    // testing that.
+    bool fuse_elementwise_epilogues = true;
 };
 
 class Interpreter {
+    // Declared before the model, as the model's tensors may point into it.
+    std::unique_ptr<WeightCache> weight_cache_;
     OpPtr model_;
     std::unique_ptr<char[]> tensor_storage_arena_;
     InterpreterOptions options_;
     bool prepared_ = false;
 
+    // If inter_op_parallelism is enabled, the ops of the model in groups
+    // that can each be executed concurrently, in the order they must be
+    // executed.
+    std::vector<std::vector<Op *>> op_levels_;
+
 public:
     explicit Interpreter(OpPtr m, InterpreterOptions options = InterpreterOptions());
     ~Interpreter();
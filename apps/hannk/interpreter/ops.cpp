@@ -1,10 +1,12 @@
 #include <atomic>
 #include <cmath>
 #include <iostream>
+#include <limits>
 
 #include "halide/add_uint8_uint8.h"
 #include "halide/average_pool_uint8.h"
 #include "halide/constants.h"
+#include "halide/conv_elementwise_u8_u8_u8.h"
 #include "halide/conv_u8_u8_i16.h"
 #include "halide/conv_u8_u8_u8.h"
 #ifdef CONV_R16
@@ -13,6 +15,8 @@
 #endif
 #include "halide/copy_uint8_uint8.h"
 #include "halide/depthwise_conv_broadcast_uint8.h"
+#include "halide/depthwise_conv_elementwise_uint8.h"
+#include "halide/depthwise_conv_shallow_elementwise_uint8.h"
 #include "halide/depthwise_conv_shallow_uint8.h"
 #include "halide/depthwise_conv_uint8.h"
 #include "halide/elementwise_5xint16_1xuint8int16.h"
@@ -523,6 +527,59 @@ bool requantize_or_copy(const HalideBuffer<const void> &in, const QuantizationIn
     return true;
 }
 
+bool same_bounds(const TensorPtr &a, const TensorPtr &b) {
+    return a->rank() == b->rank() &&
+           is_subset_of(a->bounds(), b->bounds()) &&
+           is_subset_of(b->bounds(), a->bounds());
+}
+
+bool is_uniform_quantized_uint8(const TensorPtr &t) {
+    return t->type() == halide_type_of<uint8_t>() &&
+           t->quantization().scale.size() == 1 &&
+           t->quantization().zero.size() == 1;
+}
+
+// Make an epilogue computing the same result as add_uint8, where in1 is the
+// result of the op the epilogue is fused into, which applies
+// in1_activation. The epilogue is exact, apart from the intermediate
+// rounding that add_uint8 does, which the epilogue does too.
+ElementwiseEpilogue make_add_epilogue(const QuantizationInfo &in1q, ActivationFunction in1_activation, int in1sign,
+                                      const QuantizationInfo &in2q, int in2sign, const QuantizationInfo &outq) {
+    const int in1_zero = in1q.uniform_zero();
+    const int in2_zero = in2q.uniform_zero();
+
+    const float in1_scale = in1q.uniform_scale() * (1 << add_output_shift);
+    const float in2_scale = in2q.uniform_scale() * (1 << add_output_shift);
+    const float out_scale = outq.uniform_scale() * (1 << add_input_shift);
+
+    const long in1_multiplier = std::lround(in1_scale / out_scale) * in1sign;
+    const long in2_multiplier = std::lround(in2_scale / out_scale) * in2sign;
+    if (std::abs(in1_multiplier) > std::numeric_limits<int16_t>::max() ||
+        std::abs(in2_multiplier) > std::numeric_limits<int16_t>::max()) {
+        return {};
+    }
+
+    const auto in1_range = get_output_range(in1_activation, in1q);
+
+    // The add pipeline computes the sum of the inputs, shifted up by
+    // add_input_shift and multiplied, with an add_output_shift rounding
+    // shift. We compute that in 32 bits, without the input shift.
+    std::array<int16_t, 64> program_buffer;
+    ElementwiseAssembler p(program_buffer);
+    auto in1 = p.clamp(p.input(0), in1_range.min - in1_zero, in1_range.max - in1_zero);
+    auto sum = p.mul_shift(in1, (int16_t)in1_multiplier, 0);
+    if (in2_multiplier != 0) {
+        auto in2 = p.sub(p.input(1), in2_zero);
+        sum = p.add(sum, p.mul_shift(in2, (int16_t)in2_multiplier, 0));
+    }
+    auto result = p.shift(sum, add_output_shift - add_input_shift);
+
+    ElementwiseEpilogue epilogue;
+    epilogue.program = p.assemble({result}).copy();
+    epilogue.quantization = in1q;
+    return epilogue;
+}
+
 ActivationFunction to_activation(UnaryOp::Operator op) {
     switch (op) {
     case UnaryOp::Relu:
@@ -720,6 +777,25 @@ void BinaryOp::execute() {
         << " for types " << in1->type() << ", " << in2->type() << ", " << out->type();
 }
 
+ElementwiseEpilogue BinaryOp::to_epilogue(int input_idx, ActivationFunction input_activation) const {
+    const TensorPtr &in = input(input_idx);
+    const TensorPtr &other = input(1 - input_idx);
+    if ((op_ != Add && op_ != Sub) || in == other ||
+        !is_uniform_quantized_uint8(in) ||
+        !is_uniform_quantized_uint8(other) ||
+        !is_uniform_quantized_uint8(output())) {
+        return {};
+    }
+    // The epilogue can't broadcast either input.
+    if (!same_bounds(in, output()) || !same_bounds(other, output())) {
+        return {};
+    }
+    const int in_sign = op_ == Sub && input_idx == 1 ? -1 : 1;
+    const int other_sign = op_ == Sub && input_idx == 0 ? -1 : 1;
+    return make_add_epilogue(in->quantization(), input_activation, in_sign,
+                             other->quantization(), other_sign, output()->quantization());
+}
+
 BoundsMap ConcatenationOp::map_bounds(int input_idx, int output_idx) const {
     int rank = output()->rank();
     assert(rank == input(input_idx)->rank());
@@ -799,9 +875,11 @@ BoundsMap ConvOp::map_bounds(int input_idx, int output_idx) const {
             result.constant(i + 3, filter()->bounds(i));
         }
         return result;
-    } else {
-        assert(input_idx == 2);
+    } else if (input_idx == 2) {
         return BoundsMap(1, output()->rank()).elementwise(0, 0);
+    } else {
+        assert(input_idx == 3);
+        return BoundsMap::elementwise(output()->rank());
     }
 }
 
@@ -810,7 +888,15 @@ namespace {
 void call_conv2d(halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_t *bias,
                  const MultiplyParams &params, const std::array<int, 2> &stride,
                  const std::array<int, 2> &dilation, const Interval &output_range,
-                 halide_buffer_t *output) {
+                 halide_buffer_t *addend, halide_buffer_t *epilogue, halide_buffer_t *output) {
+    if (epilogue) {
+        conv_elementwise_u8_u8_u8(input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
+                                  stride[0], stride[1], dilation[0], dilation[1], params.c.mantissa(),
+                                  -params.c.exponent(), (uint8_t)params.c_zero, output_range.min, output_range.max,
+                                  addend, epilogue, output);
+        return;
+    }
+
     using Conv2DFn = decltype(&::hannk::conv_u8_u8_u8);
 
     Conv2DFn fn;
@@ -860,16 +946,31 @@ void ConvOp::execute() {
         auto filter_buf = filt->buffer();
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
-
+        // If the epilogue doesn't use an addend, we still need to pass one.
+        auto addend_buf = addend() ? addend()->buffer() : output_buf;
+        auto epilogue_buf = epilogue_.program;
+
+        // With an epilogue, the convolution is quantized like the result
+        // the epilogue expects, rather than like the output.
+        const QuantizationInfo &result_quantization =
+            epilogue_.defined() ? epilogue_.quantization : out->quantization();
         MultiplyParams params =
-            get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
+            get_quantized_multiply_params(in->quantization(), filt->quantization(), result_quantization);
+        if (epilogue_.defined()) {
+            // The result of the epilogue is quantized like the output, but
+            // the pipeline adds the zero point.
+            params.c_zero = out->quantization().uniform_zero();
+        }
 
         const auto output_range = get_output_range(activation_, out->quantization());
 
-        // Pad with dummy dimensions up to 2D.
+        // Pad with dummy dimensions up to 2D. Inputs of lower rank come from
+        // fully connected layers, so the filter is 1x1, and we can put the
+        // batch in x, where the pipeline tiles it to reuse the filter.
         while (input_buf.dimensions() < 4) {
-            input_buf.embed(input_buf.dimensions() - 1, 1);
-            output_buf.embed(output_buf.dimensions() - 1, 1);
+            input_buf.add_dimension();
+            output_buf.add_dimension();
+            addend_buf.add_dimension();
             filter_buf.add_dimension();
         }
 
@@ -883,9 +984,11 @@ void ConvOp::execute() {
             // them all where possible, which might be a further improvement.
             while (can_fuse_xy(FuseType::Pad, input_buf) &&
                    can_fuse_xy(FuseType::Pad, output_buf) &&
+                   can_fuse_xy(FuseType::Pad, addend_buf) &&
                    input_buf.dim(1).extent() == output_buf.dim(1).extent()) {
                 fuse_xy(FuseType::Pad, input_buf);
                 fuse_xy(FuseType::Pad, output_buf);
+                fuse_xy(FuseType::Pad, addend_buf);
             }
 
             if (output_buf.dim(1).extent() < output_buf.dim(2).extent()) {
@@ -894,10 +997,12 @@ void ConvOp::execute() {
                 // if we tiled y instead. We can do this by just swapping the x and y dimensions.
                 input_buf.transpose(1, 2);
                 output_buf.transpose(1, 2);
+                addend_buf.transpose(1, 2);
             }
         }
 
-        call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range, output_buf);
+        call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range,
+                    addend_buf, epilogue_.defined() ? epilogue_buf.raw_buffer() : nullptr, output_buf);
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
     }
@@ -909,8 +1014,14 @@ namespace {
 void call_depthwise_conv_uint8(
     halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_t *bias,
     const MultiplyParams &params, const std::array<int, 2> &stride, const std::array<int, 2> &dilation,
-    int input_stride_x, const Interval &output_range, halide_buffer_t *output) {
-    if (input_stride_x != 0) {
+    int input_stride_x, const Interval &output_range, halide_buffer_t *addend, halide_buffer_t *epilogue,
+    halide_buffer_t *output) {
+    if (epilogue) {
+        auto fn = input_stride_x != 0 ? depthwise_conv_shallow_elementwise_uint8 : ::hannk::depthwise_conv_elementwise_uint8;
+        fn(input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
+           stride[0], stride[1], dilation[0], dilation[1], input_stride_x, params.c.mantissa(), -params.c.exponent(),
+           (uint8_t)params.c_zero, (uint8_t)output_range.min, (uint8_t)output_range.max, addend, epilogue, output);
+    } else if (input_stride_x != 0) {
         depthwise_conv_shallow_uint8(
             input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
             stride[0], stride[1], dilation[0], dilation[1], input_stride_x, params.c.mantissa(), -params.c.exponent(),
@@ -968,7 +1079,8 @@ BoundsMap DepthwiseConv2DOp::map_bounds(int input_idx, int output_idx) const {
     } else if (input_idx == 2) {
         return BoundsMap(1, 4).elementwise(0, 0);
     } else {
-        return BoundsMap(0, 4);
+        assert(input_idx == 3);
+        return BoundsMap::elementwise(4);
     }
 }
 
@@ -998,9 +1110,21 @@ void DepthwiseConv2DOp::execute() {
         auto filter_buf = filt->buffer().sliced(3, 0);
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
-
+        // If the epilogue doesn't use an addend, we still need to pass one.
+        auto addend_buf = addend() ? addend()->buffer() : output_buf;
+        auto epilogue_buf = epilogue_.program;
+
+        // With an epilogue, the convolution is quantized like the result
+        // the epilogue expects, rather than like the output.
+        const QuantizationInfo &result_quantization =
+            epilogue_.defined() ? epilogue_.quantization : out->quantization();
         MultiplyParams params =
-            get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
+            get_quantized_multiply_params(in->quantization(), filt->quantization(), result_quantization);
+        if (epilogue_.defined()) {
+            // The result of the epilogue is quantized like the output, but
+            // the pipeline adds the zero point.
+            params.c_zero = out->quantization().uniform_zero();
+        }
 
         const auto output_range = get_output_range(activation_, out->quantization());
 
@@ -1012,15 +1136,18 @@ void DepthwiseConv2DOp::execute() {
         if (stride_[0] == 1 &&
             can_fuse_cx(FuseType::InPlace, input_buf) &&
             can_fuse_cx(FuseType::InPlace, output_buf) &&
+            can_fuse_cx(FuseType::InPlace, addend_buf) &&
             can_be_shallow(channel_alignment_, input_buf.dim(0).extent(), input_buf.dim(1).extent())) {
             input_stride_x = input_buf.dim(1).stride();
             fuse_cx(FuseType::InPlace, input_buf);
             fuse_cx(FuseType::InPlace, output_buf);
+            fuse_cx(FuseType::InPlace, addend_buf);
         }
 
         assert(depth_multiplier_ == 1 || depth_multiplier_ >= out->extent(0));
         call_depthwise_conv_uint8(input_buf, filter_buf, bias_buf, params,
-                                  stride_, dilation_, input_stride_x, output_range, output_buf);
+                                  stride_, dilation_, input_stride_x, output_range, addend_buf,
+                                  epilogue_.defined() ? epilogue_buf.raw_buffer() : nullptr, output_buf);
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
     }
@@ -1782,6 +1909,29 @@ const char *UnaryOp::to_string(UnaryOp::Operator op) {
     }
 }
 
+ActivationFunction UnaryOp::activation() const {
+    switch (op_) {
+    case Relu:
+    case Relu6:
+    case ReluN1To1:
+        return to_activation(op_);
+    default:
+        return ActivationFunction::None;
+    }
+}
+
+ElementwiseEpilogue UnaryOp::to_epilogue(ActivationFunction input_activation) const {
+    if ((op_ != Relu && op_ != Relu6 && op_ != ReluN1To1) ||
+        !is_uniform_quantized_uint8(input()) ||
+        !is_uniform_quantized_uint8(output()) ||
+        !same_bounds(input(), output())) {
+        return {};
+    }
+    // This is implemented with try_requantize, which uses add_uint8.
+    return make_add_epilogue(input()->quantization(), input_activation, 1,
+                             input()->quantization(), 0, output()->quantization());
+}
+
 void UnaryOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
@@ -1940,4 +2090,9 @@ OpPtr OpMutator::visit(std::unique_ptr<OpGroup> op) {
     return make_op<OpGroup>(inputs, outputs, std::move(ops_new));
 }
 
+const char *op_implementation_target() {
+    // All of the ops are compiled for the same target.
+    return tile_conv_filter_uint8_metadata()->target;
+}
+
 }  // namespace hannk
@@ -22,6 +22,22 @@ enum class Padding {
     Valid,
 };
 
+// An elementwise program (see elementwise_program.h) that an op applies to
+// its result before narrowing it to the type of its output, in place of a
+// separate elementwise op that would read the result back from memory.
+// Input 0 of the program is the result, quantized like `quantization` but
+// without its zero point, and input 1 is the op's addend. The result of the
+// program should be quantized like the output of the op, again without its
+// zero point; the op adds the zero point and applies its activation.
+struct ElementwiseEpilogue {
+    HalideBuffer<int16_t, 2> program;
+    QuantizationInfo quantization;
+
+    bool defined() const {
+        return program.data() != nullptr;
+    }
+};
+
 // This is an abstract helper op for elementwise operations.
 class ElementwiseOp : public Op {
 public:
@@ -55,6 +71,19 @@ public:
         : ElementwiseOp({a, b}, {output}), op_(op), activation_(activation) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+    ActivationFunction activation() const {
+        return activation_;
+    }
+
+    // If this op can be computed by an epilogue of the op producing input
+    // input_idx, which has the given activation, return that epilogue. The
+    // addend of the epilogue is the other input, and the fused op should
+    // apply this op's activation. Otherwise, return an undefined epilogue.
+    ElementwiseEpilogue to_epilogue(int input_idx, ActivationFunction input_activation) const;
+
     void execute() override;
 
     std::string name() const override {
@@ -100,6 +129,7 @@ class ConvOp : public Op {
     std::array<int, 2> dilation_;
     Padding padding_;
     ActivationFunction activation_;
+    ElementwiseEpilogue epilogue_;
 
     // calculated in prepare()
     int vector_reduction_ = 0;
@@ -108,12 +138,13 @@ class ConvOp : public Op {
 public:
     ConvOp(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &bias, const TensorPtr &output,
            std::array<int, 2> stride, std::array<int, 2> dilation, Padding padding,
-           ActivationFunction activation)
-        : Op({input, filter, bias}, {output}),
+           ActivationFunction activation, ElementwiseEpilogue epilogue = {}, const TensorPtr &addend = nullptr)
+        : Op(addend ? std::vector<TensorPtr>{input, filter, bias, addend} : std::vector<TensorPtr>{input, filter, bias}, {output}),
           stride_(stride),
           dilation_(dilation),
           padding_(padding),
-          activation_(activation) {
+          activation_(activation),
+          epilogue_(std::move(epilogue)) {
     }
 
     const TensorPtr &filter() const {
@@ -122,6 +153,9 @@ public:
     const TensorPtr &bias() const {
         return Op::input(2);
     }
+    TensorPtr addend() const {
+        return input_count() > 3 ? Op::input(3) : nullptr;
+    }
 
     std::array<int, 2> stride() const {
         return stride_;
@@ -135,6 +169,9 @@ public:
     ActivationFunction activation() const {
         return activation_;
     }
+    const ElementwiseEpilogue &epilogue() const {
+        return epilogue_;
+    }
 
     halide_type_t filter_type() const;
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
@@ -157,6 +194,7 @@ class DepthwiseConv2DOp : public Op {
     std::array<int, 2> dilation_;
     Padding padding_;
     ActivationFunction activation_;
+    ElementwiseEpilogue epilogue_;
 
     // calculated in prepare()
     int channel_alignment_ = 0;
@@ -164,13 +202,15 @@ class DepthwiseConv2DOp : public Op {
 public:
     DepthwiseConv2DOp(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &bias, const TensorPtr &output,
                       int depth_multiplier, std::array<int, 2> stride, std::array<int, 2> dilation,
-                      Padding padding, ActivationFunction activation)
-        : Op({input, filter, bias}, {output}),
+                      Padding padding, ActivationFunction activation,
+                      ElementwiseEpilogue epilogue = {}, const TensorPtr &addend = nullptr)
+        : Op(addend ? std::vector<TensorPtr>{input, filter, bias, addend} : std::vector<TensorPtr>{input, filter, bias}, {output}),
           depth_multiplier_(depth_multiplier),
           stride_(stride),
           dilation_(dilation),
           padding_(padding),
-          activation_(activation) {
+          activation_(activation),
+          epilogue_(std::move(epilogue)) {
     }
 
     int depth_multiplier() const {
@@ -182,6 +222,9 @@ public:
     const TensorPtr &bias() const {
         return Op::input(2);
     }
+    TensorPtr addend() const {
+        return input_count() > 3 ? Op::input(3) : nullptr;
+    }
 
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
@@ -197,6 +240,9 @@ public:
     ActivationFunction activation() const {
         return activation_;
     }
+    const ElementwiseEpilogue &epilogue() const {
+        return epilogue_;
+    }
 
     bool prepare() override;
     void execute() override;
@@ -556,6 +602,19 @@ public:
         : ElementwiseOp({input}, {output}), op_(op) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+
+    // The activation function this op applies, if it is one.
+    ActivationFunction activation() const;
+
+    // If this op can be computed by an epilogue of the op producing its
+    // input, which has the given activation, return that epilogue, which
+    // has no addend. The fused op should apply activation(). Otherwise,
+    // return an undefined epilogue.
+    ElementwiseEpilogue to_epilogue(ActivationFunction input_activation) const;
+
     void execute() override;
 
     std::string name() const override {
@@ -705,6 +764,9 @@ protected:
     // clang-format on
 };
 
+// The target the Halide implementations of the ops were compiled for.
+const char *op_implementation_target();
+
 }  // namespace hannk
 
 #endif  // HANNK_OPS_H_
@@ -395,7 +395,8 @@ class PadForOps : public OpMutator {
             auto inputs = op->inputs();
             auto outputs = op->outputs();
             op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->output(),
-                                          op->stride(), op->dilation(), op->padding(), op->activation());
+                                          op->stride(), op->dilation(), op->padding(), op->activation(),
+                                          op->epilogue(), op->addend());
             new_ops.push_back(std::move(op));
 
             return make_prepared_op<OpGroup>(std::move(inputs), std::move(outputs), std::move(new_ops));
@@ -421,7 +422,7 @@ class PadForOps : public OpMutator {
 
             op = make_prepared_op<DepthwiseConv2DOp>(upsampled, op->filter(), op->bias(), op->output(),
                                                      /*depth_multiplier*/ 1, op->stride(), op->dilation(),
-                                                     op->padding(), op->activation());
+                                                     op->padding(), op->activation(), op->epilogue(), op->addend());
         }
 
         // TODO: It might be worth enabling UpsampleChannels to handle padding, and fusing the padding
@@ -439,7 +440,7 @@ class PadForOps : public OpMutator {
                 new_ops.push_back(std::move(padding_op));
                 op = make_prepared_op<DepthwiseConv2DOp>(padding_output, op->filter(), op->bias(), op->output(),
                                                          op->depth_multiplier(), op->stride(), op->dilation(),
-                                                         op->padding(), op->activation());
+                                                         op->padding(), op->activation(), op->epilogue(), op->addend());
             }
 
             auto inputs = op->inputs();
@@ -479,6 +480,115 @@ OpPtr pad_for_ops(OpPtr op) {
 
 namespace {
 
+// Replace elementwise ops that follow a conv or depthwise conv with a copy of
+// the conv that computes the elementwise op in an epilogue, so the result of
+// the conv isn't written to memory and read back. The original conv is left
+// for remove_dead_ops to remove.
+class FuseElementwiseEpilogues : public OpMutator {
+    using OpMutator::visit;
+
+    std::unordered_set<Tensor *> root_outputs_;
+
+    // Returns the conv op that produces t, if it can have an epilogue, and
+    // nothing else uses t.
+    const Op *get_conv_producer(const TensorPtr &t) const {
+        if (root_outputs_.count(t.get()) > 0 ||
+            t->producers().size() != 1 ||
+            t->consumers().size() != 1 ||
+            t->type() != halide_type_of<uint8_t>()) {
+            return nullptr;
+        }
+        const Op *producer = t->producers().front();
+        if (const ConvOp *conv = cast_op<ConvOp>(producer)) {
+            if (!conv->epilogue().defined() && conv->input()->type() == halide_type_of<uint8_t>()) {
+                return conv;
+            }
+        } else if (const DepthwiseConv2DOp *conv = cast_op<DepthwiseConv2DOp>(producer)) {
+            if (!conv->epilogue().defined() && conv->depth_multiplier() == 1) {
+                return conv;
+            }
+        }
+        return nullptr;
+    }
+
+    static ActivationFunction get_activation(const Op *conv) {
+        if (const ConvOp *c = cast_op<ConvOp>(conv)) {
+            return c->activation();
+        } else {
+            return cast_op<DepthwiseConv2DOp>(conv)->activation();
+        }
+    }
+
+    // Make a copy of conv with the given epilogue, writing to output instead.
+    OpPtr make_fused_op(const Op *conv, ElementwiseEpilogue epilogue, const TensorPtr &addend,
+                        const TensorPtr &output, ActivationFunction activation) {
+        std::unique_ptr<Op> fused;
+        if (const ConvOp *c = cast_op<ConvOp>(conv)) {
+            fused = std::make_unique<ConvOp>(c->input(), c->filter(), c->bias(), output,
+                                             c->stride(), c->dilation(), c->padding(), activation,
+                                             std::move(epilogue), addend);
+        } else {
+            const DepthwiseConv2DOp *d = cast_op<DepthwiseConv2DOp>(conv);
+            fused = std::make_unique<DepthwiseConv2DOp>(d->input(), d->filter(), d->bias(), output,
+                                                        d->depth_multiplier(), d->stride(), d->dilation(),
+                                                        d->padding(), activation, std::move(epilogue), addend);
+        }
+        if (!fused->prepare()) {
+            HLOG(ERROR) << "fuse_elementwise_epilogues: new_op " << fused->name() << " failed prepare()";
+            prepare_failed = true;
+        }
+        return fused;
+    }
+
+    OpPtr visit(std::unique_ptr<BinaryOp> op) override {
+        for (int i = 0; i < 2; i++) {
+            const Op *conv = get_conv_producer(op->input(i));
+            if (!conv) {
+                continue;
+            }
+            ElementwiseEpilogue epilogue = op->to_epilogue(i, get_activation(conv));
+            if (epilogue.defined()) {
+                return make_fused_op(conv, std::move(epilogue), op->input(1 - i), op->output(), op->activation());
+            }
+        }
+        return op;
+    }
+
+    OpPtr visit(std::unique_ptr<UnaryOp> op) override {
+        const Op *conv = get_conv_producer(op->input());
+        if (!conv) {
+            return op;
+        }
+        ElementwiseEpilogue epilogue = op->to_epilogue(get_activation(conv));
+        if (epilogue.defined()) {
+            return make_fused_op(conv, std::move(epilogue), nullptr, op->output(), op->activation());
+        }
+        return op;
+    }
+
+public:
+    explicit FuseElementwiseEpilogues(const Op *root) {
+        for (int i = 0; i < root->output_count(); i++) {
+            root_outputs_.insert(root->output(i).get());
+        }
+    }
+
+    bool prepare_failed = false;
+};
+
+}  // namespace
+
+OpPtr fuse_elementwise_epilogues(OpPtr op) {
+    FuseElementwiseEpilogues fuser(op.get());
+    op = fuser.mutate(std::move(op));
+    if (fuser.prepare_failed) {
+        return nullptr;
+    }
+    return op;
+}
+
+namespace {
+
 class FusePadOps : public OpMutator {
     using OpMutator::visit;
 
@@ -548,6 +658,30 @@ bool can_execute_with_all_constant_inputs(const Op *op) {
 class ConstantFolder : public OpMutator {
     using OpMutator::visit;
 
+    WeightCache *cache_;
+
+    OpPtr visit(std::unique_ptr<TileConvFilterOp> op) override {
+        // A tiled filter depends only on the filter and the tiled shape, so
+        // we can use (or keep) a copy of it in the cache.
+        const TensorPtr &output = op->output();
+        if (!cache_ || !can_execute_with_all_constant_inputs(op.get()) || output->is_allocated()) {
+            return visit_leaf(std::move(op));
+        }
+        const uint64_t key = WeightCache::key(op.get());
+        const size_t size = output->buffer().size_in_bytes();
+        const void *cached = cache_->find(key, size);
+        if (cached) {
+            // The cached data is read-only, as is any constant tensor.
+            output->allocate_from_arena_pointer(const_cast<void *>(cached));
+            output->set_constant();
+            return nullptr;
+        }
+        OpPtr result = visit_leaf(std::move(op));
+        assert(result == nullptr);
+        cache_->insert(key, output->buffer().data(), size);
+        return result;
+    }
+
     OpPtr visit_leaf(OpPtr op) override {
         if (can_execute_with_all_constant_inputs(op.get())) {
             // Allocate all the outputs.
@@ -574,12 +708,17 @@ class ConstantFolder : public OpMutator {
             return op;
         }
     }
+
+public:
+    explicit ConstantFolder(WeightCache *cache)
+        : cache_(cache) {
+    }
 };
 
 }  // namespace
 
-OpPtr fold_constants(OpPtr op) {
-    ConstantFolder folder;
+OpPtr fold_constants(OpPtr op, WeightCache *cache) {
+    ConstantFolder folder(cache);
     return folder.mutate(std::move(op));
 }
 
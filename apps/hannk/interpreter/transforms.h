@@ -2,6 +2,7 @@
 #define HANNK_TRANSFORMS_H
 
 #include "interpreter/ops.h"
+#include "interpreter/weight_cache.h"
 
 namespace hannk {
 
@@ -17,9 +18,18 @@ namespace hannk {
 // if any of those calls fail.
 [[nodiscard]] OpPtr pad_for_ops(OpPtr op);
 
+// Replace elementwise ops (currently quantized adds, subtracts, and
+// activations) that consume the result of a conv or depthwise conv, and
+// nothing else does, with a copy of the conv that computes the elementwise
+// op in an epilogue before writing its output. (This should be run after
+// pad_for_ops(), and before in_place().) New ops will have prepare() called
+// on them; this will return nullptr if any of those calls fail.
+[[nodiscard]] OpPtr fuse_elementwise_epilogues(OpPtr op);
+
 // Execute ops that are constant, and mark the results
-// constant as well.
-[[nodiscard]] OpPtr fold_constants(OpPtr op);
+// constant as well. If a cache is given, tiled conv filters
+// are taken from it when possible, and added to it otherwise.
+[[nodiscard]] OpPtr fold_constants(OpPtr op, WeightCache *cache = nullptr);
 
 // Flatten all nested OpGroups into a single OpGroup.
 // TODO: OpGroups that represent subgraphs shouldn't be flattened;
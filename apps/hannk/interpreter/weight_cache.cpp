@@ -0,0 +1,251 @@
+#include "interpreter/weight_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "HalideBuffer.h"  // for HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT
+
+namespace hannk {
+
+namespace {
+
+// The file starts with this, then the byte order mark (to reject files
+// written on a machine of the other endianness), the length of the target
+// string and the string itself (padded to 8 bytes), and the number of
+// entries. Then come the entries (a key, offset and size each), and the
+// data of the entries at the given offsets.
+constexpr char kMagic[8] = {'h', 'a', 'n', 'n', 'k', 'w', 'c', '1'};
+constexpr uint64_t kByteOrderMark = 0x0102030405060708ull;
+
+// The data of each entry is aligned to this, relative to the start of the
+// file (which is page aligned when mapped).
+constexpr size_t kAlignment = (size_t)std::max(HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT, 64);
+
+size_t align_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) / alignment * alignment;
+}
+
+uint64_t hash_combine(uint64_t h, uint64_t x) {
+    return h ^ (x + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+}
+
+uint64_t hash_bytes(uint64_t h, const void *data, size_t size) {
+    // Hash 8 bytes at a time, as this is done for every weight of the model
+    // each time it is prepared.
+    const char *p = static_cast<const char *>(data);
+    const uint64_t k = 0x100000001b3ull;
+    while (size >= sizeof(uint64_t)) {
+        uint64_t x;
+        memcpy(&x, p, sizeof(x));
+        h = (h ^ x) * k;
+        h ^= h >> 29;
+        p += sizeof(x);
+        size -= sizeof(x);
+    }
+    while (size > 0) {
+        h = (h ^ (uint8_t)*p++) * k;
+        size--;
+    }
+    return h;
+}
+
+uint64_t hash_string(uint64_t h, const std::string &s) {
+    return hash_combine(hash_bytes(h, s.data(), s.size()), s.size());
+}
+
+uint64_t hash_tensor_info(uint64_t h, const TensorPtr &t) {
+    if (!t) {
+        return hash_combine(h, 0);
+    }
+    const halide_type_t type = t->type();
+    h = hash_combine(h, ((uint64_t)type.code << 8) | type.bits);
+    for (const Interval &i : t->bounds()) {
+        h = hash_combine(h, (uint32_t)i.min);
+        h = hash_combine(h, (uint32_t)i.max);
+    }
+    const QuantizationInfo &q = t->quantization();
+    h = hash_combine(h, (uint32_t)q.dimension);
+    h = hash_bytes(h, q.scale.data(), q.scale.size() * sizeof(q.scale[0]));
+    h = hash_bytes(h, q.zero.data(), q.zero.size() * sizeof(q.zero[0]));
+    return hash_combine(h, q.scale.size() * 65536 + q.zero.size());
+}
+
+// Reads values from the file, failing (rather than reading out of bounds)
+// if the file is truncated.
+class Reader {
+    const char *data_;
+    size_t size_;
+    size_t pos_ = 0;
+
+public:
+    Reader(const char *data, size_t size)
+        : data_(data), size_(size) {
+    }
+
+    bool read(void *dst, size_t size) {
+        if (size > size_ - pos_) {
+            return false;
+        }
+        memcpy(dst, data_ + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+    bool read(uint64_t *x) {
+        return read(x, sizeof(*x));
+    }
+
+    bool skip_to(size_t pos) {
+        if (pos > size_) {
+            return false;
+        }
+        pos_ = pos;
+        return true;
+    }
+
+    size_t pos() const {
+        return pos_;
+    }
+};
+
+}  // namespace
+
+WeightCache::WeightCache(std::string path, std::string target)
+    : path_(std::move(path)), target_(std::move(target)) {
+    if (std::ifstream(path_).good()) {
+        file_ = std::make_unique<MappedFile>(path_);
+        load();
+    }
+}
+
+void WeightCache::load() {
+    Reader r(file_->data(), file_->size());
+    char magic[sizeof(kMagic)];
+    uint64_t byte_order_mark, target_size;
+    if (!r.read(magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+        !r.read(&byte_order_mark) || byte_order_mark != kByteOrderMark ||
+        !r.read(&target_size) || target_size != target_.size()) {
+        return;
+    }
+    std::string target(target_size, '\0');
+    uint64_t entry_count;
+    if (!r.read(&target[0], target_size) || target != target_ ||
+        !r.skip_to(align_up(r.pos(), sizeof(uint64_t))) ||
+        !r.read(&entry_count)) {
+        return;
+    }
+
+    std::map<uint64_t, Entry> entries;
+    for (uint64_t i = 0; i < entry_count; i++) {
+        uint64_t key, offset, size;
+        if (!r.read(&key) || !r.read(&offset) || !r.read(&size) ||
+            offset > file_->size() || size > file_->size() - offset) {
+            return;
+        }
+        Entry &e = entries[key];
+        e.data = file_->data() + offset;
+        e.size = size;
+    }
+    entries_ = std::move(entries);
+}
+
+/*static*/ uint64_t WeightCache::key(const Op *op) {
+    assert(op->output_count() == 1);
+    uint64_t h = hash_string(0, op->name());
+    for (int i = 0; i < op->input_count(); i++) {
+        const TensorPtr &in = op->input(i);
+        h = hash_tensor_info(h, in);
+        if (in) {
+            const auto &buf = in->buffer();
+            h = hash_bytes(h, buf.data(), buf.size_in_bytes());
+        }
+    }
+    return hash_tensor_info(h, op->output());
+}
+
+const void *WeightCache::find(uint64_t key, size_t size) {
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.size != size ||
+        (uintptr_t)it->second.data % kAlignment != 0) {
+        // (The data may not be aligned if the file couldn't be mapped.)
+        return nullptr;
+    }
+    it->second.used = true;
+    return it->second.data;
+}
+
+void WeightCache::insert(uint64_t key, const void *data, size_t size) {
+    Entry &e = entries_[key];
+    e.data = data;
+    e.size = size;
+    e.used = true;
+    dirty_ = true;
+}
+
+bool WeightCache::save() {
+    std::vector<std::pair<uint64_t, const Entry *>> used;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.used) {
+            used.emplace_back(it->first, &it->second);
+            ++it;
+        } else {
+            it = entries_.erase(it);
+            dirty_ = true;
+        }
+    }
+    if (!dirty_) {
+        return true;
+    }
+
+    // Write a new file and move it into place, so that other processes
+    // (and this one) can keep using the old one.
+    std::string temp_path = path_ + ".tmp";
+#if HANNK_HAS_MMAP
+    temp_path += std::to_string(getpid());
+#endif
+    std::ofstream f(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        return false;
+    }
+    size_t pos = 0;
+    const auto write = [&](const void *data, size_t size) {
+        f.write(static_cast<const char *>(data), size);
+        pos += size;
+    };
+    const auto write_u64 = [&](uint64_t x) {
+        write(&x, sizeof(x));
+    };
+    const auto pad_to = [&](size_t alignment) {
+        static const char zeros[kAlignment] = {0};
+        write(zeros, align_up(pos, alignment) - pos);
+    };
+
+    write(kMagic, sizeof(kMagic));
+    write_u64(kByteOrderMark);
+    write_u64(target_.size());
+    write(target_.data(), target_.size());
+    pad_to(sizeof(uint64_t));
+    write_u64(used.size());
+    size_t offset = align_up(pos + used.size() * 3 * sizeof(uint64_t), kAlignment);
+    for (const auto &it : used) {
+        write_u64(it.first);
+        write_u64(offset);
+        write_u64(it.second->size);
+        offset = align_up(offset + it.second->size, kAlignment);
+    }
+    for (const auto &it : used) {
+        pad_to(kAlignment);
+        write(it.second->data, it.second->size);
+    }
+    f.close();
+    if (!f.good() || std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+}  // namespace hannk
@@ -0,0 +1,67 @@
+#ifndef HANNK_WEIGHT_CACHE_H
+#define HANNK_WEIGHT_CACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "interpreter/ops.h"
+#include "util/file_util.h"
+
+namespace hannk {
+
+// A cache of the constant tensors computed while preparing a model (such as
+// tiled conv filters), kept in a file beside the model. The file is memory
+// mapped, and cached tensors point directly into the mapping, so a later
+// prepare() of the same model doesn't need to compute or allocate them, and
+// processes running the same model share them via the page cache.
+//
+// Entries are keyed by a hash of the op that computes them, including the
+// contents of its (constant) inputs, so a stale entry is never used. The
+// whole file is ignored if it was written for a different target.
+class WeightCache {
+    struct Entry {
+        const void *data = nullptr;
+        size_t size = 0;
+        bool used = false;
+    };
+
+    std::string path_;
+    std::string target_;
+    std::unique_ptr<MappedFile> file_;
+    std::map<uint64_t, Entry> entries_;
+    bool dirty_ = false;
+
+    void load();
+
+public:
+    // Load the cache in the given file, if there is one, and it was written
+    // for the given target.
+    WeightCache(std::string path, std::string target);
+
+    // Compute the key for the (single) output of an op with constant inputs.
+    static uint64_t key(const Op *op);
+
+    // Return the cached data for the given key, or null if there is none of
+    // the given size.
+    const void *find(uint64_t key, size_t size);
+
+    // Add data to the cache. The data must remain valid until save() is
+    // called.
+    void insert(uint64_t key, const void *data, size_t size);
+
+    // If anything was inserted, or some entries weren't used, replace the
+    // file with one containing just the entries found or inserted since it
+    // was loaded. Returns false if the file can't be written.
+    [[nodiscard]] bool save();
+
+    // Not movable or copyable: tensors may point into the mapping.
+    WeightCache(const WeightCache &) = delete;
+    WeightCache &operator=(const WeightCache &) = delete;
+    WeightCache(WeightCache &&) = delete;
+    WeightCache &operator=(WeightCache &&) = delete;
+};
+
+}  // namespace hannk
+
+#endif  // HANNK_WEIGHT_CACHE_H
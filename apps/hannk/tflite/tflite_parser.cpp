@@ -20,12 +20,14 @@ tflite::BuiltinOperator get_builtin_code(const tflite::OperatorCode *op_code) {
 
 class Parser {
     const tflite::Model *model_;
+    int batch_size_;
     std::vector<TensorPtr> tensors_;
     std::vector<std::unique_ptr<OpGroup>> subgraphs_;
 
 public:
-    explicit Parser(const tflite::Model *model)
-        : model_(model) {
+    Parser(const tflite::Model *model, int batch_size)
+        : model_(model), batch_size_(batch_size) {
+        HCHECK(batch_size_ >= 1);
     }
 
     static ActivationFunction parse_activation_function(
@@ -132,6 +134,12 @@ public:
             }
         }
 
+        // The batch is the outermost dimension of the activations; constant
+        // tensors (weights) are shared by every element of the batch.
+        if (shape.size() >= 2) {
+            shape.back() *= batch_size_;
+        }
+
         // Create an "unallocated" Buffer, which points to null.
         HalideBuffer<void> buffer(type, nullptr, shape);
         return std::make_shared<Tensor>(t->name()->str(), std::move(buffer), std::move(quantization));
@@ -262,6 +270,24 @@ public:
         return make_op<PadOp>(input, padding, output);
     }
 
+    // Scale the batch in a constant shape tensor by the batch size. Shapes
+    // computed at runtime already include it.
+    TensorPtr batch_shape(const TensorPtr &shape) {
+        if (batch_size_ == 1 || !shape || !shape->is_constant() || shape->rank() != 1) {
+            return shape;
+        }
+        const auto &shape_buf = shape->buffer<const int32_t>();
+        if (shape_buf.dim(0).extent() < 2 || shape_buf(0) == -1) {
+            return shape;
+        }
+        HalideBuffer<int32_t, 1> shape_data(shape_buf.dim(0).extent());
+        shape_data.copy_from(shape_buf);
+        shape_data(0) *= batch_size_;
+        TensorPtr result = std::make_shared<Tensor>(shape->name(), shape_data);
+        result->set_constant();
+        return result;
+    }
+
     OpPtr parse_reshape(const tflite::Operator *op) {
         const tflite::ReshapeOptions *options =
             op->builtin_options_as_ReshapeOptions();
@@ -281,7 +307,7 @@ public:
             shape_tensor = std::make_shared<Tensor>(input->name() + "_shape", shape_data);
             shape_tensor->set_constant();
         }
-        return make_op<ReshapeOp>(input, shape_tensor, output);
+        return make_op<ReshapeOp>(input, batch_shape(shape_tensor), output);
     }
 
     OpPtr parse_shape(const tflite::Operator *op) {
@@ -555,12 +581,12 @@ public:
 
 }  // namespace
 
-std::unique_ptr<OpGroup> parse_tflite_model(const tflite::Model *model) {
-    return Parser(model).parse();
+std::unique_ptr<OpGroup> parse_tflite_model(const tflite::Model *model, int batch_size) {
+    return Parser(model, batch_size).parse();
 }
 
-std::unique_ptr<OpGroup> parse_tflite_model_from_buffer(const void *buffer) {
-    return parse_tflite_model(tflite::GetModel(buffer));
+std::unique_ptr<OpGroup> parse_tflite_model_from_buffer(const void *buffer, int batch_size) {
+    return parse_tflite_model(tflite::GetModel(buffer), batch_size);
 }
 
 }  // namespace hannk
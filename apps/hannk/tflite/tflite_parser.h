@@ -14,11 +14,19 @@ struct Model;
 namespace hannk {
 
 // Translate from a tflite::Model to our own model representation.
-std::unique_ptr<OpGroup> parse_tflite_model(const tflite::Model *model);
+//
+// If batch_size is greater than 1, the outermost (batch) dimension of every
+// non-constant tensor of rank 2 or more is multiplied by it, so each execution
+// of the model runs batch_size inferences at once; the caller coalesces the
+// inputs of pending requests along that dimension. This requires that the
+// batch stays outermost through the model, and that no op combines elements
+// of the batch. Constant tensors point into the tflite::Model, so models
+// parsed from the same buffer (at any batch size) share their weights.
+std::unique_ptr<OpGroup> parse_tflite_model(const tflite::Model *model, int batch_size = 1);
 
 // Call tflite::GetModel() and then call parse_tflite_model() on the result --
 // avoids the need for client to include any tflite-specific files.
-std::unique_ptr<OpGroup> parse_tflite_model_from_buffer(const void *model);
+std::unique_ptr<OpGroup> parse_tflite_model_from_buffer(const void *model, int batch_size = 1);
 
 }  // namespace hannk
 
@@ -5,6 +5,14 @@
 #include <memory>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HANNK_HAS_MMAP 1
+#endif
+
 #include "util/error_util.h"
 
 namespace hannk {
@@ -25,6 +33,63 @@ inline std::vector<char> read_entire_file(const std::string &filename) {
     return result;
 }
 
+// A read-only view of the contents of a file. Where possible, the file is
+// memory mapped rather than read, so its pages are only read as they are
+// used, and are shared (via the page cache) with any other process that
+// maps the same file.
+class MappedFile {
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    // Used if the file can't be mapped.
+    std::vector<char> contents_;
+
+public:
+    explicit MappedFile(const std::string &filename) {
+#if HANNK_HAS_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        HCHECK(fd >= 0) << "Unable to open file: " << filename;
+        struct stat st;
+        HCHECK(fstat(fd, &st) == 0) << "Unable to stat file: " << filename;
+        size_ = st.st_size;
+        if (size_ > 0) {
+            void *mapped = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data_ = static_cast<const char *>(mapped);
+            }
+        }
+        close(fd);
+        if (data_ != nullptr || size_ == 0) {
+            return;
+        }
+#endif
+        contents_ = read_entire_file(filename);
+        data_ = contents_.data();
+        size_ = contents_.size();
+    }
+
+    ~MappedFile() {
+#if HANNK_HAS_MMAP
+        if (data_ != nullptr && contents_.empty()) {
+            munmap(const_cast<char *>(data_), size_);
+        }
+#endif
+    }
+
+    const char *data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Not movable or copyable: tensors may point into the mapping.
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&) = delete;
+    MappedFile &operator=(MappedFile &&) = delete;
+};
+
 }  // namespace hannk
 
 #endif  // HANNK_FILE_UTIL_H
@@ -406,6 +406,7 @@ ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer
 
     InterpreterOptions options;
     options.verbosity = verbosity;
+    options.inter_op_parallelism = hannk_inter_op_parallelism;
     Interpreter interpreter(std::move(model), std::move(options));
     if (!interpreter.prepare()) {
         std::cerr << "hannk::Interpreter::prepare() failed\n";
@@ -568,6 +569,10 @@ int ModelRunner::parse_flags(int argc, char **argv, std::vector<std::string> &fi
              this->external_delegate_path = value;
              return 0;
          }},
+        {"hannk_inter_op_parallelism", [this](const std::string &value) {
+             this->hannk_inter_op_parallelism = std::stoi(value) != 0;
+             return 0;
+         }},
         {"keep_going", [this](const std::string &value) {
              this->keep_going = std::stoi(value) != 0;
              return 0;
@@ -0,0 +1,43 @@
+#!/bin/bash
+#
+# Time building an app's static library with and without the
+# split_codegen target feature, and check that the split library is the
+# same from one build to the next. Run from the app's directory, e.g.
+#
+#   bash ../support/time_split_codegen.sh camera_pipe.a
+#   bash ../support/time_split_codegen.sh resnet50.a
+#
+# $1 = the static library, as named by the app's Makefile
+# HL_TARGET (default host) is the target to build for, and
+# HL_COMPILE_THREADS limits the threads used, as usual.
+
+set -euo pipefail
+
+LIB=$1
+BIN=${BIN:-bin}
+TARGET=${HL_TARGET:-host}
+
+# Build the generator first, so that it isn't part of the timing.
+make "${BIN}/${TARGET}/${LIB}" > /dev/null
+
+time_build() {
+    rm -f "${BIN}/$1/${LIB}"
+    local start end
+    start=$(date +%s%N)
+    make "${BIN}/$1/${LIB}" > /dev/null
+    end=$(date +%s%N)
+    echo "$1: $(((end - start) / 1000000)) ms"
+}
+
+time_build "${TARGET}"
+time_build "${TARGET}-split_codegen"
+
+cp "${BIN}/${TARGET}-split_codegen/${LIB}" "${BIN}/${TARGET}-split_codegen/${LIB}.first"
+time_build "${TARGET}-split_codegen"
+if cmp -s "${BIN}/${TARGET}-split_codegen/${LIB}" "${BIN}/${TARGET}-split_codegen/${LIB}.first"; then
+    echo "The split library is the same from one build to the next"
+else
+    echo "The split library differs from one build to the next"
+    exit 1
+fi
+rm -f "${BIN}/${TARGET}-split_codegen/${LIB}.first"
@@ -1177,11 +1177,16 @@ function(add_halide_runtime RT)
     # GCD is required by a later Halide library linking to this runtime.
     set(target_list "$<TARGET_GENEX_EVAL:${RT},$<TARGET_PROPERTY:${RT},Halide_RT_TARGETS>>")
 
-    # Remove features that should not be attached to a runtime
+    # Remove features that should not be attached to a runtime. Only whole
+    # features are matched, so that e.g. profile_hardware_counters survives
+    # the removal of profile: a trailing '-' is added so that every feature
+    # is followed by one, and then taken off again.
     # TODO: The fact that removing profile fixes a duplicate symbol linker error on Windows smells like a bug.
+    set(target_list "$<LIST:TRANSFORM,${target_list},APPEND,->")
     set(target_list
-        "$<LIST:TRANSFORM,${target_list},REPLACE,-(user_context|no_asserts|no_bounds_query|no_runtime|profile),>"
+        "$<LIST:TRANSFORM,${target_list},REPLACE,(-(user_context|no_asserts|no_bounds_query|no_runtime|profile))+-,->"
     )
+    set(target_list "$<LIST:TRANSFORM,${target_list},REPLACE,-$,>")
 
     if (is_crosscompiling)
         set(GEN_OUTS "${output_prefix}${ARG_FILE_BASE_NAME}${static_library_extension}")
@@ -1,7 +1,9 @@
 #include "PyBuffer.h"
 
+#include <memory>
 #include <utility>
 
+#include "PyDLPack.h"
 #include "PyFunc.h"
 #include "PyType.h"
 
@@ -270,17 +272,23 @@ py::object buffer_setitem_operator(Buffer<> &buf, const std::vector<int> &pos, c
     return py::object();
 }
 
-// Use an alias class so that if we are created via a py::buffer, we can
-// keep the py::buffer_info class alive for the life of the Buffer<>,
-// ensuring the data isn't collected out from under us.
+// Use an alias class so that if we are created via a py::buffer (or a DLPack
+// tensor), we can keep the py::buffer_info class (or the tensor) alive for the
+// life of the Buffer<>, ensuring the data isn't collected out from under us.
 class PyBuffer : public Buffer<> {
     py::buffer_info info;
+    std::shared_ptr<DLManagedTensor> dl_tensor;
 
     PyBuffer(py::buffer_info &&info, const std::string &name, bool reverse_axes)
         : Buffer<>(pybufferinfo_to_halidebuffer(info, reverse_axes), name),
           info(std::move(info)) {
     }
 
+    PyBuffer(std::shared_ptr<DLManagedTensor> &&dl_tensor, const std::string &name, bool reverse_axes)
+        : Buffer<>(dltensor_to_halidebuffer(dl_tensor->dl_tensor, reverse_axes), name),
+          info(), dl_tensor(std::move(dl_tensor)) {
+    }
+
 public:
     PyBuffer()
         : Buffer<>(), info() {
@@ -308,6 +316,14 @@ public:
         this->set_host_dirty();
     }
 
+    // Takes ownership of the tensor in a DLPack capsule, which is zero-copy
+    // like the py::buffer case above.
+    PyBuffer(const py::capsule &capsule, const std::string &name, bool reverse_axes)
+        : PyBuffer(std::shared_ptr<DLManagedTensor>(take_dlpack_tensor(capsule), release_dlpack_tensor),
+                   name, reverse_axes) {
+        this->set_host_dirty();
+    }
+
     ~PyBuffer() override = default;
 };
 
@@ -383,6 +399,45 @@ void define_buffer(py::module &m) {
             // than routing through the axis-reversing buffer-protocol path.
             .def(py::init_alias<py::buffer, const std::string &, bool>(), py::arg("buffer"), py::arg("name") = "", py::arg("reverse_axes") = true)
 
+            // Wrap the tensor in a DLPack capsule (e.g. from torch.utils.dlpack.to_dlpack()),
+            // sharing its storage. As with buffer-like objects, reverse_axes = True by default.
+            .def(py::init_alias<py::capsule, const std::string &, bool>(), py::arg("capsule"), py::arg("name") = "", py::arg("reverse_axes") = true)
+
+            // Wrap any object that supports DLPack (a PyTorch or JAX array, a NumPy ndarray, ...),
+            // sharing its storage.
+            .def_static(
+                "from_dlpack", [](const py::object &obj, const std::string &name, bool reverse_axes) -> py::object {
+                    py::object capsule = obj;
+                    if (!PyCapsule_CheckExact(obj.ptr())) {
+                        capsule = obj.attr("__dlpack__")();
+                    }
+                    return py::type::of<Buffer<>>()(capsule, name, reverse_axes);
+                },
+                py::arg("obj"), py::arg("name") = "", py::arg("reverse_axes") = true)
+
+            // The DLPack protocol, so that (e.g.) torch.from_dlpack() and numpy.from_dlpack()
+            // can share this Buffer's storage. Like the buffer protocol, this reverses the axes.
+            .def(
+                "__dlpack__", [](Buffer<> &b, const py::object &stream, const py::object &max_version, const py::object &dl_device, const py::object &copy) -> py::capsule {
+                    if (!dl_device.is_none() && !dl_device.equal(py::make_tuple((int)kDLCPU, 0))) {
+                        throw py::buffer_error("Buffers can only be exported to DLPack on the CPU.");
+                    }
+                    if (b.device_dirty()) {
+                        b.copy_to_host(nullptr);
+                    }
+                    if (!copy.is_none() && copy.cast<bool>()) {
+                        Buffer<> c = b.copy();
+                        return halidebuffer_to_dlpack_capsule(c, py::cast(c), /*reverse_axes*/ true);
+                    }
+                    // py::cast(b) ensures that `b` outlives the consumer's use of its storage.
+                    return halidebuffer_to_dlpack_capsule(b, py::cast(b), /*reverse_axes*/ true);
+                },
+                py::arg("stream") = py::none(), py::kw_only(), py::arg("max_version") = py::none(),
+                py::arg("dl_device") = py::none(), py::arg("copy") = py::none())
+            .def("__dlpack_device__", [](Buffer<> &b) -> py::tuple {
+                return py::make_tuple((int)kDLCPU, 0);
+            })
+
             .def(py::init([](Type type, const std::vector<int> &sizes, const std::string &name) -> Buffer<> {
                      return Buffer<>(type, sizes, name);
                  }),
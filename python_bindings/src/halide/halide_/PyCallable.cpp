@@ -1,6 +1,7 @@
 #include "PyCallable.h"
 
 #include "PyBuffer.h"
+#include "PyDLPack.h"
 
 #define TYPED_ALLOCA(TYPE, COUNT) ((TYPE *)alloca(sizeof(TYPE) * (COUNT)))
 
@@ -36,6 +37,25 @@ struct HBufArray {
     }
 };
 
+// The DLPack tensors taken from the arguments of a call, which we must release
+// once the call is done.
+struct DLTensorArray {
+    const size_t count;
+    DLManagedTensor **tensors;
+
+    explicit DLTensorArray(size_t count, void *storage)
+        : count(count), tensors((DLManagedTensor **)storage) {
+        _halide_user_assert(storage);
+        memset(tensors, 0, sizeof(DLManagedTensor *) * count);
+    }
+
+    ~DLTensorArray() {
+        for (size_t i = 0; i < count; i++) {
+            release_dlpack_tensor(tensors[i]);
+        }
+    }
+};
+
 template<typename T>
 T cast_to(const py::handle &h) {
     // We want to ensure that the error thrown is one that will be translated
@@ -62,9 +82,10 @@ public:
         const void **argv = TYPED_ALLOCA(const void *, argc);
         halide_scalar_value_t *scalar_storage = TYPED_ALLOCA(halide_scalar_value_t, argc);
         HBufArray buffers(argc, TYPED_ALLOCA(HalideBuffer, argc));
+        DLTensorArray dl_tensors(argc, TYPED_ALLOCA(DLManagedTensor *, argc));
         Callable::QuickCallCheckInfo *cci = TYPED_ALLOCA(Callable::QuickCallCheckInfo, argc);
 
-        _halide_user_assert(argv && scalar_storage && buffers.buffers && cci) << "alloca failure";
+        _halide_user_assert(argv && scalar_storage && buffers.buffers && dl_tensors.tensors && cci) << "alloca failure";
 
         // Clear argv to all zero so we can use it to validate that all fields are
         // set properly when using kwargs -- a well-formed call will never have any
@@ -81,7 +102,7 @@ public:
         argv[0] = &scalar_storage[0];
         cci[0] = Callable::make_ucon_qcci();
 
-        const auto define_one_arg = [&argv, &scalar_storage, &buffers, &cci](const Argument &c_arg, py::handle value, size_t slot) {
+        const auto define_one_arg = [&argv, &scalar_storage, &buffers, &dl_tensors, &cci](const Argument &c_arg, py::handle value, size_t slot) {
             if (c_arg.is_buffer()) {
                 halide_buffer_t *raw_buffer;
                 if (py::isinstance<Halide::Buffer<>>(value)) {
@@ -93,6 +114,20 @@ public:
                     // Do not reverse axes.
                     auto b = cast_to<Halide::Buffer<>>(value);
                     raw_buffer = b.raw_buffer();
+                } else if (!PyObject_CheckBuffer(value.ptr()) && is_dlpack_object(value)) {
+                    // A DLPack capsule, or an object that can make one (e.g. a PyTorch
+                    // tensor). We own the tensor until the call is done. As with the
+                    // buffer protocol, the convention is to always reverse axes.
+                    constexpr bool reverse_axes = true;
+                    try {
+                        dl_tensors.tensors[slot] = take_dlpack_tensor(value);
+                        buffers.buffers[slot] =
+                            dltensor_to_halidebuffer<void, AnyDims, MaxFastDimensions>(
+                                dl_tensors.tensors[slot]->dl_tensor, reverse_axes);
+                    } catch (const std::exception &e) {
+                        throw Halide::Error(e.what());
+                    }
+                    raw_buffer = buffers.buffers[slot].raw_buffer();
                 } else {
                     // If it's a buffer-protocol object (e.g. a NumPy array), the convention
                     // is to always reverse axes.
@@ -0,0 +1,151 @@
+#include "PyDLPack.h"
+
+namespace Halide {
+namespace PythonBindings {
+
+namespace {
+
+// The names DLPack gives to capsules before and after they are consumed.
+constexpr const char *kDLTensorName = "dltensor";
+constexpr const char *kUsedDLTensorName = "used_dltensor";
+
+// The state of a DLManagedTensor exported from a Buffer.
+struct DLPackExport {
+    DLManagedTensor managed;
+    py::object owner;
+    std::vector<int64_t> shape, strides;
+};
+
+void delete_dlpack_export(DLManagedTensor *t) {
+    // The consumer may release the tensor from any thread.
+    py::gil_scoped_acquire gil;
+    delete static_cast<DLPackExport *>(t->manager_ctx);
+}
+
+void dlpack_capsule_destructor(PyObject *capsule) {
+    // If the capsule was never consumed, the tensor is still ours to release.
+    if (PyCapsule_IsValid(capsule, kDLTensorName)) {
+        auto *t = static_cast<DLManagedTensor *>(PyCapsule_GetPointer(capsule, kDLTensorName));
+        release_dlpack_tensor(t);
+    }
+}
+
+DLDataType type_to_dldatatype(const Type &type) {
+    if (type.is_bool()) {
+        return {kDLBool, 8, 1};
+    } else if (type.is_bfloat()) {
+        return {kDLBfloat, (uint8_t)type.bits(), 1};
+    } else if (type.is_float()) {
+        return {kDLFloat, (uint8_t)type.bits(), 1};
+    } else if (type.is_int()) {
+        return {kDLInt, (uint8_t)type.bits(), 1};
+    } else if (type.is_uint()) {
+        return {kDLUInt, (uint8_t)type.bits(), 1};
+    }
+    throw py::value_error("Unsupported Buffer<> type.");
+    return DLDataType();
+}
+
+}  // namespace
+
+Type dldatatype_to_type(const DLDataType &dtype) {
+    if (dtype.lanes == 1) {
+        const int bits = dtype.bits;
+        switch (dtype.code) {
+        case kDLInt:
+            if (bits == 8 || bits == 16 || bits == 32 || bits == 64) {
+                return Int(bits);
+            }
+            break;
+        case kDLUInt:
+            if (bits == 8 || bits == 16 || bits == 32 || bits == 64) {
+                return UInt(bits);
+            }
+            break;
+        case kDLFloat:
+            if (bits == 16 || bits == 32 || bits == 64) {
+                return Float(bits);
+            }
+            break;
+        case kDLBfloat:
+            if (bits == 16) {
+                return BFloat(bits);
+            }
+            break;
+        case kDLBool:
+            if (bits == 8) {
+                return Bool();
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    throw py::value_error("Unsupported DLPack data type.");
+    return Type();
+}
+
+bool is_dlpack_object(const py::handle &obj) {
+    return PyCapsule_CheckExact(obj.ptr()) || py::hasattr(obj, "__dlpack__");
+}
+
+DLManagedTensor *take_dlpack_tensor(const py::handle &obj) {
+    py::object capsule = py::reinterpret_borrow<py::object>(obj);
+    if (!PyCapsule_CheckExact(capsule.ptr())) {
+        capsule = capsule.attr("__dlpack__")();
+    }
+    auto *t = static_cast<DLManagedTensor *>(PyCapsule_GetPointer(capsule.ptr(), kDLTensorName));
+    if (t == nullptr) {
+        PyErr_Clear();
+        throw py::value_error("Expected a DLPack capsule that has not already been consumed.");
+    }
+    if (PyCapsule_SetName(capsule.ptr(), kUsedDLTensorName) != 0) {
+        throw py::error_already_set();
+    }
+    return t;
+}
+
+void release_dlpack_tensor(DLManagedTensor *t) {
+    if (t != nullptr && t->deleter != nullptr) {
+        t->deleter(t);
+    }
+}
+
+py::capsule halidebuffer_to_dlpack_capsule(const Buffer<> &b, py::object owner, bool reverse_axes) {
+    if (b.data() == nullptr) {
+        throw py::value_error("Cannot convert a Buffer<> with null host ptr to a DLPack tensor.");
+    }
+
+    auto *e = new DLPackExport;
+    e->owner = std::move(owner);
+
+    const int d = b.dimensions();
+    e->shape.resize(d);
+    e->strides.resize(d);
+    for (int i = 0; i < d; i++) {
+        const int dst_axis = reverse_axes ? (d - i - 1) : i;
+        e->shape[dst_axis] = b.raw_buffer()->dim[i].extent;
+        e->strides[dst_axis] = b.raw_buffer()->dim[i].stride;
+    }
+
+    DLTensor &t = e->managed.dl_tensor;
+    t.data = b.data();
+    t.device = {kDLCPU, 0};
+    t.ndim = d;
+    try {
+        t.dtype = type_to_dldatatype(b.type());
+    } catch (...) {
+        delete e;
+        throw;
+    }
+    t.shape = e->shape.data();
+    t.strides = e->strides.data();
+    t.byte_offset = 0;
+    e->managed.manager_ctx = e;
+    e->managed.deleter = delete_dlpack_export;
+
+    return py::capsule(&e->managed, kDLTensorName, dlpack_capsule_destructor);
+}
+
+}  // namespace PythonBindings
+}  // namespace Halide
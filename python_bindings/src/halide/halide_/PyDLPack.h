@@ -0,0 +1,102 @@
+#ifndef HALIDE_PYTHON_BINDINGS_PYDLPACK_H
+#define HALIDE_PYTHON_BINDINGS_PYDLPACK_H
+
+#include "PyHalide.h"
+
+namespace Halide {
+namespace PythonBindings {
+
+// The parts of the (unversioned) DLPack ABI that we use; see
+// https://dmlc.github.io/dlpack/latest/c_api.html
+enum DLDeviceType : int32_t {
+    kDLCPU = 1,
+    kDLCUDAHost = 3,
+    kDLROCMHost = 11,
+    kDLCUDAManaged = 13,
+};
+
+enum DLDataTypeCode : uint8_t {
+    kDLInt = 0,
+    kDLUInt = 1,
+    kDLFloat = 2,
+    kDLBfloat = 4,
+    kDLBool = 6,
+};
+
+struct DLDevice {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DLDataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct DLTensor {
+    void *data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t *shape;
+    int64_t *strides;  // In elements; null means compact and row-major.
+    uint64_t byte_offset;
+};
+
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensor *self);
+};
+
+// Return true if the object is a DLPack capsule, or has a __dlpack__ method.
+bool is_dlpack_object(const py::handle &obj);
+
+// Take ownership of the tensor in a DLPack capsule, or in the capsule
+// returned by the __dlpack__ method of the given object. The capsule is
+// marked as consumed. The tensor must be released with
+// release_dlpack_tensor().
+DLManagedTensor *take_dlpack_tensor(const py::handle &obj);
+
+void release_dlpack_tensor(DLManagedTensor *t);
+
+// Make a DLPack capsule that views the host memory of the given Buffer,
+// keeping owner alive until the consumer is done with it.
+py::capsule halidebuffer_to_dlpack_capsule(const Buffer<> &b, py::object owner, bool reverse_axes);
+
+Type dldatatype_to_type(const DLDataType &dtype);
+
+template<typename T = void,
+         int Dims = AnyDims,
+         int InClassDimStorage = (Dims == AnyDims ? 4 : std::max(Dims, 1))>
+Halide::Runtime::Buffer<T, Dims, InClassDimStorage> dltensor_to_halidebuffer(const DLTensor &t, bool reverse_axes) {
+    const int32_t device_type = t.device.device_type;
+    if (device_type != kDLCPU && device_type != kDLCUDAHost &&
+        device_type != kDLROCMHost && device_type != kDLCUDAManaged) {
+        throw py::value_error("Only DLPack tensors in host memory are supported.");
+    }
+    const Type type = dldatatype_to_type(t.dtype);
+    halide_dimension_t *dims = (halide_dimension_t *)alloca(t.ndim * sizeof(halide_dimension_t));
+    _halide_user_assert(t.ndim == 0 || dims);
+    int64_t dense_stride = 1;
+    for (int i = t.ndim - 1; i >= 0; i--) {
+        const int64_t extent = t.shape[i];
+        const int64_t elem_stride = t.strides ? t.strides[i] : dense_stride;
+        dense_stride *= extent;
+        if (extent < 0 || extent > INT_MAX || elem_stride < INT_MIN || elem_stride > INT_MAX) {
+            throw py::value_error("Out of range dimensions in buffer conversion.");
+        }
+        // Reverse axes if requested.
+        // DLPack, like numpy, is row-major (most rapidly varying comes last).
+        const int dst_axis = reverse_axes ? (t.ndim - i - 1) : i;
+        dims[dst_axis] = {0, (int32_t)extent, (int32_t)elem_stride};
+    }
+    void *data = (uint8_t *)t.data + t.byte_offset;
+    return Halide::Runtime::Buffer<T, Dims, InClassDimStorage>(type.to_abi(), data, (int)t.ndim, dims);
+}
+
+}  // namespace PythonBindings
+}  // namespace Halide
+
+#endif  // HALIDE_PYTHON_BINDINGS_PYDLPACK_H
@@ -244,6 +244,10 @@ void define_enums(py::module &m) {
         .value("HLSL_SM67", Target::Feature::HLSL_SM67)
         .value("HLSL_SM68", Target::Feature::HLSL_SM68)
         .value("HLSL_SM69", Target::Feature::HLSL_SM69)
+        .value("StaticMemoryPlan", Target::Feature::StaticMemoryPlan)
+        .value("ProfileHardwareCounters", Target::Feature::ProfileHardwareCounters)
+        .value("SplitCodegen", Target::Feature::SplitCodegen)
+        .value("BatchEntryPoint", Target::Feature::BatchEntryPoint)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
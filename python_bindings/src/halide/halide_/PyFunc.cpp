@@ -435,6 +435,12 @@ void define_func(py::module &m) {
             .def("align_storage", &Func::align_storage, py::arg("dim"), py::arg("alignment"))
 
             .def("fold_storage", &Func::fold_storage, py::arg("dim"), py::arg("extent"), py::arg("fold_forward") = true)
+            .def(
+                "carry_storage",
+                [](Func &f, const ImageParam &state) -> Func & {
+                    return f.carry_storage(state);
+                },
+                py::arg("state"))
 
             .def("infer_arguments", &Func::infer_arguments)
 
@@ -0,0 +1,146 @@
+import time
+
+import halide as hl
+import numpy as np
+
+
+def has_numpy_dlpack():
+    # numpy.from_dlpack() and ndarray.__dlpack__() were added in NumPy 1.22.
+    return hasattr(np, "from_dlpack")
+
+
+def test_buffer_to_dlpack():
+    b = hl.Buffer(hl.Int(16), [4, 3, 2])
+    for z in range(2):
+        for y in range(3):
+            for x in range(4):
+                b[x, y, z] = x + y * 10 + z * 100
+
+    assert b.__dlpack_device__() == (1, 0)
+
+    a = np.from_dlpack(b)
+    assert a.dtype == np.int16
+    # Like the buffer protocol, the axes are reversed.
+    assert a.shape == (2, 3, 4)
+    assert a[1, 2, 3] == 123
+
+    # The storage is shared, and outlives the Buffer.
+    b[2, 1, 0] = -1
+    assert a[0, 1, 2] == -1
+    del b
+    assert a[1, 2, 3] == 123
+
+    # Strides are preserved.
+    c = hl.Buffer(hl.Float(32), [5, 4])
+    c.fill(2.0)
+    c.transpose(0, 1)
+    a = np.from_dlpack(c)
+    assert a.shape == (5, 4)
+    assert a.strides == (4, 20)
+    assert np.all(a == 2.0)
+
+    # Unconsumed capsules are released.
+    for _ in range(10):
+        hl.Buffer(hl.UInt(8), [100]).__dlpack__()
+
+
+def test_dlpack_to_buffer():
+    a = np.arange(24, dtype=np.uint16).reshape(2, 3, 4)
+    b = hl.Buffer.from_dlpack(a)
+    assert b.type() == hl.UInt(16)
+    assert b.dimensions() == 3
+    assert b.dim(0).extent() == 4
+    assert b.dim(2).extent() == 2
+    assert b[3, 2, 1] == a[1, 2, 3]
+
+    b = hl.Buffer.from_dlpack(a, reverse_axes=False)
+    assert b.dim(0).extent() == 2
+    assert b[1, 2, 3] == a[1, 2, 3]
+
+    # The storage is shared, and outlives the array.
+    b[0, 0, 0] = 1000
+    assert a[0, 0, 0] == 1000
+    del a
+    assert b[1, 2, 3] == 23
+
+    # Capsules can be wrapped directly, but only once.
+    a = np.ones((3, 3), dtype=np.float64)[::2, ::2]
+    capsule = a.__dlpack__()
+    b = hl.Buffer(capsule)
+    assert b.dim(0).stride() == 2
+    assert b.dim(1).stride() == 6
+    assert b[1, 1] == 1.0
+    try:
+        hl.Buffer(capsule)
+    except ValueError as e:
+        assert "consumed" in str(e)
+    else:
+        assert False, "Did not see expected exception!"
+
+    # Round trip.
+    c = hl.Buffer(hl.Int(32), [7, 5])
+    c.fill(3)
+    d = hl.Buffer.from_dlpack(c)
+    d[6, 4] = 4
+    assert c[6, 4] == 4
+
+
+def make_callable():
+    x, y = hl.Var("x"), hl.Var("y")
+    input = hl.ImageParam(hl.Float(32), 2, "input")
+    f = hl.Func("f")
+    f[x, y] = input[x, y] * 2.0
+    return f.compile_to_callable([input])
+
+
+def test_callable_dlpack_args():
+    c = make_callable()
+    a = np.arange(12, dtype=np.float32).reshape(3, 4)
+    out = np.zeros((3, 4), dtype=np.float32)
+
+    # Capsules can be passed directly; the axes are reversed as for ndarrays.
+    c(a.__dlpack__(), out.__dlpack__())
+    assert np.array_equal(out, a * 2.0)
+
+    out = np.zeros((3, 4), dtype=np.float32)
+    c(input=a.__dlpack__(), f=out.__dlpack__())
+    assert np.array_equal(out, a * 2.0)
+
+
+def benchmark(samples, iterations, op):
+    best = None
+    for _ in range(samples):
+        start = time.perf_counter()
+        for _ in range(iterations):
+            op()
+        elapsed = (time.perf_counter() - start) / iterations
+        if best is None or elapsed < best:
+            best = elapsed
+    return best
+
+
+def benchmark_call_overhead():
+    # Compare the overhead of a call with tiny buffers passed as ndarrays
+    # (via the buffer protocol), as Halide Buffers, and as DLPack capsules.
+    c = make_callable()
+    a = np.ones((2, 2), dtype=np.float32)
+    out = np.zeros((2, 2), dtype=np.float32)
+    a_buf, out_buf = hl.Buffer(a), hl.Buffer(out)
+
+    t_numpy = benchmark(3, 2000, lambda: c(a, out))
+    t_buffer = benchmark(3, 2000, lambda: c(a_buf, out_buf))
+    t_dlpack = benchmark(3, 2000, lambda: c(a.__dlpack__(), out.__dlpack__()))
+    print(
+        "Per-call overhead: %.2f us with ndarrays, %.2f us with Buffers, %.2f us with DLPack capsules"
+        % (t_numpy * 1e6, t_buffer * 1e6, t_dlpack * 1e6)
+    )
+
+
+if __name__ == "__main__":
+    if not has_numpy_dlpack():
+        print("[SKIP] This version of NumPy doesn't support DLPack.")
+    else:
+        test_buffer_to_dlpack()
+        test_dlpack_to_buffer()
+        test_callable_dlpack_args()
+        benchmark_call_overhead()
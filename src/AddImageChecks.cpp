@@ -5,6 +5,7 @@
 #include "IROperator.h"
 #include "IRVisitor.h"
 #include "Simplify.h"
+#include "StorageFolding.h"
 #include "Substitute.h"
 #include "Target.h"
 
@@ -188,9 +189,44 @@ Stmt add_image_checks_inner(Stmt s,
     // used on host.
     finder(s);
 
-    Scope<Interval> empty_scope;
+    // The region of a buffer the pipeline needs doesn't depend on which
+    // rows of a Func it resumes from the storage of that Func carried
+    // over from the last call (see Func::carry_storage), so leave the
+    // resume rows unbounded.
+    Scope<Interval> resume_rows;
+    for (const auto &p : env) {
+        if (p.second.schedule().carried_storage().defined()) {
+            resume_rows.push(carried_storage_resume_row(p.second), Interval::everything());
+        }
+    }
+
     Stmt sub_stmt = TrimStmtToPartsThatAccessBuffers(bufs)(s);
-    map<string, Box> boxes = boxes_touched(sub_stmt, empty_scope, fb);
+    map<string, Box> boxes = boxes_touched(sub_stmt, resume_rows, fb);
+
+    // The buffers the storage is carried in are not accessed until
+    // storage folding, so add them here. They must be large enough for
+    // the storage and its header, given the region of the Func the
+    // pipeline computes.
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        const Parameter &state = f.schedule().carried_storage();
+        Box touched = state.defined() ? box_touched(s, f.name(), resume_rows, fb) : Box();
+        if (touched.empty()) {
+            continue;
+        }
+        vector<Expr> extents;
+        for (const Interval &i : touched.bounds) {
+            extents.push_back(simplify(i.max - i.min + 1));
+        }
+        FindBuffers::Result r;
+        r.param = state;
+        r.type = state.type();
+        r.dimensions = 1;
+        r.used_on_host = true;
+        bufs[state.name()] = r;
+        Expr state_min = Variable::make(Int(32), state.name() + ".min.0", state);
+        boxes[state.name()] = Box({Interval(state_min, state_min + carried_storage_bytes(f, extents) - 1)});
+    }
 
     // Now iterate through all the buffers, creating a list of lets
     // and a list of asserts.
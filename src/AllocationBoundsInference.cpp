@@ -6,6 +6,7 @@
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Simplify.h"
+#include "StorageFolding.h"
 
 #include <set>
 
@@ -40,8 +41,17 @@ class AllocationInference : public IRMutator {
         Function f = iter->second;
         const vector<string> f_args = f.args();
 
-        Scope<Interval> empty_scope;
-        Box b = box_touched(op->body, op->name, empty_scope, func_bounds);
+        // The storage must hold every value the pipeline needs, not just
+        // the ones it uses to compute the rows of a Func after resuming
+        // from the storage of that Func carried over from the last call
+        // (see Func::carry_storage), so leave the resume rows unbounded.
+        Scope<Interval> resume_rows;
+        for (const auto &p : env) {
+            if (p.second.schedule().carried_storage().defined()) {
+                resume_rows.push(carried_storage_resume_row(p.second), Interval::everything());
+            }
+        }
+        Box b = box_touched(op->body, op->name, resume_rows, func_bounds);
 
         Stmt new_body = mutate(op->body);
         Stmt stmt = op->with(op->bounds, op->condition, new_body);
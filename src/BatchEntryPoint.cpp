@@ -0,0 +1,281 @@
+#include <set>
+
+#include "BatchEntryPoint.h"
+
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+const char *const batch_index_name = "__batch.i";
+const char *const batch_size_name = "__batch_size";
+const char *const new_shape_name = "__batch.new_shape";
+const char *const sizes_name = "__batch.sizes";
+
+// Whether an Expr depends only on the shapes of the buffer arguments and
+// on the scalar arguments, so that it has the same value for any two
+// images in a batch whose buffers have the same shapes.
+class IsShapeOnly : public IRVisitor {
+    const Scope<> &shape_vars;
+    const set<string> &buffers;
+    Scope<> lets;
+
+    using IRVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (!shape_vars.contains(op->name) && !lets.contains(op->name)) {
+            result = false;
+        }
+    }
+
+    void visit(const Load *op) override {
+        result = false;
+    }
+
+    void visit(const Call *op) override {
+        if ((op->name == Call::buffer_get_dimensions ||
+             op->name == Call::buffer_get_min ||
+             op->name == Call::buffer_get_max ||
+             op->name == Call::buffer_get_extent ||
+             op->name == Call::buffer_get_stride ||
+             op->name == Call::buffer_get_type) &&
+            !op->args.empty()) {
+            const Variable *buf = op->args[0].as<Variable>();
+            if (!buf || !buffers.count(buf->name)) {
+                result = false;
+            }
+            for (size_t i = 1; i < op->args.size(); i++) {
+                op->args[i].accept(this);
+            }
+        } else if (!op->is_pure()) {
+            result = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(lets, op->name);
+        op->body.accept(this);
+    }
+
+public:
+    bool result = true;
+
+    IsShapeOnly(const Scope<> &shape_vars, const set<string> &buffers)
+        : shape_vars(shape_vars), buffers(buffers) {
+    }
+};
+
+struct SharedAllocation {
+    string name;
+    // The size in bytes this allocation needs for one image, in terms of
+    // the buffer arguments and scalar arguments only.
+    Expr size;
+};
+
+// Make the checks that depend only on the shapes of the buffers
+// conditional on the shapes having changed since the previous image, and
+// point the heap allocations made once per run at memory shared by the
+// whole batch.
+class ShareAcrossBatch : public IRMutator {
+    // The variables with the same value for any two images of the same
+    // shape.
+    Scope<> shape_vars;
+    const set<string> &buffers;
+    // The enclosing LetStmts that define shape variables, outermost
+    // first.
+    vector<pair<string, Expr>> shape_lets;
+    // The number of enclosing loops, and of enclosing branches on
+    // something other than the shapes.
+    int in_loop = 0, in_branch = 0;
+
+    using IRMutator::visit;
+
+    bool is_shape_only(const Expr &e) const {
+        if (!e.defined()) {
+            return true;
+        }
+        IsShapeOnly check(shape_vars, buffers);
+        e.accept(&check);
+        return check.result;
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        if (!is_shape_only(op->value)) {
+            return IRMutator::visit(op);
+        }
+        ScopedBinding<> bind(shape_vars, op->name);
+        shape_lets.emplace_back(op->name, op->value);
+        Stmt body = mutate(op->body);
+        shape_lets.pop_back();
+        return LetStmt::make(op->name, op->value, body);
+    }
+
+    Stmt visit(const For *op) override {
+        in_loop++;
+        Stmt s = IRMutator::visit(op);
+        in_loop--;
+        return s;
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        bool data_dependent = !is_shape_only(op->condition);
+        in_branch += data_dependent;
+        Stmt s = IRMutator::visit(op);
+        in_branch -= data_dependent;
+        return s;
+    }
+
+    Stmt visit(const AssertStmt *op) override {
+        // An image that reaches this check passed it if the previous
+        // image, which had the same shape, reached it too.
+        if (!in_loop && !in_branch && is_shape_only(op->condition)) {
+            return IfThenElse::make(Variable::make(Bool(), new_shape_name), op);
+        }
+        return op;
+    }
+
+    Stmt visit(const Allocate *op) override {
+        Stmt body = mutate(op->body);
+        bool on_heap = (op->memory_type == MemoryType::Heap ||
+                        (op->memory_type == MemoryType::Auto &&
+                         !op->constant_allocation_size()));
+        bool shareable = (!in_loop && on_heap &&
+                          !op->new_expr.defined() &&
+                          is_shape_only(op->condition));
+        for (const Expr &e : op->extents) {
+            shareable = shareable && is_shape_only(e);
+        }
+        if (!shareable) {
+            return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                  op->condition, body, op->new_expr, op->free_function,
+                                  op->padding);
+        }
+
+        Expr size = make_const(Int(64), 1);
+        for (const Expr &e : op->extents) {
+            size *= max(cast<int64_t>(e), 0);
+        }
+        size = select(op->condition, (size + op->padding) * op->type.bytes(), 0);
+        for (auto it = shape_lets.rbegin(); it != shape_lets.rend(); it++) {
+            size = Let::make(it->first, it->second, size);
+        }
+        shared.push_back({op->name, size});
+
+        // The memory is freed once the whole batch is done.
+        Expr memory = Variable::make(Handle(), op->name + ".batch");
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                              op->condition, body, memory, "halide_device_host_nop_free",
+                              op->padding);
+    }
+
+public:
+    vector<SharedAllocation> shared;
+
+    ShareAcrossBatch(const vector<LoweredArgument> &args, const set<string> &buffers)
+        : buffers(buffers) {
+        for (const LoweredArgument &arg : args) {
+            if (!arg.is_buffer()) {
+                shape_vars.push(arg.name);
+            }
+        }
+    }
+};
+
+}  // namespace
+
+LoweredFunc make_batch_entry_point(const LoweredFunc &main_func) {
+    vector<LoweredArgument> args;
+    set<string> buffers;
+    Expr i = Variable::make(Int(32), batch_index_name);
+    Expr new_shape = (i == 0);
+    Expr non_null = const_true();
+    vector<pair<string, Expr>> get_buffers;
+    for (const LoweredArgument &arg : main_func.args) {
+        if (!arg.is_buffer()) {
+            args.push_back(arg);
+            continue;
+        }
+        string name = arg.name + "_batch";
+        args.emplace_back(name, Argument::InputScalar, type_of<halide_buffer_t **>(), 0, ArgumentEstimates{});
+        buffers.insert(arg.name + ".buffer");
+
+        Expr batch = Variable::make(type_of<halide_buffer_t **>(), name);
+        auto get = [&](const Expr &index) {
+            return Call::make(type_of<halide_buffer_t *>(), "_halide_buffer_batch_get",
+                              {batch, index}, Call::Extern);
+        };
+        get_buffers.emplace_back(arg.name + ".buffer", get(i));
+        Expr same = Call::make(Bool(), "_halide_buffer_same_shape",
+                               {get(i), get(max(i - 1, 0))}, Call::Extern);
+        new_shape = new_shape || !same;
+        non_null = non_null && reinterpret<uint64_t>(Variable::make(type_of<halide_buffer_t *>(), arg.name + ".buffer")) != 0;
+    }
+    args.emplace_back(batch_size_name, Argument::InputScalar, Int(32), 0, ArgumentEstimates{});
+
+    ShareAcrossBatch sharer(main_func.args, buffers);
+    Stmt body = sharer(main_func.body);
+    body = LetStmt::make(new_shape_name, new_shape, body);
+    for (auto it = get_buffers.rbegin(); it != get_buffers.rend(); it++) {
+        body = LetStmt::make(it->first, it->second, body);
+    }
+    Expr batch_size = Variable::make(Int(32), batch_size_name);
+    body = For::make(batch_index_name, 0, batch_size - 1, ForType::Serial,
+                     Partition::Never, DeviceAPI::None, body);
+
+    if (!sharer.shared.empty()) {
+        // Find the largest size each shared allocation needs over the
+        // whole batch, before running any of it.
+        const vector<SharedAllocation> &shared = sharer.shared;
+        Stmt allocate = body;
+        for (size_t j = shared.size(); j > 0; j--) {
+            const string &name = shared[j - 1].name;
+            Expr size = Load::make(Int(64), sizes_name, (int)(j - 1));
+            Expr error = Call::make(Int(32), "halide_error_buffer_allocation_too_large",
+                                    {name, cast<uint64_t>(size), make_const(UInt(64), 0x7fffffff)},
+                                    Call::Extern);
+            allocate = Allocate::make(name + ".batch", UInt(8), MemoryType::Heap,
+                                      {cast<int32_t>(size)}, const_true(), allocate);
+            allocate = Block::make(AssertStmt::make(size <= 0x7fffffff, error), allocate);
+        }
+
+        vector<Stmt> grow;
+        for (size_t j = 0; j < shared.size(); j++) {
+            Expr size = Load::make(Int(64), sizes_name, (int)j);
+            grow.push_back(Store::make(sizes_name, max(size, simplify(shared[j].size)), (int)j));
+        }
+        // A null buffer fails its check before anything is allocated.
+        Stmt find_sizes = IfThenElse::make(non_null, Block::make(grow));
+        for (auto it = get_buffers.rbegin(); it != get_buffers.rend(); it++) {
+            find_sizes = LetStmt::make(it->first, it->second, find_sizes);
+        }
+        find_sizes = For::make(batch_index_name, 0, batch_size - 1, ForType::Serial,
+                               Partition::Never, DeviceAPI::None, find_sizes);
+
+        vector<Stmt> zero;
+        for (size_t j = 0; j < shared.size(); j++) {
+            zero.push_back(Store::make(sizes_name, make_const(Int(64), 0), (int)j));
+        }
+        body = Block::make({Block::make(zero), find_sizes, allocate});
+        body = Allocate::make(sizes_name, Int(64), MemoryType::Stack,
+                              {(int)shared.size()}, const_true(), body);
+    }
+
+    return LoweredFunc(main_func.name + "_batch", args, body, LinkageType::External);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,33 @@
+#ifndef HALIDE_BATCH_ENTRY_POINT_H
+#define HALIDE_BATCH_ENTRY_POINT_H
+
+/** \file
+ * Defines the pass that makes an entry point that runs a pipeline over a
+ * batch of buffers.
+ */
+
+#include "Module.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Make a function named <name>_batch from the main entry point of a
+ * pipeline. It takes the same arguments, except that each buffer argument
+ * <arg> is replaced by an array of buffers named <arg>_batch, and a final
+ * int32 argument __batch_size says how many buffers each array holds. It
+ * runs the body of the pipeline once per index into the arrays, in order,
+ * and returns the first error, if any.
+ *
+ * The checks that depend only on the shapes of the buffers and on the
+ * scalar arguments (not on the host pointers or the contents) are made
+ * only when the shape of some buffer differs from that of the previous
+ * image in the batch. Heap allocations made at most once per run of the
+ * pipeline are instead made once for the whole batch, with the largest
+ * size any of the images needs. Must be run on the body of the main entry
+ * point once it is complete, i.e. after lower_parallel_tasks. */
+LoweredFunc make_batch_entry_point(const LoweredFunc &main_func);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,4 +1,12 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
 
 #include "Argument.h"
 #include "Callable.h"
@@ -9,6 +17,190 @@ using namespace Halide::Internal;
 
 namespace Halide {
 
+namespace {
+
+// Compiles, and dispatches calls to, variants of a Callable specialized to
+// the shapes of the buffers it is most often called with.
+struct ShapeSpecializer {
+    std::function<Callable(const std::vector<const halide_buffer_t *> &, const std::vector<int> &)> compile_variant;
+
+    // The indices in argv of the buffer arguments.
+    std::vector<size_t> buffer_args;
+
+    int min_calls, max_variants;
+
+    // Stop counting calls with new shapes once this many have been seen.
+    static constexpr size_t max_shapes_tracked = 1024;
+
+    struct Variant {
+        int calls = 0;
+        bool compiling = false;
+        Callable callable;
+    };
+
+    struct KeyHash {
+        size_t operator()(const std::vector<int64_t> &key) const {
+            uint64_t h = 14695981039346656037ULL;
+            for (int64_t k : key) {
+                h = (h ^ (uint64_t)k) * 1099511628211ULL;
+            }
+            return (size_t)h;
+        }
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::vector<int64_t>, Variant, KeyHash> variants;
+    int num_compiled = 0, num_compiling = 0;
+
+    // Once no more variants can be compiled, the finished ones are
+    // published here, and calls look them up without taking the lock.
+    struct FinishedVariant {
+        std::vector<int64_t> key;
+        Callable callable;
+    };
+    std::unique_ptr<const std::vector<FinishedVariant>> finished_storage;
+    std::atomic<const std::vector<FinishedVariant> *> finished{nullptr};
+
+    // The largest power of two, up to 64, that divides the host pointer.
+    static int host_alignment(const halide_buffer_t *b) {
+        int alignment = 64;
+        while (alignment > 1 && ((uintptr_t)b->host % alignment) != 0) {
+            alignment /= 2;
+        }
+        return alignment;
+    }
+
+    // Describe the shapes of the buffer arguments. Returns false if any
+    // of them is a bounds query, which the generic code handles.
+    bool shape_key(const void *const *argv, std::vector<int64_t> *key) const {
+        for (size_t i : buffer_args) {
+            const halide_buffer_t *b = (const halide_buffer_t *)argv[i];
+            if (b == nullptr || b->host == nullptr) {
+                return false;
+            }
+            key->push_back(b->dimensions);
+            for (int d = 0; d < b->dimensions; d++) {
+                key->push_back(b->dim[d].extent);
+                key->push_back(b->dim[d].stride);
+            }
+            key->push_back(host_alignment(b));
+        }
+        return true;
+    }
+
+    // Does a key made by shape_key describe the buffers in argv? Doesn't
+    // allocate, unlike building a key to compare.
+    bool shape_matches(const std::vector<int64_t> &key, const void *const *argv) const {
+        size_t j = 0;
+        for (size_t i : buffer_args) {
+            const halide_buffer_t *b = (const halide_buffer_t *)argv[i];
+            if (b == nullptr || b->host == nullptr || key[j++] != b->dimensions) {
+                return false;
+            }
+            for (int d = 0; d < b->dimensions; d++) {
+                if (key[j++] != b->dim[d].extent ||
+                    key[j++] != b->dim[d].stride) {
+                    return false;
+                }
+            }
+            if (key[j++] != host_alignment(b)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Publish the finished variants if no more can be compiled. Called
+    // with the lock held.
+    void maybe_publish_finished() {
+        if (num_compiled < max_variants || num_compiling > 0 || finished_storage) {
+            return;
+        }
+        auto done = std::make_unique<std::vector<FinishedVariant>>();
+        for (const auto &[key, v] : variants) {
+            if (v.callable.defined()) {
+                done->push_back({key, v.callable});
+            }
+        }
+        finished_storage = std::move(done);
+        finished.store(finished_storage.get(), std::memory_order_release);
+    }
+
+    // Return the variant to use for a call, if there is one, compiling it
+    // if the shape has now been seen often enough.
+    Callable variant_for(const void *const *argv) {
+        if (const auto *done = finished.load(std::memory_order_acquire)) {
+            for (const FinishedVariant &f : *done) {
+                if (shape_matches(f.key, argv)) {
+                    return f.callable;
+                }
+            }
+            return Callable();
+        }
+
+        std::vector<int64_t> key;
+        key.reserve(buffer_args.size() * 10);
+        if (!shape_key(argv, &key)) {
+            return Callable();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            maybe_publish_finished();
+            auto it = variants.find(key);
+            if (it == variants.end()) {
+                if (variants.size() >= max_shapes_tracked) {
+                    return Callable();
+                }
+                it = variants.emplace(key, Variant()).first;
+            }
+            Variant &v = it->second;
+            if (v.callable.defined() || v.compiling || num_compiled >= max_variants ||
+                ++v.calls < min_calls) {
+                return v.callable;
+            }
+            // Compile it without holding the lock. Calls with this shape
+            // use the generic code until it's ready.
+            v.compiling = true;
+            num_compiled++;
+            num_compiling++;
+        }
+
+        // If the compile fails, give the slot back, and only try this
+        // shape again once it has been seen min_calls more times.
+        struct CompileGuard {
+            ShapeSpecializer *self;
+            const std::vector<int64_t> &key;
+            Callable callable;
+            ~CompileGuard() {
+                std::lock_guard<std::mutex> lock(self->mutex);
+                Variant &v = self->variants[key];
+                v.compiling = false;
+                self->num_compiling--;
+                if (callable.defined()) {
+                    v.callable = callable;
+                } else {
+                    v.calls = 0;
+                    self->num_compiled--;
+                }
+                self->maybe_publish_finished();
+            }
+        } guard{this, key, Callable()};
+
+        std::vector<const halide_buffer_t *> buffers;
+        std::vector<int> alignments;
+        for (size_t i : buffer_args) {
+            buffers.push_back((const halide_buffer_t *)argv[i]);
+            alignments.push_back(host_alignment(buffers.back()));
+        }
+        debug(1) << "Compiling a variant of a Callable specialized to a shape seen "
+                 << min_calls << " times\n";
+        guard.callable = compile_variant(buffers, alignments);
+        return guard.callable;
+    }
+};
+
+}  // namespace
+
 struct CallableContents {
     mutable RefCount ref_count;
 
@@ -32,6 +224,9 @@ struct CallableContents {
     // Encoded values for complete runtime type checking, used
     // only for make_std_function. Lazily created.
     std::vector<Callable::FullCallCheckInfo> full_call_check_info;
+
+    // Only set for Callables made by Pipeline::compile_to_specializing_callable.
+    std::unique_ptr<ShapeSpecializer> specializer;
 };
 
 namespace Internal {
@@ -46,6 +241,133 @@ void destroy<CallableContents>(const CallableContents *p) {
 }
 }  // namespace Internal
 
+namespace {
+
+// The contexts passed to call_async by calls that haven't finished. The
+// JITFuncCallContext of a call points its context at the call's own error
+// buffer, so calls in flight at the same time can't share a context.
+std::mutex async_contexts_mutex;
+std::set<const JITUserContext *> async_contexts;
+
+}  // namespace
+
+struct AsyncCallContents {
+    mutable RefCount ref_count;
+
+    IntrusivePtr<CallableContents> callable;
+
+    // The context the pipeline runs with: the caller's if they passed one,
+    // otherwise our own.
+    JITUserContext own_context;
+    JITUserContext *context = nullptr;
+    // Whether context is the caller's, and so is in async_contexts.
+    bool callers_context = false;
+
+    // A copy of the caller's argv. Scalars (including the context pointer)
+    // are copied into scalar_store, as the caller's copies only last as
+    // long as the call to call_async.
+    std::vector<const void *> argv;
+    std::vector<uint64_t> scalar_store;
+
+    std::optional<JITFuncCallContext> call_context;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool finished = false;
+    int exit_status = 0;
+    std::string error;
+    std::vector<std::function<void(int)>> callbacks;
+
+    // A reference to this object held while the call is in flight, so that
+    // the caller may drop their AsyncCall before it finishes.
+    IntrusivePtr<AsyncCallContents> in_flight;
+
+    void finish(int status) {
+        // If we're profiling, report runtimes and reset profiler stats.
+        callable->jit_cache.finish_profiling(context);
+        std::string msg = call_context->error_message(status);
+        if (callers_context) {
+            std::lock_guard<std::mutex> lock(async_contexts_mutex);
+            async_contexts.erase(context);
+        }
+
+        IntrusivePtr<AsyncCallContents> self = std::move(in_flight);
+        std::vector<std::function<void(int)>> to_call;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            exit_status = status;
+            error = std::move(msg);
+            to_call.swap(callbacks);
+        }
+        cond.notify_all();
+        for (auto &f : to_call) {
+            f(status);
+        }
+    }
+};
+
+namespace Internal {
+template<>
+RefCount &ref_count<AsyncCallContents>(const AsyncCallContents *p) noexcept {
+    return p->ref_count;
+}
+
+template<>
+void destroy<AsyncCallContents>(const AsyncCallContents *p) {
+    delete p;
+}
+}  // namespace Internal
+
+namespace {
+
+// Called by the runtime on the worker thread that ran the pipeline.
+void async_call_done(void *user_context, int exit_status, void *closure) {
+    ((AsyncCallContents *)closure)->finish(exit_status);
+}
+
+}  // namespace
+
+AsyncCall::AsyncCall()
+    : contents(nullptr) {
+}
+
+bool AsyncCall::defined() const {
+    return contents.defined();
+}
+
+bool AsyncCall::done() const {
+    user_assert(defined()) << "Cannot call done() on an undefined AsyncCall.";
+    std::lock_guard<std::mutex> lock(contents->mutex);
+    return contents->finished;
+}
+
+int AsyncCall::wait() const {
+    user_assert(defined()) << "Cannot call wait() on an undefined AsyncCall.";
+    std::string error;
+    {
+        std::unique_lock<std::mutex> lock(contents->mutex);
+        contents->cond.wait(lock, [&]() { return contents->finished; });
+        error = contents->error;
+    }
+    if (!error.empty()) {
+        halide_runtime_error << error;
+    }
+    return contents->exit_status;
+}
+
+void AsyncCall::on_done(std::function<void(int)> f) const {
+    user_assert(defined()) << "Cannot call on_done() on an undefined AsyncCall.";
+    {
+        std::lock_guard<std::mutex> lock(contents->mutex);
+        if (!contents->finished) {
+            contents->callbacks.push_back(std::move(f));
+            return;
+        }
+    }
+    f(contents->exit_status);
+}
+
 Callable::Callable()
     : contents(nullptr) {
 }
@@ -75,6 +397,32 @@ Callable::Callable(const std::string &name,
     // Don't create full_call_check_info yet.
 }
 
+void Callable::enable_shape_specialization(CompileVariantFn compile_variant, int min_calls, int max_variants) {
+    internal_assert(defined() && !contents->specializer);
+    auto specializer = std::make_unique<ShapeSpecializer>();
+    specializer->compile_variant = std::move(compile_variant);
+    specializer->min_calls = min_calls;
+    specializer->max_variants = max_variants;
+    for (size_t i = 0; i < contents->jit_cache.arguments.size(); i++) {
+        if (contents->jit_cache.arguments[i].is_buffer()) {
+            specializer->buffer_args.push_back(i);
+        }
+    }
+    contents->specializer = std::move(specializer);
+}
+
+int Callable::num_specialized_variants() const {
+    if (!defined() || !contents->specializer) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(contents->specializer->mutex);
+    int count = 0;
+    for (const auto &it : contents->specializer->variants) {
+        count += it.second.callable.defined() ? 1 : 0;
+    }
+    return count;
+}
+
 const std::vector<Argument> &Callable::arguments() const {
     return contents->jit_cache.arguments;
 }
@@ -190,6 +538,13 @@ Callable::FailureFn Callable::check_fcci(size_t argc, const FullCallCheckInfo *a
     JITUserContext *context = *(JITUserContext **)const_cast<void *>(argv[0]);
     assert(context != nullptr);
 
+    if (contents->specializer) {
+        Callable variant = contents->specializer->variant_for(argv);
+        if (variant.defined()) {
+            return variant.call_argv_fast(argc, argv);
+        }
+    }
+
     JITFuncCallContext jit_call_context(context, contents->saved_jit_handlers);
 
     int exit_status = contents->jit_cache.call_jit_code(argv);
@@ -214,4 +569,114 @@ int Callable::call_argv_checked(size_t argc, const void *const *argv, const Quic
     return call_argv_fast(argc, argv);
 }
 
+int Callable::call_argv_batch(size_t argc, size_t num_calls, const void *const *const *argvs, const QuickCallCheckInfo *actual_qcci) const {
+    user_assert(defined()) << "Cannot call() a default-constructed Callable.";
+
+    if (num_calls == 0) {
+        return halide_error_code_success;
+    }
+
+    JITUserContext *context = *(JITUserContext **)const_cast<void *>(argvs[0][0]);
+
+    // It's *essential* we call this for safety.
+    const auto failure_fn = check_qcci(argc, actual_qcci);
+    if (failure_fn) {
+        return failure_fn(context);
+    }
+
+    using BatchFn = int (*)(void *, int (*)(void **), int, void **const *, int *);
+    BatchFn batch = nullptr;
+    if (contents->jit_cache.get_compiled_jit_target().arch != Target::WebAssembly) {
+        batch = (BatchFn)contents->jit_cache.jit_module.find_symbol_by_name("halide_call_argv_batch").address;
+    }
+    if (!batch) {
+        for (size_t i = 0; i < num_calls; i++) {
+            int exit_status = call_argv_fast(argc, argvs[i]);
+            if (exit_status != halide_error_code_success) {
+                return exit_status;
+            }
+        }
+        return halide_error_code_success;
+    }
+
+    // The calls share the context, and so one JITFuncCallContext.
+    JITFuncCallContext jit_call_context(context, contents->saved_jit_handlers);
+
+    auto argv_fn = (int (*)(void **))contents->jit_cache.jit_module.argv_function();
+    internal_assert(argv_fn != nullptr);
+    int exit_status = batch(context, argv_fn, (int)num_calls, (void **const *)argvs, nullptr);
+
+    // If we're profiling, report runtimes and reset profiler stats.
+    contents->jit_cache.finish_profiling(context);
+
+    jit_call_context.finalize(exit_status);
+
+    return exit_status;
+}
+
+AsyncCall Callable::call_argv_async(size_t argc, const void *const *argv, const QuickCallCheckInfo *actual_qcci) const {
+    user_assert(defined()) << "Cannot call_async() a default-constructed Callable.";
+
+    AsyncCall result;
+    result.contents = new AsyncCallContents;
+    AsyncCallContents *c = result.contents.get();
+    c->callable = contents;
+
+    JITUserContext *context = *(JITUserContext **)const_cast<void *>(argv[0]);
+    c->context = context ? context : &c->own_context;
+
+    // It's *essential* we call this for safety.
+    const auto failure_fn = check_qcci(argc, actual_qcci);
+    if (failure_fn) {
+        c->exit_status = failure_fn(c->context);
+        c->finished = true;
+        return result;
+    }
+
+    const std::vector<Argument> &args = contents->jit_cache.arguments;
+    c->argv.resize(argc);
+    c->scalar_store.resize(argc);
+    for (size_t i = 0; i < argc; i++) {
+        if (i == 0) {
+            memcpy(&c->scalar_store[i], &c->context, sizeof(c->context));
+            c->argv[i] = &c->scalar_store[i];
+        } else if (args[i].is_scalar()) {
+            memcpy(&c->scalar_store[i], argv[i], args[i].type.bytes());
+            c->argv[i] = &c->scalar_store[i];
+        } else {
+            c->argv[i] = argv[i];
+        }
+    }
+
+    if (context) {
+        std::lock_guard<std::mutex> lock(async_contexts_mutex);
+        user_assert(async_contexts.insert(context).second)
+            << "The JITUserContext passed to call_async() is in use by another call that hasn't finished. "
+            << "Calls in flight at the same time each need their own JITUserContext.\n";
+        c->callers_context = true;
+    }
+    c->call_context.emplace(c->context, contents->saved_jit_handlers);
+
+    using SubmitFn = int (*)(void *, int (*)(void **), void **, void (*)(void *, int, void *), void *);
+    SubmitFn submit = nullptr;
+    if (contents->jit_cache.get_compiled_jit_target().arch != Target::WebAssembly) {
+        submit = (SubmitFn)contents->jit_cache.jit_module.find_symbol_by_name("halide_call_argv_async").address;
+    }
+    if (!submit) {
+        // No thread pool to run it on, so run it here.
+        c->finish(contents->jit_cache.call_jit_code(c->argv.data()));
+        return result;
+    }
+
+    auto argv_fn = (int (*)(void **))contents->jit_cache.jit_module.argv_function();
+    internal_assert(argv_fn != nullptr);
+    c->in_flight = result.contents;
+    int status = submit(c->context, argv_fn, (void **)c->argv.data(), async_call_done, c);
+    if (status != halide_error_code_success) {
+        // The done callback won't be called.
+        c->finish(status);
+    }
+    return result;
+}
+
 }  // namespace Halide
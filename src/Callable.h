@@ -8,6 +8,8 @@
 
 #include <array>
 #include <map>
+#include <tuple>
+#include <vector>
 
 #include "Buffer.h"
 #include "IntrusivePtr.h"
@@ -16,6 +18,7 @@
 namespace Halide {
 
 struct Argument;
+struct AsyncCallContents;
 struct CallableContents;
 
 namespace PythonBindings {
@@ -79,6 +82,37 @@ struct HalideBufferStaticTypeAndDims<::Halide::Runtime::Buffer<T, Dims>> {
 
 }  // namespace Internal
 
+/** A handle on a call to a Callable made with Callable::call_async, which
+ * may still be running. Copies of the handle refer to the same call. */
+class AsyncCall {
+    friend class Callable;
+
+    Internal::IntrusivePtr<AsyncCallContents> contents;
+
+public:
+    /** Construct an AsyncCall that doesn't refer to any call. The defined()
+     * method will return false. */
+    AsyncCall();
+
+    /** Return true if this refers to a call. */
+    bool defined() const;
+
+    /** Return true if the call has finished. Never blocks. */
+    bool done() const;
+
+    /** Block until the call has finished, and return its exit status. If it
+     * failed, the error is reported here, just as a synchronous call would
+     * report it. */
+    int wait() const;
+
+    /** Arrange for a function to be called with the exit status of the call
+     * once it has finished. It's called on the thread that ran the call, or
+     * on this thread, before this returns, if the call has already
+     * finished. It must not block for long, as it holds up a thread in
+     * Halide's thread pool. */
+    void on_done(std::function<void(int)> f) const;
+};
+
 class Callable {
 private:
     friend class Pipeline;
@@ -282,6 +316,17 @@ private:
              const std::map<std::string, JITExtern> &jit_externs,
              Internal::JITCache &&jit_cache);
 
+    /** Compiles a variant of the Callable specialized to the shapes of the
+     * given buffer arguments, each of which is assumed to have the given
+     * host alignment. */
+    using CompileVariantFn = std::function<Callable(const std::vector<const halide_buffer_t *> &buffers,
+                                                    const std::vector<int> &host_alignments)>;
+
+    /** Make this Callable compile and use specialized variants of itself for
+     * the shapes it is called with most often. See
+     * Pipeline::compile_to_specializing_callable. */
+    void enable_shape_specialization(CompileVariantFn compile_variant, int min_calls, int max_variants);
+
     // Note that the first entry in argv must always be a JITUserContext*.
     int call_argv_checked(size_t argc, const void *const *argv, const QuickCallCheckInfo *actual_cci) const;
 
@@ -301,6 +346,13 @@ private:
         return call_argv_checked(count, &argv.argv[0], actual_arg_types.data());
     }
 
+    // Note that the first entry in argv must always be a JITUserContext*,
+    // which may be null, in which case the call makes its own.
+    AsyncCall call_argv_async(size_t argc, const void *const *argv, const QuickCallCheckInfo *actual_cci) const;
+
+    // Every argv must have the same JITUserContext* as its first entry.
+    int call_argv_batch(size_t argc, size_t num_calls, const void *const *const *argvs, const QuickCallCheckInfo *actual_cci) const;
+
     /** Return the expected Arguments for this Callable, in the order they must be specified, including all outputs.
      * Note that the first entry will *always* specify a JITUserContext. */
     const std::vector<Argument> &arguments() const;
@@ -313,6 +365,11 @@ public:
     /** Return true if the Callable is well-defined and usable, false if it is a default-constructed empty Callable. */
     bool defined() const;
 
+    /** Return the number of variants specialized to particular buffer shapes
+     * that this Callable has compiled. Always zero unless it was made by
+     * Pipeline::compile_to_specializing_callable. */
+    int num_specialized_variants() const;
+
     template<typename... Args>
     HALIDE_FUNCTION_ATTRS int
     operator()(JITUserContext *context, Args &&...args) const {
@@ -326,6 +383,78 @@ public:
         return call(&empty, std::forward<Args>(args)...);
     }
 
+    /** Start a call of the Callable as a task on Halide's thread pool, and
+     * return a handle on it without waiting for it to finish. The arguments
+     * are the same as for operator(). Scalar arguments are copied, but
+     * Buffers are not: they, and the JITUserContext if one is passed, must
+     * stay alive and untouched until the call has finished. A call records
+     * its errors through its JITUserContext, so calls in flight at the same
+     * time can't share one; passing a context that another unfinished call
+     * is using is an error.
+     *
+     * No thread blocks waiting for the call: a worker thread runs it,
+     * sharing its parallel loops with the rest of the thread pool, so many
+     * calls can be in flight at once without a thread each. (See
+     * halide_call_argv_async.) When JIT-compiling for WebAssembly, the call
+     * is made synchronously, and has finished when this returns. */
+    // @{
+    template<typename... Args>
+    AsyncCall call_async(JITUserContext *context, Args &&...args) const {
+        static constexpr auto actual_arg_types = make_qcci_array<JITUserContext *, Args...>();
+
+        constexpr size_t count = sizeof...(args) + 1;
+        ArgvStorage<count> argv(context, std::forward<Args>(args)...);
+        return call_argv_async(count, &argv.argv[0], actual_arg_types.data());
+    }
+
+    template<typename... Args>
+    AsyncCall call_async(Args &&...args) const {
+        return call_async((JITUserContext *)nullptr, std::forward<Args>(args)...);
+    }
+    // @}
+
+    /** Call the Callable once for each tuple of arguments in a batch, and
+     * wait for all the calls to finish. Each tuple holds the same arguments
+     * as would be passed to operator(). The calls are spread across Halide's
+     * thread pool, and may run in any order and concurrently, so they must
+     * not write to the same Buffers. Returns the exit status of the first
+     * call that failed, after which calls not yet started are skipped.
+     * The calls all share the JITUserContext, so if several fail at once,
+     * the error reported holds the messages of all of them.
+     *
+     * This only dispatches the calls in parallel. Each one is still a
+     * separate call of the compiled pipeline, with its own argument checks
+     * and allocations; what is amortized over the batch is waking the
+     * thread pool. For many calls on small inputs this is still much
+     * cheaper than making them one at a time. (See
+     * halide_call_argv_batch.) To check each shape once and share the
+     * intermediate allocations too, compile ahead of time with the
+     * batch_entry_point target feature instead. */
+    // @{
+    template<typename... Args>
+    int call_batch(JITUserContext *context, const std::vector<std::tuple<Args...>> &batch) const {
+        static constexpr auto actual_arg_types = make_qcci_array<JITUserContext *, Args...>();
+
+        constexpr size_t count = sizeof...(Args) + 1;
+        // ArgvStorage points into itself, so it must be built in place.
+        std::vector<ArgvStorage<count>> storage;
+        storage.reserve(batch.size());
+        std::vector<const void *const *> argvs;
+        argvs.reserve(batch.size());
+        for (const auto &args : batch) {
+            std::apply([&](const auto &...a) { storage.emplace_back(context, a...); }, args);
+            argvs.push_back(&storage.back().argv[0]);
+        }
+        return call_argv_batch(count, batch.size(), argvs.data(), actual_arg_types.data());
+    }
+
+    template<typename... Args>
+    int call_batch(const std::vector<std::tuple<Args...>> &batch) const {
+        JITUserContext empty;
+        return call_batch(&empty, batch);
+    }
+    // @}
+
     /** This allows us to construct a std::function<> that wraps the Callable.
      * This is nice in that it is, well, just a std::function, but also in that
      * since the argument-count-and-type checking are baked into the language,
@@ -12,6 +12,7 @@
 #include "IROperator.h"
 #include "Lerp.h"
 #include "Param.h"
+#include "PlanAllocations.h"
 #include "Simplify.h"
 #include "StrictifyFloat.h"
 #include "Substitute.h"
@@ -1210,6 +1211,24 @@ void CodeGen_C::compile(const LoweredFunc &f, const MetadataNameMap &metadata_na
         if (f.linkage != LinkageType::Internal) {
             emit_constexpr_function_info(simple_name, args, metadata_name_map);
         }
+
+        bool has_scratch = false;
+        for (const auto &arg : args) {
+            has_scratch |= (arg.name == "__scratch");
+        }
+        if (has_scratch) {
+            // The caller may pass in memory for the arena that the
+            // pipeline's allocations were planned into. Tell them how
+            // much it needs.
+            stream << "\n"
+                   << "// The number of bytes of memory to pass as __scratch to " << simple_name << ".\n"
+                   << "// It must be aligned to the native vector width, as halide_malloc would align it,\n"
+                   << "// and its size passed as __scratch_size. If __scratch is null, " << simple_name << "\n"
+                   << "// allocates the memory itself.\n"
+                   << "static inline int64_t " << simple_name << "_scratch_size(void) {\n"
+                   << "    return " << scratch_arena_size(f.body) << ";\n"
+                   << "}\n";
+        }
     }
 
     if (!namespaces.empty()) {
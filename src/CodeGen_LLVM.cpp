@@ -840,6 +840,20 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     }
     apply_runtime_prefixes_prefixes(*module, input.get_runtime_prefixes_map(), pipeline_functions, runtime_symbols);
 
+    parallel_closures.clear();
+    for (size_t i = 0; i < input.functions().size(); i++) {
+        if (input.functions()[i].attributes & LoweredFunc::Attribute::PARALLEL_CLOSURE) {
+            parallel_closures.insert(function_names[i].extern_name);
+        }
+    }
+
+    generated_functions.clear();
+    for (const llvm::Function &f : module->functions()) {
+        if (!f.isDeclaration() && !runtime_symbols.count(f.getName().str())) {
+            generated_functions.push_back(f.getName().str());
+        }
+    }
+
     return finish_codegen();
 }
 
@@ -850,12 +864,14 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::finish_codegen() {
     internal_assert(!verifyModule(*module, &llvm::errs()));
     debug(2) << "Done generating llvm bitcode\n";
 
-    // Optimize
-    CodeGen_LLVM::optimize_module();
+    if (!skip_optimization) {
+        // Optimize
+        CodeGen_LLVM::optimize_module();
 
-    if (target.has_feature(Target::EmbedBitcode)) {
-        std::string halide_command = "halide target=" + target.to_string();
-        embed_bitcode(module.get(), halide_command);
+        if (target.has_feature(Target::EmbedBitcode)) {
+            std::string halide_command = "halide target=" + target.to_string();
+            embed_bitcode(module.get(), halide_command);
+        }
     }
 
     // Disown the module and return it.
@@ -1357,17 +1373,17 @@ llvm::Type *CodeGen_LLVM::llvm_type_of(const Type &t) const {
     return llvm_type_of(context, t, effective_vscale);
 }
 
-void CodeGen_LLVM::optimize_module() {
+void optimize_llvm_module(llvm::Module &module, const Target &target) {
     debug(3) << "Optimizing module\n";
 
     debug(3) << [&] {
-        module->print(dbgs(), nullptr, false, true);
+        module.print(dbgs(), nullptr, false, true);
         return "";
     }();
 
-    std::unique_ptr<TargetMachine> tm = make_target_machine(*module);
+    std::unique_ptr<TargetMachine> tm = make_target_machine(module);
 
-    const bool do_loop_opt = get_target().has_feature(Target::EnableLLVMLoopOpt);
+    const bool do_loop_opt = target.has_feature(Target::EnableLLVMLoopOpt);
 
     PipelineTuningOptions pto;
     pto.LoopInterleaving = do_loop_opt;
@@ -1409,7 +1425,7 @@ void CodeGen_LLVM::optimize_module() {
             });
     }
 
-    if (get_target().has_feature(Target::SanitizerCoverage)) {
+    if (target.has_feature(Target::SanitizerCoverage)) {
         pb.registerOptimizerLastEPCallback(
             [&](ModulePassManager &mpm, OptimizationLevel, ThinOrFullLTOPhase) {
                 SanitizerCoverageOptions sanitizercoverage_options;
@@ -1421,14 +1437,14 @@ void CodeGen_LLVM::optimize_module() {
                 sanitizercoverage_options.Inline8bitCounters = true;
                 sanitizercoverage_options.PCTable = true;
                 // Due to TLS differences, stack depth tracking is only enabled on Linux
-                if (get_target().os == Target::OS::Linux) {
+                if (target.os == Target::OS::Linux) {
                     sanitizercoverage_options.StackDepth = true;
                 }
                 mpm.addPass(SanitizerCoveragePass(sanitizercoverage_options));
             });
     }
 
-    if (get_target().has_feature(Target::ASAN)) {
+    if (target.has_feature(Target::ASAN)) {
         pb.registerPipelineStartEPCallback(
             [](ModulePassManager &mpm, OptimizationLevel) {
                 AddressSanitizerOptions asan_options;  // default values are good...
@@ -1444,7 +1460,7 @@ void CodeGen_LLVM::optimize_module() {
     // Target::MSAN handling is sprinkled throughout the codebase,
     // there is no need to run MemorySanitizerPass here.
 
-    if (get_target().has_feature(Target::TSAN)) {
+    if (target.has_feature(Target::TSAN)) {
         pb.registerOptimizerLastEPCallback(
             [](ModulePassManager &mpm, OptimizationLevel, ThinOrFullLTOPhase) {
                 mpm.addPass(
@@ -1452,14 +1468,14 @@ void CodeGen_LLVM::optimize_module() {
             });
     }
 
-    for (auto &function : *module) {
-        if (get_target().has_feature(Target::ASAN)) {
+    for (auto &function : module) {
+        if (target.has_feature(Target::ASAN)) {
             function.addFnAttr(Attribute::SanitizeAddress);
         }
-        if (get_target().has_feature(Target::MSAN)) {
+        if (target.has_feature(Target::MSAN)) {
             function.addFnAttr(Attribute::SanitizeMemory);
         }
-        if (get_target().has_feature(Target::TSAN)) {
+        if (target.has_feature(Target::TSAN)) {
             // Do not annotate any of Halide's low-level synchronization code as it has
             // tsan interface calls to mark its behavior and is much faster if
             // it is not analyzed instruction by instruction.
@@ -1480,19 +1496,23 @@ void CodeGen_LLVM::optimize_module() {
     }
 
     mpm = pb.buildPerModuleDefaultPipeline(level);
-    mpm.run(*module, mam);
+    mpm.run(module, mam);
 
-    if (llvm::verifyModule(*module, &errs())) {
+    if (llvm::verifyModule(module, &errs())) {
         report_fatal_error("Transformation resulted in an invalid module\n");
     }
 
     debug(3) << "After LLVM optimizations:\n";
     debug(2) << [&] {
-        module->print(dbgs(), nullptr, false, true);
+        module.print(dbgs(), nullptr, false, true);
         return "";
     }();
 }
 
+void CodeGen_LLVM::optimize_module() {
+    optimize_llvm_module(*module, get_target());
+}
+
 void CodeGen_LLVM::sym_push(const string &name, llvm::Value *value) {
     if (!value->getType()->isVoidTy()) {
         value->setName(name);
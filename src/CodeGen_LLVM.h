@@ -76,6 +76,28 @@ public:
     /** Tell the code generator which LLVM context to use. */
     void set_context(llvm::LLVMContext &context);
 
+    /** Tell the code generator to leave the llvm Module returned by
+     * compile unoptimized, for callers that run optimize_llvm_module on
+     * it (or on pieces of it) themselves. */
+    void set_skip_optimization(bool skip) {
+        skip_optimization = skip;
+    }
+
+    /** The names of the functions defined by the most recent call to
+     * compile that were generated from the Halide module (including
+     * closures, argv wrappers and metadata getters), as opposed to linked
+     * in from the runtime, in the order they were defined. */
+    const std::vector<std::string> &get_generated_functions() const {
+        return generated_functions;
+    }
+
+    /** The names of the generated functions that are the bodies of
+     * parallel loops and tasks, which the pipeline only ever passes to
+     * the runtime by address. */
+    const std::set<std::string> &get_parallel_closures() const {
+        return parallel_closures;
+    }
+
     /** Initialize internal llvm state for the enabled targets. */
     static void initialize_llvm();
 
@@ -176,6 +198,15 @@ protected:
      * nor in the Halide::Runtime::Internal namespace. */
     std::set<std::string> runtime_symbols;
 
+    /** See get_generated_functions. */
+    std::vector<std::string> generated_functions;
+
+    /** See get_parallel_closures. */
+    std::set<std::string> parallel_closures;
+
+    /** See set_skip_optimization. */
+    bool skip_optimization = false;
+
     llvm::Function *function = nullptr;
     llvm::LLVMContext *context = nullptr;
     std::unique_ptr<llvm::IRBuilder<llvm::ConstantFolder, llvm::IRBuilderDefaultInserter>> builder;
@@ -802,6 +833,10 @@ private:
     std::map<llvm::Value *, llvm::Type *> struct_type_recovery;
 };
 
+/** Run all of llvm's optimization passes, configured for the given
+ * Halide target, on an llvm Module. */
+void optimize_llvm_module(llvm::Module &module, const Target &target);
+
 }  // namespace Internal
 
 /** Given a Halide module, generate an llvm::Module. */
@@ -7,6 +7,7 @@
 #include "Function.h"
 #include "IR.h"
 #include "Schedule.h"
+#include "Util.h"
 #include "halide_ir.fbs.h"
 
 #include <fstream>
@@ -36,6 +37,9 @@ public:
     // Deserialize a pipeline from the given buffer of bytes
     Pipeline deserialize(const std::vector<uint8_t> &data);
 
+    // Deserialize a pipeline from the given bytes in memory, which are not copied
+    Pipeline deserialize(const uint8_t *data, size_t size);
+
     // Deserialize just the unbound external parameters that need to be defined for the pipeline from the given filename
     // (so they can be remapped and overridden with user parameters prior to deserializing the pipeline)
     std::map<std::string, Parameter> deserialize_parameters(const std::string &filename);
@@ -46,6 +50,9 @@ public:
     // Deserialize just the unbound external parameters that need to be defined for the pipeline from the given buffer of bytes
     std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_t> &data);
 
+    // Deserialize just the unbound external parameters that need to be defined for the pipeline from the given bytes in memory
+    std::map<std::string, Parameter> deserialize_parameters(const uint8_t *data, size_t size);
+
 private:
     // Helper function to deserialize a homogeneous vector from a flatbuffer vector,
     // does not apply to union types like Stmt and Expr or enum types like MemoryType
@@ -78,6 +85,11 @@ private:
     // Default external parameters that were created during deserialization
     std::map<std::string, Parameter> external_params;
 
+    // A lookup table for finding Exprs that have already been deserialized via
+    // their location in the serialized data. The serializer writes a shared
+    // subexpression once, so this rebuilds it once and restores the sharing.
+    std::unordered_map<const void *, Expr> exprs_deserialized;
+
     MemoryType deserialize_memory_type(Serialize::MemoryType memory_type);
 
     ForType deserialize_for_type(Serialize::ForType for_type);
@@ -114,6 +126,8 @@ private:
 
     Expr deserialize_expr(Serialize::Expr type_code, const void *expr);
 
+    Expr deserialize_expr_node(Serialize::Expr type_code, const void *expr);
+
     std::vector<Expr> deserialize_expr_vector(const flatbuffers::Vector<Serialize::Expr> *exprs_types, const flatbuffers::Vector<flatbuffers::Offset<void>> *exprs_serialized);
 
     Range deserialize_range(const Serialize::Range *range);
@@ -688,6 +702,15 @@ Stmt Deserializer::deserialize_stmt(Serialize::Stmt type_code, const void *stmt)
 
 Expr Deserializer::deserialize_expr(Serialize::Expr type_code, const void *expr) {
     user_assert(expr != nullptr);
+    if (auto it = exprs_deserialized.find(expr); it != exprs_deserialized.end()) {
+        return it->second;
+    }
+    Expr result = deserialize_expr_node(type_code, expr);
+    exprs_deserialized.emplace(expr, result);
+    return result;
+}
+
+Expr Deserializer::deserialize_expr_node(Serialize::Expr type_code, const void *expr) {
     switch (type_code) {
     case Serialize::Expr::IntImm: {
         const auto *int_imm_expr = (const Serialize::IntImm *)expr;
@@ -1044,6 +1067,15 @@ FuncSchedule Deserializer::deserialize_func_schedule(const Serialize::FuncSchedu
                 deserialize_string(check->message()));
         }
     }
+    const auto carried_storage_name = func_schedule->carried_storage_name() != nullptr ?
+                                          deserialize_string(func_schedule->carried_storage_name()) :
+                                          "";
+    Parameter carried_storage;
+    if (auto it = parameters_in_pipeline.find(carried_storage_name); it != parameters_in_pipeline.end()) {
+        carried_storage = it->second;
+    } else if (!carried_storage_name.empty()) {
+        user_error << "unknown parameter used in pipeline '" << carried_storage_name << "'\n";
+    }
     auto hl_func_schedule = FuncSchedule();
     hl_func_schedule.store_level() = store_level;
     hl_func_schedule.compute_level() = compute_level;
@@ -1058,6 +1090,7 @@ FuncSchedule Deserializer::deserialize_func_schedule(const Serialize::FuncSchedu
     hl_func_schedule.ring_buffer() = ring_buffer;
     hl_func_schedule.memoize_eviction_key() = memoize_eviction_key;
     hl_func_schedule.type_change_checks() = std::move(type_change_checks);
+    hl_func_schedule.carried_storage() = carried_storage;
     return hl_func_schedule;
 }
 
@@ -1371,19 +1404,28 @@ Buffer<> Deserializer::deserialize_buffer(const Serialize::Buffer *buffer) {
         }
         dense_buffer_dimensions.push_back(dense_dim);
     }
-    // To handle cropped buffer, we create a dense buffer and serialize into it,
-    // then create a (potential sparse) buffer with original dimension infos and copy from the dense buffer
     auto fake_dense_buffer = Buffer<>(type, nullptr, dimensions, dense_buffer_dimensions.data(), name + "_dense_fake");
-    auto dense_buffer = Buffer<>::make_with_shape_of(fake_dense_buffer, nullptr, nullptr, name + "_dense_tmp");
     const auto *buffer_data = buffer->data();
     user_assert(buffer_data != nullptr) << "deserialized buffer " << name << " has no data\n";
-    user_assert(buffer_data->size() == dense_buffer.size_in_bytes())
+    user_assert(buffer_data->size() == fake_dense_buffer.size_in_bytes())
         << "deserialized buffer " << name << " carries " << buffer_data->size()
-        << " bytes of data, but its dimensions require " << dense_buffer.size_in_bytes() << "\n";
-    memcpy(dense_buffer.data(), buffer_data->data(), buffer_data->size());
+        << " bytes of data, but its dimensions require " << fake_dense_buffer.size_in_bytes() << "\n";
     auto fake_buffer = Buffer<>(type, nullptr, dimensions, hl_buffer_dimensions.data(), name + "_fake");
     auto hl_buffer = Buffer<>::make_with_shape_of(fake_buffer, nullptr, nullptr, name);
-    hl_buffer.copy_from(dense_buffer);
+    bool is_dense = true;
+    for (int i = 0; i < dimensions; ++i) {
+        is_dense &= hl_buffer.dim(i).stride() == dense_buffer_dimensions[i].stride;
+    }
+    if (is_dense) {
+        // The common case: the data can be copied straight into the new buffer
+        memcpy(hl_buffer.data(), buffer_data->data(), buffer_data->size());
+    } else {
+        // To handle cropped buffer, we create a dense buffer and serialize into it,
+        // then copy from the dense buffer into the (potentially sparse) buffer with original dimension infos
+        auto dense_buffer = Buffer<>::make_with_shape_of(fake_dense_buffer, nullptr, nullptr, name + "_dense_tmp");
+        memcpy(dense_buffer.data(), buffer_data->data(), buffer_data->size());
+        hl_buffer.copy_from(dense_buffer);
+    }
     return hl_buffer;
 }
 
@@ -1418,18 +1460,14 @@ void Deserializer::build_reverse_function_mappings(const std::vector<Function> &
 }
 
 Pipeline Deserializer::deserialize(const std::string &filename) {
-    std::ifstream in(filename, std::ios::binary | std::ios::in);
-    if (!in) {
+    if (!file_exists(filename)) {
         user_error << "failed to open file " << filename << "\n";
         return Pipeline();
     }
-    Pipeline result = deserialize(in);
-    if (!in.good()) {
-        user_error << "failed to deserialize from file " << filename << " properly\n";
-        return Pipeline();
-    }
-    in.close();
-    return result;
+    // Map the file rather than reading it, so that only the parts of it
+    // that are used are paged in, and nothing is copied.
+    MappedFile file(filename);
+    return deserialize(file.data(), file.size());
 }
 
 Pipeline Deserializer::deserialize(std::istream &in) {
@@ -1446,7 +1484,16 @@ Pipeline Deserializer::deserialize(std::istream &in) {
 }
 
 Pipeline Deserializer::deserialize(const std::vector<uint8_t> &data) {
-    const auto *pipeline_obj = Serialize::GetPipeline(data.data());
+    return deserialize(data.data(), data.size());
+}
+
+Pipeline Deserializer::deserialize(const uint8_t *data, size_t size) {
+    if (data == nullptr || size < sizeof(flatbuffers::uoffset_t)) {
+        user_error << "serialized pipeline is truncated: " << size << " bytes\n";
+        return Pipeline();
+    }
+    exprs_deserialized.clear();
+    const auto *pipeline_obj = Serialize::GetPipeline(data);
     if (pipeline_obj == nullptr) {
         user_warning << "deserialized pipeline is empty\n";
         return Pipeline();
@@ -1508,6 +1555,10 @@ Pipeline Deserializer::deserialize(const std::vector<uint8_t> &data) {
     for (const auto &param : parameters_external) {
         external_params[param.name()] = param;
     }
+    // Variables and Calls are bound to parameters by name, and the
+    // parameters above were rebuilt before they could all be found, so
+    // don't reuse any Exprs rebuilt for them in the definitions below.
+    exprs_deserialized.clear();
 
     std::vector<Func> funcs;
     user_assert(pipeline_obj->funcs()->size() == functions.size()) << "malformed pipeline: serialized function count does not match the number of function names\n";
@@ -1538,23 +1589,17 @@ Pipeline Deserializer::deserialize(const std::vector<uint8_t> &data) {
         auto requirement_deserialized = deserialize_stmt(static_cast<Serialize::Stmt>(requirement_type_objs->Get(i)), requirements_objs->Get(i));
         requirements.push_back(requirement_deserialized);
     }
+    exprs_deserialized.clear();
     return Pipeline(output_funcs, requirements);
 }
 
 std::map<std::string, Parameter> Deserializer::deserialize_parameters(const std::string &filename) {
-    std::map<std::string, Parameter> empty;
-    std::ifstream in(filename, std::ios::binary | std::ios::in);
-    if (!in) {
+    if (!file_exists(filename)) {
         user_error << "failed to open file " << filename << "\n";
-        return empty;
-    }
-    std::map<std::string, Parameter> params = deserialize_parameters(in);
-    if (!in.good()) {
-        user_error << "failed to deserialize from file " << filename << " properly\n";
-        return empty;
+        return {};
     }
-    in.close();
-    return params;
+    MappedFile file(filename);
+    return deserialize_parameters(file.data(), file.size());
 }
 
 std::map<std::string, Parameter> Deserializer::deserialize_parameters(std::istream &in) {
@@ -1572,8 +1617,16 @@ std::map<std::string, Parameter> Deserializer::deserialize_parameters(std::istre
 }
 
 std::map<std::string, Parameter> Deserializer::deserialize_parameters(const std::vector<uint8_t> &data) {
+    return deserialize_parameters(data.data(), data.size());
+}
+
+std::map<std::string, Parameter> Deserializer::deserialize_parameters(const uint8_t *data, size_t size) {
     std::map<std::string, Parameter> external_parameters_by_name;
-    const auto *pipeline_obj = Serialize::GetPipeline(data.data());
+    if (data == nullptr || size < sizeof(flatbuffers::uoffset_t)) {
+        user_error << "serialized pipeline is truncated: " << size << " bytes\n";
+        return external_parameters_by_name;
+    }
+    const auto *pipeline_obj = Serialize::GetPipeline(data);
     if (pipeline_obj == nullptr) {
         user_warning << "deserialized pipeline is empty\n";
         return external_parameters_by_name;
@@ -1606,6 +1659,11 @@ Pipeline deserialize_pipeline(const std::vector<uint8_t> &buffer, const std::map
     return deserializer.deserialize(buffer);
 }
 
+Pipeline deserialize_pipeline(const uint8_t *data, size_t size, const std::map<std::string, Parameter> &user_params) {
+    Internal::Deserializer deserializer(user_params);
+    return deserializer.deserialize(data, size);
+}
+
 std::map<std::string, Parameter> deserialize_parameters(const std::string &filename) {
     Internal::Deserializer deserializer;
     return deserializer.deserialize_parameters(filename);
@@ -1621,6 +1679,11 @@ std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_
     return deserializer.deserialize_parameters(buffer);
 }
 
+std::map<std::string, Parameter> deserialize_parameters(const uint8_t *data, size_t size) {
+    Internal::Deserializer deserializer;
+    return deserializer.deserialize_parameters(data, size);
+}
+
 }  // namespace Halide
 
 #else  // WITH_SERIALIZATION
@@ -1642,6 +1705,11 @@ Pipeline deserialize_pipeline(const std::vector<uint8_t> &buffer, const std::map
     return Pipeline();
 }
 
+Pipeline deserialize_pipeline(const uint8_t *data, size_t size, const std::map<std::string, Parameter> &user_params) {
+    user_error << "Deserialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+    return Pipeline();
+}
+
 std::map<std::string, Parameter> deserialize_parameters(const std::string &filename) {
     user_error << "Deserialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
     return {};
@@ -1657,6 +1725,11 @@ std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_
     return {};
 }
 
+std::map<std::string, Parameter> deserialize_parameters(const uint8_t *data, size_t size) {
+    user_error << "Deserialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+    return {};
+}
+
 }  // namespace Halide
 
 #endif  // WITH_SERIALIZATION
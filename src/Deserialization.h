@@ -8,7 +8,7 @@
 namespace Halide {
 
 /// @brief Deserialize a Halide pipeline from a file.
-/// @param filename The location of the file to deserialize.  Must use .hlpipe extension.
+/// @param filename The location of the file to deserialize.  Must use .hlpipe extension. The file is mapped into memory rather than read.
 /// @param user_params Map of named input/output parameters to bind with the resulting pipeline (used to avoid deserializing specific objects and enable the use of externally defined ones instead).
 /// @return Returns a newly constructed deserialized Pipeline object/
 Pipeline deserialize_pipeline(const std::string &filename, const std::map<std::string, Parameter> &user_params);
@@ -25,6 +25,16 @@ Pipeline deserialize_pipeline(std::istream &in, const std::map<std::string, Para
 /// @return Returns a newly constructed deserialized Pipeline object/
 Pipeline deserialize_pipeline(const std::vector<uint8_t> &data, const std::map<std::string, Parameter> &user_params);
 
+/// @brief Deserialize a Halide pipeline from memory containing a serialized pipeline in binary format, without copying it
+///        first. This is the entry point to use with memory that is already mapped or owned elsewhere. (The overload that
+///        takes a filename maps the file into memory itself.) Subexpressions that were shared in the serialized pipeline
+///        are shared again in the result.
+/// @param data The start of the memory containing a serialized Halide pipeline. It only needs to stay valid for the duration of the call.
+/// @param size The size of the serialized pipeline in bytes
+/// @param user_params Map of named input/output parameters to bind with the resulting pipeline (used to avoid deserializing specific objects and enable the use of externally defined ones instead).
+/// @return Returns a newly constructed deserialized Pipeline object/
+Pipeline deserialize_pipeline(const uint8_t *data, size_t size, const std::map<std::string, Parameter> &user_params);
+
 /// @brief Deserialize the external parameters for the Halide pipeline from a file.
 ///        This method allows a minimal deserialization of just the external pipeline parameters, so they can be
 ///        remapped and overridden with user parameters prior to deserializing the pipeline definition.
@@ -47,6 +57,13 @@ std::map<std::string, Parameter> deserialize_parameters(std::istream &in);
 /// @return Returns a map containing the names and description of external parameters referenced in the pipeline
 std::map<std::string, Parameter> deserialize_parameters(const std::vector<uint8_t> &data);
 
+/// @brief Deserialize the external parameters for the Halide pipeline from memory containing a serialized pipeline in
+///        binary format, without copying it first.
+/// @param data The start of the memory containing a serialized Halide pipeline
+/// @param size The size of the serialized pipeline in bytes
+/// @return Returns a map containing the names and description of external parameters referenced in the pipeline
+std::map<std::string, Parameter> deserialize_parameters(const uint8_t *data, size_t size);
+
 }  // namespace Halide
 
 #endif
@@ -126,6 +126,18 @@ struct IRNode {
      * anyway, so this doesn't increase the memory footprint of an IR node.
      */
     IRNodeType node_type;
+
+    /** If this node is interned by a ScopedIRInterning that is still
+     * alive, the number of that scope, and zero otherwise. See
+     * IRInterning.h. This and the hash below live in the rest of the
+     * free bits described above. */
+    mutable std::atomic<uint8_t> intern_scope{0};
+
+    /** A hash of the structure of this node, or zero if it hasn't been
+     * computed. Nodes that are equal according to IREquality have equal
+     * hashes, so nodes with different nonzero hashes are not equal. It is
+     * computed for constants and interned nodes. */
+    mutable std::atomic<uint16_t> structural_hash{0};
 };
 
 template<>
@@ -3172,6 +3172,16 @@ Func &Func::fold_storage(const Var &dim, const Expr &factor, bool fold_forward)
     return *this;
 }
 
+Func &Func::carry_storage(const Parameter &state) {
+    invalidate_cache();
+    user_assert(state.defined() && state.is_buffer() &&
+                state.type() == UInt(8) && state.dimensions() == 1)
+        << "In schedule for " << name()
+        << ", the buffer to carry its storage in must be a one-dimensional uint8 buffer.\n";
+    func.schedule().carried_storage() = state;
+    return *this;
+}
+
 Func &Func::compute_at(LoopLevel loop_level) {
     invalidate_cache();
     func.schedule().compute_level() = std::move(loop_level);
@@ -2243,6 +2243,39 @@ public:
      */
     Func &fold_storage(const Var &dim, const Expr &extent, bool fold_forward = true);
 
+    /** Keep the folded storage of this function between calls to the
+     * pipeline, in the given one-dimensional uint8 buffer, so that a call
+     * that continues where the last one left off (e.g. on the next strip
+     * of a very tall image) reuses the rows the last call computed instead
+     * of computing them again. The buffer becomes an argument of the
+     * pipeline. A bounds query sets its extent to the number of bytes
+     * needed, and it should be zeroed before the first call.
+     *
+     * The function must have a single value, must not be async, and
+     * must slide down a serial loop over the rows of its consumer, with
+     * its storage explicitly folded forwards along the dimension it
+     * slides in. For example:
+     *
+     \code
+     ImageParam state(UInt(8), 1);
+     g.store_root().compute_at(f, y).fold_storage(y, 4).carry_storage(state);
+     \endcode
+     *
+     * A call reuses the rows of g still in the buffer if the storage of
+     * g has the same shape as in the last call, and the first row it
+     * needs is one of them or the one after the last. Otherwise it
+     * computes every row it needs, as it would without carry_storage. A
+     * call that fails leaves the buffer holding no valid rows. Calls that
+     * share a buffer must not run at the same time.
+     */
+    // @{
+    Func &carry_storage(const Parameter &state);
+    template<typename T>
+    Func &carry_storage(const T &state) {
+        return carry_storage(state.parameter());
+    }
+    // @}
+
     /** Compute this function as needed for each unique value of the
      * given var for the given calling function f.
      *
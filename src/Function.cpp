@@ -13,6 +13,7 @@
 #include "ParallelRVar.h"
 #include "Random.h"
 #include "Scope.h"
+#include "Substitute.h"
 #include "Var.h"
 
 namespace Halide {
@@ -1023,6 +1024,46 @@ void Function::mutate(IRMutator *mutator) {
     contents->mutate(mutator);
 }
 
+namespace {
+
+class SubstituteParametersInFunction : public IRMutator {
+    const std::map<std::string, Parameter> &replacements;
+
+protected:
+    Expr mutate(const Expr &e) override {
+        return e.defined() ? substitute_parameters(replacements, e) : e;
+    }
+    Stmt mutate(const Stmt &s) override {
+        return s.defined() ? substitute_parameters(replacements, s) : s;
+    }
+
+public:
+    SubstituteParametersInFunction(const std::map<std::string, Parameter> &r)
+        : replacements(r) {
+    }
+};
+
+}  // namespace
+
+void Function::substitute_parameters(const std::map<std::string, Parameter> &replacements) {
+    SubstituteParametersInFunction mutator(replacements);
+    contents->mutate(&mutator);
+    for (Parameter &p : contents->output_buffers) {
+        auto it = replacements.find(p.name());
+        if (it != replacements.end()) {
+            p = it->second;
+        }
+    }
+    for (ExternFuncArgument &e : contents->extern_arguments) {
+        if (e.is_image_param()) {
+            auto it = replacements.find(e.image_param.name());
+            if (it != replacements.end()) {
+                e.image_param = it->second;
+            }
+        }
+    }
+}
+
 const std::string &Function::name() const {
     return contents->name;
 }
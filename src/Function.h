@@ -145,6 +145,12 @@ public:
      * arguments of this function. */
     void mutate(IRMutator *mutator);
 
+    /** Replace every reference this function makes to a Parameter
+     * (including its output buffers and extern arguments) with the
+     * Parameter of the same name in the map, if there is one. Meant for
+     * deep copies, as it modifies the definitions in place. */
+    void substitute_parameters(const std::map<std::string, Parameter> &replacements);
+
     /** Get the name of the function. */
     const std::string &name() const;
 
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <system_error>
 #include <vector>
 
@@ -52,6 +53,9 @@ namespace {
 // Bump this whenever the on-disk cache layout changes in an incompatible way.
 constexpr char kFormatVersion[] = "hlgc1";
 
+// Likewise for JIT object entries, which hold a single "object" blob.
+constexpr char kJITFormatVersion[] = "hljc1";
+
 // Default cache budget when HL_CACHE_MAX_SIZE is unset.
 constexpr uint64_t kDefaultMaxSizeBytes = 1024ull * 1024 * 1024;  // 1 GiB
 
@@ -706,5 +710,97 @@ void GeneratorCache::store(const std::string &key,
     prune_cache(root);
 }
 
+std::string JITObjectCache::cache_dir() {
+    static const std::string dir = get_env_variable("HL_JIT_CACHE_DIR");
+    return dir;
+}
+
+bool JITObjectCache::try_load(const std::string &key, std::vector<uint8_t> &object) {
+    object.clear();
+    const std::string dir = cache_dir();
+    if (dir.empty() || key.empty()) {
+        return false;
+    }
+
+    const fs::path entry = entry_dir(fs::path(dir), key);
+    std::ifstream manifest(entry / "manifest.txt", std::ios::binary);
+    if (!manifest) {
+        return false;
+    }
+    std::string version;
+    std::getline(manifest, version);
+    std::string expected_size;
+    std::getline(manifest, expected_size);
+    if (version != kJITFormatVersion || expected_size.empty()) {
+        return false;
+    }
+
+    std::ifstream f(entry / "object", std::ios::binary);
+    if (!f) {
+        return false;
+    }
+    object.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    // The manifest records the blob size, so a truncated blob is a miss
+    // rather than a malformed object handed to the JIT linker.
+    if (object.empty() || std::to_string(object.size()) != expected_size) {
+        object.clear();
+        return false;
+    }
+
+    touch_used(entry);
+    debug(1) << "JITObjectCache: hit for key " << key << "\n";
+    return true;
+}
+
+bool JITObjectCache::store(const std::string &key, const std::vector<uint8_t> &object) {
+    const std::string dir = cache_dir();
+    if (dir.empty() || key.empty() || object.empty()) {
+        return false;
+    }
+    const fs::path root = dir;
+    std::error_code ec;
+
+    const fs::path entry = entry_dir(root, key);
+    if (fs::exists(entry / "manifest.txt", ec)) {
+        return false;
+    }
+
+    fs::create_directories(root, ec);
+    const fs::path staging = make_staging_dir(root);
+    if (staging.empty()) {
+        debug(1) << "JITObjectCache: could not create staging dir; skipping store.\n";
+        return false;
+    }
+
+    {
+        std::ofstream f(staging / "object", std::ios::binary);
+        f.write(reinterpret_cast<const char *>(object.data()), object.size());
+        if (!f) {
+            debug(1) << "JITObjectCache: failed to stage object; skipping store.\n";
+            f.close();
+            fs::remove_all(staging, ec);
+            return false;
+        }
+    }
+    {
+        std::ofstream manifest(staging / "manifest.txt", std::ios::binary);
+        manifest << kJITFormatVersion << "\n"
+                 << object.size() << "\n";
+    }
+    touch_used(staging);
+
+    fs::create_directories(entry.parent_path(), ec);
+    fs::rename(staging, entry, ec);
+    if (ec) {
+        fs::remove_all(staging, ec);
+        return false;
+    }
+
+    debug(1) << "JITObjectCache: stored key " << key << "\n";
+
+    prune_cache(root);
+    return true;
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -15,6 +15,10 @@
  * and a fingerprint of the Halide compiler itself (see
  * compiler_identity_digest). If two invocations agree on all of these, they
  * must produce identical outputs, so the cached copies can be reused.
+ *
+ * The same content-addressed store also backs the JIT object cache (enabled
+ * by HL_JIT_CACHE_DIR), which persists the machine code produced by
+ * Pipeline::compile_jit and Pipeline::compile_to_callable across processes.
  */
 
 #include <cstdint>
@@ -92,6 +96,27 @@ struct GeneratorCache {
                       const std::map<OutputFileType, std::string> &output_files);
 };
 
+/** Opt-in, content-addressed cache for the object code produced when
+ * JIT-compiling a Pipeline. Active only when HL_JIT_CACHE_DIR names a
+ * directory. Entries share the on-disk layout, atomic install, and pruning
+ * limits (HL_CACHE_MAX_SIZE, HL_CACHE_MAX_AGE) of the GeneratorCache. */
+struct JITObjectCache {
+    /** The configured cache directory, or "" when HL_JIT_CACHE_DIR is unset
+     * or empty (i.e. caching disabled). Read once and memoized. */
+    static std::string cache_dir();
+
+    /** If a complete entry for `key` exists in the cache, read the cached
+     * object code into `object` and return true. Otherwise return false and
+     * leave `object` empty. A partial or corrupt entry is treated as a miss. */
+    static bool try_load(const std::string &key, std::vector<uint8_t> &object);
+
+    /** Install `object` into the cache under `key` (atomically, as for
+     * GeneratorCache::store), then opportunistically prune the cache. A
+     * no-op when caching is disabled or `object` is empty. Returns true if
+     * this call installed a new entry. */
+    static bool store(const std::string &key, const std::vector<uint8_t> &object);
+};
+
 }  // namespace Internal
 }  // namespace Halide
 
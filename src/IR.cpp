@@ -1,5 +1,6 @@
 #include "IR.h"
 
+#include "IRInterning.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
@@ -45,7 +46,7 @@ Expr Cast::make(Type t, Expr v) {
     Cast *node = new Cast;
     node->type = t;
     node->value = std::move(v);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Reinterpret::make(Type t, Expr v) {
@@ -61,7 +62,7 @@ Expr Reinterpret::make(Type t, Expr v) {
     Reinterpret *node = new Reinterpret;
     node->type = t;
     node->value = std::move(v);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Add::make(Expr a, Expr b) {
@@ -73,7 +74,7 @@ Expr Add::make(Expr a, Expr b) {
     node->type = a.type();
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Sub::make(Expr a, Expr b) {
@@ -85,7 +86,7 @@ Expr Sub::make(Expr a, Expr b) {
     node->type = a.type();
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Mul::make(Expr a, Expr b) {
@@ -97,7 +98,7 @@ Expr Mul::make(Expr a, Expr b) {
     node->type = a.type();
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Div::make(Expr a, Expr b) {
@@ -109,7 +110,7 @@ Expr Div::make(Expr a, Expr b) {
     node->type = a.type();
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Mod::make(Expr a, Expr b) {
@@ -121,7 +122,7 @@ Expr Mod::make(Expr a, Expr b) {
     node->type = a.type();
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Min::make(Expr a, Expr b) {
@@ -133,7 +134,7 @@ Expr Min::make(Expr a, Expr b) {
     node->type = a.type();
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Max::make(Expr a, Expr b) {
@@ -145,7 +146,7 @@ Expr Max::make(Expr a, Expr b) {
     node->type = a.type();
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr EQ::make(Expr a, Expr b) {
@@ -157,7 +158,7 @@ Expr EQ::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr NE::make(Expr a, Expr b) {
@@ -169,7 +170,7 @@ Expr NE::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr LT::make(Expr a, Expr b) {
@@ -181,7 +182,7 @@ Expr LT::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr LE::make(Expr a, Expr b) {
@@ -193,7 +194,7 @@ Expr LE::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr GT::make(Expr a, Expr b) {
@@ -205,7 +206,7 @@ Expr GT::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr GE::make(Expr a, Expr b) {
@@ -217,7 +218,7 @@ Expr GE::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr And::make(Expr a, Expr b) {
@@ -231,7 +232,7 @@ Expr And::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Or::make(Expr a, Expr b) {
@@ -245,7 +246,7 @@ Expr Or::make(Expr a, Expr b) {
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
     node->b = std::move(b);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Not::make(Expr a) {
@@ -255,7 +256,7 @@ Expr Not::make(Expr a) {
     Not *node = new Not;
     node->type = Bool(a.type().lanes());
     node->a = std::move(a);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Select::make(Expr condition, Expr true_value, Expr false_value) {
@@ -272,7 +273,7 @@ Expr Select::make(Expr condition, Expr true_value, Expr false_value) {
     node->condition = std::move(condition);
     node->true_value = std::move(true_value);
     node->false_value = std::move(false_value);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Load::make(Type type, const std::string &name, Expr index, Buffer<> image, Parameter param, Expr predicate, ModulusRemainder alignment, bool is_streaming) {
@@ -323,7 +324,7 @@ Expr Ramp::make(Expr base, Expr stride, int lanes) {
     node->base = std::move(base);
     node->stride = std::move(stride);
     node->lanes = lanes;
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Broadcast::make(Expr value, int lanes) {
@@ -334,7 +335,7 @@ Expr Broadcast::make(Expr value, int lanes) {
     node->type = value.type().with_lanes(lanes * value.type().lanes());
     node->value = std::move(value);
     node->lanes = lanes;
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Let::make(const std::string &name, Expr value, Expr body) {
@@ -963,7 +964,7 @@ Expr Call::make(Type type, const std::string &name, const std::vector<Expr> &arg
     node->value_index = value_index;
     node->image = std::move(image);
     node->param = std::move(param);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Call::with(const std::vector<Expr> &args) const {
@@ -981,7 +982,7 @@ Expr Variable::make(Type type, const std::string &name, Buffer<> image, Paramete
     node->image = std::move(image);
     node->param = std::move(param);
     node->reduction_domain = std::move(reduction_domain);
-    return node;
+    return intern_expr_node(node);
 }
 
 Expr Shuffle::make(const std::vector<Expr> &vectors,
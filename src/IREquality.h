@@ -10,6 +10,7 @@
  */
 
 #include "Expr.h"
+#include "IRInterning.h"
 
 namespace Halide {
 namespace Internal {
@@ -38,7 +39,7 @@ HALIDE_ALWAYS_INLINE
 bool equal(const IRNode &a, const IRNode &b) {
     if (&a == &b) {
         return true;
-    } else if (a.node_type != b.node_type) {
+    } else if (a.node_type != b.node_type || known_unequal(a, b)) {
         return false;
     } else {
         return equal_impl(a, b);
@@ -63,7 +64,7 @@ HALIDE_ALWAYS_INLINE
 bool graph_equal(const IRNode &a, const IRNode &b) {
     if (&a == &b) {
         return true;
-    } else if (a.node_type != b.node_type) {
+    } else if (a.node_type != b.node_type || known_unequal(a, b)) {
         return false;
     } else {
         return graph_equal_impl(a, b);
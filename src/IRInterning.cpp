@@ -0,0 +1,434 @@
+#include "IRInterning.h"
+#include "IR.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// Interned nodes are looked up by their immediate contents only: their
+// type, any names or scalar fields, and the identities of their operands.
+// Since operands are themselves interned, this is enough to find a node
+// that is equal in the deep sense of IREquality. Constants are the
+// exception, as they are compared by value, so that they don't need
+// interning themselves (IntImm::make and friends return raw pointers,
+// which the caller may not have taken a reference to yet).
+
+template<typename T>
+const T *node_as(const BaseExprNode *e) {
+    return e->node_type == T::_node_type ? (const T *)e : nullptr;
+}
+
+bool is_constant(const Expr &e) {
+    IRNodeType t = e->node_type;
+    return t == IRNodeType::IntImm || t == IRNodeType::UIntImm || t == IRNodeType::FloatImm;
+}
+
+// The operands of an interned node that isn't a Variable or a Call.
+int fixed_operands(const BaseExprNode *e, const Expr *ops[3]) {
+    switch (e->node_type) {
+#define HALIDE_BINARY_OPERANDS(T)  \
+    case IRNodeType::T:            \
+        ops[0] = &((const T *)e)->a; \
+        ops[1] = &((const T *)e)->b; \
+        return 2;
+        HALIDE_BINARY_OPERANDS(Add)
+        HALIDE_BINARY_OPERANDS(Sub)
+        HALIDE_BINARY_OPERANDS(Mul)
+        HALIDE_BINARY_OPERANDS(Div)
+        HALIDE_BINARY_OPERANDS(Mod)
+        HALIDE_BINARY_OPERANDS(Min)
+        HALIDE_BINARY_OPERANDS(Max)
+        HALIDE_BINARY_OPERANDS(EQ)
+        HALIDE_BINARY_OPERANDS(NE)
+        HALIDE_BINARY_OPERANDS(LT)
+        HALIDE_BINARY_OPERANDS(LE)
+        HALIDE_BINARY_OPERANDS(GT)
+        HALIDE_BINARY_OPERANDS(GE)
+        HALIDE_BINARY_OPERANDS(And)
+        HALIDE_BINARY_OPERANDS(Or)
+#undef HALIDE_BINARY_OPERANDS
+    case IRNodeType::Not:
+        ops[0] = &((const Not *)e)->a;
+        return 1;
+    case IRNodeType::Cast:
+        ops[0] = &((const Cast *)e)->value;
+        return 1;
+    case IRNodeType::Reinterpret:
+        ops[0] = &((const Reinterpret *)e)->value;
+        return 1;
+    case IRNodeType::Broadcast:
+        ops[0] = &((const Broadcast *)e)->value;
+        return 1;
+    case IRNodeType::Ramp:
+        ops[0] = &((const Ramp *)e)->base;
+        ops[1] = &((const Ramp *)e)->stride;
+        return 2;
+    case IRNodeType::Select:
+        ops[0] = &((const Select *)e)->condition;
+        ops[1] = &((const Select *)e)->true_value;
+        ops[2] = &((const Select *)e)->false_value;
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+size_t hash_combine(size_t h, size_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+size_t hash_type(const Type &t) {
+    return ((size_t)t.code() << 24) ^ ((size_t)t.bits() << 16) ^ (size_t)t.lanes();
+}
+
+size_t hash_constant(const Expr &e) {
+    size_t h = hash_combine((size_t)e->node_type, hash_type(e.type()));
+    if (const IntImm *i = e.as<IntImm>()) {
+        return hash_combine(h, std::hash<int64_t>()(i->value));
+    } else if (const UIntImm *u = e.as<UIntImm>()) {
+        return hash_combine(h, std::hash<uint64_t>()(u->value));
+    } else {
+        // As in IREquality, all NaNs are the same, and so are 0 and -0.
+        double f = e.as<FloatImm>()->value;
+        return hash_combine(h, std::isnan(f) ? 1 : std::hash<double>()(f == 0 ? 0.0 : f));
+    }
+}
+
+size_t hash_operand(const Expr &e) {
+    if (is_constant(e)) {
+        return hash_constant(e);
+    } else {
+        return std::hash<const void *>()(e.get());
+    }
+}
+
+// Fold a hash into the 16 bits stored in IRNode::structural_hash, where
+// zero means it hasn't been computed.
+uint16_t fold_hash(size_t h) {
+    uint64_t h64 = h;
+    h64 ^= h64 >> 32;
+    h64 ^= h64 >> 16;
+    return (uint16_t)h64 ? (uint16_t)h64 : 1;
+}
+
+// The structural hash of an operand of an interned node, which is either
+// interned, and so has one already, or is a constant.
+uint16_t structural_hash_of_operand(const Expr &e) {
+    uint16_t h = e->structural_hash.load(std::memory_order_relaxed);
+    if (!h) {
+        h = fold_hash(hash_constant(e));
+        e->structural_hash.store(h, std::memory_order_relaxed);
+    }
+    return h;
+}
+
+bool same_operand(const Expr &a, const Expr &b) {
+    if (a.same_as(b)) {
+        return true;
+    } else if (a->node_type != b->node_type || a.type() != b.type()) {
+        return false;
+    } else if (const IntImm *i = a.as<IntImm>()) {
+        return i->value == b.as<IntImm>()->value;
+    } else if (const UIntImm *u = a.as<UIntImm>()) {
+        return u->value == b.as<UIntImm>()->value;
+    } else if (const FloatImm *f = a.as<FloatImm>()) {
+        double fb = b.as<FloatImm>()->value;
+        return (std::isnan(f->value) && std::isnan(fb)) || f->value == fb;
+    } else {
+        return false;
+    }
+}
+
+// Hash the immediate contents of a node that can be interned, using the
+// given function to hash its operands.
+template<typename HashOperand>
+size_t hash_node(const BaseExprNode *e, HashOperand hash_operand) {
+    size_t h = hash_combine((size_t)e->node_type, hash_type(e->type));
+    if (const Variable *v = node_as<Variable>(e)) {
+        return hash_combine(h, std::hash<std::string>()(v->name));
+    } else if (const Call *c = node_as<Call>(e)) {
+        h = hash_combine(h, std::hash<std::string>()(c->name));
+        h = hash_combine(h, (size_t)c->call_type);
+        h = hash_combine(h, (size_t)c->value_index);
+        for (const Expr &arg : c->args) {
+            h = hash_combine(h, hash_operand(arg));
+        }
+        return h;
+    }
+    const Expr *ops[3];
+    int n = fixed_operands(e, ops);
+    for (int i = 0; i < n; i++) {
+        h = hash_combine(h, hash_operand(*ops[i]));
+    }
+    return h;
+}
+
+// The hash the intern table uses, which uses the identities of
+// non-constant operands.
+size_t shallow_hash(const BaseExprNode *e) {
+    return hash_node(e, hash_operand);
+}
+
+// The hash that is cached on the node. This one doesn't depend on where
+// nodes are in memory, so it is the same for equal nodes interned by
+// different scopes.
+uint16_t structural_hash(const BaseExprNode *e) {
+    return fold_hash(hash_node(e, [](const Expr &op) { return (size_t)structural_hash_of_operand(op); }));
+}
+
+bool shallow_equal(const BaseExprNode *a, const BaseExprNode *b) {
+    if (a->node_type != b->node_type || a->type != b->type) {
+        return false;
+    }
+    if (const Variable *va = node_as<Variable>(a)) {
+        return va->name == ((const Variable *)b)->name;
+    } else if (const Call *ca = node_as<Call>(a)) {
+        const Call *cb = (const Call *)b;
+        if (ca->name != cb->name ||
+            ca->call_type != cb->call_type ||
+            ca->value_index != cb->value_index ||
+            ca->args.size() != cb->args.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < ca->args.size(); i++) {
+            if (!same_operand(ca->args[i], cb->args[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const Expr *ops_a[3], *ops_b[3];
+    int n = fixed_operands(a, ops_a);
+    fixed_operands(b, ops_b);
+    for (int i = 0; i < n; i++) {
+        if (!same_operand(*ops_a[i], *ops_b[i])) {
+            return false;
+        }
+    }
+    // Ramps and Broadcasts carry their lanes in their type.
+    return true;
+}
+
+}  // namespace
+
+// An open-addressing hash set of interned nodes, which keeps the hash of
+// each node alongside it. It holds a reference to each of its nodes, so
+// that a node never has to remove itself from it when it dies, and the
+// table can be private to its thread.
+class InternTable {
+    struct Slot {
+        size_t hash;
+        Expr node;
+    };
+    std::vector<Slot> slots;
+    size_t used = 0;
+
+    // Check if this exact node is in the table.
+    bool contains(const BaseExprNode *node) const {
+        if (slots.empty()) {
+            return false;
+        }
+        size_t hash = shallow_hash(node);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; slots[i].node.defined(); i = (i + 1) & mask) {
+            if (slots[i].node.get() == node) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Called when the table is half full. Drops the nodes nothing else
+    // refers to any more, as no one can build on them, and then rehashes
+    // into a table at least four times the size of what is left. Nodes
+    // freed by dropping others go on the next time around.
+    void make_room() {
+        std::vector<Slot> old = std::move(slots);
+        size_t live = 0;
+        for (Slot &s : old) {
+            if (s.node.defined()) {
+                if (s.node.get()->ref_count.atomic_get() == 1) {
+                    s.node = Expr();
+                } else {
+                    live++;
+                }
+            }
+        }
+        size_t size = 1024;
+        while (size < live * 4) {
+            size *= 2;
+        }
+        slots.clear();
+        slots.resize(size);
+        used = live;
+        size_t mask = size - 1;
+        for (Slot &s : old) {
+            if (s.node.defined()) {
+                size_t i = s.hash & mask;
+                while (slots[i].node.defined()) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = std::move(s);
+            }
+        }
+    }
+
+public:
+    // The number of the scope that owns the table, or zero if all the
+    // numbers were taken. Nodes in the table are marked with it.
+    const uint8_t scope;
+
+    InternTable(uint8_t scope)
+        : scope(scope) {
+    }
+
+    ~InternTable() {
+        for (const Slot &s : slots) {
+            if (s.node.defined()) {
+                s.node->intern_scope.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Check if a node is in the table.
+    bool is_interned(const BaseExprNode *node) const {
+        if (scope) {
+            return node->intern_scope.load(std::memory_order_relaxed) == scope;
+        } else {
+            return contains(node);
+        }
+    }
+
+    // Find the node equal to the given one, or insert the given one if
+    // there isn't one.
+    const Expr &find_or_insert(const Expr &node) {
+        if ((used + 1) * 2 > slots.size()) {
+            make_room();
+        }
+        size_t hash = shallow_hash(node.get());
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        for (; slots[i].node.defined(); i = (i + 1) & mask) {
+            if (slots[i].hash == hash && shallow_equal(slots[i].node.get(), node.get())) {
+                return slots[i].node;
+            }
+        }
+        node->structural_hash.store(structural_hash(node.get()), std::memory_order_relaxed);
+        node->intern_scope.store(scope, std::memory_order_relaxed);
+        slots[i] = Slot{hash, node};
+        used++;
+        return slots[i].node;
+    }
+};
+
+namespace {
+
+bool can_intern_operand(const Expr &e, const InternTable &table) {
+    return e.defined() && (is_constant(e) || table.is_interned(e.get()));
+}
+
+bool can_intern(const BaseExprNode *e, const InternTable &table) {
+    if (e->type.is_handle()) {
+        return false;
+    }
+    if (const Variable *v = node_as<Variable>(e)) {
+        // IREquality ignores these, so they must not be merged.
+        return !v->image.defined() && !v->param.defined() && !v->reduction_domain.defined();
+    } else if (const Call *c = node_as<Call>(e)) {
+        if (!(c->call_type == Call::PureIntrinsic || c->call_type == Call::PureExtern) ||
+            c->func.defined() || c->image.defined() || c->param.defined()) {
+            return false;
+        }
+        for (const Expr &arg : c->args) {
+            if (!can_intern_operand(arg, table)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const Expr *ops[3];
+    int n = fixed_operands(e, ops);
+    if (n < 0) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        if (!can_intern_operand(*ops[i], table)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The table of the active scope on this thread, if any.
+thread_local InternTable *current_table = nullptr;
+
+// The scope numbers in use. A number is only given out again once the
+// scope that had it has unmarked all its nodes, so that a node marked
+// with the number of the scope active on a thread is in that scope's
+// table.
+std::mutex scope_mutex;
+bool scope_in_use[256] = {true};
+uint8_t last_scope = 0;
+
+uint8_t acquire_scope() {
+    std::lock_guard<std::mutex> lock(scope_mutex);
+    for (int i = 0; i < 255; i++) {
+        last_scope = last_scope == 255 ? 1 : last_scope + 1;
+        if (!scope_in_use[last_scope]) {
+            scope_in_use[last_scope] = true;
+            return last_scope;
+        }
+    }
+    return 0;
+}
+
+void release_scope(uint8_t scope) {
+    std::lock_guard<std::mutex> lock(scope_mutex);
+    scope_in_use[scope] = false;
+}
+
+}  // namespace
+
+ScopedIRInterning::ScopedIRInterning() {
+    if (current_table) {
+        return;
+    }
+    scope = acquire_scope();
+    table = std::make_unique<InternTable>(scope);
+    current_table = table.get();
+}
+
+ScopedIRInterning::~ScopedIRInterning() {
+    if (table) {
+        current_table = nullptr;
+        table.reset();
+        if (scope) {
+            release_scope(scope);
+        }
+    }
+}
+
+bool is_current_intern_scope(uint8_t scope) {
+    return current_table && current_table->scope == scope;
+}
+
+Expr intern_expr_node(const BaseExprNode *node) {
+    Expr fresh(node);
+    InternTable *table = current_table;
+    if (!table || !can_intern(node, *table)) {
+        return fresh;
+    }
+    return table->find_or_insert(fresh);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,87 @@
+#ifndef HALIDE_IR_INTERNING_H
+#define HALIDE_IR_INTERNING_H
+
+/** \file
+ * Defines an optional mode in which IR construction is hash-consed, so
+ * that structurally equal Exprs share one node.
+ */
+
+#include <cstdint>
+#include <memory>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class InternTable;
+
+/** While an object of this type is alive, the Expr node constructors
+ * (Add::make, etc) called on this thread return an existing live node
+ * instead of a new one whenever it would be equal to the new one. Such
+ * nodes are said to be interned. Equal expressions built in the scope
+ * are then the same node, so equal() and graph_equal() on them stop at
+ * their pointer comparison, and common subexpressions come out already
+ * shared.
+ *
+ * Only side-effect-free nodes whose operands are all interned nodes or
+ * constants are interned: Variables without a parameter, buffer, or
+ * reduction domain, casts, arithmetic, comparisons, logical operators,
+ * selects, ramps, broadcasts, and pure intrinsic and pure extern calls.
+ * Constants themselves are compared by value instead, and nodes of
+ * handle type are not interned. The table belongs to this thread, and
+ * holds a reference to each of its nodes, so ordinary nodes pay nothing
+ * for the mode when they are destroyed. It lets go of the nodes nothing
+ * else refers to whenever it fills up, and of the rest when the scope
+ * ends.
+ *
+ * Each interned node records the scope in IRNode::intern_scope, so that
+ * two different nodes interned by the scope active on the calling thread
+ * are known to be unequal without looking at them further. Interned nodes
+ * and constants also carry their IRNode::structural_hash, which they
+ * keep after the scope ends. When the scope ends, its nodes go back to
+ * being ordinary nodes.
+ *
+ * A scope made while another is active on the same thread does nothing.
+ * Lowering runs in a scope when the environment variable HL_INTERN_IR is
+ * set to 1. */
+class ScopedIRInterning {
+    std::unique_ptr<InternTable> table;
+    uint8_t scope = 0;
+
+public:
+    ScopedIRInterning();
+    ~ScopedIRInterning();
+
+    ScopedIRInterning(const ScopedIRInterning &) = delete;
+    ScopedIRInterning &operator=(const ScopedIRInterning &) = delete;
+};
+
+/** Return the interned node equal to a newly-made node, which is
+ * interned first if there is no such node yet. Returns the node itself
+ * if there is no ScopedIRInterning active on this thread, or if the node
+ * can't be interned. Used by the Expr node constructors. */
+Expr intern_expr_node(const BaseExprNode *node);
+
+/** Check if the scope with the given number is the ScopedIRInterning
+ * active on this thread. */
+bool is_current_intern_scope(uint8_t scope);
+
+/** Check if two different nodes are known to be unequal from their
+ * structural hashes, or from both being interned by the scope active on
+ * this thread. Used by equal() and graph_equal(). */
+HALIDE_ALWAYS_INLINE
+bool known_unequal(const IRNode &a, const IRNode &b) {
+    uint16_t ha = a.structural_hash.load(std::memory_order_relaxed);
+    uint16_t hb = b.structural_hash.load(std::memory_order_relaxed);
+    if (ha && hb && ha != hb) {
+        return true;
+    }
+    uint8_t sa = a.intern_scope.load(std::memory_order_relaxed);
+    return sa && sa == b.intern_scope.load(std::memory_order_relaxed) && is_current_intern_scope(sa);
+}
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
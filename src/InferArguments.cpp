@@ -169,6 +169,10 @@ private:
 
         func.accept(this);
 
+        // The buffer the Function carries its storage across calls in is
+        // an argument too, though no Expr refers to it.
+        include_parameter(func.schedule().carried_storage());
+
         // Function::accept hits all the Expr children of the
         // Function, but misses the buffers and images that might be
         // extern arguments.
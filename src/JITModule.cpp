@@ -333,6 +333,34 @@ public:
     void deregisterEHFrames() override {};
 };
 
+// An llvm::ObjectCache that never supplies objects, but records a copy of the
+// object code that the JIT compiler produces, so that it can be persisted by
+// the JITObjectCache and reloaded in a later process.
+class CapturingObjectCache : public llvm::ObjectCache {
+    std::vector<uint8_t> &object;
+
+public:
+    CapturingObjectCache(std::vector<uint8_t> &object)
+        : object(object) {
+    }
+
+    void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef obj) override {
+        object.assign(obj.getBufferStart(), obj.getBufferEnd());
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        return nullptr;
+    }
+};
+
+void compile_module_impl(
+    IntrusivePtr<JITModuleContents> &jit_module,
+    std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
+    const std::vector<JITModule> &dependencies,
+    const std::vector<std::string> &requested_exports,
+    const std::vector<uint8_t> *object_in = nullptr,
+    std::vector<uint8_t> *object_out = nullptr);
+
 }  // namespace
 
 JITModule::JITModule() {
@@ -340,24 +368,53 @@ JITModule::JITModule() {
 }
 
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
-                     const std::vector<JITModule> &dependencies) {
+                     const std::vector<JITModule> &dependencies,
+                     std::vector<uint8_t> *object_out) {
     jit_module = new JITModuleContents();
     std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, *jit_module->context));
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+    run_with_large_stack([&]() {
+        compile_module_impl(jit_module, std::move(llvm_module), fn.name, m.target(),
+                            deps_with_runtime, {}, nullptr, object_out);
+    });
     // If -time-passes is in HL_LLVM_ARGS, this will print llvm pass time
     // statistics. Otherwise it's a no-op.
     llvm::reportAndResetTimings();
 }
 
+/*static*/
+JITModule JITModule::load_object(const std::vector<uint8_t> &object,
+                                 const std::string &function_name, const Target &target,
+                                 const std::vector<JITModule> &dependencies) {
+    internal_assert(!object.empty()) << "Cannot load an empty object for " << function_name << "\n";
+    JITModule result;
+    // Only the triple of this module is used: it stands in for the IR
+    // module when building the TargetMachine that links the object.
+    auto stub = std::make_unique<llvm::Module>(function_name, *result.jit_module->context);
+    stub->setTargetTriple(get_triple_for_target(target));
+    std::vector<JITModule> deps_with_runtime = dependencies;
+    // The shared runtime normally clones its target options from the first
+    // IR module it sees. A warm start may have no IR module at all, in which
+    // case the runtime uses the defaults for the target.
+    std::vector<JITModule> shared_runtime = JITSharedRuntime::get(nullptr, target);
+    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+    run_with_large_stack([&]() {
+        compile_module_impl(result.jit_module, std::move(stub), function_name, target,
+                            deps_with_runtime, {}, &object, nullptr);
+    });
+    return result;
+}
+
 namespace {
 void compile_module_impl(
     IntrusivePtr<JITModuleContents> &jit_module,
     std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
     const std::vector<JITModule> &dependencies,
-    const std::vector<std::string> &requested_exports) {
+    const std::vector<std::string> &requested_exports,
+    const std::vector<uint8_t> *object_in,
+    std::vector<uint8_t> *object_out) {
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
@@ -372,7 +429,6 @@ void compile_module_impl(
     llvm::TargetOptions options;
     get_target_options(*m, options);
 
-    DataLayout initial_module_data_layout = m->getDataLayout();
     string module_name = m->getModuleIdentifier();
 
     // Build TargetMachine
@@ -387,6 +443,12 @@ void compile_module_impl(
     internal_assert(tm) << llvm::toString(tm.takeError()) << "\n";
 
     DataLayout target_data_layout(tm.get()->createDataLayout());
+    if (object_in) {
+        // A previously compiled object carries no IR, so the stub module
+        // takes its data layout from the TargetMachine.
+        m->setDataLayout(target_data_layout);
+    }
+    DataLayout initial_module_data_layout = m->getDataLayout();
     if (initial_module_data_layout != target_data_layout) {
         internal_error << "Warning: data layout mismatch between module ("
                        << initial_module_data_layout.getStringRepresentation()
@@ -394,10 +456,23 @@ void compile_module_impl(
                        << target_data_layout.getStringRepresentation() << ")\n";
     }
 
+    // Object code is only worth capturing if it is self-contained: static
+    // constructors and destructors are run from the IR module, which a later
+    // load_object() won't have.
+    std::unique_ptr<CapturingObjectCache> object_cache;
+    if (object_out) {
+        object_out->clear();
+        auto ctors = llvm::orc::getConstructors(*m);
+        auto dtors = llvm::orc::getDestructors(*m);
+        if (ctors.begin() == ctors.end() && dtors.begin() == dtors.end()) {
+            object_cache = std::make_unique<CapturingObjectCache>(*object_out);
+        }
+    }
+
     // Create LLJIT
     const auto compilerBuilder = [&](const llvm::orc::JITTargetMachineBuilder & /*jtmb*/)
         -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
-        return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*tm));
+        return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*tm), object_cache.get());
     };
 
     llvm::orc::LLJITBuilderState::ObjectLinkingLayerCreator linkerBuilder;
@@ -466,8 +541,14 @@ void compile_module_impl(
     internal_assert(gen) << llvm::toString(gen.takeError()) << "\n";
     JIT->getMainJITDylib().addGenerator(std::move(gen.get()));
 
-    llvm::orc::ThreadSafeModule tsm(std::move(m), std::move(jit_module->context));
-    auto err = JIT->addIRModule(std::move(tsm));
+    auto err = [&]() -> llvm::Error {
+        if (object_in) {
+            llvm::StringRef object_data(reinterpret_cast<const char *>(object_in->data()), object_in->size());
+            return JIT->addObjectFile(llvm::MemoryBuffer::getMemBufferCopy(object_data, module_name));
+        }
+        llvm::orc::ThreadSafeModule tsm(std::move(m), std::move(jit_module->context));
+        return JIT->addIRModule(std::move(tsm));
+    }();
     internal_assert(!err) << llvm::toString(std::move(err)) << "\n";
 
     // Resolve symbol dependencies
@@ -669,6 +750,35 @@ void JITModule::memoization_cache_evict(uint64_t eviction_key) const {
     }
 }
 
+halide_memoization_cache_policy_t JITModule::memoization_cache_set_policy(halide_memoization_cache_policy_t p) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_policy");
+    if (f != exports().end()) {
+        using set_policy_fn = halide_memoization_cache_policy_t (*)(halide_memoization_cache_policy_t);
+        return (reinterpret_bits<set_policy_fn>(f->second.address))(p);
+    }
+    return halide_memoization_cache_policy_lru;
+}
+
+halide_memoization_cache_stats_t JITModule::memoization_cache_get_stats(const std::string &pipeline_name) const {
+    halide_memoization_cache_stats_t stats = {};
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_get_stats");
+    if (f != exports().end()) {
+        using get_stats_fn = int (*)(void *, const char *, halide_memoization_cache_stats_t *);
+        (reinterpret_bits<get_stats_fn>(f->second.address))(nullptr, pipeline_name.empty() ? nullptr : pipeline_name.c_str(), &stats);
+    }
+    return stats;
+}
+
+void JITModule::memoization_cache_reset_stats() const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_reset_stats");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)()>(f->second.address))();
+    }
+}
+
 void JITModule::reuse_device_allocations(bool b) const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_reuse_device_allocations");
@@ -677,6 +787,41 @@ void JITModule::reuse_device_allocations(bool b) const {
     }
 }
 
+void JITModule::reuse_host_allocations(bool b) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_reuse_host_allocations");
+    if (f != exports().end()) {
+        (reinterpret_bits<int (*)(void *, bool)>(f->second.address))(nullptr, b);
+    }
+}
+
+void JITModule::release_unused_host_allocations() const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_release_unused_host_allocations");
+    if (f != exports().end()) {
+        (reinterpret_bits<int (*)(void *)>(f->second.address))(nullptr);
+    }
+}
+
+int64_t JITModule::host_allocation_pool_set_limit(int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_host_allocation_pool_set_limit");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int64_t (*)(int64_t)>(f->second.address))(size);
+    }
+    return 0;
+}
+
+halide_host_allocation_pool_stats_t JITModule::host_allocation_pool_get_stats() const {
+    halide_host_allocation_pool_stats_t stats = {};
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_host_allocation_pool_get_stats");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(halide_host_allocation_pool_stats_t *)>(f->second.address))(&stats);
+    }
+    return stats;
+}
+
 int JITModule::get_num_threads() const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_get_num_threads");
@@ -695,6 +840,26 @@ int JITModule::set_num_threads(int n) const {
     return 1;
 }
 
+halide_thread_pool_scheduler_t JITModule::set_thread_pool_scheduler(halide_thread_pool_scheduler_t s) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_set_thread_pool_scheduler");
+    if (f != exports().end()) {
+        using set_scheduler_fn = halide_thread_pool_scheduler_t (*)(halide_thread_pool_scheduler_t);
+        return (reinterpret_bits<set_scheduler_fn>(f->second.address))(s);
+    }
+    return halide_thread_pool_scheduler_shared_queue;
+}
+
+halide_numa_policy_t JITModule::set_numa_policy(halide_numa_policy_t p) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_set_numa_policy");
+    if (f != exports().end()) {
+        using set_policy_fn = halide_numa_policy_t (*)(halide_numa_policy_t);
+        return (reinterpret_bits<set_policy_fn>(f->second.address))(p);
+    }
+    return halide_numa_policy_none;
+}
+
 bool JITModule::compiled() const {
     return jit_module->JIT != nullptr;
 }
@@ -1236,11 +1401,46 @@ void JITSharedRuntime::memoization_cache_evict(uint64_t eviction_key) {
     shared_runtimes(MainShared).memoization_cache_evict(eviction_key);
 }
 
+halide_memoization_cache_policy_t JITSharedRuntime::memoization_cache_set_policy(halide_memoization_cache_policy_t p) {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).memoization_cache_set_policy(p);
+}
+
+halide_memoization_cache_stats_t JITSharedRuntime::memoization_cache_get_stats(const std::string &pipeline_name) {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).memoization_cache_get_stats(pipeline_name);
+}
+
+void JITSharedRuntime::memoization_cache_reset_stats() {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_reset_stats();
+}
+
 void JITSharedRuntime::reuse_device_allocations(bool b) {
     std::scoped_lock lock(shared_runtimes_mutex);
     shared_runtimes(MainShared).reuse_device_allocations(b);
 }
 
+void JITSharedRuntime::reuse_host_allocations(bool b) {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).reuse_host_allocations(b);
+}
+
+void JITSharedRuntime::release_unused_host_allocations() {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).release_unused_host_allocations();
+}
+
+int64_t JITSharedRuntime::host_allocation_pool_set_limit(int64_t size) {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).host_allocation_pool_set_limit(size);
+}
+
+halide_host_allocation_pool_stats_t JITSharedRuntime::host_allocation_pool_get_stats() {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).host_allocation_pool_get_stats();
+}
+
 int JITSharedRuntime::get_num_threads() {
     std::scoped_lock lock(shared_runtimes_mutex);
     return shared_runtimes(MainShared).get_num_threads();
@@ -1251,6 +1451,16 @@ int JITSharedRuntime::set_num_threads(int n) {
     return shared_runtimes(MainShared).set_num_threads(n);
 }
 
+halide_thread_pool_scheduler_t JITSharedRuntime::set_thread_pool_scheduler(halide_thread_pool_scheduler_t s) {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).set_thread_pool_scheduler(s);
+}
+
+halide_numa_policy_t JITSharedRuntime::set_numa_policy(halide_numa_policy_t p) {
+    std::scoped_lock lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).set_numa_policy(p);
+}
+
 void *JITSharedRuntime::find_symbol(const Target &target, const std::string &name) {
     for (const JITModule &m : JITSharedRuntime::get(nullptr, target, false)) {
         JITModule::Symbol sym = m.find_symbol_by_name(name);
@@ -1382,7 +1592,7 @@ JITFuncCallContext::JITFuncCallContext(JITUserContext *context, const JITHandler
              << "custom_trace: " << (void *)context->handlers.custom_trace << "\n";
 }
 
-void JITFuncCallContext::finalize(int exit_status) {
+std::string JITFuncCallContext::error_message(int exit_status) const {
     // Only report the errors if no custom error handler was installed
     if (exit_status && !custom_error_handler) {
         std::string output = error_buffer.str();
@@ -1391,6 +1601,14 @@ void JITFuncCallContext::finalize(int exit_status) {
                       std::to_string(exit_status) +
                       " but halide_error was never called.\n");
         }
+        return output;
+    }
+    return "";
+}
+
+void JITFuncCallContext::finalize(int exit_status) {
+    std::string output = error_message(exit_status);
+    if (!output.empty()) {
         halide_runtime_error << output;
         error_buffer.end = 0;
     }
@@ -155,8 +155,22 @@ struct JITModule {
     };
 
     JITModule();
+
+    /** Compile a lowered Module to machine code. If object_out is non-null,
+     * it receives a copy of the object code produced by the JIT compiler,
+     * suitable for passing to load_object() in a later process. It is left
+     * empty if the module can't be reloaded that way (e.g. it has static
+     * constructors). */
     JITModule(const Module &m, const LoweredFunc &fn,
-              const std::vector<JITModule> &dependencies = std::vector<JITModule>());
+              const std::vector<JITModule> &dependencies = std::vector<JITModule>(),
+              std::vector<uint8_t> *object_out = nullptr);
+
+    /** Link object code previously captured by the JITModule constructor,
+     * without lowering or running LLVM codegen. The entrypoint and argv
+     * entrypoint of function_name are exported as usual. */
+    static JITModule load_object(const std::vector<uint8_t> &object,
+                                 const std::string &function_name, const Target &target,
+                                 const std::vector<JITModule> &dependencies = std::vector<JITModule>());
 
     /** Take a list of JITExterns and generate trampoline functions
      * which can be called dynamically via a function pointer that
@@ -244,15 +258,42 @@ struct JITModule {
     /** See JITSharedRuntime::memoization_cache_evict */
     void memoization_cache_evict(uint64_t eviction_key) const;
 
+    /** See JITSharedRuntime::memoization_cache_set_policy */
+    halide_memoization_cache_policy_t memoization_cache_set_policy(halide_memoization_cache_policy_t) const;
+
+    /** See JITSharedRuntime::memoization_cache_get_stats */
+    halide_memoization_cache_stats_t memoization_cache_get_stats(const std::string &pipeline_name) const;
+
+    /** See JITSharedRuntime::memoization_cache_reset_stats */
+    void memoization_cache_reset_stats() const;
+
     /** See JITSharedRuntime::reuse_device_allocations */
     void reuse_device_allocations(bool) const;
 
+    /** See JITSharedRuntime::reuse_host_allocations */
+    void reuse_host_allocations(bool) const;
+
+    /** See JITSharedRuntime::release_unused_host_allocations */
+    void release_unused_host_allocations() const;
+
+    /** See JITSharedRuntime::host_allocation_pool_set_limit */
+    int64_t host_allocation_pool_set_limit(int64_t size) const;
+
+    /** See JITSharedRuntime::host_allocation_pool_get_stats */
+    halide_host_allocation_pool_stats_t host_allocation_pool_get_stats() const;
+
     /** See JITSharedRuntime::get_num_threads */
     int get_num_threads() const;
 
     /** See JITSharedRuntime::set_num_threads */
     int set_num_threads(int) const;
 
+    /** See JITSharedRuntime::set_thread_pool_scheduler */
+    halide_thread_pool_scheduler_t set_thread_pool_scheduler(halide_thread_pool_scheduler_t) const;
+
+    /** See JITSharedRuntime::set_numa_policy */
+    halide_numa_policy_t set_numa_policy(halide_numa_policy_t) const;
+
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
 };
@@ -277,6 +318,20 @@ public:
      */
     static void memoization_cache_evict(uint64_t eviction_key);
 
+    /** Select the eviction policy of the memoization cache. See
+     * halide_memoization_cache_policy_t. Returns the old policy. */
+    static halide_memoization_cache_policy_t memoization_cache_set_policy(halide_memoization_cache_policy_t);
+
+    /** Get the hit, miss and eviction counts of the memoization cache
+     * for the named pipeline (the name of its output Func), or for all
+     * pipelines if the name is empty. If you are compiling statically,
+     * you should include HalideRuntime.h and call
+     * halide_memoization_cache_get_stats() instead. */
+    static halide_memoization_cache_stats_t memoization_cache_get_stats(const std::string &pipeline_name = "");
+
+    /** Reset the counts returned by memoization_cache_get_stats to zero. */
+    static void memoization_cache_reset_stats();
+
     /** Set whether or not Halide may hold onto and reuse device
      * allocations to avoid calling expensive device API allocation
      * functions. If you are compiling statically, you should include
@@ -284,6 +339,22 @@ public:
      * instead. */
     static void reuse_device_allocations(bool);
 
+    /** Set whether the default host allocator may pool freed memory for
+     * reuse by later allocations. Off by default. If you are compiling
+     * statically, you should include HalideRuntime.h and call
+     * halide_reuse_host_allocations instead. */
+    static void reuse_host_allocations(bool);
+
+    /** Return all pooled host memory not currently in use to the system. */
+    static void release_unused_host_allocations();
+
+    /** Set the most memory, in bytes, that the host allocation pool may
+     * hold onto while it isn't in use. Returns the previous limit. */
+    static int64_t host_allocation_pool_set_limit(int64_t size);
+
+    /** Get the allocation and reuse counts of the host allocation pool. */
+    static halide_host_allocation_pool_stats_t host_allocation_pool_get_stats();
+
     static void release_all();
 
     /** Get the number of threads in the Halide thread pool. Includes the
@@ -298,6 +369,18 @@ public:
      * number. */
     static int set_num_threads(int);
 
+    /** Select how the Halide thread pool schedules the iterations of
+     * parallel for loops: on one shared job queue (the default), or by work
+     * stealing between threads. See halide_thread_pool_scheduler_t. Calling
+     * this is meaningless if custom_do_par_for has been set. Returns the old
+     * scheduler. */
+    static halide_thread_pool_scheduler_t set_thread_pool_scheduler(halide_thread_pool_scheduler_t);
+
+    /** Select how the Halide thread pool places work on machines with
+     * several NUMA nodes. See halide_numa_policy_t. Returns the old
+     * policy. */
+    static halide_numa_policy_t set_numa_policy(halide_numa_policy_t);
+
     /** Search the shared JIT runtime for `target` for a symbol with the
      * given name. Returns the first match's address, or nullptr if no
      * runtime module exports it. JIT shared runtimes are created
@@ -349,6 +432,11 @@ struct JITFuncCallContext {
 
     JITFuncCallContext(JITUserContext *context, const JITHandlers &pipeline_handlers);
 
+    /** The error to report for a call that returned the given exit status,
+     * or the empty string if there is nothing to report, because the call
+     * succeeded or a custom error handler has already dealt with it. */
+    std::string error_message(int exit_status) const;
+
     void finalize(int exit_status);
 };
 
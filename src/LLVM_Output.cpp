@@ -4,9 +4,12 @@
 #include "CodeGen_LLVM.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
+#include "ParallelCompile.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
 
 #ifdef _WIN32
 #ifndef NOMINMAX
@@ -427,10 +430,6 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
 
 }  // namespace
 
-std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context) {
-    return codegen_llvm(module, context);
-}
-
 void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream &out) {
     Internal::run_with_large_stack([&]() {
         emit_file(module, out, llvm::CodeGenFileType::ObjectFile);
@@ -443,6 +442,272 @@ void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream
     });
 }
 
+namespace {
+
+// The most pieces compile_module_to_split_objects divides a module into.
+// This is deliberately independent of the number of compile threads, so
+// that the objects produced don't depend on the machine doing the
+// compiling.
+constexpr int max_split_partitions = 8;
+
+size_t count_instructions(const llvm::Function &f) {
+    size_t n = 0;
+    for (const llvm::BasicBlock &b : f) {
+        n += b.size();
+    }
+    return n;
+}
+
+// Turn a copy of a split module into the given partition of it, by
+// reducing everything that another partition defines to a declaration.
+// Partition 0 holds the pipeline's entry points, and everything from the
+// runtime that must be defined exactly once. The others hold some of the
+// closures, plus their own copies of any local or linkonce runtime
+// functions and constants they need; the linker merges the linkonce
+// copies, and the optimizer discards the ones that are unused.
+void select_partition(llvm::Module &module, int partition,
+                      const std::map<std::string, int> &function_partition) {
+    for (llvm::Function &f : module) {
+        if (f.isDeclaration()) {
+            continue;
+        }
+        auto it = function_partition.find(f.getName().str());
+        bool keep;
+        if (it != function_partition.end()) {
+            keep = (it->second == partition);
+        } else {
+            keep = (partition == 0 || f.hasLocalLinkage() || f.hasLinkOnceLinkage());
+        }
+        if (!keep) {
+            f.deleteBody();
+            f.setComdat(nullptr);
+        }
+    }
+
+    if (partition == 0) {
+        return;
+    }
+
+    std::vector<llvm::GlobalVariable *> to_erase;
+    for (llvm::GlobalVariable &g : module.globals()) {
+        if (g.isDeclaration() || g.hasLocalLinkage() || g.hasLinkOnceLinkage()) {
+            continue;
+        }
+        if (g.hasAppendingLinkage()) {
+            // e.g. llvm.global_ctors and llvm.global_dtors. The runtime's
+            // constructors and destructors must only run once.
+            to_erase.push_back(&g);
+        } else {
+            g.setInitializer(nullptr);
+            g.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            g.setComdat(nullptr);
+        }
+    }
+    for (llvm::GlobalVariable *g : to_erase) {
+        g->eraseFromParent();
+    }
+}
+
+}  // namespace
+
+namespace {
+
+// A module generated whole and unoptimized, and divided into partitions
+// that can be optimized independently.
+struct SplitModule {
+    llvm::SmallVector<char, 0> bitcode;
+    // The partition of each function generated from the Halide module.
+    std::map<std::string, int> function_partition;
+    int num_partitions = 0;
+    // The local functions and globals made externally visible, so that
+    // the partitions can refer to each other's.
+    std::vector<std::string> externalized;
+};
+
+// Generate the whole module, unoptimized, and decide which partition
+// each function generated from the Halide module goes in.
+SplitModule split_module(const Module &module) {
+    SplitModule split;
+    {
+        llvm::LLVMContext context;
+        std::unique_ptr<Internal::CodeGen_LLVM> cg(Internal::CodeGen_LLVM::new_for_target(module.target(), context));
+        cg->set_skip_optimization(true);
+        std::unique_ptr<llvm::Module> whole = cg->compile(module);
+
+        // The pipeline's externally visible functions (the entry point,
+        // the argv wrapper, the metadata getter, ...) go in partition 0,
+        // and the parallel closures are spread over all of them. The
+        // closures are only ever called indirectly, through the runtime's
+        // parallel for and task functions, so separating them from their
+        // callers costs no inlining. Other local functions (e.g. SME
+        // streaming tasks) may be called directly, so, like local
+        // runtime functions, each partition gets its own copy.
+        const std::set<std::string> &parallel_closures = cg->get_parallel_closures();
+        std::string prefix;
+        size_t root_size = 0;
+        std::vector<std::pair<size_t, llvm::Function *>> closures;
+        for (const std::string &name : cg->get_generated_functions()) {
+            llvm::Function *f = whole->getFunction(name);
+            internal_assert(f) << "Could not find generated function " << name << "\n";
+            if (parallel_closures.count(name)) {
+                internal_assert(f->hasLocalLinkage()) << "Parallel closure " << name << " is externally visible\n";
+                closures.emplace_back(count_instructions(*f), f);
+            } else if (!f->hasLocalLinkage()) {
+                if (prefix.empty()) {
+                    prefix = name;
+                }
+                split.function_partition[name] = 0;
+                root_size += count_instructions(*f);
+            }
+        }
+        if (prefix.empty()) {
+            prefix = module.name();
+        }
+        split.num_partitions = std::min<int>(max_split_partitions, closures.size() + 1);
+
+        if (split.num_partitions > 1) {
+            // Closures, and globals that can't be duplicated because they
+            // are written to, must be visible from the other objects. Give
+            // them names unique to this pipeline, so that several split
+            // pipelines can be linked together, and hide them outside of
+            // the final link.
+            auto externalize = [&](llvm::GlobalValue *v) {
+                v->setName(prefix + "." + v->getName().str());
+                split.externalized.push_back(v->getName().str());
+                v->setLinkage(llvm::GlobalValue::ExternalLinkage);
+                v->setVisibility(llvm::GlobalValue::HiddenVisibility);
+                v->setDSOLocal(true);
+            };
+            for (auto &c : closures) {
+                externalize(c.second);
+            }
+            for (llvm::GlobalVariable &g : whole->globals()) {
+                if (g.hasLocalLinkage() && !g.isConstant()) {
+                    externalize(&g);
+                }
+            }
+        }
+
+        // Balance the partitions by size, largest closures first. Ties go
+        // to the earlier closure and the lower partition, so the result
+        // only depends on the module.
+        std::stable_sort(closures.begin(), closures.end(),
+                         [](const auto &a, const auto &b) { return a.first > b.first; });
+        std::vector<size_t> load(split.num_partitions, 0);
+        load[0] = root_size;
+        for (const auto &c : closures) {
+            int p = (int)(std::min_element(load.begin(), load.end()) - load.begin());
+            load[p] += c.first;
+            split.function_partition[c.second->getName().str()] = p;
+        }
+        debug(1) << "Splitting module " << module.name() << " into " << split.num_partitions << " partitions\n";
+
+        llvm::raw_svector_ostream out(split.bitcode);
+        WriteBitcodeToFile(*whole, out);
+    }
+    return split;
+}
+
+// Parse a partition of a split module into the given context, and
+// optimize it.
+std::unique_ptr<llvm::Module> optimize_partition(const Module &module, const SplitModule &split,
+                                                 int partition, llvm::LLVMContext &context) {
+    llvm::MemoryBufferRef buffer_ref(llvm::StringRef(split.bitcode.data(), split.bitcode.size()), "split_buffer");
+    auto parsed = llvm::parseBitcodeFile(buffer_ref, context);
+    if (!parsed) {
+        llvm::dbgs() << parsed.takeError();
+    }
+    internal_assert(parsed);
+    std::unique_ptr<llvm::Module> result = std::move(parsed.get());
+
+    select_partition(*result, partition, split.function_partition);
+    Internal::optimize_llvm_module(*result, module.target());
+    return result;
+}
+
+void embed_halide_command(llvm::Module &module, const Target &target) {
+    if (target.has_feature(Target::EmbedBitcode)) {
+        std::string halide_command = "halide target=" + target.to_string();
+        Internal::embed_bitcode(&module, halide_command);
+    }
+}
+
+}  // namespace
+
+std::vector<std::vector<char>> compile_module_to_split_objects(const Module &module) {
+    SplitModule split = split_module(module);
+
+    // Optimize and compile each partition in its own LLVMContext, so that
+    // they can proceed in parallel.
+    std::vector<std::vector<char>> objects(split.num_partitions);
+    Internal::parallel_compile_for("split_codegen", split.num_partitions, [&](int i) {
+        llvm::LLVMContext context;
+        std::unique_ptr<llvm::Module> partition = optimize_partition(module, split, i, context);
+        embed_halide_command(*partition, module.target());
+
+        llvm::SmallVector<char, 0> object;
+        llvm::raw_svector_ostream object_out(object);
+        emit_file(*partition, object_out, llvm::CodeGenFileType::ObjectFile);
+        objects[i].assign(object.begin(), object.end());
+    });
+    return objects;
+}
+
+namespace {
+
+// Optimize the partitions of a module in parallel, each in its own
+// LLVMContext, and link them back together in the given one.
+std::unique_ptr<llvm::Module> compile_module_to_optimized_partitions(const Module &module, llvm::LLVMContext &context) {
+    SplitModule split = split_module(module);
+
+    std::vector<llvm::SmallVector<char, 0>> optimized(split.num_partitions);
+    Internal::parallel_compile_for("split_optimize", split.num_partitions, [&](int i) {
+        llvm::LLVMContext partition_context;
+        std::unique_ptr<llvm::Module> partition = optimize_partition(module, split, i, partition_context);
+        llvm::raw_svector_ostream out(optimized[i]);
+        WriteBitcodeToFile(*partition, out);
+    });
+
+    // Link the partitions in order, so that the result only depends on
+    // the module.
+    std::unique_ptr<llvm::Module> result;
+    for (int i = 0; i < split.num_partitions; i++) {
+        llvm::MemoryBufferRef buffer_ref(llvm::StringRef(optimized[i].data(), optimized[i].size()), "split_optimized_buffer");
+        auto parsed = llvm::parseBitcodeFile(buffer_ref, context);
+        if (!parsed) {
+            llvm::dbgs() << parsed.takeError();
+        }
+        internal_assert(parsed);
+        if (!result) {
+            result = std::move(parsed.get());
+        } else {
+            bool failed = llvm::Linker::linkModules(*result, std::move(parsed.get()));
+            internal_assert(!failed) << "Failure linking the partitions of module " << module.name() << "\n";
+        }
+    }
+
+    // Hide again what was only made visible to the other partitions.
+    for (const std::string &name : split.externalized) {
+        if (llvm::GlobalValue *v = result->getNamedValue(name)) {
+            if (!v->isDeclaration()) {
+                v->setVisibility(llvm::GlobalValue::DefaultVisibility);
+                v->setLinkage(llvm::GlobalValue::InternalLinkage);
+            }
+        }
+    }
+    embed_halide_command(*result, module.target());
+    return result;
+}
+
+}  // namespace
+
+std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context) {
+    if (module.target().has_feature(Target::SplitCodegen)) {
+        return compile_module_to_optimized_partitions(module, context);
+    }
+    return codegen_llvm(module, context);
+}
+
 void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOStream &out) {
     WriteBitcodeToFile(module, out);
 }
@@ -39,6 +39,17 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream &
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream &out);
 // @}
 
+/** Compile a Halide module to several objects which, linked together,
+ * are equivalent to the object compile_llvm_module_to_object would
+ * produce. The module is partitioned by function, with the closures for
+ * the pipeline's parallel loops and tasks spread across partitions, and
+ * each partition is optimized and compiled to native code in parallel
+ * (see HL_COMPILE_THREADS). The partitioning depends only on the module,
+ * so the objects are the same from run to run. Returns the contents of
+ * each object. Used for static libraries when the target has the
+ * split_codegen feature. */
+std::vector<std::vector<char>> compile_module_to_split_objects(const Module &module);
+
 /** Compile an LLVM module to LLVM targets (bitcode, LLVM assembly). */
 // @{
 void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOStream &out);
@@ -124,6 +124,7 @@ DECLARE_CPP_INITMOD(destructors)
 DECLARE_CPP_INITMOD(device_interface)
 DECLARE_CPP_INITMOD(errors)
 DECLARE_CPP_INITMOD(fake_get_symbol)
+DECLARE_CPP_INITMOD(fake_numa)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(fopen)
@@ -140,11 +141,14 @@ DECLARE_CPP_INITMOD(hexagon_dma)
 DECLARE_CPP_INITMOD(hexagon_dma_pool)
 DECLARE_CPP_INITMOD(hexagon_host)
 DECLARE_CPP_INITMOD(ios_io)
+DECLARE_CPP_INITMOD(linux_arm_perf_counters)
 DECLARE_CPP_INITMOD(linux_arm_thread_id)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
+DECLARE_CPP_INITMOD(linux_numa)
 DECLARE_CPP_INITMOD(linux_powerpc_thread_id)
 DECLARE_CPP_INITMOD(linux_riscv_thread_id)
+DECLARE_CPP_INITMOD(linux_x86_perf_counters)
 DECLARE_CPP_INITMOD(linux_x86_thread_id)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(module_aot_ref_count)
@@ -861,6 +865,7 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
     modules.push_back(std::move(extra_module));
     modules.push_back(get_initmod_force_include_types(c, bits_64, debug));
     modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+    modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
     modules.push_back(get_initmod_posix_aligned_alloc(c, bits_64, debug));
     modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
     modules.push_back(get_initmod_halide_buffer_t(c, bits_64, debug));
@@ -943,7 +948,16 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
         modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
     };
 
+    const auto add_numa = [&] {
+        if (t.os == Target::Linux || t.os == Target::Android) {
+            modules.push_back(get_initmod_linux_numa(c, bits_64, debug));
+        } else {
+            modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
+        }
+    };
+
     const auto add_posix_threads = [&] {
+        add_numa();
         if (tsan) {
             modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
         } else {
@@ -1014,6 +1028,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                     add_wasm_posix_threads();
                 } else {
                     modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+                    modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
                 }
                 modules.push_back(get_initmod_fake_get_symbol(c, bits_64, debug));
             } else if (t.os == Target::OSX) {
@@ -1049,6 +1064,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_windows_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_io(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_yield(c, bits_64, debug));
+                add_numa();
                 if (tsan) {
                     modules.push_back(get_initmod_windows_threads_tsan(c, bits_64, debug));
                 } else {
@@ -1068,6 +1084,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_aligned_alloc(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_yield(c, bits_64, debug));
+                add_numa();
                 if (tsan) {
                     modules.push_back(get_initmod_qurt_threads_tsan(c, bits_64, debug));
                 } else {
@@ -1090,6 +1107,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                     modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 }
                 modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
             } else if (t.os == Target::Fuchsia) {
                 add_allocator();
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
@@ -1183,6 +1201,23 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                         modules.push_back(get_initmod_profiler(c, bits_64, debug));
                     }
                 }
+                // A standalone runtime shared by several targets may have
+                // the hardware counters without the profile feature
+                // itself, which is checked when lowering instead.
+                if (t.has_feature(Target::ProfileHardwareCounters)) {
+                    user_assert(t.os == Target::Linux && (t.arch == Target::X86 || t.arch == Target::ARM))
+                        << "Hardware counters in the profiler are currently only supported on x86 and ARM Linux.";
+                }
+                // The JIT shared runtime is built once, for whichever
+                // pipeline came first, so it always has the hardware
+                // counters in case a later pipeline wants them.
+                if (t.has_feature(Target::ProfileHardwareCounters) || module_type == ModuleJITShared) {
+                    if (t.os == Target::Linux && t.arch == Target::X86) {
+                        modules.push_back(get_initmod_linux_x86_perf_counters(c, bits_64, debug));
+                    } else if (t.os == Target::Linux && t.arch == Target::ARM) {
+                        modules.push_back(get_initmod_linux_arm_perf_counters(c, bits_64, debug));
+                    }
+                }
             }
 
 #ifdef HALIDE_INTERNAL_USING_MSAN
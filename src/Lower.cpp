@@ -2,6 +2,7 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <set>
 #include <sstream>
 
@@ -14,6 +15,7 @@
 #include "AddTypeChangeChecks.h"
 #include "AllocationBoundsInference.h"
 #include "AsyncProducers.h"
+#include "BatchEntryPoint.h"
 #include "BoundConstantExtentLoops.h"
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
@@ -36,6 +38,7 @@
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
 #include "HexagonOffload.h"
+#include "IRInterning.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
@@ -50,6 +53,7 @@
 #include "Memoization.h"
 #include "OffloadGPULoops.h"
 #include "PartitionLoops.h"
+#include "PlanAllocations.h"
 #include "Prefetch.h"
 #include "Profiling.h"
 #include "PurifyIndexMath.h"
@@ -398,6 +402,27 @@ void lower_impl(const vector<Function> &output_funcs,
     s = inject_early_frees(s);
     log("Lowering after injecting early frees:", s);
 
+    if (t.has_feature(Target::StaticMemoryPlan) &&
+        !(t.arch != Target::Hexagon && t.has_feature(Target::HVX))) {
+        debug(1) << "Planning allocations...\n";
+        Expr scratch, scratch_size;
+        for (const Argument &arg : args) {
+            if (arg.name == "__scratch") {
+                user_assert(arg.is_scalar() && arg.type.is_handle())
+                    << "The __scratch argument of a pipeline must be a pointer.\n";
+                scratch = Variable::make(Handle(), arg.name);
+            } else if (arg.name == "__scratch_size") {
+                user_assert(arg.is_scalar() && arg.type.is_int_or_uint())
+                    << "The __scratch_size argument of a pipeline must be an integer.\n";
+                scratch_size = cast<uint64_t>(Variable::make(arg.type, arg.name));
+            }
+        }
+        user_assert(scratch.defined() == scratch_size.defined())
+            << "A pipeline that takes a __scratch argument must also take a __scratch_size argument, and vice versa.\n";
+        s = plan_allocations(s, t, scratch, scratch_size);
+        log("Lowering after planning allocations:", s);
+    }
+
     if (t.has_feature(Target::FuzzFloatStores)) {
         debug(1) << "Fuzzing floating point stores...\n";
         s = fuzz_float_stores(s);
@@ -442,6 +467,9 @@ void lower_impl(const vector<Function> &output_funcs,
     s = hoist_loop_invariant_if_statements(s);
     log("Lowering after removing dead allocations and hoisting loop invariants:", s);
 
+    user_assert(!t.has_feature(Target::ProfileHardwareCounters) ||
+                t.has_feature(Target::Profile) || t.has_feature(Target::ProfileByTimer))
+        << "Target::ProfileHardwareCounters must be used with Target::Profile or Target::ProfileByTimer.\n";
     if (t.has_feature(Target::Profile) || t.has_feature(Target::ProfileByTimer)) {
         debug(1) << "Injecting profiling...\n";
         s = inject_profiling(s, pipeline_name, env, t);
@@ -612,6 +640,13 @@ void lower_impl(const vector<Function> &output_funcs,
 
     LoweredFunc main_func(pipeline_name, public_args, s, linkage_type);
 
+    if (t.has_feature(Target::BatchEntryPoint)) {
+        debug(1) << "Making batch entry point...\n";
+        LoweredFunc batch_func = make_batch_entry_point(main_func);
+        log("Batch entry point:", batch_func.body);
+        result_module.append(batch_func);
+    }
+
     // If we're in debug mode, add code that prints the args.
     if (t.has_feature(Target::Debug)) {
         debug_arguments(&main_func, t);
@@ -637,6 +672,11 @@ Module lower(const vector<Function> &output_funcs,
     Target target = t.with_implied_features();
     Module result_module{strip_namespaces(pipeline_name), target};
     run_with_large_stack([&]() {
+        static bool intern_ir = get_env_variable("HL_INTERN_IR") == "1";
+        std::optional<ScopedIRInterning> interning;
+        if (intern_ir) {
+            interning.emplace();
+        }
         lower_impl(output_funcs, pipeline_name, target, args, linkage_type, requirements, trace_pipeline, custom_passes, result_module);
     });
     return result_module;
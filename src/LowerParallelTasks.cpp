@@ -1,5 +1,7 @@
 #include "LowerParallelTasks.h"
 
+#include <cctype>
+#include <memory>
 #include <string>
 
 #include "Argument.h"
@@ -11,6 +13,7 @@
 #include "LoopPartitioningDirective.h"
 #include "Module.h"
 #include "Param.h"
+#include "ParallelCompile.h"
 #include "Simplify.h"
 
 namespace Halide {
@@ -156,6 +159,19 @@ int calculate_min_threads(const Stmt &body) {
     return min_threads.result;
 }
 
+// The work of making the function for a parallel task: lowering the
+// parallel tasks in its body, and unpacking its closure around it.
+struct TaskFunction {
+    std::string name;
+    // The name of the task, which names the tasks within it.
+    std::string task_name;
+    Stmt body;
+    Expr task_parent;
+    std::shared_ptr<const Closure> closure;
+    Expr closure_arg;
+    std::vector<LoweredArgument> args;
+};
+
 struct LowerParallelTasks : public IRMutator {
 
     /** Codegen a call to do_parallel_tasks */
@@ -198,7 +214,8 @@ struct LowerParallelTasks : public IRMutator {
     Stmt rewrite_parallel_tasks(const std::vector<ParallelTask> &tasks) {
         Stmt body;
 
-        Closure closure;
+        auto closure_ptr = std::make_shared<Closure>();
+        Closure &closure = *closure_ptr;
         for (const auto &t : tasks) {
             Stmt s = t.body;
             if (!t.loop_var.empty()) {
@@ -288,23 +305,17 @@ struct LowerParallelTasks : public IRMutator {
                 closure_args[4] = make_scalar_arg<void *>(closure_task_parent_name);
             }
 
-            {
-                ScopedValue<std::string> save_name(function_name, t.name);
-
-                task_parents.push(closure_task_parent);
-                t.body = mutate(t.body);
-                task_parents.pop();
-            }
-
             const std::string new_function_name = c_print_name(unique_name(t.name), false);
             {
                 Expr closure_arg_var = Variable::make(closure_struct_allocation.type(), closure_arg_name);
-                Stmt wrapped_body = closure.unpack_from_struct(closure_arg_var, t.body);
-
-                // TODO(zvookin): Figure out how we want to handle name mangling of closures.
-                // For now, the C++ backend makes them extern "C" so they have to be NameMangling::C.
-                LoweredFunc closure_func{new_function_name, closure_args, std::move(wrapped_body), LinkageType::Internal, NameMangling::C};
-                closure_implementations.emplace_back(std::move(closure_func));
+                TaskFunction f{new_function_name, t.name, t.body, closure_task_parent,
+                               closure_ptr, std::move(closure_arg_var), closure_args};
+                if (task_functions) {
+                    task_functions->emplace_back(std::move(f));
+                } else {
+                    std::vector<LoweredFunc> made = make_task_function(f, target);
+                    closure_implementations.insert(closure_implementations.end(), made.begin(), made.end());
+                }
             }
 
             // Codegen will add user_context for us
@@ -411,23 +422,72 @@ struct LowerParallelTasks : public IRMutator {
         return rewrite_parallel_tasks(tasks);
     }
 
-    LowerParallelTasks(const std::string &name, const Target &t)
-        : function_name(name), target(t) {
+    // Make the function for a parallel task, preceded by the functions
+    // for the parallel tasks within it.
+    static std::vector<LoweredFunc> make_task_function(const TaskFunction &f, const Target &target) {
+        LowerParallelTasks inner(f.task_name, target, nullptr);
+        inner.task_parents.push(f.task_parent);
+        Stmt body = inner.mutate(f.body);
+        body = f.closure->unpack_from_struct(f.closure_arg, body);
+
+        // TODO(zvookin): Figure out how we want to handle name mangling of closures.
+        // For now, the C++ backend makes them extern "C" so they have to be NameMangling::C.
+        LoweredFunc closure_func{f.name, f.args, std::move(body), LinkageType::Internal, NameMangling::C,
+                                 LoweredFunc::Attribute::PARALLEL_CLOSURE};
+        inner.closure_implementations.emplace_back(std::move(closure_func));
+        return std::move(inner.closure_implementations);
+    }
+
+    LowerParallelTasks(const std::string &name, const Target &t, std::vector<TaskFunction> *task_functions)
+        : function_name(name), target(t), task_functions(task_functions) {
     }
 
     std::string function_name;
     const Target &target;
+    // If set, the functions for the parallel tasks found are left here
+    // to be made later, rather than made as they are found.
+    std::vector<TaskFunction> *task_functions;
     std::vector<LoweredFunc> closure_implementations;
     SmallStack<Expr> task_parents;
 };
 
+// A tag for the unique names made while lowering the parallel tasks of
+// the given function, distinct for each function name.
+std::string parallel_tasks_region_name(const std::string &name) {
+    const char *hex = "0123456789abcdef";
+    std::string result = "parallel_tasks_";
+    for (char c : name) {
+        if (std::isalnum((unsigned char)c)) {
+            result += c;
+        } else {
+            result += '_';
+            result += hex[((unsigned char)c) >> 4];
+            result += hex[((unsigned char)c) & 15];
+        }
+    }
+    return result;
+}
+
 }  // namespace
 
 Stmt lower_parallel_tasks(const Stmt &s, std::vector<LoweredFunc> &closure_implementations,
                           const std::string &name, const Target &t) {
-    LowerParallelTasks lowering_mutator(name, t);
+    // The outermost parallel tasks are found first, and then their
+    // functions, which includes lowering the parallel tasks within them,
+    // are made in parallel.
+    std::vector<TaskFunction> task_functions;
+    LowerParallelTasks lowering_mutator(name, t, &task_functions);
     Stmt result = lowering_mutator(s);
 
+    std::vector<std::vector<LoweredFunc>> made(task_functions.size());
+    parallel_compile_for(parallel_tasks_region_name(name), (int)task_functions.size(), [&](int i) {
+        made[i] = LowerParallelTasks::make_task_function(task_functions[i], t);
+    });
+    for (const auto &m : made) {
+        lowering_mutator.closure_implementations.insert(lowering_mutator.closure_implementations.end(),
+                                                        m.begin(), m.end());
+    }
+
     // Main body will be dumped as part of standard lowering debugging, but closures will not be.
     debug(2) << [&] {
         std::stringstream ss;
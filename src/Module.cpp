@@ -15,6 +15,7 @@
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
+#include "ParallelCompile.h"
 #include "Pipeline.h"
 #include "PythonExtensionGen.h"
 #include "StmtToHTML.h"
@@ -620,14 +621,23 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
     if (contains(output_files, OutputFileType::object) || contains(output_files, OutputFileType::assembly) ||
         contains(output_files, OutputFileType::bitcode) || contains(output_files, OutputFileType::llvm_assembly) ||
         contains(output_files, OutputFileType::static_library) || !assembly_path.empty()) {
+        // A split static library is generated separately (see below), so
+        // only make the llvm::Module for the whole pipeline if some other
+        // output needs it.
         llvm::LLVMContext context;
-        std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(*this, context));
+        std::unique_ptr<llvm::Module> llvm_module;
+        auto get_llvm_module = [&]() -> llvm::Module & {
+            if (!llvm_module) {
+                llvm_module = compile_module_to_llvm_module(*this, context);
+            }
+            return *llvm_module;
+        };
 
         if (contains(output_files, OutputFileType::object)) {
             const auto &f = output_files.at(OutputFileType::object);
             debug(1) << "Module.compile(): object " << f << "\n";
             auto out = make_raw_fd_ostream(f);
-            compile_llvm_module_to_object(*llvm_module, *out);
+            compile_llvm_module_to_object(get_llvm_module(), *out);
         }
         if (contains(output_files, OutputFileType::static_library)) {
             // To simplify the code, we always emit to a temporary file
@@ -639,11 +649,20 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
             // (Use a separate TemporaryFileDir here so we don't try to embed assembly files from
             // `temp_assembly_dir` into a static library...)
             TemporaryFileDir temp_object_dir;
-            {
+            if (target().has_feature(Target::SplitCodegen)) {
+                std::vector<std::vector<char>> objects = compile_module_to_split_objects(*this);
+                for (size_t i = 0; i < objects.size(); i++) {
+                    std::string object = temp_object_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), "_" + std::to_string(i), target());
+                    debug(1) << "Module.compile(): temporary object " << object << "\n";
+                    auto out = make_raw_fd_ostream(object);
+                    out->write(objects[i].data(), objects[i].size());
+                    out->flush();
+                }
+            } else {
                 std::string object = temp_object_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), "", target());
                 debug(1) << "Module.compile(): temporary object " << object << "\n";
                 auto out = make_raw_fd_ostream(object);
-                compile_llvm_module_to_object(*llvm_module, *out);
+                compile_llvm_module_to_object(get_llvm_module(), *out);
                 out->flush();  // create_static_library() is happier if we do this
             }
             debug(1) << "Module.compile(): static_library " << output_files.at(OutputFileType::static_library) << "\n";
@@ -654,17 +673,17 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
         if (!assembly_path.empty()) {
             debug(1) << "Module.compile(): assembly " << assembly_path << "\n";
             auto out = make_raw_fd_ostream(assembly_path);
-            compile_llvm_module_to_assembly(*llvm_module, *out);
+            compile_llvm_module_to_assembly(get_llvm_module(), *out);
         }
         if (contains(output_files, OutputFileType::bitcode)) {
             debug(1) << "Module.compile(): bitcode " << output_files.at(OutputFileType::bitcode) << "\n";
             auto out = make_raw_fd_ostream(output_files.at(OutputFileType::bitcode));
-            compile_llvm_module_to_llvm_bitcode(*llvm_module, *out);
+            compile_llvm_module_to_llvm_bitcode(get_llvm_module(), *out);
         }
         if (contains(output_files, OutputFileType::llvm_assembly)) {
             debug(1) << "Module.compile(): llvm_assembly " << output_files.at(OutputFileType::llvm_assembly) << "\n";
             auto out = make_raw_fd_ostream(output_files.at(OutputFileType::llvm_assembly));
-            compile_llvm_module_to_llvm_assembly(*llvm_module, *out);
+            compile_llvm_module_to_llvm_assembly(get_llvm_module(), *out);
         }
     }
 
@@ -879,6 +898,13 @@ void compile_multitarget(const std::string &fn_name,
     // (since x86-64-linux would be selected first due to ordering), but could
     // crash on non-sse41 machines (if we generated a runtime with sse41 instructions
     // included). So we'll keep track of the common features as we walk thru the targets.
+    //
+    // The exception is features that only add support code to the runtime, which
+    // is harmless for targets that don't use it, but required by those that do.
+    // Those are included if any target has them.
+    static const std::array<Target::Feature, 1> any_target_runtime_features = {{
+        Target::ProfileHardwareCounters,
+    }};
 
     // Using something like std::bitset would be arguably cleaner here, but we need an
     // array-of-uint64 for calls to halide_can_use_target_features() anyway,
@@ -887,6 +913,11 @@ void compile_multitarget(const std::string &fn_name,
     uint64_t runtime_features[kFeaturesWordCount] = {(uint64_t)-1LL};
 
     TemporaryFileDir temp_obj_dir;
+    // Lowering runs serially, as the module factory is generally not
+    // thread-safe, but each resulting module (and the runtime) is compiled
+    // to an object independently, so those are gathered up here and run
+    // in parallel below.
+    std::vector<std::function<void()>> compile_jobs;
     std::vector<Expr> wrapper_args;
     std::vector<std::string> sub_fn_names;
     std::vector<LoweredArgument> base_target_args;
@@ -902,6 +933,14 @@ void compile_multitarget(const std::string &fn_name,
             target.bits != base_target.bits) {
             user_error << "All Targets must have matching arch-bits-os for compile_multitarget.\n";
         }
+        // Each sub-target is compiled to a single object, so split_codegen
+        // would be silently ignored.
+        user_assert(!target.has_feature(Target::SplitCodegen))
+            << "Feature 'split_codegen' is not supported by compile_multitarget with more than one Target.\n";
+        // The wrapper only dispatches to the main entry point of each
+        // sub-target, so a batch entry point could not be called.
+        user_assert(!target.has_feature(Target::BatchEntryPoint))
+            << "Feature 'batch_entry_point' is not supported by compile_multitarget with more than one Target.\n";
         // Some features must match across all targets.
         static const std::array<Target::Feature, 10> must_match_features = {{
             Target::ASAN,
@@ -912,6 +951,7 @@ void compile_multitarget(const std::string &fn_name,
             Target::NoRuntime,
             Target::TSAN,
             Target::SanitizerCoverage,
+            Target::StaticMemoryPlan,
             Target::UserContext,
         }};
         for (auto f : must_match_features) {
@@ -945,8 +985,10 @@ void compile_multitarget(const std::string &fn_name,
             sub_out.erase(OutputFileType::schedule);
             sub_out.erase(OutputFileType::c_header);
             sub_out.erase(OutputFileType::function_info_header);
-            debug(1) << "compile_multitarget: compile_sub_target " << sub_out[OutputFileType::object] << "\n";
-            sub_module.compile(sub_out);
+            compile_jobs.emplace_back([sub_module, sub_out]() {
+                debug(1) << "compile_multitarget: compile_sub_target " << sub_out.at(OutputFileType::object) << "\n";
+                sub_module.compile(sub_out);
+            });
             const auto *r = sub_module.get_auto_scheduler_results();
             auto_scheduler_results.push_back(r ? *r : AutoSchedulerResults());
             if (target == base_target) {
@@ -999,14 +1041,23 @@ void compile_multitarget(const std::string &fn_name,
                 runtime_target.set_feature((Target::Feature)i);
             }
         }
+        for (const Target &target : targets) {
+            for (auto f : any_target_runtime_features) {
+                if (target.has_feature(f)) {
+                    runtime_target.set_feature(f);
+                }
+            }
+        }
         std::string runtime_path = contains(output_files, OutputFileType::static_library) ?
                                        temp_obj_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), "_runtime", runtime_target) :
                                        add_suffix(output_files.at(OutputFileType::object), "_runtime");
 
         std::map<OutputFileType, std::string> runtime_out =
             {{OutputFileType::object, runtime_path}};
-        debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.at(OutputFileType::object) << "\n";
-        compile_standalone_runtime(runtime_out, runtime_target);
+        compile_jobs.emplace_back([runtime_out, runtime_target]() {
+            debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.at(OutputFileType::object) << "\n";
+            compile_standalone_runtime(runtime_out, runtime_target);
+        });
     }
 
     if (needs_wrapper) {
@@ -1036,10 +1087,14 @@ void compile_multitarget(const std::string &fn_name,
                                        add_suffix(output_files.at(OutputFileType::object), "_wrapper");
 
         std::map<OutputFileType, std::string> wrapper_out = {{OutputFileType::object, wrapper_path}};
-        debug(1) << "compile_multitarget: wrapper " << wrapper_out.at(OutputFileType::object) << "\n";
-        wrapper_module.compile(wrapper_out);
+        compile_jobs.emplace_back([wrapper_module, wrapper_out]() {
+            debug(1) << "compile_multitarget: wrapper " << wrapper_out.at(OutputFileType::object) << "\n";
+            wrapper_module.compile(wrapper_out);
+        });
     }
 
+    parallel_compile_for("multitarget", (int)compile_jobs.size(), [&](int i) { compile_jobs[i](); });
+
     if (contains(output_files, OutputFileType::c_header)) {
         Module header_module(fn_name, base_target);
         header_module.append(LoweredFunc(fn_name, base_target_args, {}, LinkageType::ExternalPlusMetadata));
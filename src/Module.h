@@ -127,6 +127,7 @@ struct LoweredFunc {
         NO_ATTRIBUTE = 0,
         SME_STREAMING_TASK = 1 << 0,
         SME_NONSTREAMING_TASK = 1 << 1,
+        PARALLEL_CLOSURE = 1 << 2,
     };
     uint64_t attributes;
 
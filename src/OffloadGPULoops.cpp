@@ -16,6 +16,7 @@
 #include "InjectHostDevBufferCopies.h"
 #include "ModulusRemainder.h"
 #include "OffloadGPULoops.h"
+#include "ParallelCompile.h"
 #include "Scope.h"
 #include "Simplify.h"
 #include "Util.h"
@@ -95,6 +96,16 @@ protected:
 
     map<string, bool> state_needed;
 
+    // The kernels found for each device API, in the order they were
+    // found. They are compiled once the host code has been rewritten, so
+    // that the device APIs can compile theirs in parallel.
+    struct Kernel {
+        Stmt loop;
+        string name;
+        vector<DeviceArgument> args;
+    };
+    map<DeviceAPI, vector<Kernel>> kernels;
+
     const Target &target;
 
     Expr get_state_var(const string &name) {
@@ -176,11 +187,8 @@ protected:
         user_assert(gpu_codegen != nullptr)
             << "Loop is scheduled on device " << loop->device_api
             << " which does not appear in target " << target.to_string() << "\n";
-        gpu_codegen->add_kernel(loop, kernel_name, closure_args);
-
-        // get the actual name of the generated kernel for this loop
-        kernel_name = gpu_codegen->get_current_kernel_name();
-        debug(2) << "Compiled launch to kernel \"" << kernel_name << "\"\n";
+        kernels[loop->device_api].push_back({loop, kernel_name, closure_args});
+        debug(2) << "Launching kernel \"" << kernel_name << "\"\n";
 
         bool runtime_run_takes_types = gpu_codegen->kernel_run_takes_types();
         Type target_size_t_type = target.bits == 32 ? Int(32) : Int(64);
@@ -289,19 +297,36 @@ public:
 
         Stmt result = mutate(s);
 
+        // If the module state for an API/function did not get created,
+        // there were no kernels using that API. The code generators of
+        // the rest are independent of each other, each with its own
+        // LLVMContext if it uses LLVM, so they compile their kernels in
+        // parallel.
+        vector<DeviceAPI> used;
         for (auto &i : cgdev) {
-            string api_unique_name = i.second->api_unique_name();
-
-            // If the module state for this API/function did not get created, there were
-            // no kernels using this API.
-            if (!state_needed[api_unique_name]) {
-                continue;
+            if (state_needed[i.second->api_unique_name()]) {
+                used.push_back(i.first);
             }
+        }
+        vector<vector<char>> kernel_srcs(used.size());
+        parallel_compile_for("gpu_offload", (int)used.size(), [&](int i) {
+            CodeGen_GPU_Dev *gpu_codegen = cgdev[used[i]].get();
+            for (const Kernel &k : kernels[used[i]]) {
+                gpu_codegen->add_kernel(k.loop, k.name, k.args);
+                internal_assert(gpu_codegen->get_current_kernel_name() == k.name)
+                    << "Kernel " << k.name << " was compiled as " << gpu_codegen->get_current_kernel_name() << "\n";
+            }
+            debug(2) << "Compiling kernels for " << gpu_codegen->api_unique_name() << "\n";
+            kernel_srcs[i] = gpu_codegen->compile_to_src();
+        });
+
+        for (size_t i = 0; i < used.size(); i++) {
+            string api_unique_name = cgdev[used[i]]->api_unique_name();
             Expr state_ptr = make_state_var(api_unique_name);
             Expr state_ptr_var = Variable::make(type_of<void *>(), api_unique_name);
 
             debug(2) << "Generating init_kernels for " << api_unique_name << "\n";
-            vector<char> kernel_src = i.second->compile_to_src();
+            const vector<char> &kernel_src = kernel_srcs[i];
             Expr kernel_src_buf = make_buffer_ptr(kernel_src, api_unique_name + "_gpu_source_kernels");
 
             string init_kernels_name = "halide_" + api_unique_name + "_initialize_kernels";
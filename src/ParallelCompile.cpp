@@ -0,0 +1,175 @@
+#include "ParallelCompile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Debug.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// Set on the threads running the body of a parallel_compile_for.
+thread_local bool in_parallel_compile = false;
+
+// One call to parallel_compile_for. The calling thread and any helpers
+// it gets from the pool claim indices from it until there are none left.
+struct Region {
+    const std::string &name;
+    const int n;
+    const std::function<void(int)> &f;
+    std::atomic<int> next{0};
+#ifdef HALIDE_WITH_EXCEPTIONS
+    std::vector<std::exception_ptr> exceptions;
+#endif
+
+    // Protected by the pool's mutex.
+    int helpers_wanted;
+    int helpers_active = 0;
+
+    Region(const std::string &name, int n, const std::function<void(int)> &f, int helpers_wanted)
+        : name(name), n(n), f(f),
+#ifdef HALIDE_WITH_EXCEPTIONS
+          exceptions(n),
+#endif
+          helpers_wanted(helpers_wanted) {
+    }
+
+    void run() {
+        in_parallel_compile = true;
+        int i;
+        while ((i = next++) < n) {
+            ScopedUniqueNameContext names(name + "_" + std::to_string(i));
+#ifdef HALIDE_WITH_EXCEPTIONS
+            try {
+                run_with_large_stack([&]() { f(i); });
+            } catch (...) {
+                exceptions[i] = std::current_exception();
+            }
+#else
+            run_with_large_stack([&]() { f(i); });
+#endif
+        }
+        in_parallel_compile = false;
+    }
+};
+
+// The threads that help run parallel_compile_for. They are started as
+// they are first needed, and then kept for the life of the process, so
+// that regions with little work in them don't pay to start threads. The
+// pool is never destroyed, as its threads may still be waiting on it
+// when static destructors run.
+class CompileThreadPool {
+    std::mutex mutex;
+    std::condition_variable wakeup_helpers, region_done;
+    // Regions that want more helpers, oldest first.
+    std::deque<Region *> regions;
+    int num_threads = 0;
+
+    void helper_thread() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            if (regions.empty()) {
+                wakeup_helpers.wait(lock);
+                continue;
+            }
+            Region *r = regions.front();
+            if (--r->helpers_wanted == 0) {
+                regions.pop_front();
+            }
+            r->helpers_active++;
+            lock.unlock();
+            r->run();
+            lock.lock();
+            if (--r->helpers_active == 0) {
+                region_done.notify_all();
+            }
+        }
+    }
+
+public:
+    static CompileThreadPool &get() {
+        static CompileThreadPool *pool = new CompileThreadPool;
+        return *pool;
+    }
+
+    // Run r on the calling thread, with the help of up to
+    // r.helpers_wanted threads from the pool.
+    void run(Region &r) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (num_threads < r.helpers_wanted) {
+                std::thread(&CompileThreadPool::helper_thread, this).detach();
+                num_threads++;
+            }
+            regions.push_back(&r);
+            wakeup_helpers.notify_all();
+        }
+        r.run();
+        std::unique_lock<std::mutex> lock(mutex);
+        // All the indices have been claimed, so don't send it any more
+        // helpers, and wait for the ones it has.
+        auto it = std::find(regions.begin(), regions.end(), &r);
+        if (it != regions.end()) {
+            regions.erase(it);
+        }
+        region_done.wait(lock, [&]() { return r.helpers_active == 0; });
+    }
+};
+
+}  // namespace
+
+int compile_thread_count() {
+    std::string env = get_env_variable("HL_COMPILE_THREADS");
+    if (!env.empty()) {
+        int n = std::atoi(env.c_str());
+        return n > 0 ? n : 1;
+    }
+    int n = (int)std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void parallel_compile_for(const std::string &name, int n, const std::function<void(int)> &f) {
+    if (n <= 0) {
+        return;
+    }
+    if (in_parallel_compile) {
+        // Nested parallelism would only oversubscribe the machine. Run
+        // serially, in the name context of the enclosing call.
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+
+    const int num_threads = std::min(n, compile_thread_count());
+    debug(2) << "Running " << n << " compilation tasks for " << name << " on " << num_threads << " threads\n";
+
+    Region region(name, n, f, num_threads - 1);
+    if (num_threads > 1) {
+        CompileThreadPool::get().run(region);
+    } else {
+        region.run();
+    }
+
+#ifdef HALIDE_WITH_EXCEPTIONS
+    for (const auto &e : region.exceptions) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+#endif
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,39 @@
+#ifndef HALIDE_PARALLEL_COMPILE_H
+#define HALIDE_PARALLEL_COMPILE_H
+
+/** \file
+ * Defines a helper for running independent parts of compilation on
+ * multiple threads.
+ */
+
+#include <functional>
+#include <string>
+
+namespace Halide {
+namespace Internal {
+
+/** The number of threads to use for parallel parts of compilation. This
+ * is the number of cores on the host, unless the environment variable
+ * HL_COMPILE_THREADS says otherwise. A value of one makes compilation
+ * run entirely on the calling thread. */
+int compile_thread_count();
+
+/** Call f(i) for each i in [0, n), spread across up to
+ * compile_thread_count() threads, the calling thread and threads kept
+ * for the purpose. Each call runs on a large stack (see
+ * run_with_large_stack), and in its own ScopedUniqueNameContext, tagged
+ * with the name and the index, so the names it makes and the results
+ * depend only on the work, not on the number of threads or on what was
+ * compiled before. The name describes the work (and so must consist only
+ * of letters, digits, and underscores); names made by calls with the
+ * same name must not end up in the same IR. f must otherwise only touch
+ * state that is private to index i. A call to parallel_compile_for made
+ * from within f runs serially on the calling thread. If any of the calls
+ * throws, the exception from the lowest index is rethrown once they have
+ * all finished. */
+void parallel_compile_for(const std::string &name, int n, const std::function<void(int)> &f);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
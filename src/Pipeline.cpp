@@ -1,4 +1,7 @@
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sstream>
 #include <utility>
 
 #include "Argument.h"
@@ -7,6 +10,7 @@
 #include "Deserialization.h"
 #include "FindCalls.h"
 #include "Func.h"
+#include "GeneratorCache.h"
 #include "IRVisitor.h"
 #include "InferArguments.h"
 #include "LLVM_Output.h"
@@ -16,6 +20,7 @@
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
 #include "Serialization.h"
+#include "Substitute.h"
 #include "WasmExecutor.h"
 
 using namespace Halide::Internal;
@@ -60,6 +65,13 @@ std::map<OutputFileType, std::string> object_file_outputs(const string &filename
     return outputs;
 }
 
+// Counters reported by Pipeline::get_jit_disk_cache_stats.
+std::atomic<uint64_t> jit_disk_cache_hits{0};
+std::atomic<uint64_t> jit_disk_cache_misses{0};
+std::atomic<uint64_t> jit_disk_cache_stores{0};
+std::atomic<uint64_t> jit_disk_cache_bytes_loaded{0};
+std::atomic<uint64_t> jit_disk_cache_bytes_stored{0};
+
 std::string sanitize_function_name(const std::string &s) {
     string name = s;
     for (char &c : name) {
@@ -547,6 +559,21 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
         lowering_args.insert(lowering_args.begin(), contents->user_context_arg.arg);
     }
 
+    // Ahead-of-time compiled pipelines that plan their allocations into
+    // an arena take an optional pointer to memory to use for it and the
+    // size of that memory, after the other inputs. The JIT allocates the
+    // arena itself, unless the caller passed Params with these names.
+    if (target.has_feature(Target::StaticMemoryPlan) && !target.has_feature(Target::JIT)) {
+        bool has_scratch = false;
+        for (const Argument &arg : lowering_args) {
+            has_scratch |= (arg.name == "__scratch" || arg.name == "__scratch_size");
+        }
+        if (!has_scratch) {
+            lowering_args.emplace_back("__scratch", Argument::InputScalar, type_of<void *>(), 0, ArgumentEstimates{});
+            lowering_args.emplace_back("__scratch_size", Argument::InputScalar, type_of<uint64_t>(), 0, ArgumentEstimates{});
+        }
+    }
+
     const Module &old_module = contents->module;
 
     // A lowered module stores the target with implied features set, so compare
@@ -666,9 +693,18 @@ void Pipeline::compile_jit(const Target &target_arg) {
         args.push_back(arg.arg);
     }
 
-    Module module = compile_to_module(args, generate_function_name(), target).resolve_submodules();
-    std::map<std::string, JITExtern> lowered_externs = contents->jit_externs;
-    contents->jit_cache = compile_jit_cache(module, std::move(args), contents->outputs, contents->jit_externs, target);
+    std::string fn_name = generate_function_name();
+    Pipeline canonical;
+    vector<Argument> canonical_args;
+    const std::string object_cache_key = jit_object_cache_key(args, fn_name, target, canonical, canonical_args);
+    const auto make_module = [&]() {
+        if (canonical.defined()) {
+            return canonical.compile_to_module(canonical_args, fn_name, target).resolve_submodules();
+        }
+        return compile_to_module(args, fn_name, target).resolve_submodules();
+    };
+    contents->jit_cache = compile_jit_cache(make_module, fn_name, args, contents->outputs,
+                                            contents->jit_externs, target, object_cache_key);
 #ifdef WITH_SERIALIZATION_JIT_ROUNDTRIP_TESTING
     // Restore the original outputs and requirements.
     contents->outputs = origin_outputs;
@@ -692,22 +728,326 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
         args.push_back(a);
     }
 
-    Module module = compile_to_module(args, generate_function_name(), target).resolve_submodules();
-
-    auto jit_cache = compile_jit_cache(module, std::move(args), contents->outputs, get_jit_externs(), target);
+    std::string fn_name = generate_function_name();
+    Pipeline canonical;
+    vector<Argument> canonical_args;
+    const std::string object_cache_key = jit_object_cache_key(args, fn_name, target, canonical, canonical_args);
+    const auto make_module = [&]() {
+        if (canonical.defined()) {
+            return canonical.compile_to_module(canonical_args, fn_name, target).resolve_submodules();
+        }
+        return compile_to_module(args, fn_name, target).resolve_submodules();
+    };
+    auto jit_cache = compile_jit_cache(make_module, fn_name, args, contents->outputs,
+                                       get_jit_externs(), target, object_cache_key);
 
     // Save the jit_handlers and jit_externs as they were at the time this
     // Callable was created, in case the Pipeline's version is mutated in
     // between creation and call -- we want the Callable to remain immutable
     // after creation, regardless of what you do to the Func.
-    return Callable(module.name(), jit_handlers(), get_jit_externs(), std::move(jit_cache));
+    return Callable(fn_name, jit_handlers(), get_jit_externs(), std::move(jit_cache));
 }
 
-/*static*/ JITCache Pipeline::compile_jit_cache(const Module &module,
+namespace {
+
+// Collects the buffer Parameters that a set of Functions refer to, by name.
+class FindBufferParameters : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        add(op->param);
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        add(op->param);
+    }
+
+public:
+    std::map<std::string, Parameter> params;
+
+    void add(const Parameter &p) {
+        if (p.defined() && p.is_buffer()) {
+            params.emplace(p.name(), p);
+        }
+    }
+};
+
+// Collects the buffers embedded in a set of Functions, by name.
+class FindEmbeddedBuffers : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->image.defined()) {
+            buffers.emplace(op->image.name(), op->image);
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->image.defined()) {
+            buffers.emplace(op->image.name(), op->image);
+        }
+    }
+
+public:
+    std::map<std::string, Buffer<>> buffers;
+};
+
+// Make a copy of a Pipeline in which the named buffer Parameters are
+// replaced by clones of themselves, and return the clones. The Funcs and
+// Parameters of the original are left untouched, so the clones can be
+// constrained without affecting anyone else using them.
+Pipeline clone_with_parameters(const Pipeline &p,
+                               const std::vector<Function> &outputs,
+                               const std::vector<std::string> &names,
+                               std::map<std::string, Parameter> &clones) {
+    std::map<std::string, Function> env = build_environment(outputs);
+    auto [copied_outputs, copied_env] = deep_copy(outputs, env);
+
+    FindBufferParameters finder;
+    for (const auto &[name, f] : copied_env) {
+        f.accept(&finder);
+        for (const Parameter &b : f.output_buffers()) {
+            finder.add(b);
+        }
+        for (const ExternFuncArgument &e : f.extern_arguments()) {
+            if (e.is_image_param()) {
+                finder.add(e.image_param);
+            }
+        }
+    }
+
+    std::map<std::string, Parameter> originals;
+    for (const std::string &name : names) {
+        auto it = finder.params.find(name);
+        internal_assert(it != finder.params.end()) << "No Parameter for buffer argument " << name << "\n";
+        const Parameter &o = it->second;
+        Parameter c(o.type(), true, o.dimensions(), o.name());
+        c.set_host_alignment(o.host_alignment());
+        c.store_in(o.memory_type());
+        if (o.is_tracing_loads()) {
+            c.trace_loads();
+        }
+        for (const std::string &tag : o.get_trace_tags()) {
+            c.add_trace_tag(tag);
+        }
+        originals.emplace(name, o);
+        clones.emplace(name, c);
+    }
+
+    // The constraints may refer to other Parameters that are being cloned,
+    // so they can only be copied once all the clones exist.
+    for (const auto &[name, o] : originals) {
+        Parameter &c = clones.at(name);
+        for (int d = 0; d < o.dimensions(); d++) {
+            c.set_min_constraint(d, substitute_parameters(clones, o.min_constraint(d)));
+            c.set_extent_constraint(d, substitute_parameters(clones, o.extent_constraint(d)));
+            c.set_stride_constraint(d, substitute_parameters(clones, o.stride_constraint(d)));
+            c.set_min_constraint_estimate(d, substitute_parameters(clones, o.min_constraint_estimate(d)));
+            c.set_extent_constraint_estimate(d, substitute_parameters(clones, o.extent_constraint_estimate(d)));
+        }
+    }
+
+    for (auto &[name, f] : copied_env) {
+        f.substitute_parameters(clones);
+    }
+
+    std::vector<Func> funcs;
+    for (const Function &f : copied_outputs) {
+        funcs.emplace_back(f);
+    }
+    std::vector<Stmt> requirements;
+    for (const Stmt &r : p.requirements()) {
+        requirements.push_back(substitute_parameters(clones, r));
+    }
+    return Pipeline(funcs, requirements);
+}
+
+}  // namespace
+
+Callable Pipeline::compile_to_specializing_callable(const std::vector<Argument> &args,
+                                                    const Target &target,
+                                                    int min_calls,
+                                                    int max_variants) {
+    user_assert(min_calls >= 1 && max_variants >= 0)
+        << "compile_to_specializing_callable needs min_calls >= 1 and max_variants >= 0\n";
+
+    Callable callable = compile_to_callable(args, target);
+
+    // The names of the buffer arguments, in the order the Callable takes them.
+    std::vector<std::string> buffer_names;
+    for (const Argument &a : callable.arguments()) {
+        if (a.is_buffer()) {
+            buffer_names.push_back(a.name);
+        }
+    }
+
+    // Each variant is compiled from a private copy of the pipeline, so
+    // that the constraints it adds never reach the caller's Params, even
+    // if the compile fails or another thread is using them.
+    Pipeline p = *this;
+    auto compile_variant = [p, args, target, buffer_names](const std::vector<const halide_buffer_t *> &buffers,
+                                                           const std::vector<int> &host_alignments) {
+        std::map<std::string, Parameter> params;
+        Pipeline variant_pipeline = clone_with_parameters(p, p.contents->outputs, buffer_names, params);
+        variant_pipeline.contents->jit_handlers = p.contents->jit_handlers;
+        variant_pipeline.contents->jit_externs = p.contents->jit_externs;
+        variant_pipeline.contents->trace_pipeline = p.contents->trace_pipeline;
+        variant_pipeline.contents->runtime_prefixes_params = p.contents->runtime_prefixes_params;
+        // The passes are still owned (and deleted) by the original.
+        for (const CustomLoweringPass &pass : p.contents->custom_lowering_passes) {
+            variant_pipeline.contents->custom_lowering_passes.push_back({pass.pass, nullptr});
+        }
+
+        for (size_t i = 0; i < buffers.size(); i++) {
+            Parameter &param = params.at(buffer_names[i]);
+            for (int d = 0; d < buffers[i]->dimensions; d++) {
+                param.set_extent_constraint(d, buffers[i]->dim[d].extent);
+                param.set_stride_constraint(d, buffers[i]->dim[d].stride);
+            }
+            // Never weaker than an alignment the user declared, or the
+            // variant would accept buffers the generic code rejects.
+            param.set_host_alignment(std::max(host_alignments[i], param.host_alignment()));
+        }
+
+        return variant_pipeline.compile_to_callable(args, target);
+    };
+
+    callable.enable_shape_specialization(std::move(compile_variant), min_calls, max_variants);
+    return callable;
+}
+
+std::string Pipeline::jit_object_cache_key(const std::vector<Argument> &args,
+                                           std::string &fn_name,
+                                           const Target &target,
+                                           Pipeline &canonical,
+                                           std::vector<Argument> &canonical_args) const {
+#ifdef WITH_SERIALIZATION
+    if (JITObjectCache::cache_dir().empty() ||
+        target.arch == Target::WebAssembly) {
+        return "";
+    }
+    // A custom lowering pass is arbitrary C++ that we can't fingerprint.
+    if (!contents->custom_lowering_passes.empty()) {
+        debug(1) << "JITObjectCache: pipeline has custom lowering passes; not caching.\n";
+        return "";
+    }
+    const std::string compiler_id = compiler_identity_digest();
+    if (compiler_id.empty()) {
+        return "";
+    }
+
+    std::vector<uint8_t> data;
+    std::map<std::string, std::string> canonical_names;
+#ifdef HALIDE_WITH_EXCEPTIONS
+    try {
+#endif
+        // The names unique_name makes depend on everything the process
+        // has named before, so hash the pipeline with canonical names, so
+        // that the same pipeline built in another process gets the same
+        // key, and compile it with those names too, so that it makes the
+        // same code.
+        serialize_pipeline_canonically(*this, data, canonical_names);
+        canonical = deserialize_pipeline(data, {});
+#ifdef HALIDE_WITH_EXCEPTIONS
+    } catch (...) {
+        debug(1) << "JITObjectCache: pipeline serialization failed; not caching.\n";
+        canonical = Pipeline();
+        return "";
+    }
+#endif
+    // Lowering depends on these too, and they aren't serialized.
+    canonical.contents->trace_pipeline = contents->trace_pipeline;
+    canonical.contents->runtime_prefixes_params = contents->runtime_prefixes_params;
+
+    auto canonical_name = [&](const std::string &name) {
+        auto it = canonical_names.find(name);
+        return it != canonical_names.end() ? it->second : name;
+    };
+    // The function is named after the first output, so name it after the
+    // canonical name of that instead.
+    fn_name = sanitize_function_name(canonical_name(contents->outputs[0].name()));
+
+    CacheKeyBuilder b;
+    b.add("jit");
+    b.add(compiler_id);
+    b.add(target.to_string());
+    b.add(fn_name);
+    canonical_args = args;
+    for (Argument &a : canonical_args) {
+        a.name = canonical_name(a.name);
+        std::ostringstream arg;
+        arg << a.name << " " << (int)a.kind << " " << a.type << " " << (int)a.dimensions;
+        b.add(arg.str());
+    }
+    // In the JIT, codegen assumes the alignment of the data of an
+    // embedded buffer from its address (see
+    // CodeGen_LLVM::codegen_vector_load), so the alignments of the
+    // buffers of the copy being compiled go in the key. Beyond 256
+    // bytes, wider than any vector, they can't make a difference.
+    FindEmbeddedBuffers embedded;
+    for (const auto &[name, f] : build_environment(canonical.contents->outputs)) {
+        f.accept(&embedded);
+        for (const ExternFuncArgument &e : f.extern_arguments()) {
+            if (e.is_buffer()) {
+                embedded.buffers.emplace(e.buffer.name(), e.buffer);
+            }
+        }
+    }
+    for (const auto &[name, buffer] : embedded.buffers) {
+        uintptr_t address = (uintptr_t)buffer.data();
+        uintptr_t alignment = std::min<uintptr_t>(address & (~address + 1), 256);
+        b.add(name + " aligned to " + std::to_string(alignment));
+    }
+    // Extern calls are resolved by name at link time, so only their names
+    // and signatures affect the object code.
+    for (const auto &[name, jit_extern] : contents->jit_externs) {
+        std::ostringstream ext;
+        ext << name << " ";
+        if (jit_extern.pipeline().defined()) {
+            ext << "pipeline";
+        } else {
+            ext << jit_extern.extern_c_function().signature();
+        }
+        b.add(ext.str());
+    }
+    b.add(contents->trace_pipeline ? "trace" : "notrace");
+    // The serialized pipeline writes each shared subexpression once, so
+    // the same pipeline built with different sharing gets a different
+    // key. That only costs a cache miss.
+    b.add(data);
+    return b.hex();
+#else
+    return "";
+#endif
+}
+
+/*static*/ JITDiskCacheStats Pipeline::get_jit_disk_cache_stats() {
+    JITDiskCacheStats stats;
+    stats.hits = jit_disk_cache_hits;
+    stats.misses = jit_disk_cache_misses;
+    stats.stores = jit_disk_cache_stores;
+    stats.bytes_loaded = jit_disk_cache_bytes_loaded;
+    stats.bytes_stored = jit_disk_cache_bytes_stored;
+    return stats;
+}
+
+/*static*/ void Pipeline::reset_jit_disk_cache_stats() {
+    jit_disk_cache_hits = 0;
+    jit_disk_cache_misses = 0;
+    jit_disk_cache_stores = 0;
+    jit_disk_cache_bytes_loaded = 0;
+    jit_disk_cache_bytes_stored = 0;
+}
+
+/*static*/ JITCache Pipeline::compile_jit_cache(const std::function<Module()> &make_module,
+                                                const std::string &fn_name,
                                                 std::vector<Argument> args,
                                                 const std::vector<Internal::Function> &outputs,
                                                 const std::map<std::string, JITExtern> &jit_externs_in,
-                                                const Target &target_arg) {
+                                                const Target &target_arg,
+                                                const std::string &object_cache_key) {
     user_assert(!target_arg.has_unknowns()) << "Cannot jit-compile for target '" << target_arg << "'\n";
 
     Target jit_target = target_arg.with_feature(Target::JIT).with_feature(Target::UserContext);
@@ -732,6 +1072,19 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
     // TODO: it fills in the value side with JITExtern values, but does anything actually use those?
     auto jit_externs = jit_externs_in;
     std::vector<JITModule> externs_jit_module = Pipeline::make_externs_jit_module(jit_target, jit_externs);
+
+    if (!object_cache_key.empty()) {
+        std::vector<uint8_t> object;
+        if (JITObjectCache::try_load(object_cache_key, object)) {
+            jit_disk_cache_hits++;
+            jit_disk_cache_bytes_loaded += object.size();
+            jit_module = JITModule::load_object(object, fn_name, jit_target, externs_jit_module);
+            return JITCache(jit_target, std::move(args), std::move(jit_externs), std::move(jit_module), std::move(wasm_module));
+        }
+        jit_disk_cache_misses++;
+    }
+
+    const Module module = make_module();
     if (jit_target.arch == Target::WebAssembly) {
         FindExterns find_externs(jit_externs);
         for (const LoweredFunc &f : module.functions()) {
@@ -748,9 +1101,17 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
         wasm_module = WasmModule::compile(module, args,
                                           module.name(), jit_externs, externs_jit_module);
     } else {
-        std::string name = sanitize_function_name(outputs[0].name());
-        auto f = module.get_function_by_name(name);
-        jit_module = JITModule(module, f, externs_jit_module);
+        auto f = module.get_function_by_name(fn_name);
+        if (object_cache_key.empty()) {
+            jit_module = JITModule(module, f, externs_jit_module);
+        } else {
+            std::vector<uint8_t> object;
+            jit_module = JITModule(module, f, externs_jit_module, &object);
+            if (JITObjectCache::store(object_cache_key, object)) {
+                jit_disk_cache_stores++;
+                jit_disk_cache_bytes_stored += object.size();
+            }
+        }
     }
 
     return JITCache(jit_target, std::move(args), std::move(jit_externs), std::move(jit_module), std::move(wasm_module));
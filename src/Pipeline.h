@@ -114,6 +114,21 @@ struct AutoSchedulerResults {
     std::vector<uint8_t> featurization;        // The featurization of the pipeline (if any)
 };
 
+/** Process-wide counters for the on-disk JIT object cache, which is
+ * enabled by setting the HL_JIT_CACHE_DIR environment variable. See
+ * Pipeline::get_jit_disk_cache_stats. */
+struct JITDiskCacheStats {
+    /** JIT compilations whose object code was loaded from the cache, skipping
+     * lowering and LLVM codegen entirely. */
+    uint64_t hits = 0;
+    /** JIT compilations that looked in the cache and found no entry. */
+    uint64_t misses = 0;
+    /** Freshly compiled objects that were added to the cache. */
+    uint64_t stores = 0;
+    /** Total size of the objects loaded on hits and written on stores. */
+    uint64_t bytes_loaded = 0, bytes_stored = 0;
+};
+
 class Pipeline;
 
 using AutoSchedulerFn = std::function<void(const Pipeline &, const Target &, const AutoschedulerParams &, AutoSchedulerResults *outputs)>;
@@ -181,11 +196,31 @@ private:
     // sensibly match the value. Return Target() if not jitted.
     Target get_compiled_jit_target() const;
 
-    static Internal::JITCache compile_jit_cache(const Module &module,
+    // Lowering is deferred to the make_module callback, which is not called
+    // at all if object_cache_key names an entry in the on-disk JIT object
+    // cache. An empty key disables the on-disk cache.
+    static Internal::JITCache compile_jit_cache(const std::function<Module()> &make_module,
+                                                const std::string &fn_name,
                                                 std::vector<Argument> args,
                                                 const std::vector<Internal::Function> &outputs,
                                                 const std::map<std::string, JITExtern> &jit_externs,
-                                                const Target &target_arg);
+                                                const Target &target_arg,
+                                                const std::string &object_cache_key);
+
+    /** The key to look up the JIT-compiled object code for this pipeline
+     * with in the on-disk cache, or an empty string if it shouldn't be
+     * cached. When it should, canonical is set to a copy of this
+     * pipeline whose names, like the key, don't depend on what else the
+     * process has named, and canonical_args to the args renamed to
+     * match. The copy is what gets compiled, so that a cached object
+     * reports the same names in its errors and traces no matter which
+     * process compiled it. fn_name is renamed too, as the cached object
+     * defines a function with that name. */
+    std::string jit_object_cache_key(const std::vector<Argument> &args,
+                                     std::string &fn_name,
+                                     const Target &target,
+                                     Pipeline &canonical,
+                                     std::vector<Argument> &canonical_args) const;
 
 public:
     /** Make an undefined Pipeline object. */
@@ -218,6 +253,17 @@ public:
      * It is an error to call this with the same name multiple times. */
     static void add_autoscheduler(const std::string &autoscheduler_name, const AutoSchedulerFn &autoscheduler);
 
+    /** Get the counters for the on-disk JIT object cache. When the
+     * HL_JIT_CACHE_DIR environment variable names a directory, compile_jit
+     * and compile_to_callable key each compilation on the serialized
+     * pipeline, the arguments, the target, and the identity of the Halide
+     * compiler, and reload previously compiled object code from that
+     * directory instead of lowering and compiling again. */
+    static JITDiskCacheStats get_jit_disk_cache_stats();
+
+    /** Reset the counters returned by get_jit_disk_cache_stats to zero. */
+    static void reset_jit_disk_cache_stats();
+
     /** Apply any runtime namespace prefixes to allow custom runtime method names to be emitted */
     void apply_runtime_prefixes(const Target &target,
                                 const RuntimePrefixParams &runtime_prefixes_params) const;
@@ -381,6 +427,25 @@ public:
     Callable compile_to_callable(const std::vector<Argument> &args,
                                  const Target &target = get_jit_target_from_environment());
 
+    /** Like compile_to_callable, but the Callable also keeps count of the
+     * shapes (the extents and strides, and the alignment of the host
+     * pointer) of the buffers it is called with. Once it has been called
+     * min_calls times with the same shape, it compiles a variant of the
+     * pipeline with that shape as constants, which needs no loop tails or
+     * general stride arithmetic, and uses it for calls with that shape from
+     * then on. At most max_variants variants are compiled. Calls with
+     * other shapes, and bounds queries, use the generic code.
+     *
+     * Variants are compiled on the thread that makes the call, from a copy
+     * of the pipeline whose buffer parameters are constrained to the shape
+     * (see OutputImageParam::dim). The pipeline's own parameters are never
+     * modified. If a compile fails, the shape may be tried again after
+     * another min_calls calls with it. */
+    Callable compile_to_specializing_callable(const std::vector<Argument> &args,
+                                              const Target &target = get_jit_target_from_environment(),
+                                              int min_calls = 3,
+                                              int max_variants = 8);
+
     /** Install a set of external C functions or Funcs to satisfy
      * dependencies introduced by HalideExtern and define_extern
      * mechanisms. These will be used by calls to realize,
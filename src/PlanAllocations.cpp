@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <map>
+
+#include "PlanAllocations.h"
+
+#include "CodeGen_Internal.h"
+#include "Debug.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Target.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+using std::map;
+using std::string;
+using std::vector;
+
+const char *const arena_name = "__scratch_arena";
+const char *const arena_base_name = "__scratch_arena.base";
+
+// Offsets into the arena are aligned to at least the largest native
+// vector width we target, so that allocations placed in the arena are as
+// aligned as ones from halide_malloc would be.
+const int64_t arena_alignment = 128;
+
+struct Candidate {
+    const Allocate *op;
+    int64_t size;
+    // The first and last ticks at which the allocation is live, or -1 if
+    // not yet known.
+    int first, last;
+    // The statements enclosing the Allocate, outermost first, ending with
+    // the Allocate itself.
+    vector<Stmt> path;
+    int64_t offset = -1;
+};
+
+// Find the heap allocations that can be placed in the arena, and when
+// each one is live. Time advances by one tick at each statement outside
+// of any loop, and a whole loop takes a single tick. An allocation is
+// live from the tick of its first use to the tick of its Free, so two
+// allocations that are live at the same time have overlapping ranges of
+// ticks. (Allocate nodes are nested, so the Allocate itself says nothing
+// about when the memory is first needed.)
+class FindCandidates : public IRVisitor {
+public:
+    vector<Candidate> candidates;
+
+private:
+    using IRVisitor::visit;
+
+    int tick = 0;
+    int in_loop = 0;
+    vector<Stmt> path;
+    // The index of the candidate each allocation in scope corresponds
+    // to, or -1 if it isn't one.
+    Scope<int> allocs;
+
+    void advance() {
+        if (!in_loop) {
+            tick++;
+        }
+    }
+
+    void use(const string &name) {
+        const int *index = allocs.find(name);
+        if (index && *index >= 0 && candidates[*index].first < 0) {
+            candidates[*index].first = tick;
+        }
+    }
+
+    template<typename T>
+    void visit_loop(const T *op) {
+        advance();
+        in_loop++;
+        IRVisitor::visit(op);
+        in_loop--;
+    }
+
+    template<typename T>
+    void visit_enclosing(const T *op) {
+        path.emplace_back(op);
+        IRVisitor::visit(op);
+        path.pop_back();
+    }
+
+    void visit(const For *op) override {
+        visit_loop(op);
+    }
+
+    void visit(const Fork *op) override {
+        visit_loop(op);
+    }
+
+    void visit(const Acquire *op) override {
+        visit_loop(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        advance();
+        visit_enclosing(op);
+    }
+
+    void visit(const IfThenElse *op) override {
+        advance();
+        visit_enclosing(op);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        visit_enclosing(op);
+    }
+
+    void visit(const Block *op) override {
+        visit_enclosing(op);
+    }
+
+    void visit(const Atomic *op) override {
+        advance();
+        use(op->mutex_name);
+        visit_enclosing(op);
+    }
+
+    void visit(const Prefetch *op) override {
+        advance();
+        use(op->name);
+        visit_enclosing(op);
+    }
+
+    void visit(const Store *op) override {
+        advance();
+        use(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Evaluate *op) override {
+        advance();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const AssertStmt *op) override {
+        advance();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Load *op) override {
+        use(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        use(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        use(op->name);
+        if (ends_with(op->name, ".buffer")) {
+            use(op->name.substr(0, op->name.size() - 7));
+        }
+    }
+
+    void visit(const Allocate *op) override {
+        advance();
+        int index = -1;
+        int64_t elems = op->constant_allocation_size();
+        int64_t bytes = (elems + op->padding) * op->type.bytes();
+        if (!in_loop &&
+            !op->new_expr.defined() &&
+            op->free_function.empty() &&
+            !op->extents.empty() &&
+            elems > 0 &&
+            (op->memory_type == MemoryType::Heap ||
+             (op->memory_type == MemoryType::Auto &&
+              !can_allocation_fit_on_stack(bytes)))) {
+            index = (int)candidates.size();
+            Candidate c;
+            c.op = op;
+            c.size = align_up(bytes, arena_alignment);
+            c.first = -1;
+            c.last = -1;
+            c.path = path;
+            c.path.emplace_back(op);
+            candidates.push_back(std::move(c));
+        }
+
+        for (const auto &e : op->extents) {
+            e.accept(this);
+        }
+        op->condition.accept(this);
+        if (op->new_expr.defined()) {
+            op->new_expr.accept(this);
+        }
+
+        path.emplace_back(op);
+        {
+            ScopedBinding<int> bind(allocs, op->name, index);
+            op->body.accept(this);
+        }
+        path.pop_back();
+
+        if (index >= 0) {
+            Candidate &c = candidates[index];
+            if (c.last < 0) {
+                // There was no Free, so it is live until the end of the
+                // body.
+                c.last = ++tick;
+            }
+            if (c.first < 0) {
+                c.first = c.last;
+            }
+        }
+    }
+
+    void visit(const Free *op) override {
+        advance();
+        const int *index = allocs.find(op->name);
+        if (!in_loop && index && *index >= 0) {
+            candidates[*index].last = tick;
+        }
+    }
+};
+
+// Point each candidate into the arena, and make the arena around the
+// innermost statement that encloses all of them.
+class PlaceInArena : public IRMutator {
+    using IRMutator::visit;
+
+    const map<const Allocate *, int64_t> &offsets;
+    const Stmt &arena_site;
+    int64_t arena_size;
+    Expr scratch, scratch_size;
+    int alignment;
+    int bits;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = offsets.find(op);
+        if (it == offsets.end()) {
+            return IRMutator::visit(op);
+        }
+        Stmt body = mutate(op->body);
+        Expr base = Variable::make(Handle(), arena_base_name);
+        Expr ptr = reinterpret(Handle(), reinterpret<uint64_t>(base) + make_const(UInt(64), it->second));
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents, op->condition,
+                              body, ptr, "halide_device_host_nop_free", op->padding);
+    }
+
+    Stmt make_arena(const Stmt &body) {
+        Expr arena = Variable::make(Handle(), arena_name);
+        vector<Expr> extents = {make_const(Int(32), arena_size)};
+        if (!scratch.defined()) {
+            Stmt stmt = LetStmt::make(arena_base_name, arena, body);
+            return Allocate::make(arena_name, UInt(8), MemoryType::Heap, extents, const_true(), stmt);
+        }
+        // The caller may pass in memory to use as the arena. If they
+        // don't, allocate it.
+        Expr no_scratch = reinterpret<uint64_t>(scratch) == 0;
+        Stmt stmt = LetStmt::make(arena_base_name, select(no_scratch, arena, scratch), body);
+        Expr new_expr = Call::make(Handle(), Call::if_then_else,
+                                   {no_scratch,
+                                    Call::make(Handle(), "halide_malloc", {make_const(UInt(bits), arena_size)}, Call::Extern),
+                                    reinterpret(Handle(), make_zero(UInt(64)))},
+                                   Call::PureIntrinsic);
+        stmt = Allocate::make(arena_name, UInt(8), MemoryType::Heap, extents, no_scratch, stmt, new_expr);
+        Expr required = make_const(UInt(64), arena_size);
+        Expr too_small_error = Call::make(Int(32), "halide_error_scratch_too_small",
+                                          {scratch_size, required}, Call::Extern);
+        stmt = Block::make(AssertStmt::make(no_scratch || scratch_size >= required, too_small_error), stmt);
+        // The code using the allocations in the arena assumes they are
+        // aligned to the native vector width.
+        Expr aligned = (reinterpret<uint64_t>(scratch) % make_const(UInt(64), alignment)) == 0;
+        Expr unaligned_error = Call::make(Int(32), "halide_error_scratch_unaligned",
+                                          {alignment}, Call::Extern);
+        return Block::make(AssertStmt::make(no_scratch || aligned, unaligned_error), stmt);
+    }
+
+public:
+    using IRMutator::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        if (s.same_as(arena_site)) {
+            return make_arena(IRMutator::mutate(s));
+        }
+        return IRMutator::mutate(s);
+    }
+
+    PlaceInArena(const map<const Allocate *, int64_t> &offsets, const Stmt &arena_site,
+                 int64_t arena_size, const Expr &scratch, const Expr &scratch_size,
+                 int alignment, int bits)
+        : offsets(offsets), arena_site(arena_site), arena_size(arena_size),
+          scratch(scratch), scratch_size(scratch_size), alignment(alignment), bits(bits) {
+    }
+};
+
+class FindArenaSize : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) override {
+        if (op->name == arena_name) {
+            size = op->constant_allocation_size();
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    int64_t size = 0;
+};
+
+}  // namespace
+
+Stmt plan_allocations(const Stmt &s, const Target &t, const Expr &scratch, const Expr &scratch_size) {
+    FindCandidates finder;
+    s.accept(&finder);
+    vector<Candidate> &candidates = finder.candidates;
+    if (candidates.empty()) {
+        return s;
+    }
+
+    // Give out offsets greedily, largest allocation first, placing each
+    // one at the lowest offset that doesn't overlap any allocation
+    // already placed that is live at the same time.
+    vector<Candidate *> by_size;
+    for (Candidate &c : candidates) {
+        by_size.push_back(&c);
+    }
+    std::stable_sort(by_size.begin(), by_size.end(),
+                     [](const Candidate *a, const Candidate *b) { return a->size > b->size; });
+
+    int64_t total = 0;
+    vector<const Candidate *> placed;
+    for (Candidate *c : by_size) {
+        // The placed allocations that are live at the same time as this
+        // one, in order of offset.
+        vector<const Candidate *> conflicts;
+        for (const Candidate *p : placed) {
+            if (!(p->first > c->last || c->first > p->last)) {
+                conflicts.push_back(p);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end(),
+                  [](const Candidate *a, const Candidate *b) { return a->offset < b->offset; });
+        int64_t offset = 0;
+        for (const Candidate *p : conflicts) {
+            if (offset + c->size <= p->offset) {
+                break;
+            }
+            offset = std::max(offset, p->offset + p->size);
+        }
+        c->offset = offset;
+        total = std::max(total, offset + c->size);
+        placed.push_back(c);
+    }
+
+    if (total > 0x7fffffff) {
+        // Too large to make as a single allocation. Leave the
+        // allocations as they are.
+        return s;
+    }
+
+    // The arena goes around the innermost statement that encloses all
+    // of the candidates.
+    size_t common = candidates[0].path.size();
+    for (const Candidate &c : candidates) {
+        size_t i = 0;
+        while (i < common && i < c.path.size() && c.path[i].same_as(candidates[0].path[i])) {
+            i++;
+        }
+        common = i;
+    }
+    Stmt arena_site = common > 0 ? candidates[0].path[common - 1] : s;
+
+    map<const Allocate *, int64_t> offsets;
+    for (const Candidate &c : candidates) {
+        offsets[c.op] = c.offset;
+        debug(3) << "Placing " << c.op->name << " (" << c.size << " bytes, live from "
+                 << c.first << " to " << c.last << ") at offset " << c.offset << " of " << arena_name << "\n";
+    }
+    debug(2) << "Packed " << candidates.size() << " allocations into an arena of " << total << " bytes\n";
+
+    // Caller-supplied memory must be aligned as the codegen assumes
+    // allocations are, which is to the native vector width.
+    const int alignment = (int)std::min<int64_t>(arena_alignment, t.natural_vector_size(UInt(8)));
+    PlaceInArena placer(offsets, arena_site, total, scratch, scratch_size, alignment, t.bits);
+    return placer.mutate(s);
+}
+
+int64_t scratch_arena_size(const Stmt &s) {
+    FindArenaSize finder;
+    if (s.defined()) {
+        s.accept(&finder);
+    }
+    return finder.size;
+}
+
+}  // namespace Internal
+}  // namespace Halide
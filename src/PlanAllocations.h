@@ -0,0 +1,37 @@
+#ifndef HALIDE_PLAN_ALLOCATIONS_H
+#define HALIDE_PLAN_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that packs the constant-sized heap allocations
+ * of a pipeline into a single arena.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Find the heap allocations in a statement that have a constant size and
+ * are made at most once per run (i.e. not inside any loop or fork), work
+ * out when each one is live, and give each one an offset into a single
+ * arena such that allocations that are live at the same time don't
+ * overlap. The allocations are then rewritten to point into the arena,
+ * which is allocated with one call to halide_malloc. If scratch is
+ * defined, it is a handle to caller-supplied memory to use for the arena
+ * instead when it is non-null, and scratch_size is the size of that
+ * memory in bytes. Its size, and its alignment to the target's native
+ * vector width, are checked at runtime. Must be run after
+ * inject_early_frees. */
+Stmt plan_allocations(const Stmt &s, const Target &t, const Expr &scratch, const Expr &scratch_size);
+
+/** The size in bytes of the arena made by plan_allocations in the given
+ * statement, or zero if there isn't one. */
+int64_t scratch_arena_size(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
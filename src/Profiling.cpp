@@ -1011,6 +1011,10 @@ public:
     bool in_parallel = false;
     bool in_leaf_task = false;
 
+    // Whether to read hardware performance counters on every change of
+    // current func (Target::ProfileHardwareCounters).
+    bool read_hardware_counters = false;
+
     InjectProfiling(Names &names, const map<std::string, Function> &env)
         : names(names), env(env) {
 
@@ -1111,8 +1115,12 @@ private:
         return names.id_for_entry(names.prefix(name), parent);
     }
 
+    const char *set_current_func_name() const {
+        return read_hardware_counters ? "halide_profiler_set_current_func_with_counters" : "halide_profiler_set_current_func";
+    }
+
     Stmt unconditionally_set_current_func(int id) {
-        Stmt s = Evaluate::make(Call::make(Int(32), "halide_profiler_set_current_func",
+        Stmt s = Evaluate::make(Call::make(Int(32), set_current_func_name(),
                                            {profiler_instance, id, reinterpret(Handle(), make_zero(UInt(64)))}, Call::Extern));
         return s;
     }
@@ -1121,10 +1129,12 @@ private:
     // memory_current/peak. Shared by the Allocate visitor and the
     // declare_allocation marker (device-only buffers whose host Allocate
     // was nulled out). num_allocs/memory_total are handled separately via
-    // the counter path.
-    Expr memory_allocate_call(int idx, const Expr &size) {
+    // the counter path. `ptr` is the allocation if it came from
+    // halide_malloc, so that reuses of the host allocation pool can be
+    // billed to this pipeline, and null otherwise.
+    Expr memory_allocate_call(int idx, const Expr &size, const Expr &ptr) {
         return Call::make(Int(32), "halide_profiler_memory_allocate",
-                          {profiler_instance, idx, size}, Call::Extern);
+                          {profiler_instance, idx, size, ptr}, Call::Extern);
     }
 
     Stmt set_current_func(int id) {
@@ -1133,8 +1143,8 @@ private:
         }
         most_recently_set_func = id;
         Expr last_arg = in_leaf_task ? profiler_local_sampling_token : reinterpret(Handle(), make_zero(UInt(64)));
-        // Inlined to a single store.
-        Stmt s = Evaluate::make(Call::make(Int(32), "halide_profiler_set_current_func",
+        // Inlined to a single store, unless reading hardware counters.
+        Stmt s = Evaluate::make(Call::make(Int(32), set_current_func_name(),
                                            {profiler_instance, id, last_arg}, Call::Extern));
 
         return s;
@@ -1164,7 +1174,7 @@ private:
             }
             func_alloc_sizes.push(name, {/*on_stack=*/false, size, idx});
             if (profiling_memory && idx >= 0 && !is_const_zero(size)) {
-                return memory_allocate_call(idx, size);
+                return memory_allocate_call(idx, size, make_zero(Handle()));
             }
             return make_zero(op->type);
         } else {
@@ -1225,10 +1235,18 @@ private:
                      << names.pipeline_name << "\n";
 
             tasks.push_back(set_current_func(names.malloc_id));
-            tasks.push_back(Evaluate::make(memory_allocate_call(idx, size)));
         }
 
         Stmt body = mutate(op->body);
+        if (track_heap_allocation) {
+            // Bill the allocation once it has been made. Only ones with no
+            // new_expr, in heap memory, come from halide_malloc.
+            bool from_malloc = !op->new_expr.defined() &&
+                               (op->memory_type == MemoryType::Auto ||
+                                op->memory_type == MemoryType::Heap);
+            Expr ptr = from_malloc ? Variable::make(Handle(), op->name) : make_zero(Handle());
+            body = Block::make(Evaluate::make(memory_allocate_call(idx, size, ptr)), body);
+        }
 
         Expr new_expr;
         Stmt stmt;
@@ -1530,6 +1548,7 @@ Stmt inject_profiling(const Stmt &stmt, const string &pipeline_name, const std::
     // 3) Inject the rest of the profiler scaffolding: thread activation,
     //    memory tracking, current-func tracking, copy-to-host/device timing.
     InjectProfiling profiling(names, env);
+    profiling.read_hardware_counters = target.has_feature(Target::ProfileHardwareCounters);
     s = profiling(s);
 
     int num_funcs = names.num_ids();
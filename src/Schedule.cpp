@@ -249,6 +249,9 @@ struct FuncScheduleContents {
     // a lowering pass turns them into assertions in the pipeline's initial
     // assertion block (removed by the no_asserts target feature).
     std::vector<std::pair<Expr, std::string>> type_change_checks;
+    // The buffer that holds the folded storage of the Function between
+    // calls to the pipeline, if any. See Func::carry_storage.
+    Parameter carried_storage;
 
     FuncScheduleContents()
         : store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()), hoist_storage_level(LoopLevel::inlined()) {
@@ -380,6 +383,7 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->async = contents->async;
     copy.contents->ring_buffer = contents->ring_buffer;
     copy.contents->type_change_checks = contents->type_change_checks;
+    copy.contents->carried_storage = contents->carried_storage;
 
     // Deep-copy wrapper functions. In a partial deep-copy (e.g. cloning a
     // single Func via clone_in), the wrapper Funcs may not be among the Funcs
@@ -442,6 +446,14 @@ std::vector<std::pair<Expr, std::string>> &FuncSchedule::type_change_checks() {
     return contents->type_change_checks;
 }
 
+const Parameter &FuncSchedule::carried_storage() const {
+    return contents->carried_storage;
+}
+
+Parameter &FuncSchedule::carried_storage() {
+    return contents->carried_storage;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -618,6 +618,15 @@ public:
     std::vector<std::pair<Expr, std::string>> &type_change_checks();
     // @}
 
+    /** The buffer that holds the folded storage of this Function, and
+     * which of its rows are valid, between calls to the pipeline. Undefined
+     * unless the storage is carried across calls. See
+     * \ref Func::carry_storage */
+    // @{
+    const Parameter &carried_storage() const;
+    Parameter &carried_storage();
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -10,10 +10,14 @@
 #include "Schedule.h"
 #include "halide_ir.fbs.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <set>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -34,6 +38,11 @@ public:
     // Serialize the given pipeline into given the data buffer
     void serialize(const Pipeline &pipeline, std::vector<uint8_t> &data);
 
+    // Serialize the given pipeline into the given data buffer, with its names canonicalized
+    // (see serialize_pipeline_canonically)
+    void serialize_canonically(const Pipeline &pipeline, std::vector<uint8_t> &data,
+                               std::map<std::string, std::string> &canonical_names);
+
     const std::map<std::string, Parameter> &get_external_parameters() const {
         return external_parameters;
     }
@@ -54,6 +63,29 @@ private:
     // so it can later be used during deserialization to have the correct bindings.
     std::map<std::string, Parameter> external_parameters;
 
+    // A lookup table for finding Exprs that have already been serialized via
+    // their nodes, so that a subexpression shared by several parents is
+    // written once and then referred to by its offset. The Expr is held to
+    // keep the address of its node from being reused.
+    std::unordered_map<const IRNode *, std::tuple<Expr, Serialize::Expr, Offset<void>>> exprs_serialized;
+
+    // If set, every name written is recorded here
+    std::set<std::string> *names_seen = nullptr;
+
+    // If set, every name is written as its canonical form from here, and
+    // things looked up by name are written in the order of their canonical
+    // names rather than their names
+    const std::map<std::string, std::string> *canonical_names = nullptr;
+
+    // Whether this is either pass of serialize_canonically
+    bool canonical() const {
+        return names_seen || canonical_names;
+    }
+
+    // The keys of the given map, in the order their entries are written in
+    template<typename T>
+    std::vector<std::string> keys_in_order(const std::map<std::string, T> &m) const;
+
     Serialize::MemoryType serialize_memory_type(const MemoryType &memory_type);
 
     Serialize::ForType serialize_for_type(const ForType &for_type);
@@ -80,8 +112,13 @@ private:
 
     Serialize::ExternFuncArgumentType serialize_extern_func_argument_type(const ExternFuncArgument::ArgType &extern_func_argument_type);
 
+    // Serialize the name of something in the pipeline
     Offset<String> serialize_string(FlatBufferBuilder &builder, const std::string &str);
 
+    // Serialize a string that isn't a name, or that refers to something outside the pipeline (e.g. an extern
+    // function), and so is never canonicalized
+    Offset<String> serialize_raw_string(FlatBufferBuilder &builder, const std::string &str);
+
     Offset<Serialize::Type> serialize_type(FlatBufferBuilder &builder, const Type &type);
 
     // Stmt and Expr are special because they are union types so need to return both the type and serialized object
@@ -89,6 +126,8 @@ private:
 
     std::pair<Serialize::Expr, Offset<void>> serialize_expr(FlatBufferBuilder &builder, const Expr &expr);
 
+    std::pair<Serialize::Expr, Offset<void>> serialize_expr_node(FlatBufferBuilder &builder, const Expr &expr);
+
     Offset<Serialize::Func> serialize_function(FlatBufferBuilder &builder, const Function &function);
 
     Offset<Serialize::Range> serialize_range(FlatBufferBuilder &builder, const Range &range);
@@ -397,7 +436,35 @@ Serialize::ExternFuncArgumentType Serializer::serialize_extern_func_argument_typ
 }
 
 Offset<String> Serializer::serialize_string(FlatBufferBuilder &builder, const std::string &str) {
-    return builder.CreateString(str);
+    if (names_seen) {
+        names_seen->insert(str);
+    }
+    if (canonical_names) {
+        auto it = canonical_names->find(str);
+        internal_assert(it != canonical_names->end()) << "No canonical name for " << str << "\n";
+        return serialize_raw_string(builder, it->second);
+    }
+    return serialize_raw_string(builder, str);
+}
+
+Offset<String> Serializer::serialize_raw_string(FlatBufferBuilder &builder, const std::string &str) {
+    // Names recur throughout a pipeline, so only write each one once.
+    return builder.CreateSharedString(str);
+}
+
+template<typename T>
+std::vector<std::string> Serializer::keys_in_order(const std::map<std::string, T> &m) const {
+    std::vector<std::string> keys;
+    keys.reserve(m.size());
+    for (const auto &it : m) {
+        keys.push_back(it.first);
+    }
+    if (canonical_names) {
+        std::sort(keys.begin(), keys.end(), [&](const std::string &a, const std::string &b) {
+            return canonical_names->find(a)->second < canonical_names->find(b)->second;
+        });
+    }
+    return keys;
 }
 
 Offset<Serialize::Type> Serializer::serialize_type(FlatBufferBuilder &builder, const Type &type) {
@@ -532,7 +599,7 @@ std::pair<Serialize::Stmt, Offset<void>> Serializer::serialize_stmt(FlatBufferBu
         }
         const auto condition_serialized = serialize_expr(builder, allocate_stmt->condition);
         const auto new_expr_serialized = serialize_expr(builder, allocate_stmt->new_expr);
-        const auto free_function_serialized = serialize_string(builder, allocate_stmt->free_function);
+        const auto free_function_serialized = serialize_raw_string(builder, allocate_stmt->free_function);
         const auto padding = allocate_stmt->padding;
         const auto body_serialized = serialize_stmt(builder, allocate_stmt->body);
         return std::make_pair(Serialize::Stmt::Allocate,
@@ -684,6 +751,15 @@ std::pair<Serialize::Expr, Offset<void>> Serializer::serialize_expr(FlatBufferBu
     if (!expr.defined()) {
         return std::make_pair(Serialize::Expr::UndefinedExpr, Serialize::CreateUndefinedExpr(builder).Union());
     }
+    if (auto it = exprs_serialized.find(expr.get()); it != exprs_serialized.end()) {
+        return std::make_pair(std::get<1>(it->second), std::get<2>(it->second));
+    }
+    const auto result = serialize_expr_node(builder, expr);
+    exprs_serialized.emplace(expr.get(), std::make_tuple(expr, result.first, result.second));
+    return result;
+}
+
+std::pair<Serialize::Expr, Offset<void>> Serializer::serialize_expr_node(FlatBufferBuilder &builder, const Expr &expr) {
     switch (expr.node_type()) {
     case IRNodeType::IntImm: {
         const auto *const int_imm = expr.as<IntImm>();
@@ -702,7 +778,7 @@ std::pair<Serialize::Expr, Offset<void>> Serializer::serialize_expr(FlatBufferBu
     }
     case IRNodeType::StringImm: {
         const auto *const string_imm = expr.as<StringImm>();
-        const auto value_serialized = serialize_string(builder, string_imm->value);
+        const auto value_serialized = serialize_raw_string(builder, string_imm->value);
         return std::make_pair(Serialize::Expr::StringImm, Serialize::CreateStringImm(builder, value_serialized).Union());
     }
     case IRNodeType::Cast: {
@@ -880,7 +956,10 @@ std::pair<Serialize::Expr, Offset<void>> Serializer::serialize_expr(FlatBufferBu
     }
     case IRNodeType::Call: {
         const auto *const call_expr = expr.as<Call>();
-        const auto name_serialized = serialize_string(builder, call_expr->name);
+        // Only calls to Funcs and images name something in the pipeline
+        const bool names_pipeline_object = call_expr->call_type == Call::Halide || call_expr->call_type == Call::Image;
+        const auto name_serialized = names_pipeline_object ? serialize_string(builder, call_expr->name) :
+                                                             serialize_raw_string(builder, call_expr->name);
         const auto args = call_expr->args;
         std::vector<Serialize::Expr> args_types;
         args_types.reserve(args.size());
@@ -1004,7 +1083,7 @@ Offset<Serialize::Func> Serializer::serialize_function(FlatBufferBuilder &builde
     for (const auto &update : function.updates()) {
         updates_serialized.push_back(serialize_definition(builder, update));
     }
-    const auto debug_file_serialized = serialize_string(builder, function.debug_file());
+    const auto debug_file_serialized = serialize_raw_string(builder, function.debug_file());
 
     std::vector<Offset<String>> output_buffers_names_serialized;
     output_buffers_names_serialized.reserve(function.output_buffers().size());
@@ -1021,7 +1100,7 @@ Offset<Serialize::Func> Serializer::serialize_function(FlatBufferBuilder &builde
         extern_arguments_serialized.push_back(serialize_extern_func_argument(builder, extern_argument));
     }
 
-    const auto extern_function_name_serialized = serialize_string(builder, function.extern_function_name());
+    const auto extern_function_name_serialized = serialize_raw_string(builder, function.extern_function_name());
     const auto extern_mangling_serialized = serialize_name_mangling(function.extern_definition_name_mangling());
     const auto extern_function_device_api_serialized = serialize_device_api(function.extern_function_device_api());
     const auto extern_proxy_expr_serialized = serialize_expr(builder, function.extern_definition_proxy_expr());
@@ -1031,10 +1110,10 @@ Offset<Serialize::Func> Serializer::serialize_function(FlatBufferBuilder &builde
     std::vector<Offset<String>> trace_tags_serialized;
     trace_tags_serialized.reserve(function.get_trace_tags().size());
     for (const auto &tag : function.get_trace_tags()) {
-        trace_tags_serialized.push_back(serialize_string(builder, tag));
+        trace_tags_serialized.push_back(serialize_raw_string(builder, tag));
     }
     const bool no_profiling = function.should_not_profile();
-    const auto profiler_display_name_serialized = serialize_string(builder, function.profiler_display_name());
+    const auto profiler_display_name_serialized = serialize_raw_string(builder, function.profiler_display_name());
     const bool frozen = function.frozen();
 
     Offset<Serialize::WrapperRef> global_wrapper_serialized = 0;
@@ -1143,13 +1222,19 @@ Offset<Serialize::FuncSchedule> Serializer::serialize_func_schedule(FlatBufferBu
     type_change_checks_serialized.reserve(func_schedule.type_change_checks().size());
     for (const auto &[condition, message] : func_schedule.type_change_checks()) {
         const auto condition_serialized = serialize_expr(builder, condition);
-        const auto message_serialized = serialize_string(builder, message);
+        const auto message_serialized = serialize_raw_string(builder, message);
         type_change_checks_serialized.push_back(
             Serialize::CreateTypeChangeCheck(builder,
                                              condition_serialized.first,
                                              condition_serialized.second,
                                              message_serialized));
     }
+    const Parameter &carried_storage = func_schedule.carried_storage();
+    const std::string carried_storage_name = carried_storage.defined() ? carried_storage.name() : "";
+    if (carried_storage.defined() && parameters_in_pipeline.find(carried_storage_name) == parameters_in_pipeline.end()) {
+        parameters_in_pipeline[carried_storage_name] = carried_storage;
+    }
+    const auto carried_storage_name_serialized = serialize_string(builder, carried_storage_name);
     return Serialize::CreateFuncSchedule(builder, store_level_serialized, compute_level_serialized,
                                          hoist_storage_level_serialized,
                                          builder.CreateVector(storage_dims_serialized),
@@ -1159,13 +1244,14 @@ Offset<Serialize::FuncSchedule> Serializer::serialize_func_schedule(FlatBufferBu
                                          memory_type, memoized, async,
                                          ring_buffer.first, ring_buffer.second,
                                          memoize_eviction_key_serialized.first, memoize_eviction_key_serialized.second,
-                                         builder.CreateVector(type_change_checks_serialized));
+                                         builder.CreateVector(type_change_checks_serialized),
+                                         carried_storage_name_serialized);
 }
 
 Offset<Serialize::Specialization> Serializer::serialize_specialization(FlatBufferBuilder &builder, const Specialization &specialization) {
     const auto condition_serialized = serialize_expr(builder, specialization.condition);
     const auto definition_serialized = serialize_definition(builder, specialization.definition);
-    const auto failure_message_serialized = serialize_string(builder, specialization.failure_message);
+    const auto failure_message_serialized = serialize_raw_string(builder, specialization.failure_message);
     return Serialize::CreateSpecialization(builder, condition_serialized.first, condition_serialized.second, definition_serialized, failure_message_serialized);
 }
 
@@ -1198,7 +1284,7 @@ Offset<Serialize::Definition> Serializer::serialize_definition(FlatBufferBuilder
     // This always relied on Introspection working, so an empty string was always valid.
     // Rather than change the serialization format for a compiler-dependent value, we'll
     // just always use an empty string now.
-    const auto source_location_serialized = serialize_string(builder, "");
+    const auto source_location_serialized = serialize_raw_string(builder, "");
     return Serialize::CreateDefinition(builder, is_init,
                                        predicate_serialized.first, predicate_serialized.second,
                                        builder.CreateVector(values_types), builder.CreateVector(values_serialized),
@@ -1394,7 +1480,9 @@ Offset<Serialize::Parameter> Serializer::serialize_parameter(FlatBufferBuilder &
                        std::optional<uint64_t>(v.value().u.u64) :
                        std::nullopt;
         };
-        const auto scalar_data = make_optional_u64(parameter.scalar_data());
+        // A canonical pipeline is compiled rather than run, so it doesn't
+        // carry the values of its parameters.
+        const auto scalar_data = canonical() ? std::nullopt : make_optional_u64(parameter.scalar_data());
         const auto scalar_default_serialized = serialize_expr(builder, parameter.default_value());
         const auto scalar_min_serialized = serialize_expr(builder, parameter.min_value());
         const auto scalar_max_serialized = serialize_expr(builder, parameter.max_value());
@@ -1474,11 +1562,12 @@ Offset<Serialize::Buffer> Serializer::serialize_buffer(FlatBufferBuilder &builde
 std::vector<Offset<Serialize::WrapperRef>> Serializer::serialize_wrapper_refs(FlatBufferBuilder &builder, const std::map<std::string, FunctionPtr> &wrappers) {
     std::vector<Offset<Serialize::WrapperRef>> wrapper_refs_serialized;
     wrapper_refs_serialized.reserve(wrappers.size());
-    for (const auto &wrapper : wrappers) {
-        auto wrapper_name_serialized = serialize_string(builder, wrapper.first);
+    for (const auto &wrapper_name : keys_in_order(wrappers)) {
+        auto wrapper_name_serialized = serialize_string(builder, wrapper_name);
+        const std::string wrapper_func_name = Function(wrappers.at(wrapper_name)).name();
         int func_index = -1;
-        if (this->func_mappings.find(Function(wrapper.second).name()) != this->func_mappings.end()) {
-            func_index = this->func_mappings[Function(wrapper.second).name()];
+        if (this->func_mappings.find(wrapper_func_name) != this->func_mappings.end()) {
+            func_index = this->func_mappings[wrapper_func_name];
         }
         wrapper_refs_serialized.push_back(Serialize::CreateWrapperRef(builder, wrapper_name_serialized, func_index));
     }
@@ -1490,14 +1579,15 @@ void Serializer::build_function_mappings(const std::map<std::string, Function> &
         this->func_mappings.clear();
     }
     int32_t cnt = 0;
-    for (const auto &entry : env) {
-        user_assert(env.find(entry.first) != env.end()) << "function " << entry.first << " not found in the environment\n";
-        this->func_mappings[entry.first] = cnt++;
+    for (const auto &name : keys_in_order(env)) {
+        this->func_mappings[name] = cnt++;
     }
 }
 
 void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &result) {
     FlatBufferBuilder builder(1024);
+    // Offsets are only meaningful within the builder that made them
+    exprs_serialized.clear();
 
     // extract the DAG, unwrap function from Funcs
     std::vector<Function> outputs_functions;
@@ -1509,9 +1599,9 @@ void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &resul
 
     std::vector<Offset<String>> func_names_in_order_serialized;
     std::vector<Offset<Serialize::Func>> funcs_serialized;
-    for (const auto &entry : env) {
-        func_names_in_order_serialized.push_back(serialize_string(builder, entry.first));
-        funcs_serialized.push_back(this->serialize_function(builder, entry.second));
+    for (const auto &name : keys_in_order(env)) {
+        func_names_in_order_serialized.push_back(serialize_string(builder, name));
+        funcs_serialized.push_back(this->serialize_function(builder, env.at(name)));
     }
 
     auto outputs = pipeline.outputs();
@@ -1536,24 +1626,43 @@ void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &resul
     // then we do the actual serialization of the unique objects once
     std::vector<Offset<Serialize::Parameter>> parameters_serialized;
     parameters_serialized.reserve(parameters_in_pipeline.size());
-    for (const auto &param : parameters_in_pipeline) {
+    std::set<std::string> parameters_written;
+    for (const auto &name : keys_in_order(parameters_in_pipeline)) {
         // we only serialize the definitions of internal parameters with the pipeline
-        if (external_parameters.find(param.first) == external_parameters.end()) {
-            parameters_serialized.push_back(serialize_parameter(builder, param.second));
+        if (external_parameters.find(name) == external_parameters.end()) {
+            parameters_serialized.push_back(serialize_parameter(builder, parameters_in_pipeline.at(name)));
+            parameters_written.insert(name);
         }
     }
 
     // Serialize only the metadata describing external parameters (to allow the to be created with defaults upon deserialization)
     std::vector<Offset<Serialize::ExternalParameter>> external_parameters_serialized;
-    external_parameters_serialized.reserve(external_parameters.size());
-    for (const auto &param : external_parameters) {
-        external_parameters_serialized.push_back(serialize_external_parameter(builder, param.second));
+    if (canonical()) {
+        // A canonical pipeline is compiled in place of the original, so
+        // it has no external parameters, but defines all of them with the
+        // constraints codegen depends on. Their constraints may refer to
+        // parameters not seen yet, so go until there are no new ones.
+        bool found_more = true;
+        while (found_more) {
+            found_more = false;
+            for (const auto &name : keys_in_order(external_parameters)) {
+                if (parameters_written.insert(name).second) {
+                    parameters_serialized.push_back(serialize_parameter(builder, external_parameters.at(name)));
+                    found_more = true;
+                }
+            }
+        }
+    } else {
+        external_parameters_serialized.reserve(external_parameters.size());
+        for (const auto &name : keys_in_order(external_parameters)) {
+            external_parameters_serialized.push_back(serialize_external_parameter(builder, external_parameters.at(name)));
+        }
     }
 
     std::vector<Offset<Serialize::Buffer>> buffers_serialized;
     buffers_serialized.reserve(buffers_in_pipeline.size());
-    for (auto &buffer : buffers_in_pipeline) {
-        buffers_serialized.push_back(serialize_buffer(builder, buffer.second));
+    for (const auto &name : keys_in_order(buffers_in_pipeline)) {
+        buffers_serialized.push_back(serialize_buffer(builder, buffers_in_pipeline.at(name)));
     }
 
     std::string halide_version = std::to_string(HALIDE_VERSION_MAJOR) + "." +
@@ -1573,8 +1682,8 @@ void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &resul
                                                   builder.CreateVector(parameters_serialized),
                                                   builder.CreateVector(external_parameters_serialized),
                                                   builder.CreateVector(buffers_serialized),
-                                                  serialize_string(builder, halide_version),
-                                                  serialize_string(builder, serialization_version));
+                                                  serialize_raw_string(builder, halide_version),
+                                                  serialize_raw_string(builder, serialization_version));
     builder.Finish(pipeline_obj);
 
     uint8_t *buf = builder.GetBufferPointer();
@@ -1589,6 +1698,96 @@ void Serializer::serialize(const Pipeline &pipeline, std::vector<uint8_t> &resul
     }
 }
 
+namespace {
+
+// Split a name into the family of names unique_name would make it in, and
+// its number within that family, so that "f", "f$2" and "f$15" are f$
+// numbers "", "2" and "15", and "v3" is v number "3".
+std::pair<std::string, std::string> name_family(const std::string &name) {
+    size_t dollar = name.rfind('$');
+    if (dollar != std::string::npos && dollar + 1 < name.size() &&
+        std::all_of(name.begin() + dollar + 1, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return {name.substr(0, dollar + 1), name.substr(dollar + 1)};
+    }
+    if (name.size() > 1 && name[0] != '$' && !(name[0] >= '0' && name[0] <= '9') &&
+        std::all_of(name.begin() + 1, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return {name.substr(0, 1), name.substr(1)};
+    }
+    return {name + "$", ""};
+}
+
+// Map each of the given names to a canonical form, which renumbers the
+// names of each family in the order of their numbers. The numbers come
+// from unique_name's global counters, so they depend on what else the
+// process has made, but their order within one pipeline doesn't. Each
+// '.'-separated part of a name is renumbered separately, so that e.g. loop
+// names follow the names of their Funcs and Vars. The first name of a
+// family like f$ is just "f", so names without a number are left alone.
+// The mapping is one to one, so pipelines with the same canonical form
+// are the same up to the names of their Funcs, Vars and Params.
+std::map<std::string, std::string> canonicalize_names(const std::set<std::string> &names) {
+    std::vector<std::vector<std::string>> parts_of_names;
+    std::map<std::string, std::vector<std::string>> numbers_in_family;
+    for (const std::string &name : names) {
+        std::vector<std::string> parts = split_string(name, ".");
+        for (const std::string &part : parts) {
+            auto [family, number] = name_family(part);
+            numbers_in_family[family].push_back(number);
+        }
+        parts_of_names.push_back(std::move(parts));
+    }
+    // Order numbers by value, with no number (the first name of a family)
+    // coming before all of them.
+    auto by_value = [](const std::string &a, const std::string &b) {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    };
+    for (auto &[family, numbers] : numbers_in_family) {
+        std::sort(numbers.begin(), numbers.end(), by_value);
+        numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+    }
+
+    std::map<std::string, std::string> result;
+    auto name = names.begin();
+    for (const auto &parts : parts_of_names) {
+        std::string canonical;
+        for (size_t i = 0; i < parts.size(); i++) {
+            auto [family, number] = name_family(parts[i]);
+            const auto &numbers = numbers_in_family[family];
+            size_t rank = std::lower_bound(numbers.begin(), numbers.end(), number, by_value) - numbers.begin();
+            canonical += (i > 0 ? "." : "");
+            // The first name of a family ending in '$' is written the way
+            // unique_name writes the first name it makes with a prefix,
+            // unless that could be mistaken for a name in another family.
+            const std::string prefix = family.substr(0, family.size() - 1);
+            if (rank == 0 && family.back() == '$' && !prefix.empty() && name_family(prefix).second.empty()) {
+                canonical += prefix;
+            } else {
+                canonical += family + std::to_string(rank);
+            }
+        }
+        result[*name++] = canonical;
+    }
+    return result;
+}
+
+}  // namespace
+
+void Serializer::serialize_canonically(const Pipeline &pipeline, std::vector<uint8_t> &result,
+                                       std::map<std::string, std::string> &canonical) {
+    // Find all the names first, as the canonical form of a name depends on
+    // the other names in its family.
+    std::set<std::string> names;
+    {
+        Serializer collector;
+        collector.names_seen = &names;
+        collector.serialize(pipeline, result);
+    }
+    canonical = canonicalize_names(names);
+    Serializer canonicalizer;
+    canonicalizer.canonical_names = &canonical;
+    canonicalizer.serialize(pipeline, result);
+}
+
 void Serializer::serialize(const Pipeline &pipeline, const std::string &filename) {
     std::vector<uint8_t> data;
     serialize(pipeline, data);
@@ -1601,6 +1800,12 @@ void Serializer::serialize(const Pipeline &pipeline, const std::string &filename
     out.close();
 }
 
+void serialize_pipeline_canonically(const Pipeline &pipeline, std::vector<uint8_t> &data,
+                                    std::map<std::string, std::string> &canonical_names) {
+    Serializer serializer;
+    serializer.serialize_canonically(pipeline, data, canonical_names);
+}
+
 }  // namespace Internal
 
 void serialize_pipeline(const Pipeline &pipeline, std::vector<uint8_t> &data) {
@@ -1647,6 +1852,15 @@ void serialize_pipeline(const Pipeline &pipeline, const std::string &filename, s
     user_error << "Serialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
 }
 
+namespace Internal {
+
+void serialize_pipeline_canonically(const Pipeline &pipeline, std::vector<uint8_t> &data,
+                                    std::map<std::string, std::string> &canonical_names) {
+    user_error << "Serialization is not supported in this build of Halide; try rebuilding with WITH_SERIALIZATION=ON.";
+}
+
+}  // namespace Internal
+
 }  // namespace Halide
 
 #endif  // WITH_SERIALIZATION
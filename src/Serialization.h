@@ -27,6 +27,23 @@ void serialize_pipeline(const Pipeline &pipeline, const std::string &filename);
 /// @param params Map of named parameters which will get populated during serialization (can be used to bind external parameters to objects in the pipeline by name).
 void serialize_pipeline(const Pipeline &pipeline, const std::string &filename, std::map<std::string, Parameter> &params);
 
+namespace Internal {
+
+/// @brief Serialize a Halide pipeline into the given data buffer, with the names of its Funcs, Vars, Params and buffers
+///        replaced by canonical names that don't depend on what else the process has named (e.g. "f$7" and "f$12" may
+///        become "f" and "f$1"). Pipelines with the same result are the same up to the names of those things, so the
+///        result can be used to compare pipelines, e.g. as part of a cache key. It deserializes (with no user
+///        parameters) into a copy of the pipeline with the canonical names, to compile in its place. All of its
+///        Parameters are then new ones, with the same constraints as the originals, but without their values.
+/// @param pipeline The Halide pipeline to serialize.
+/// @param data The data buffer to store the serialized Halide pipeline into. Any existing contents will be destroyed.
+/// @param canonical_names Map from each name in the pipeline that was replaced to its canonical name, which will get
+///        populated during serialization.
+void serialize_pipeline_canonically(const Pipeline &pipeline, std::vector<uint8_t> &data,
+                                    std::map<std::string, std::string> &canonical_names);
+
+}  // namespace Internal
+
 }  // namespace Halide
 
 #endif
@@ -870,6 +870,15 @@ Stmt skip_stages(const Stmt &stmt,
             analysis.unconditionally_used_funcs.insert(func_id[f.name()]);
         }
 
+        // Funcs that carry their storage across calls to the pipeline must
+        // keep the rows of it that the next call may resume from valid, so
+        // they can't be skipped either.
+        for (const auto &p : env) {
+            if (p.second.schedule().carried_storage().defined()) {
+                analysis.unconditionally_used_funcs.insert(func_id[p.first]);
+            }
+        }
+
         SkipStages skipper(analysis, name_for_id);
         stmt = skipper(stmt);
         stmt = skipper.emit_outermost_defs(stmt);
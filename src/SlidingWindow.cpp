@@ -13,6 +13,7 @@
 #include "Scope.h"
 #include "Simplify.h"
 #include "Solve.h"
+#include "StorageFolding.h"
 #include "Substitute.h"
 #include <list>
 #include <set>
@@ -466,6 +467,16 @@ class SlidingWindowOnFunctionAndLoop : public IRMutator {
                     new_max = select(need_explicit_warmup, max_required, likely_if_innermost(new_max));
                 }
             }
+            if (can_slide_up && func.schedule().carried_storage().defined()) {
+                // The rows before the resume row are still in the storage
+                // carried over from the last call to the pipeline (see
+                // Func::carry_storage), so don't compute them again.
+                for (const StorageDim &sd : func.schedule().storage_dims()) {
+                    if (sd.var == dim && sd.fold_factor.defined() && sd.fold_forward) {
+                        new_min = max(new_min, Variable::make(Int(32), carried_storage_resume_row(func)));
+                    }
+                }
+            }
             new_min = simplify(new_min);
             new_max = simplify(new_max);
 
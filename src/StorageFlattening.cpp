@@ -10,6 +10,7 @@
 #include "Parameter.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "StorageFolding.h"
 #include "Substitute.h"
 
 #include <optional>
@@ -232,8 +233,28 @@ public:
         }
         stmt = LetStmt::make(op->name + ".buffer", builder.build(), stmt);
 
-        // Make the allocation node
-        stmt = Allocate::make(op->name, op->types[0], op->memory_type, allocation_extents, condition, stmt);
+        // Make the allocation node. A Func that carries its storage
+        // across calls to the pipeline keeps it at the start of its
+        // state buffer, ahead of the header storage folding put at the
+        // end (see Func::carry_storage).
+        const Parameter &carried = env.find(op->name)->second.first.schedule().carried_storage();
+        if (carried.defined()) {
+            Expr state_bytes = Variable::make(Int(32), carried.name() + ".extent.0", carried);
+            Expr header_words = carried_storage_header_words(dims);
+            Expr bytes = op->types[0].bytes();
+            for (const Expr &e : allocation_extents) {
+                bytes *= e;
+            }
+            Expr error = Call::make(Int(32), "halide_error_access_out_of_bounds",
+                                    {StringImm::make(carried.name()), 0, 0,
+                                     (bytes + 3) / 4 * 4 + header_words * 4 - 1, 0, state_bytes - 1},
+                                    Call::Extern);
+            stmt = Allocate::make(op->name, op->types[0], MemoryType::Heap, allocation_extents, condition, stmt,
+                                  Variable::make(Handle(), carried.name(), carried), "halide_device_host_nop_free");
+            stmt = Block::make(AssertStmt::make((bytes + 3) / 4 <= state_bytes / 4 - header_words, error), stmt);
+        } else {
+            stmt = Allocate::make(op->name, op->types[0], op->memory_type, allocation_extents, condition, stmt);
+        }
 
         // Wrap it into storage bound asserts.
         if (!bound_asserts.empty()) {
@@ -12,6 +12,7 @@
 #include "Substitute.h"
 #include "Util.h"
 #include <algorithm>
+#include <set>
 #include <utility>
 
 namespace Halide {
@@ -933,6 +934,73 @@ public:
     }
 };
 
+// A value in the first word of the header of the state buffer of a Func
+// scheduled with Func::carry_storage, to mark the rows the header
+// describes as valid.
+const int carried_storage_magic = 0x48434653;
+
+// Wrap the folded realization of a Func scheduled with
+// Func::carry_storage in the code that works out which rows of the
+// storage carried over from the last call to the pipeline it can reuse,
+// and that records which rows it leaves there for the next call. The
+// header at the end of the state buffer holds the magic value, the first
+// and last valid rows, and the min and extent of each dimension of the
+// folded storage.
+Stmt carry_folded_storage(const Function &func, const Realize *op, const Region &folded_bounds,
+                          int dim, const Expr &factor, Stmt stmt) {
+    const Parameter &state = func.schedule().carried_storage();
+    const string prefix = func.name() + ".carried.";
+    Expr header = Variable::make(Int(32), prefix + "header");
+    auto word = [&](int i) {
+        return Load::make(Int(32), state.name(), header + i, Buffer<>(), state,
+                          const_true(), ModulusRemainder(), false);
+    };
+    auto set_word = [&](int i, const Expr &value) {
+        return Store::make(state.name(), value, header + i, state,
+                           const_true(), ModulusRemainder(), false);
+    };
+
+    Expr valid_min = Variable::make(Int(32), prefix + "valid_min");
+    Expr valid_max = Variable::make(Int(32), prefix + "valid_max");
+    Expr resume = Variable::make(Bool(), prefix + "resume");
+    Expr first = op->bounds[dim].min;
+    Expr last = op->bounds[dim].min + op->bounds[dim].extent - 1;
+
+    // The rows we need can be taken from the carried storage if it has
+    // the same shape as ours, and holds the rows from the first one we
+    // need up to the last one it has, with nothing missing in between.
+    Expr can_resume = word(0) == carried_storage_magic;
+    for (size_t i = 0; i < folded_bounds.size(); i++) {
+        can_resume = can_resume &&
+                     word(3 + 2 * i) == folded_bounds[i].min &&
+                     word(4 + 2 * i) == folded_bounds[i].extent;
+    }
+    can_resume = can_resume &&
+                 first >= max(valid_min, valid_max - factor + 1) &&
+                 first <= valid_max + 1;
+
+    // Until this call is done, the storage holds no valid rows, so a
+    // call that fails part of the way through leaves nothing to resume
+    // from.
+    vector<Stmt> record;
+    record.push_back(set_word(1, select(resume, valid_min, first)));
+    record.push_back(set_word(2, select(resume, max(valid_max, last), last)));
+    for (size_t i = 0; i < folded_bounds.size(); i++) {
+        record.push_back(set_word(3 + 2 * i, folded_bounds[i].min));
+        record.push_back(set_word(4 + 2 * i, folded_bounds[i].extent));
+    }
+    record.push_back(set_word(0, select(resume || first <= last, carried_storage_magic, 0)));
+
+    stmt = Block::make({set_word(0, 0), stmt, Block::make(record)});
+    stmt = LetStmt::make(carried_storage_resume_row(func), select(resume, valid_max + 1, first), stmt);
+    stmt = LetStmt::make(prefix + "resume", can_resume, stmt);
+    stmt = LetStmt::make(prefix + "valid_max", word(2), stmt);
+    stmt = LetStmt::make(prefix + "valid_min", word(1), stmt);
+    Expr state_bytes = Variable::make(Int(32), state.name() + ".extent.0", state);
+    stmt = LetStmt::make(prefix + "header", state_bytes / 4 - carried_storage_header_words(func.dimensions()), stmt);
+    return stmt;
+}
+
 // Look for opportunities for storage folding in a statement
 class StorageFolding : public IRMutator {
     const map<string, Function> &env;
@@ -985,6 +1053,31 @@ class StorageFolding : public IRMutator {
                 << sd.var << " may not have a corresponding inner loop to fold over.";
         }
 
+        // The storage of a Func carried across calls to the pipeline must
+        // be folded forward along the dimension the Func slides along,
+        // as that is what says which of its rows are still valid.
+        const Parameter &carried = func.schedule().carried_storage();
+        int carried_dim = -1;
+        if (carried.defined()) {
+            carried_funcs.insert(op->name);
+            for (const StorageDim &sd : func.schedule().storage_dims()) {
+                if (sd.fold_factor.defined() && sd.fold_forward) {
+                    carried_dim = (int)(std::find(args.begin(), args.end(), sd.var) - args.begin());
+                }
+            }
+            user_assert(carried_dim >= 0)
+                << "Func " << op->name << " carries its storage across calls to the pipeline, "
+                << "so its storage must be folded forwards along the dimension it slides along "
+                << "with an explicit call to fold_storage().\n";
+            user_assert(op->types.size() == 1 && !func.schedule().async())
+                << "Func " << op->name << " carries its storage across calls to the pipeline, "
+                << "which is not supported for Funcs with Tuple values or async schedules.\n";
+            user_assert(stmt_uses_var(body, carried_storage_resume_row(func)))
+                << "Func " << op->name << " carries its storage across calls to the pipeline, "
+                << "but could not be slid along dimension " << args[carried_dim]
+                << " over a serial loop, so it has no rows to resume from.\n";
+        }
+
         if (body.same_as(op->body)) {
             return op;
         } else if (folder.dims_folded.empty()) {
@@ -1003,6 +1096,14 @@ class StorageFolding : public IRMutator {
 
             Stmt stmt = op->with(bounds, op->condition, body);
 
+            if (carried.defined()) {
+                for (const auto &fold : folder.dims_folded) {
+                    if (fold.dim == carried_dim) {
+                        stmt = carry_folded_storage(func, op, bounds, fold.dim, fold.factor, stmt);
+                    }
+                }
+            }
+
             // Each fold may have an associated semaphore that needs initialization, along with some counters
             for (const auto &fold : folder.dims_folded) {
                 auto sema = fold.semaphore;
@@ -1037,6 +1138,8 @@ class StorageFolding : public IRMutator {
     }
 
 public:
+    std::set<string> carried_funcs;
+
     StorageFolding(const map<string, Function> &env)
         : env(env) {
     }
@@ -1055,8 +1158,43 @@ class RemoveSlidingWindowMarkers : public IRMutator {
 
 }  // namespace
 
+int carried_storage_header_words(int dimensions) {
+    return 3 + 2 * dimensions;
+}
+
+Expr carried_storage_bytes(const Function &f, const std::vector<Expr> &extents) {
+    const vector<string> &args = f.args();
+    Expr bytes = f.output_types()[0].bytes();
+    for (const StorageDim &sd : f.schedule().storage_dims()) {
+        size_t i = std::find(args.begin(), args.end(), sd.var) - args.begin();
+        internal_assert(i < extents.size());
+        Expr extent = sd.fold_factor.defined() ? sd.fold_factor : extents[i];
+        if (sd.bound.defined()) {
+            extent = sd.bound;
+        }
+        if (sd.alignment.defined()) {
+            extent = ((extent + sd.alignment - 1) / sd.alignment) * sd.alignment;
+        }
+        bytes *= extent;
+    }
+    // Round up to a whole number of words, then add the header.
+    return ((bytes + 3) / 4 + carried_storage_header_words(f.dimensions())) * 4;
+}
+
+std::string carried_storage_resume_row(const Function &f) {
+    return f.name() + ".carried.resume_row";
+}
+
 Stmt storage_folding(const Stmt &s, const std::map<std::string, Function> &env) {
-    Stmt stmt = StorageFolding(env)(s);
+    StorageFolding folding(env);
+    Stmt stmt = folding(s);
+    for (const auto &p : env) {
+        user_assert(!p.second.schedule().carried_storage().defined() ||
+                    folding.carried_funcs.count(p.first))
+            << "Func " << p.first << " carries its storage across calls to the pipeline, "
+            << "but has no storage of its own to carry. It must not be inlined or "
+            << "be an output of the pipeline.\n";
+    }
     stmt = RemoveSlidingWindowMarkers()(stmt);
     return stmt;
 }
@@ -7,6 +7,7 @@
  */
 #include <map>
 #include <string>
+#include <vector>
 
 #include "Expr.h"
 
@@ -30,6 +31,24 @@ class Function;
  */
 Stmt storage_folding(const Stmt &s, const std::map<std::string, Function> &env);
 
+/** A Func scheduled with Func::carry_storage keeps its folded storage at
+ * the start of its state buffer, and a header at the end that records
+ * the shape of the storage and which rows of it are valid. This is the
+ * number of int32 words in the header. */
+int carried_storage_header_words(int dimensions);
+
+/** The number of bytes the state buffer of a Func scheduled with
+ * Func::carry_storage needs, given the extent of each dimension of the
+ * region of the Func that the pipeline computes. */
+Expr carried_storage_bytes(const Function &f, const std::vector<Expr> &extents);
+
+/** The name of the variable that holds the first row of a Func
+ * scheduled with Func::carry_storage that a call to the pipeline must
+ * compute, as the rows before it are still in the state buffer. The
+ * sliding window optimization starts the rows each iteration computes
+ * there, and storage folding defines it. */
+std::string carried_storage_resume_row(const Function &f);
+
 }  // namespace Internal
 }  // namespace Halide
 
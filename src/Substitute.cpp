@@ -121,6 +121,60 @@ Stmt substitute(const map<string, Expr> &m, const Stmt &stmt) {
 
 namespace {
 
+class SubstituteParameters : public IRMutator {
+    const map<string, Parameter> &replace;
+
+    using IRMutator::visit;
+
+    const Parameter *find_replacement(const Parameter &p) const {
+        if (!p.defined()) {
+            return nullptr;
+        }
+        auto it = replace.find(p.name());
+        if (it == replace.end() || it->second.same_as(p)) {
+            return nullptr;
+        }
+        return &it->second;
+    }
+
+    Expr visit(const Variable *op) override {
+        if (const Parameter *p = find_replacement(op->param)) {
+            return Variable::make(op->type, op->name, op->image, *p, op->reduction_domain);
+        }
+        return op;
+    }
+
+    Expr visit(const Call *op) override {
+        Expr e = IRMutator::visit(op);
+        if (const Parameter *p = find_replacement(op->param)) {
+            op = e.as<Call>();
+            internal_assert(op);
+            return Call::make(op->type, op->name, op->args, op->call_type, op->func,
+                              op->value_index, op->image, *p);
+        }
+        return e;
+    }
+
+public:
+    SubstituteParameters(const map<string, Parameter> &m)
+        : replace(m) {
+    }
+};
+
+}  // namespace
+
+Expr substitute_parameters(const map<string, Parameter> &m, const Expr &expr) {
+    SubstituteParameters s(m);
+    return s(expr);
+}
+
+Stmt substitute_parameters(const map<string, Parameter> &m, const Stmt &stmt) {
+    SubstituteParameters s(m);
+    return s(stmt);
+}
+
+namespace {
+
 template<typename T>
 auto substitute_impl(const Expr &find, const Expr &replacement, const T &ir) {
     return mutate_with(ir, [&](auto *self, const Expr &e) {
@@ -11,6 +11,7 @@
 #include <map>
 
 #include "Expr.h"
+#include "Parameter.h"
 
 namespace Halide {
 namespace Internal {
@@ -49,6 +50,15 @@ T substitute(const std::map<std::string, Expr> &replacements, const T &container
     return output;
 }
 
+/** Replace references to Parameters (by Variables and by loads from
+ * images) with the Parameter of the same name in the map. This includes
+ * references in the buffer constraints of the replacements themselves
+ * only if those constraints were built with this function. */
+// @{
+Expr substitute_parameters(const std::map<std::string, Parameter> &replacements, const Expr &expr);
+Stmt substitute_parameters(const std::map<std::string, Parameter> &replacements, const Stmt &stmt);
+// @}
+
 /** Substitutions where the IR may be a general graph (and not just a
  * DAG). */
 // @{
@@ -636,6 +636,7 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"armv89a", Target::ARMv89a},
     {"sanitizer_coverage", Target::SanitizerCoverage},
     {"profile_by_timer", Target::ProfileByTimer},
+    {"profile_hardware_counters", Target::ProfileHardwareCounters},
     {"spirv", Target::SPIRV},
     {"vulkan", Target::Vulkan},
     {"vk_int8", Target::VulkanInt8},
@@ -650,6 +651,9 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"avx10_1", Target::AVX10_1},
     {"x86apx", Target::X86APX},
     {"simulator", Target::Simulator},
+    {"static_memory_plan", Target::StaticMemoryPlan},
+    {"split_codegen", Target::SplitCodegen},
+    {"batch_entry_point", Target::BatchEntryPoint},
     // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
 };
 
@@ -1727,6 +1731,11 @@ bool Target::get_runtime_compatible_target(const Target &other, Target &result)
     // (a) must be included if either target has the feature (union)
     // (b) must be included if both targets have the feature (intersection)
     // (c) must match across both targets; it is an error if one target has the feature and the other doesn't
+    // Features in none of these lists only change the code generated for a pipeline, never the
+    // runtime it links against, and are dropped from the result. These are:
+    //   SplitCodegen
+    //   StaticMemoryPlan
+    //   BatchEntryPoint
 
     const std::vector<Feature> union_features = {{
         // These are true union features.
@@ -1784,6 +1793,9 @@ bool Target::get_runtime_compatible_target(const Target &other, Target &result)
         ARMv87a,
         ARMv88a,
         ARMv89a,
+
+        // The runtime support for these is only used by code compiled with them.
+        ProfileHardwareCounters,
     }};
 
     const std::vector<Feature> intersection_features = {{
@@ -205,6 +205,10 @@ struct Target {
         HLSL_SM67 = halide_target_feature_hlsl_sm67,
         HLSL_SM68 = halide_target_feature_hlsl_sm68,
         HLSL_SM69 = halide_target_feature_hlsl_sm69,
+        StaticMemoryPlan = halide_target_feature_static_memory_plan,
+        ProfileHardwareCounters = halide_target_feature_profile_hardware_counters,
+        SplitCodegen = halide_target_feature_split_codegen,
+        BatchEntryPoint = halide_target_feature_batch_entry_point,
         FeatureEnd = halide_target_feature_end
     };
     Target() = default;
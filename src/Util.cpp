@@ -186,8 +186,19 @@ int unique_count(size_t h) {
     h = h & (num_unique_name_counters - 1);
     return unique_name_counters[h]++;
 }
+
+thread_local ScopedUniqueNameContext *unique_name_context = nullptr;
 }  // namespace
 
+ScopedUniqueNameContext::ScopedUniqueNameContext(const std::string &tag)
+    : tag(tag), old_context(unique_name_context) {
+    unique_name_context = this;
+}
+
+ScopedUniqueNameContext::~ScopedUniqueNameContext() {
+    unique_name_context = old_context;
+}
+
 // There are three possible families of names returned by the methods below:
 // 1) char pattern: (char that isn't '$') + number (e.g. v234)
 // 2) string pattern: (string without '$') + '$' + number (e.g. fr#nk82$42)
@@ -196,10 +207,19 @@ int unique_count(size_t h) {
 // done above, and there can be no collisions across families by
 // construction.
 
+// Names made within a ScopedUniqueNameContext put the context's tag
+// after the numeric suffix, separated by a 'k'. That takes them out of
+// the first two families, and the tag keeps them distinct from the names
+// of other contexts.
+
 string unique_name(char prefix) {
     if (prefix == '$') {
         prefix = '_';
     }
+    if (ScopedUniqueNameContext *ctx = unique_name_context) {
+        int count = ctx->counters[string(1, prefix)]++;
+        return prefix + std::to_string(count) + "k" + ctx->tag;
+    }
     return prefix + std::to_string(unique_count((size_t)(prefix)));
 }
 
@@ -236,6 +256,13 @@ string unique_name(const std::string &prefix) {
     matches_string_pattern &= num_dollars == 1;
     matches_char_pattern &= prefix.size() > 1;
 
+    if (ScopedUniqueNameContext *ctx = unique_name_context) {
+        // Never return the input as-is, as another context may be
+        // returning the same one.
+        int count = ctx->counters["$" + sanitized]++;
+        return sanitized + "$" + std::to_string(count) + "k" + ctx->tag;
+    }
+
     // Then add a suffix that's globally unique relative to the hash
     // of the sanitized name.
     int count = unique_count(std::hash<std::string>()(sanitized));
@@ -502,6 +529,63 @@ std::vector<char> read_entire_file(const std::string &pathname) {
     return result;
 }
 
+MappedFile::MappedFile(const std::string &pathname) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(pathname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    user_assert(file != INVALID_HANDLE_VALUE) << "Unable to open file: " << pathname << "\n";
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        user_error << "Unable to get the size of file: " << pathname << "\n";
+    }
+    contents_size = (size_t)file_size.QuadPart;
+    if (contents_size > 0) {
+        // The mapping keeps the file open, so the handle can be closed here.
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        user_assert(mapping != nullptr) << "Unable to map file: " << pathname << "\n";
+        contents = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        user_assert(contents != nullptr) << "Unable to map file: " << pathname << "\n";
+    } else {
+        CloseHandle(file);
+    }
+#else
+    int fd = ::open(pathname.c_str(), O_RDONLY);
+    user_assert(fd != -1) << "Unable to open file: " << pathname << "\n";
+    struct stat s;
+    if (::fstat(fd, &s) != 0) {
+        ::close(fd);
+        user_error << "Unable to get the size of file: " << pathname << "\n";
+    }
+    contents_size = (size_t)s.st_size;
+    if (contents_size > 0) {
+        // The mapping keeps the file open, so the descriptor can be closed here.
+        void *p = mmap(nullptr, contents_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        user_assert(p != MAP_FAILED) << "Unable to map file: " << pathname << ": " << strerror(errno) << "\n";
+        contents = (const uint8_t *)p;
+    } else {
+        ::close(fd);
+    }
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (contents) {
+        UnmapViewOfFile(contents);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+#else
+    if (contents) {
+        munmap((void *)contents, contents_size);
+    }
+#endif
+}
+
 void write_entire_file(const std::string &pathname, const void *source, size_t source_len) {
     std::ofstream f(pathname, std::ios::out | std::ios::binary);
 
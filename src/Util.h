@@ -18,6 +18,7 @@
 #include <cstring>
 #include <functional>
 #include <limits>
+#include <map>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -170,6 +171,32 @@ std::string unique_name(char prefix);
 std::string unique_name(const std::string &prefix);
 // @}
 
+/** While an object of this type is alive, unique_name on the current
+ * thread draws its numeric suffixes from counters private to the
+ * object, and tags the names it returns with the given tag. This
+ * makes the names made by a piece of work depend only on that work, and
+ * not on what other threads are doing at the same time, which keeps the
+ * output of work done in parallel at compile time deterministic. The
+ * tag must consist only of letters, digits, and underscores, and must
+ * differ from the tag of any other context whose names may end up in the
+ * same IR. Names made within a context are never returned as-is, and are
+ * distinct from anything unique_name returns outside of one. */
+class ScopedUniqueNameContext {
+    std::string tag;
+    std::map<std::string, int> counters;
+    ScopedUniqueNameContext *old_context;
+
+    friend std::string unique_name(char prefix);
+    friend std::string unique_name(const std::string &prefix);
+
+public:
+    explicit ScopedUniqueNameContext(const std::string &tag);
+    ~ScopedUniqueNameContext();
+
+    ScopedUniqueNameContext(const ScopedUniqueNameContext &) = delete;
+    ScopedUniqueNameContext &operator=(const ScopedUniqueNameContext &) = delete;
+};
+
 /** Test if the first string starts with the second string */
 bool starts_with(const std::string &str, const std::string &prefix);
 
@@ -345,6 +372,33 @@ FileStat file_stat(const std::string &name);
  * is read in binary mode. Errors trigger an assertion failure. */
 std::vector<char> read_entire_file(const std::string &pathname);
 
+/** A read-only view of the entire contents of a file, which is mapped
+ * into memory rather than read, so that only the pages actually touched
+ * are loaded. The view is valid for the lifetime of the object. Errors
+ * trigger a user error. */
+class MappedFile final {
+    const uint8_t *contents = nullptr;
+    size_t contents_size = 0;
+#ifdef _WIN32
+    void *mapping = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const std::string &pathname);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const {
+        return contents;
+    }
+
+    size_t size() const {
+        return contents_size;
+    }
+};
+
 /** Create or replace the contents of a file with a given pointer-and-length
  * of memory. If the file doesn't exist, it is created; if it does exist, it
  * is completely overwritten. Any error triggers an assertion failure. */
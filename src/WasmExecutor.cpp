@@ -1027,6 +1027,8 @@ WABT_HOST_CALLBACK(halide_current_thread_id) {
     return wabt::Result::Ok;
 }
 
+WABT_HOST_CALLBACK_UNIMPLEMENTED(halide_current_time_ns)
+
 WABT_HOST_CALLBACK(halide_trace_helper) {
     WabtContext &wabt_context = get_wabt_context(thread);
 
@@ -1783,6 +1785,10 @@ void wasm_jit_halide_current_thread_id_callback(const v8::FunctionCallbackInfo<v
     args.GetReturnValue().Set(Integer::New(isolate, 1));
 }
 
+void wasm_jit_halide_current_time_ns_callback(const v8::FunctionCallbackInfo<v8::Value> &args) {
+    internal_error << "WebAssembly JIT does not yet support the halide_current_time_ns() call.";
+}
+
 void wasm_jit_halide_trace_helper_callback(const v8::FunctionCallbackInfo<v8::Value> &args) {
     internal_assert(args.Length() == 13);
     Isolate *isolate = args.GetIsolate();
@@ -2194,6 +2200,7 @@ const HostCallbackMap &get_host_callback_map() {
         DEFINE_CALLBACK(fwrite),
         DEFINE_CALLBACK(getenv),
         DEFINE_CALLBACK(halide_current_thread_id),
+        DEFINE_CALLBACK(halide_current_time_ns),
         DEFINE_CALLBACK(halide_error),
         DEFINE_CALLBACK(halide_print),
         DEFINE_CALLBACK(halide_trace_helper),
@@ -27,6 +27,9 @@
   HL_PERMIT_FAILED_UNROLL
   Set to 1 to tell Halide not to freak out if we try to unroll a loop that doesn't have a constant extent. Should generally not be necessary, but sometimes the autoscheduler's model for what will and will not turn into a constant during lowering is inaccurate, because Halide isn't perfect at constant-folding.
 
+  HL_COMPILE_THREADS
+  The number of threads to expand the states of each beam search step on. Defaults to the number of cores. The schedule found does not depend on it.
+
 #ifdef HALIDE_AUTOSCHEDULER_ALLOW_CYOS
 
   HL_CYOS
@@ -46,6 +49,8 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <random>
 #include <set>
@@ -214,6 +219,43 @@ public:
     }
 };
 
+// Forwards to another cost model, one call at a time, so that states can
+// be expanded on several threads at once. Each cost only depends on the
+// schedule it is for, so the order in which states are enqueued doesn't
+// change the results.
+class LockedCostModel : public CostModel {
+    CostModel *model;
+    std::mutex mutex;
+
+public:
+    explicit LockedCostModel(CostModel *model)
+        : model(model) {
+    }
+
+    void set_pipeline_features(const FunctionDAG &dag,
+                               const Adams2019Params &params) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        model->set_pipeline_features(dag, params);
+    }
+
+    void enqueue(const FunctionDAG &dag,
+                 const StageMapOfScheduleFeatures &schedule_feats,
+                 double *cost_ptr) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        model->enqueue(dag, schedule_feats, cost_ptr);
+    }
+
+    void evaluate_costs() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        model->evaluate_costs();
+    }
+
+    void reset() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        model->reset();
+    }
+};
+
 // Configure a cost model to process a specific pipeline.
 void configure_pipeline_features(const FunctionDAG &dag,
                                  const Adams2019Params &params,
@@ -301,7 +343,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
         }
 
         expanded = 0;
-        while (expanded < params.beam_size && !pending.empty()) {
+        vector<IntrusivePtr<State>> to_expand;
+        while ((int)to_expand.size() < params.beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -378,8 +421,35 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                 return best;
             }
 
-            state->generate_children(dag, params, cost_model, enqueue_new_children, cache);
-            expanded++;
+            to_expand.emplace_back(std::move(state));
+        }
+
+        // Expand the chosen states, possibly in parallel. The children of
+        // each state are collected separately and then enqueued in
+        // order, and each state sees only the tilings memoized in earlier
+        // steps, so the search doesn't depend on the number of threads.
+        {
+            std::unique_ptr<LockedCostModel> locked_cost_model;
+            if (cost_model) {
+                locked_cost_model = std::make_unique<LockedCostModel>(cost_model);
+            }
+            vector<vector<IntrusivePtr<State>>> children(to_expand.size());
+            vector<std::unique_ptr<Cache>> caches(to_expand.size());
+            parallel_compile_for("adams2019_expand", (int)to_expand.size(), [&](int i) {
+                caches[i] = std::make_unique<Cache>(cache, dag.nodes.size());
+                std::function<void(IntrusivePtr<State> &&)> accept_child =
+                    [&](IntrusivePtr<State> &&s) {
+                        children[i].emplace_back(std::move(s));
+                    };
+                to_expand[i]->generate_children(dag, params, locked_cost_model.get(), accept_child, caches[i].get());
+            });
+            for (size_t i = 0; i < to_expand.size(); i++) {
+                cache->merge(*caches[i]);
+                for (auto &child : children[i]) {
+                    enqueue_new_children(std::move(child));
+                }
+                expanded++;
+            }
         }
 
         // Drop the other states unconsidered.
@@ -12,7 +12,8 @@ bool Cache::add_memoized_blocks(const State *state,
                                 const FunctionDAG &dag,
                                 const Adams2019Params &params,
                                 CostModel *cost_model) const {
-    if (!options.cache_blocks || !memoized_compute_root_blocks.contains(node)) {
+    const BlockCache &memoized_blocks = shared ? shared->memoized_compute_root_blocks : memoized_compute_root_blocks;
+    if (!options.cache_blocks || !memoized_blocks.contains(node)) {
         // either memoization is turned off, or we haven't cached this node yet.
         return false;
     }
@@ -26,7 +27,7 @@ bool Cache::add_memoized_blocks(const State *state,
         }
     }
 
-    const auto &vector_dim_map = memoized_compute_root_blocks.get(node);
+    const auto &vector_dim_map = memoized_blocks.get(node);
 
     if (vector_dim_map.count(vector_dims) == 0) {
         // Never cached this vector dimension before.
@@ -103,6 +104,23 @@ void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
     }
 }
 
+void Cache::merge(const Cache &other) {
+    cache_hits += other.cache_hits;
+    cache_misses += other.cache_misses;
+    if (!options.cache_blocks) {
+        return;
+    }
+
+    for (auto it = other.memoized_compute_root_blocks.begin(); it != other.memoized_compute_root_blocks.end(); it++) {
+        auto &vector_dim_map = memoized_compute_root_blocks.get_or_create(it.key());
+        for (const auto &p : it.value()) {
+            if (vector_dim_map.count(p.first) == 0) {
+                vector_dim_map[p.first] = p.second;
+            }
+        }
+    }
+}
+
 }  // namespace Autoscheduler
 }  // namespace Internal
 }  // namespace Halide
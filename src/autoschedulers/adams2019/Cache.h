@@ -95,6 +95,10 @@ struct Cache {
     CachingOptions options;
     BlockCache memoized_compute_root_blocks;
 
+    // If set, tilings are looked up here instead, and the tilings
+    // memoized by this cache are kept apart until merged into it.
+    const Cache *shared = nullptr;
+
     mutable size_t cache_hits = 0;
     mutable size_t cache_misses = 0;
 
@@ -106,6 +110,14 @@ struct Cache {
         }
     }
 
+    // Make a cache for expanding one state of a beam search step in
+    // parallel with the others. It sees the tilings memoized in earlier
+    // steps, but not those memoized by other states in this one.
+    Cache(const Cache *_shared, size_t nodes_size)
+        : Cache(_shared->options, nodes_size) {
+        shared = _shared;
+    }
+
     ~Cache() = default;
 
     // check if we generated tilings for the current func on a previous pass
@@ -121,6 +133,13 @@ struct Cache {
 
     // Generate tilings for a specific vector dimension and memoize them.
     void memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root);
+
+    // Add the tilings memoized by a cache made for expanding one state
+    // to this one, along with its statistics. Tilings for a Func and
+    // vector dimension that this cache already has are dropped, so
+    // merging the caches of a step in the order of its states gives the
+    // same result on any number of threads.
+    void merge(const Cache &other);
 };
 
 }  // namespace Autoscheduler
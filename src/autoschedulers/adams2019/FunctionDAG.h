@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -318,9 +319,12 @@ struct BoundContents {
     // We're frequently going to need to make these concrete bounds
     // arrays.  It makes things more efficient if we figure out the
     // memory layout of those data structures once ahead of time, and
-    // make each individual instance just use that. Note that this is
-    // not thread-safe.
+    // make each individual instance just use that. States may be
+    // expanded on several threads at once, so the pool is guarded by a
+    // mutex.
     class Layout {
+        mutable std::mutex mutex;
+
         // A memory pool of free BoundContent objects with this layout
         mutable std::vector<BoundContents *> pool;
 
@@ -113,7 +113,7 @@ void LoopNest::copy_from(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
+    bounds = n.bounds_snapshot();
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -316,16 +316,22 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Checks if the features cache has seen this state before, and use the cached features if so.
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    const auto &entry = c->features_cache.at(hash_of_producers);
-
-                    for (auto it = entry.begin(); it != entry.end(); it++) {
-                        const auto *stage_ptr = it.key();
-                        const auto &feat = it.value();
-
-                        features->insert(stage_ptr, feat);
+                bool cached = false;
+                {
+                    std::lock_guard<std::mutex> lock(c->cache_mutex);
+                    auto entry = c->features_cache.find(hash_of_producers);
+                    if (entry != c->features_cache.end()) {
+                        for (auto it = entry->second.begin(); it != entry->second.end(); it++) {
+                            const auto *stage_ptr = it.key();
+                            const auto &feat = it.value();
+
+                            features->insert(stage_ptr, feat);
+                        }
+                        cached = true;
                     }
+                }
 
+                if (cached) {
                     // 'working_set_here' is required below for computing the
                     // root-level features so we compute the value that it
                     // would have had if the current loop nest had not been
@@ -341,6 +347,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Cache these features for future reference.
+                std::lock_guard<std::mutex> lock(c->cache_mutex);
                 c->features_cache[hash_of_producers].make_large(dag.nodes[0].stages[0].max_id);
                 c->memoize_features(c->features_cache[hash_of_producers], features);
             }
@@ -425,8 +432,10 @@ void LoopNest::compute_features(const FunctionDAG &dag,
                 // may not have been computed when it is accessed as a memoized
                 // feature. We memoize 'points_computed_minimum' here to ensure
                 // its value is always available
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    c->memoize_points_computed_minimum(c->features_cache[hash_of_producers], features);
+                std::lock_guard<std::mutex> lock(c->cache_mutex);
+                auto entry = c->features_cache.find(hash_of_producers);
+                if (entry != c->features_cache.end()) {
+                    c->memoize_points_computed_minimum(entry->second, features);
                 }
             }
             recompute_inlined_features(sites, features);
@@ -997,6 +1006,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
         if (use_cached_features) {
             const auto &block = sites.get(stage).task;
             uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
+            std::lock_guard<std::mutex> lock(block->cache_mutex);
             auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get_or_create(&(f->stages[0]));
             auto &intermediate = intermediate_map.get_or_create(stage);
 
@@ -1011,12 +1021,15 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 // Get the region required of a Func at this site, from which we
 // know what region would be computed if it were scheduled here,
 // and what its loop nest would be.
-const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
-    if (bounds.contains(f)) {
-        const Bound &b = bounds.get(f);
-        // Expensive validation for debugging
-        // b->validate();
-        return b;
+Bound LoopNest::get_bounds(const FunctionDAG::Node *f) const {
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (bounds.contains(f)) {
+            const Bound &b = bounds.get(f);
+            // Expensive validation for debugging
+            // b->validate();
+            return b;
+        }
     }
     auto *bound = f->make_bound();
 
@@ -1067,10 +1080,17 @@ const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
         f->loop_nest_for_region(i, &(bound->region_computed(0)), &(bound->loops(i, 0)));
     }
 
-    const Bound &b = set_bounds(f, bound);
+    // When states are expanded in parallel, another thread may have
+    // computed the same bounds meanwhile. Keep whichever got there first.
+    Bound b(bound);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (bounds.contains(f)) {
+        return bounds.get(f);
+    }
+    bounds.emplace(f, std::move(b));
     // Validation is expensive, turn if off by default.
-    // b->validate();
-    return b;
+    // bounds.get(f)->validate();
+    return bounds.get(f);
 }
 
 // Recursively print a loop nest representation to stderr
@@ -1362,7 +1382,7 @@ IntrusivePtr<const LoopNest> LoopNest::parallelize_in_tiles(const Adams2019Param
     inner->innermost = innermost;
     inner->children = children;
     inner->inlined = inlined;
-    inner->bounds = bounds;
+    inner->bounds = bounds_snapshot();
     inner->store_at = store_at;
 
     auto *b = inner->get_bounds(node)->make_copy();
@@ -1536,7 +1556,7 @@ vector<IntrusivePtr<const LoopNest>> LoopNest::compute_in_tiles(const FunctionDA
             inner->innermost = innermost;
             inner->children = children;
             inner->inlined = inlined;
-            inner->bounds = bounds;
+            inner->bounds = bounds_snapshot();
             inner->store_at = store_at;
 
             {
@@ -1947,7 +1967,6 @@ void LoopNest::copy_from_including_features(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -1955,6 +1974,8 @@ void LoopNest::copy_from_including_features(const LoopNest &n) {
     parallel = n.parallel;
     vector_dim = n.vector_dim;
     vectorized_loop_index = n.vectorized_loop_index;
+    std::lock_guard<std::mutex> lock(n.cache_mutex);
+    bounds = n.bounds;
     features_cache = n.features_cache;
     feature_intermediates_cache = n.feature_intermediates_cache;
 }
@@ -2030,6 +2051,7 @@ void LoopNest::recompute_inlined_features(const StageMap<Sites> &sites, StageMap
         internal_assert(sites.contains(block->stage));
         uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
 
+        std::lock_guard<std::mutex> lock(block->cache_mutex);
         internal_assert(block->feature_intermediates_cache.count(hash_of_producers) > 0);
         auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get(&(f->stages[0]));
         auto &intermediate = intermediate_map.get(stage);
@@ -9,6 +9,7 @@
 #include "FunctionDAG.h"
 #include "PerfectHashMap.h"
 #include <map>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <vector>
@@ -53,6 +54,11 @@ struct LoopNest {
     // little boxes to the left of the loop nest tree figures.
     mutable NodeMap<Bound> bounds;
 
+    // Loop nests are shared between states, which may be expanded on
+    // different threads, so this guards the caches that are filled in
+    // lazily: bounds, features_cache, and feature_intermediates_cache.
+    mutable std::mutex cache_mutex;
+
     // The Func this loop nest belongs to
     const FunctionDAG::Node *node = nullptr;
 
@@ -145,14 +151,21 @@ struct LoopNest {
     }
 
     // Set the region required of a Func at this site.
-    const Bound &set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+    Bound set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+        std::lock_guard<std::mutex> lock(cache_mutex);
         return bounds.emplace(f, b);
     }
 
     // Get the region required of a Func at this site, from which we
     // know what region would be computed if it were scheduled here,
     // and what its loop nest would be.
-    const Bound &get_bounds(const FunctionDAG::Node *f) const;
+    Bound get_bounds(const FunctionDAG::Node *f) const;
+
+    // A copy of all the bounds computed at this site so far.
+    NodeMap<Bound> bounds_snapshot() const {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        return bounds;
+    }
 
     // Recursively print a loop nest representation to stderr
     void dump(std::ostream &os, string prefix, const LoopNest *parent) const;
@@ -959,6 +959,18 @@ public:
         decref();
     }
 
+    /** Make this Buffer, which must not already own its host memory,
+     * share ownership of that memory through the given allocation
+     * header, whose reference count must be one. Buffers copied from this
+     * one afterwards share it too, and once the last of them lets go,
+     * header->deallocate_fn is called with the header. This ties memory
+     * the Buffer did not allocate itself (e.g. a memory-mapped file) to
+     * the lifetime of the Buffers that use it. */
+    void adopt_host_allocation(AllocationHeader *header) {
+        assert(!owns_host_memory() && header->ref_count == 1);
+        alloc = header;
+    }
+
     /** Drop reference to any owned device memory, possibly freeing it
      * if this buffer held the last reference to it. Asserts that
      * device_dirty is false. */
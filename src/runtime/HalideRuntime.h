@@ -423,6 +423,125 @@ extern int halide_get_num_threads();
 extern int halide_set_num_threads(int n);
 // @}
 
+/** The strategies the default thread pool can use to schedule the
+ * iterations of a parallel for loop (halide_do_par_for). Jobs enqueued via
+ * halide_do_parallel_tasks (i.e. those involving async producers,
+ * semaphores or blocking extern stages) always use the shared queue.
+ *
+ * halide_thread_pool_scheduler_shared_queue: every iteration is claimed
+ * from a single job stack protected by one mutex. This is the default.
+ *
+ * halide_thread_pool_scheduler_work_stealing: each thread running part of
+ * a parallel loop splits halves of its range of iterations off onto its
+ * own deque, and idle threads steal those halves from deques picked at
+ * random. No lock is taken per iteration, which scales better for nested
+ * parallel loops on many-core machines.
+ *
+ * The initial scheduler can also be selected by setting the environment
+ * variable HL_THREAD_POOL_SCHEDULER to "shared_queue" or "work_stealing".
+ * Like halide_set_num_threads, this only affects the default
+ * implementation of halide_do_par_for. */
+typedef enum halide_thread_pool_scheduler_t {
+    halide_thread_pool_scheduler_shared_queue = 0,
+    halide_thread_pool_scheduler_work_stealing = 1,
+} halide_thread_pool_scheduler_t;
+
+/** Select the scheduler used by subsequent calls to the default
+ * halide_do_par_for. Loops already running finish on the scheduler they
+ * started with. Returns the previous scheduler. */
+extern halide_thread_pool_scheduler_t halide_set_thread_pool_scheduler(halide_thread_pool_scheduler_t s);
+
+/** How the default thread pool places work on machines with more than one
+ * NUMA node. NUMA topology is currently only detected on Linux; elsewhere
+ * the machine is treated as a single node and these policies do nothing.
+ *
+ * halide_numa_policy_none: worker threads may run anywhere, and take
+ * whatever work is available. This is the default.
+ *
+ * halide_numa_policy_node_local: worker threads are pinned round-robin to
+ * the nodes. A parallel for loop started from a thread that may run on
+ * several nodes (e.g. the thread that called the pipeline) is divided into
+ * one contiguous range of iterations per node, and each node's workers
+ * prefer their own range, only taking iterations from other nodes' ranges
+ * once theirs is exhausted. A parallel for loop started from a thread that
+ * is confined to one node (e.g. a nested loop run by a pinned worker)
+ * prefers to stay on that node. Combined with halide_numa_malloc, this
+ * means the pages of an intermediate tend to be first touched, and hence
+ * placed, on the node that computes them.
+ *
+ * The policy only applies to the shared queue scheduler. It can also be
+ * selected by setting the environment variable HL_NUMA_POLICY to "none" or
+ * "node_local". */
+typedef enum halide_numa_policy_t {
+    halide_numa_policy_none = 0,
+    halide_numa_policy_node_local = 1,
+} halide_numa_policy_t;
+
+/** Select the NUMA placement policy for the default thread pool. Worker
+ * threads re-pin themselves the next time they look for work. Returns the
+ * previous policy. */
+extern halide_numa_policy_t halide_set_numa_policy(halide_numa_policy_t policy);
+
+/** Get the number of NUMA nodes with CPUs that the default thread pool
+ * knows about. Returns 1 if the topology is unknown. */
+extern int halide_get_numa_node_count();
+
+/** The function called when a pipeline run by halide_call_argv_async
+ * finishes, with the user context and closure passed to
+ * halide_call_argv_async and the pipeline's exit status. */
+typedef void (*halide_async_call_done_t)(void *user_context, int exit_status, void *closure);
+
+/** Run a pipeline as a task on the default thread pool, and return without
+ * waiting for it. argv_fn is the argv-based entry point of the pipeline
+ * (for an ahead-of-time compiled pipeline, the function named <name>_argv)
+ * and args are the arguments to pass to it. They, and everything they point
+ * to, must stay valid until done is called. done is called after the
+ * pipeline returns, on the thread that ran it.
+ *
+ * No thread waits for the pipeline. A worker thread runs it, sharing its
+ * parallel loops with the rest of the thread pool as usual, so calls in
+ * flight don't each need a thread of their own. If the thread pool has no
+ * worker threads (e.g. with HL_NUM_THREADS=1), one is started. Calls still
+ * in flight must finish before halide_shutdown_thread_pool is called.
+ *
+ * Calls in flight at the same time run concurrently, so if the user
+ * context in args is used to hold the state of a call (as the JIT does,
+ * to collect its error messages), each call needs its own.
+ *
+ * Returns an error code if the call could not be enqueued, in which case
+ * done is never called. On platforms without threads, the pipeline is run
+ * and done is called before this returns. Like halide_set_num_threads, this
+ * ignores any custom parallel runtime. */
+extern int halide_call_argv_async(void *user_context, int (*argv_fn)(void **), void **args,
+                                  halide_async_call_done_t done, void *closure);
+
+/** Run a pipeline once for each of a batch of argument lists, spreading the
+ * calls across the thread pool, and wait for them all to finish. argv_fn
+ * is the argv-based entry point of the pipeline (for an ahead-of-time
+ * compiled pipeline, the function named <name>_argv) and args[i] is the
+ * list of arguments for the i'th call. The calls may be made in any order,
+ * and concurrently, so they must not write to the same buffers.
+ *
+ * This is a parallel dispatch helper, not a batched pipeline: each call is
+ * an ordinary, separate call of argv_fn, which checks its arguments,
+ * allocates its intermediates and runs its loops just as it would if called
+ * on its own. What is saved is the cost of dispatching the calls: the
+ * thread pool is woken once for the whole batch rather than once per call,
+ * and the calls' own parallel loops don't have to wait for each other. For
+ * many calls on small inputs, that can make up most of the time. Pipelines
+ * compiled with the batch_entry_point target feature also have an entry
+ * point, <name>_batch, that runs the calls in order but checks each distinct
+ * shape of the arguments once and shares one set of intermediate
+ * allocations between them.
+ *
+ * If exit_statuses is not null, it must have room for num_calls entries.
+ * Every call is made, its exit status is stored there, and the first
+ * failing status (in order of the calls) is returned. Otherwise, calls not
+ * yet started when one fails are skipped, and its status is returned. This
+ * uses halide_do_par_for, and so respects a custom parallel runtime. */
+extern int halide_call_argv_batch(void *user_context, int (*argv_fn)(void **), int num_calls,
+                                  void **const *args, int *exit_statuses);
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -445,6 +564,16 @@ extern void *halide_malloc(void *user_context, size_t x);
 extern void halide_free(void *user_context, void *ptr);
 extern void *halide_default_malloc(void *user_context, size_t x);
 extern void halide_default_free(void *user_context, void *ptr);
+
+/** An allocator for use with halide_numa_policy_node_local. Install it with
+ * halide_set_custom_malloc(halide_numa_malloc) and
+ * halide_set_custom_free(halide_numa_free). Large allocations are given
+ * fresh pages from the OS rather than recycled memory, so that the kernel
+ * places each page on the node of the thread that first writes to it.
+ * Smaller allocations use halide_default_malloc. Memory allocated with one
+ * of these must be freed with the other. */
+extern void *halide_numa_malloc(void *user_context, size_t x);
+extern void halide_numa_free(void *user_context, void *ptr);
 typedef void *(*halide_malloc_t)(void *, size_t);
 typedef void (*halide_free_t)(void *, void *);
 extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
@@ -849,6 +978,61 @@ extern int halide_get_trace_file(void *user_context);
  * (flushing the trace). Returns zero on success. */
 extern int halide_shutdown_trace(void);
 
+/** If the environment variable HL_TRACE_RING names a file, the default
+ * trace handler doesn't print or write packets. Instead it records
+ * timestamped begin and end events for pipelines, realizations, and
+ * productions into a fixed-size ring buffer per thread, without taking
+ * any locks, and ignores all other events. Each ring holds the most
+ * recent HL_TRACE_RING_SIZE events of its thread (default 65536). The
+ * rings are written to the file by halide_shutdown_trace, which runs
+ * at exit. util/HalideTraceToJSON converts the file to the Chrome trace
+ * event format, which Perfetto can display.
+ *
+ * There are 256 rings, each claimed by the first event of a thread and
+ * given back when the rings are written out. While they are all claimed,
+ * events from other threads are dropped and counted in the header.
+ *
+ * The file starts with a halide_trace_ring_header_t, followed by the
+ * names of the Funcs and pipelines, each as a uint32_t length and
+ * that many characters. Then for each thread there is a
+ * halide_trace_ring_thread_t, followed by its events, oldest first. */
+// @{
+#define HALIDE_TRACE_RING_MAGIC 0x474e5248  // "HRNG"
+
+struct halide_trace_ring_header_t {
+    uint32_t magic;
+    uint32_t num_names;
+    uint32_t num_threads;
+    /** Events dropped since the rings were last written, because every
+     * ring was claimed by another thread. */
+    uint32_t num_dropped_events;
+};
+
+struct halide_trace_ring_thread_t {
+    int32_t thread_id;
+    uint32_t num_events;
+};
+
+struct halide_trace_ring_event_t {
+    /** Nanoseconds since an arbitrary point before the first event. */
+    uint64_t time;
+    /** The id returned for this event, and the id of the event it
+     * belongs to, as in halide_trace_event_t. An end event's parent is
+     * the matching begin event. */
+    int32_t id, parent_id;
+    /** The index of the name of the Func or pipeline. */
+    uint32_t name;
+    /** A halide_trace_event_code_t. */
+    int32_t event;
+};
+
+/** Write the ring buffers to the given file descriptor in the format
+ * above, and empty them and give them back. This may be called while
+ * other threads run Halide pipelines: their events go to fresh storage
+ * until the old rings have been written out. Returns zero on success. */
+extern int halide_write_trace_ring(void *user_context, int fd);
+// @}
+
 /** All Halide GPU or device backend implementations provide an
  * interface to be used with halide_device_malloc, etc. This is
  * accessed via the functions below.
@@ -1104,6 +1288,61 @@ extern void halide_memoization_cache_release(void *user_context, void *host);
  */
 extern void halide_memoization_cache_cleanup(void);
 
+/** The policies the default memoization cache can use to decide what to
+ * evict when it is over its size limit.
+ *
+ * halide_memoization_cache_policy_lru: evict the least recently used
+ * entries first. This is the default.
+ *
+ * halide_memoization_cache_policy_cost_aware: among the few least
+ * recently used entries, evict the one that was cheapest to recompute per
+ * byte, as measured by the time between the cache miss and the store of
+ * the result.
+ *
+ * halide_memoization_cache_policy_tinylfu: evict in LRU order, but when
+ * the cache is full only admit a new result if its key has been looked up
+ * more often recently than the entry it would displace. This keeps one-off
+ * results from flushing out ones that are reused. */
+typedef enum halide_memoization_cache_policy_t {
+    halide_memoization_cache_policy_lru = 0,
+    halide_memoization_cache_policy_cost_aware = 1,
+    halide_memoization_cache_policy_tinylfu = 2,
+} halide_memoization_cache_policy_t;
+
+/** Select the eviction policy of the memoization cache. Entries already
+ * in the cache are kept. Returns the previous policy. */
+extern halide_memoization_cache_policy_t halide_memoization_cache_set_policy(halide_memoization_cache_policy_t policy);
+
+/** Statistics kept by the memoization cache, either for the memoized
+ * Funcs of one pipeline or for the whole cache. */
+struct halide_memoization_cache_stats_t {
+    /** Number of lookups that found a result in the cache. */
+    uint64_t hits;
+    /** Number of lookups that did not. */
+    uint64_t misses;
+    /** Number of entries removed to keep the cache within its size limit. */
+    uint64_t evictions;
+    /** Number of results not stored because the eviction policy declined
+     * to admit them. */
+    uint64_t rejections;
+    /** Number of entries currently in the cache, and their size in bytes. */
+    int64_t entries;
+    int64_t bytes;
+};
+
+/** Get the statistics of the memoization cache for the pipeline with the
+ * given name (the function name of an AOT-compiled pipeline, or the name
+ * of the output Func for the JIT), or for all pipelines if pipeline_name
+ * is NULL. A pipeline that has never used the cache reports all zeros.
+ * Statistics are kept separately for up to 31 pipelines; the rest are
+ * only counted in the totals. */
+extern int halide_memoization_cache_get_stats(void *user_context, const char *pipeline_name,
+                                              struct halide_memoization_cache_stats_t *stats);
+
+/** Reset the hit, miss, eviction and rejection counts of the memoization
+ * cache to zero. */
+extern void halide_memoization_cache_reset_stats(void);
+
 /** Verify that a given range of memory has been initialized; only used when Target::MSAN is enabled.
  *
  * The default implementation simply calls the LLVM-provided __msan_check_mem_is_initialized() function.
@@ -1354,6 +1593,16 @@ enum halide_error_code_t {
     /** "vscale" value of Streaming Scalable Vector detected in runtime does not
      * match the streaming vscale value used in compilation. */
     halide_error_code_streaming_vscale_invalid = -49,
+
+    /** The memory passed to a pipeline compiled with the
+     * static_memory_plan target feature to use for its arena of
+     * allocations is smaller than the arena. */
+    halide_error_code_scratch_too_small = -50,
+
+    /** The memory passed to a pipeline compiled with the
+     * static_memory_plan target feature to use for its arena of
+     * allocations is not aligned to the native vector width. */
+    halide_error_code_scratch_unaligned = -51,
 };
 
 /** Halide calls the functions below on various error conditions. The
@@ -1431,6 +1680,8 @@ extern int halide_error_device_crop_failed(void *user_context);
 extern int halide_error_split_factor_not_positive(void *user_context, const char *func_name, const char *orig, const char *outer, const char *inner, const char *factor_str, int factor);
 extern int halide_error_vscale_invalid(void *user_context, const char *func_name, int runtime_vscale, int compiletime_vscale);
 extern int halide_error_streaming_vscale_invalid(void *user_context, const char *func_name, int runtime_vscale, int compiletime_vscale);
+extern int halide_error_scratch_too_small(void *user_context, uint64_t provided_size, uint64_t required_size);
+extern int halide_error_scratch_unaligned(void *user_context, int alignment);
 // @}
 
 /** Optional features a compilation Target can have.
@@ -1574,6 +1825,10 @@ typedef enum halide_target_feature_t {
     halide_target_feature_hlsl_sm67,              ///< Enable D3D12 Shader Model 6.7
     halide_target_feature_hlsl_sm68,              ///< Enable D3D12 Shader Model 6.8
     halide_target_feature_hlsl_sm69,              ///< Enable D3D12 Shader Model 6.9 (long vectors 5-1024 lanes, native 16-bit/wave/int64 required)
+    halide_target_feature_static_memory_plan,     ///< Pack constant-sized heap allocations into a single arena, which AOT callers may supply.
+    halide_target_feature_profile_hardware_counters,  ///< Add per-Func hardware performance counters to the profile. Use with profile or profile_by_timer. Linux only.
+    halide_target_feature_split_codegen,              ///< Optimize the LLVM module in several pieces in parallel, and split static library output into several objects compiled in parallel. Not supported by compile_multitarget with several targets.
+    halide_target_feature_batch_entry_point,          ///< Also generate an entry point named <pipeline>_batch that runs the pipeline over arrays of buffers, checking each distinct shape once and sharing intermediate allocations. Not supported by compile_multitarget with several targets.
     halide_target_feature_end                     ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
@@ -2108,6 +2363,15 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_func_stats {
      * classified the same way (scalar / unit-stride vector / scatter), plus
      * the total bytes stored. */
     uint64_t scalar_stores, vector_stores, scatters, bytes_stored;
+
+    /** Hardware performance counters, totalled over every thread that
+     * worked on this Func. Only gathered by pipelines compiled with the
+     * -profile_hardware_counters target flag, and only on Linux, otherwise
+     * zero. Counts in kernel mode are excluded. Must stay in this order;
+     * see linux_perf_counters_common.h. */
+    uint64_t cycles, instructions;
+    uint64_t cache_references, cache_misses;
+    uint64_t branches, branch_misses;
 };
 
 /** Per-pipeline state tracked by the sampling profiler. These exist
@@ -2161,6 +2425,12 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_pipeline_stats {
 
     /** The total number of memory allocation of funcs in this pipeline. */
     int num_allocs;
+
+    /** The number of heap allocations of funcs in this pipeline that
+     * reused memory from the host allocation pool, and their total size
+     * in bytes. See halide_reuse_host_allocations. */
+    int num_pooled_allocs;
+    uint64_t memory_pooled;
 };
 
 /** Per-invocation-of-a-pipeline state. Lives on the stack of the Halide
@@ -2186,6 +2456,11 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_instance_state {
      * work while computing this instance. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** The number of heap allocations of funcs in this instance that
+     * reused memory from the host allocation pool, and their total size
+     * in bytes. */
+    uint64_t num_pooled_allocs, memory_pooled;
+
     /** A pointer to the next running instance, so that the running instances
      * can exist in a linked list. */
     struct halide_profiler_instance_state *next;
@@ -2360,6 +2635,46 @@ struct halide_device_allocation_pool {
  * global lifetime, and its next field will be clobbered. */
 extern void halide_register_device_allocation_pool(struct halide_device_allocation_pool *);
 
+/** Set whether halide_default_malloc and halide_default_free may keep
+ * freed host memory in a pool for reuse by later allocations, instead of
+ * returning it to the system straight away. This helps pipelines that
+ * are run repeatedly and allocate large intermediates each time, for
+ * which the cost of malloc and free (and of faulting in fresh pages) can
+ * be significant. Allocations are rounded up to one of a set of size
+ * classes, so the pool can waste up to a fifth of each allocation. Off by
+ * default. Setting it to false releases all unused pooled memory.
+ * Has no effect if a custom allocator has been installed. */
+extern int halide_reuse_host_allocations(void *user_context, bool flag);
+
+/** Return all host memory held by the pool that isn't currently in use
+ * to the system. */
+extern int halide_release_unused_host_allocations(void *user_context);
+
+/** Set the most memory, in bytes, that the host allocation pool may hold
+ * onto while it isn't in use. Memory freed beyond this is returned to
+ * the system. The default is 64MB. Returns the previous limit. */
+extern int64_t halide_host_allocation_pool_set_limit(int64_t size);
+
+/** Statistics kept by the host allocation pool. The profiler reports
+ * them for the whole process, and the reuses by each pipeline in its
+ * halide_profiler_pipeline_stats. */
+struct halide_host_allocation_pool_stats_t {
+    /** Number of allocations made while the pool was enabled, and their
+     * size in bytes, after rounding up to a size class. */
+    uint64_t allocations;
+    uint64_t bytes_allocated;
+    /** How many of those allocations reused memory from the pool, and
+     * their size in bytes. */
+    uint64_t reuses;
+    uint64_t bytes_reused;
+    /** Bytes currently held by the pool and not in use. */
+    int64_t cached_bytes;
+};
+
+/** Get the statistics of the host allocation pool. The counts are never
+ * reset. */
+extern void halide_host_allocation_pool_get_stats(struct halide_host_allocation_pool_stats_t *stats);
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
@@ -1,6 +1,7 @@
 #include "HalideRuntime.h"
 #include "device_buffer_utils.h"
 #include "printer.h"
+#include "runtime_atomics.h"
 #include "scoped_mutex_lock.h"
 
 namespace Halide {
@@ -74,7 +75,7 @@ struct CacheEntry {
     uint8_t *metadata_storage;
     size_t key_size;
     uint8_t *key;
-    uint32_t hash;
+    uint64_t hash;
     uint32_t in_use_count;  // 0 if none returned from halide_cache_lookup
     uint32_t tuple_count;
     // The shape of the computed data. There may be more data allocated than this.
@@ -84,9 +85,14 @@ struct CacheEntry {
     halide_buffer_t *buf;
     uint64_t eviction_key;
     bool has_eviction_key;
+    // The statistics slot of the pipeline that stored the entry.
+    int32_t stats_slot;
+    // The total size of the tuple buffers, and how long they took to compute.
+    int64_t bytes;
+    int64_t cost_ns;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
-              uint32_t key_hash,
+              uint64_t key_hash,
               const halide_buffer_t *computed_bounds_buf,
               int32_t tuples, halide_buffer_t **tuple_buffers,
               bool has_eviction_key, uint64_t eviction_key);
@@ -96,14 +102,17 @@ struct CacheEntry {
 
 struct CacheBlockHeader {
     CacheEntry *entry;
-    uint32_t hash;
+    uint64_t hash;
+    // When the lookup that allocated the block missed, if the eviction
+    // policy uses recompute costs, and zero otherwise.
+    int64_t miss_time_ns;
 };
 
 // Each host block has extra space to store a header just before the
 // contents. This block must respect the same alignment as
 // halide_malloc, because it offsets the return value from
-// halide_malloc. The header holds the cache key hash and pointer to
-// the hash entry.
+// halide_malloc. The header holds the cache key hash, the pointer to
+// the hash entry, and the time of the cache miss.
 WEAK __attribute((always_inline)) size_t header_bytes() {
     size_t s = sizeof(CacheBlockHeader);
     size_t mask = ::halide_internal_malloc_alignment() - 1;
@@ -115,7 +124,7 @@ WEAK CacheBlockHeader *get_pointer_to_header(uint8_t *host) {
 }
 
 WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
-                           uint32_t key_hash, const halide_buffer_t *computed_bounds_buf,
+                           uint64_t key_hash, const halide_buffer_t *computed_bounds_buf,
                            int32_t tuples, halide_buffer_t **tuple_buffers,
                            bool has_eviction_key_arg, uint64_t eviction_key_arg) {
     next = nullptr;
@@ -126,6 +135,9 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     in_use_count = 0;
     tuple_count = tuples;
     dimensions = computed_bounds_buf->dimensions;
+    stats_slot = 0;
+    bytes = 0;
+    cost_ns = 0;
 
     // Allocate all the necessary space (or die)
     size_t storage_bytes = 0;
@@ -188,56 +200,243 @@ WEAK void CacheEntry::destroy() {
     halide_free(nullptr, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size) {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
-    }
-    return h;
+ALWAYS_INLINE uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
 }
 
-WEAK halide_mutex memoization_lock = {{0}};
-
-const size_t kHashTableSize = 256;
+// Cache keys are long and mostly alike: they start with the pipeline
+// and Func names and end with the values the Func depends on, which often
+// differ in only a few bits. This hashes eight bytes at a time in the
+// manner of MurmurHash3, so that every byte of the key reaches both the
+// top bits (which pick the shard) and the bottom bits (which pick the
+// bucket).
+WEAK uint64_t key_hash(const uint8_t *key, size_t key_size) {
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h = key_size;
+    for (size_t i = 0; i < key_size; i += 8) {
+        uint64_t k = 0;
+        memcpy(&k, key + i, key_size - i < 8 ? key_size - i : 8);
+        h ^= rotl64(k * c1, 31) * c2;
+        h = rotl64(h, 27) * 5 + 0x52dce729;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+// The cache is split into shards, each with its own lock, hash table and
+// LRU list, so that threads looking up unrelated keys don't wait on each
+// other. The size limit applies to the cache as a whole.
+const int kShardBits = 4;
+const int kNumShards = 1 << kShardBits;
+const size_t kHashTableSize = 64;
+
+// Each shard keeps a count-min sketch of how often its keys are looked
+// up, for TinyLFU admission. Counters saturate at 15, and are all halved
+// every kSketchSampleSize lookups so that the sketch favors recent use.
+const int kSketchDepth = 4;
+const int kSketchWidth = 256;
+const uint32_t kSketchSampleSize = 8 * kSketchWidth;
+
+// Statistics are kept separately for this many pipelines. The last slot
+// is shared by all the pipelines that don't fit, and by any keys not in
+// the format Memoization.cpp produces.
+const int kMaxPipelineStats = 32;
+const int kOverflowStatsSlot = kMaxPipelineStats - 1;
+
+// The number of least recently used entries the cost-aware policy chooses
+// among.
+const int kCostAwareCandidates = 8;
+
+struct CacheShard {
+    halide_mutex lock;
+    CacheEntry *entries[kHashTableSize];
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+    // Written only with the lock held, but read without it to find the
+    // total size of the cache.
+    int64_t current_size;
+    uint8_t sketch[kSketchDepth][kSketchWidth];
+    uint32_t sketch_additions;
+    halide_memoization_cache_stats_t stats[kMaxPipelineStats];
+};
 
-WEAK CacheEntry *most_recently_used = nullptr;
-WEAK CacheEntry *least_recently_used = nullptr;
+WEAK CacheShard cache_shards[kNumShards];
 
 const uint64_t kDefaultCacheSize = 1 << 20;
 WEAK int64_t max_cache_size = kDefaultCacheSize;
-WEAK int64_t current_cache_size = 0;
+
+WEAK int memoization_policy = halide_memoization_cache_policy_lru;
+
+// The names of the pipelines with their own statistics slot, or null for
+// a free slot. Each is a copy made with halide_malloc.
+WEAK char *stats_pipeline_names[kOverflowStatsSlot];
+
+ALWAYS_INLINE CacheShard &shard_for_hash(uint64_t h) {
+    return cache_shards[h >> (64 - kShardBits)];
+}
+
+ALWAYS_INLINE int shard_index_for_hash(uint64_t h) {
+    return (int)(h >> (64 - kShardBits));
+}
+
+ALWAYS_INLINE size_t bucket_for_hash(uint64_t h) {
+    return h % kHashTableSize;
+}
+
+ALWAYS_INLINE halide_memoization_cache_policy_t get_policy() {
+    int policy;
+    Synchronization::atomic_load_relaxed(&memoization_policy, &policy);
+    return (halide_memoization_cache_policy_t)policy;
+}
+
+ALWAYS_INLINE int64_t get_max_cache_size() {
+    int64_t size;
+    Synchronization::atomic_load_relaxed(&max_cache_size, &size);
+    return size;
+}
+
+WEAK int64_t get_current_cache_size() {
+    int64_t total = 0;
+    for (CacheShard &shard : cache_shards) {
+        int64_t size;
+        Synchronization::atomic_load_relaxed(&shard.current_size, &size);
+        total += size;
+    }
+    return total;
+}
+
+ALWAYS_INLINE void add_to_shard_size(CacheShard &shard, int64_t delta) {
+    int64_t size = shard.current_size + delta;
+    Synchronization::atomic_store_relaxed(&shard.current_size, &size);
+}
+
+ALWAYS_INLINE uint8_t &sketch_counter(CacheShard &shard, int row, uint64_t h) {
+    return shard.sketch[row][(h >> (8 + 12 * row)) % kSketchWidth];
+}
+
+WEAK void sketch_increment(CacheShard &shard, uint64_t h) {
+    for (int r = 0; r < kSketchDepth; r++) {
+        uint8_t &c = sketch_counter(shard, r, h);
+        if (c < 15) {
+            c++;
+        }
+    }
+    if (++shard.sketch_additions == kSketchSampleSize) {
+        for (auto &row : shard.sketch) {
+            for (uint8_t &c : row) {
+                c >>= 1;
+            }
+        }
+        shard.sketch_additions /= 2;
+    }
+}
+
+WEAK uint32_t sketch_estimate(CacheShard &shard, uint64_t h) {
+    uint32_t result = 15;
+    for (int r = 0; r < kSketchDepth; r++) {
+        uint32_t c = sketch_counter(shard, r, h);
+        result = c < result ? c : result;
+    }
+    return result;
+}
+
+ALWAYS_INLINE bool stats_slot_name_is(const char *slot_name, const uint8_t *name, size_t len) {
+    return strncmp(slot_name, (const char *)name, len) == 0 && slot_name[len] == 0;
+}
+
+// Find the statistics slot of a pipeline by its name, claiming a free one
+// if create is true. Returns -1 if the pipeline has no slot and create is
+// false.
+WEAK int find_stats_slot(void *user_context, const uint8_t *name, size_t len, bool create) {
+    const uint64_t h = key_hash(name, len);
+    char *copy = nullptr;
+    int result = create ? kOverflowStatsSlot : -1;
+    for (int i = 0; i < kOverflowStatsSlot; i++) {
+        int slot = (int)((h + i) % kOverflowStatsSlot);
+        char *current;
+        Synchronization::atomic_load_acquire(&stats_pipeline_names[slot], &current);
+        if (current == nullptr && create) {
+            if (copy == nullptr) {
+                copy = (char *)halide_malloc(user_context, len + 1);
+                if (copy == nullptr) {
+                    break;
+                }
+                memcpy(copy, name, len);
+                copy[len] = 0;
+            }
+            char *expected = nullptr;
+            if (Synchronization::atomic_cas_strong_sequentially_consistent(&stats_pipeline_names[slot], &expected, &copy)) {
+                return slot;
+            }
+            // Another thread claimed the slot first.
+            current = expected;
+        }
+        if (current == nullptr) {
+            break;
+        } else if (stats_slot_name_is(current, name, len)) {
+            result = slot;
+            break;
+        }
+    }
+    if (copy != nullptr) {
+        halide_free(user_context, copy);
+    }
+    return result;
+}
+
+// Memoization.cpp starts every cache key with the length-prefixed name
+// of the pipeline, e.g. "5:blurx", which is what statistics are kept by.
+WEAK int stats_slot_for_key(void *user_context, const uint8_t *key, size_t key_size) {
+    size_t len = 0, i = 0;
+    while (i < key_size && i < 9 && key[i] >= '0' && key[i] <= '9') {
+        len = len * 10 + (key[i] - '0');
+        i++;
+    }
+    if (i == 0 || i >= key_size || key[i] != ':' || len > key_size - i - 1) {
+        return kOverflowStatsSlot;
+    }
+    return find_stats_slot(user_context, key + i + 1, len, true);
+}
 
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(nullptr) << "validating cache, "
-                   << "current size " << current_cache_size
+WEAK void validate_cache(CacheShard &shard) {
+    print(nullptr) << "validating cache shard " << (int)(&shard - cache_shards) << ", "
+                   << "current size " << shard.current_size
+                   << ", cache size " << get_current_cache_size()
                    << " of maximum " << max_cache_size << "\n";
     int entries_in_hash_table = 0;
     for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+        CacheEntry *entry = shard.entries[i];
         while (entry != nullptr) {
             entries_in_hash_table++;
-            if (entry->more_recent == nullptr && entry != most_recently_used) {
+            if (entry->more_recent == nullptr && entry != shard.most_recently_used) {
                 halide_print(nullptr, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == nullptr && entry != least_recently_used) {
+            if (entry->less_recent == nullptr && entry != shard.least_recently_used) {
                 halide_print(nullptr, "cache invalid case 2\n");
                 __builtin_trap();
             }
+            if (&shard_for_hash(entry->hash) != &shard || bucket_for_hash(entry->hash) != i) {
+                halide_print(nullptr, "cache entry in wrong bucket\n");
+                __builtin_trap();
+            }
             entry = entry->next;
         }
     }
     int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
+    CacheEntry *mru_chain = shard.most_recently_used;
     while (mru_chain != nullptr) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
     int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
+    CacheEntry *lru_chain = shard.least_recently_used;
     while (lru_chain != nullptr) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
@@ -253,69 +452,173 @@ WEAK void validate_cache() {
         halide_print(nullptr, "cache invalid case 4\n");
         __builtin_trap();
     }
-    if (current_cache_size < 0) {
+    if (shard.current_size < 0) {
         halide_print(nullptr, "cache size is negative\n");
         __builtin_trap();
     }
 }
 #endif
 
-WEAK void prune_cache() {
+// Add an entry to its shard as the most recently used.
+WEAK void link_entry(CacheShard &shard, CacheEntry *entry) {
+    size_t index = bucket_for_hash(entry->hash);
+    entry->next = shard.entries[index];
+    shard.entries[index] = entry;
+
+    entry->more_recent = nullptr;
+    entry->less_recent = shard.most_recently_used;
+    if (shard.most_recently_used != nullptr) {
+        shard.most_recently_used->more_recent = entry;
+    }
+    shard.most_recently_used = entry;
+    if (shard.least_recently_used == nullptr) {
+        shard.least_recently_used = entry;
+    }
+}
+
+// Remove an entry from its shard's hash table and LRU list.
+WEAK void unlink_entry(CacheShard &shard, CacheEntry *entry) {
+    CacheEntry **prev = &shard.entries[bucket_for_hash(entry->hash)];
+    while (*prev != entry) {
+        halide_abort_if_false(nullptr, *prev != nullptr);
+        prev = &(*prev)->next;
+    }
+    *prev = entry->next;
+
+    if (entry->more_recent != nullptr) {
+        entry->more_recent->less_recent = entry->less_recent;
+    } else {
+        shard.most_recently_used = entry->less_recent;
+    }
+    if (entry->less_recent != nullptr) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        shard.least_recently_used = entry->more_recent;
+    }
+}
+
+// Remove an entry from its shard and free it. The caller must hold the
+// shard's lock.
+WEAK void remove_entry(void *user_context, CacheShard &shard, CacheEntry *entry, bool evicted) {
+    unlink_entry(shard, entry);
+    add_to_shard_size(shard, -entry->bytes);
+
+    halide_memoization_cache_stats_t &stats = shard.stats[entry->stats_slot];
+    stats.entries--;
+    stats.bytes -= entry->bytes;
+    if (evicted) {
+        stats.evictions++;
+    }
+
+    entry->destroy();
+    halide_free(user_context, entry);
+}
+
+ALWAYS_INLINE double recompute_cost_per_byte(const CacheEntry *entry) {
+    return (double)entry->cost_ns / (double)(entry->bytes > 0 ? entry->bytes : 1);
+}
+
+// Pick the entry of a shard to evict next according to the eviction
+// policy, or return null if every entry is in use.
+WEAK CacheEntry *choose_victim(CacheShard &shard, halide_memoization_cache_policy_t policy) {
+    CacheEntry *victim = nullptr;
+    int candidates = 0;
+    for (CacheEntry *entry = shard.least_recently_used;
+         entry != nullptr && candidates < kCostAwareCandidates;
+         entry = entry->more_recent) {
+        if (entry->in_use_count != 0) {
+            continue;
+        }
+        if (policy != halide_memoization_cache_policy_cost_aware) {
+            return entry;
+        }
+        if (victim == nullptr || recompute_cost_per_byte(entry) < recompute_cost_per_byte(victim)) {
+            victim = entry;
+        }
+        candidates++;
+    }
+    return victim;
+}
+
+// Evict entries from a shard until the cache as a whole is within its
+// size limit, or nothing more in the shard can be evicted. The caller
+// must hold the shard's lock.
+WEAK void prune_shard(CacheShard &shard) {
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_cache(shard);
 #endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != nullptr) {
-        CacheEntry *more_recent = prune_candidate->more_recent;
-
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != nullptr && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_abort_if_false(nullptr, prev_hash_entry != nullptr);
-                prev_hash_entry->next = prune_candidate->next;
-            }
+    const int64_t max_size = get_max_cache_size();
+    const halide_memoization_cache_policy_t policy = get_policy();
+    while (get_current_cache_size() > max_size) {
+        CacheEntry *victim = choose_victim(shard, policy);
+        if (victim == nullptr) {
+            break;
+        }
+        remove_entry(nullptr, shard, victim, true);
+    }
+#if CACHE_DEBUGGING
+    validate_cache(shard);
+#endif
+}
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != nullptr) {
-                more_recent->less_recent = prune_candidate->less_recent;
+// Bring the cache within its size limit. The cost-aware policy evicts
+// the cheapest candidate of any shard each time. The others prune the
+// shards in turn, starting with the given one, in LRU order. Takes each
+// shard's lock in turn, so the caller must not hold any.
+WEAK void prune_cache(int first_shard) {
+    if (get_policy() == halide_memoization_cache_policy_cost_aware) {
+        while (get_current_cache_size() > get_max_cache_size()) {
+            CacheShard *cheapest = nullptr;
+            double cheapest_cost = 0;
+            for (CacheShard &shard : cache_shards) {
+                ScopedMutexLock lock(&shard.lock);
+                CacheEntry *victim = choose_victim(shard, halide_memoization_cache_policy_cost_aware);
+                if (victim != nullptr && (cheapest == nullptr || recompute_cost_per_byte(victim) < cheapest_cost)) {
+                    cheapest = &shard;
+                    cheapest_cost = recompute_cost_per_byte(victim);
+                }
             }
-
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
+            if (cheapest == nullptr) {
+                break;
             }
-            if (prune_candidate->less_recent != nullptr) {
-                prune_candidate->less_recent = more_recent;
+            // The candidates may have changed since they were looked at,
+            // but whatever is cheapest now is a good choice too.
+            ScopedMutexLock lock(&cheapest->lock);
+            CacheEntry *victim = choose_victim(*cheapest, halide_memoization_cache_policy_cost_aware);
+            if (victim != nullptr) {
+                remove_entry(nullptr, *cheapest, victim, true);
             }
+        }
+        return;
+    }
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
-            }
+    for (int i = 0; i < kNumShards && get_current_cache_size() > get_max_cache_size(); i++) {
+        CacheShard &shard = cache_shards[(first_shard + i) % kNumShards];
+        ScopedMutexLock lock(&shard.lock);
+        prune_shard(shard);
+    }
+}
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(nullptr, prune_candidate);
+// TinyLFU admission: a result that would push the cache over its size
+// limit is only stored if its key has been looked up more often recently
+// than the entry it would displace. That entry is the next victim of the
+// key's own shard, or failing that of the next shard with one. Takes each
+// shard's lock in turn, so the caller must not hold any.
+WEAK bool admit_to_cache(uint64_t h) {
+    const int first_shard = shard_index_for_hash(h);
+    uint32_t frequency = 0;
+    for (int i = 0; i < kNumShards; i++) {
+        CacheShard &shard = cache_shards[(first_shard + i) % kNumShards];
+        ScopedMutexLock lock(&shard.lock);
+        if (i == 0) {
+            frequency = sketch_estimate(shard, h);
+        }
+        CacheEntry *victim = choose_victim(shard, halide_memoization_cache_policy_lru);
+        if (victim != nullptr) {
+            return frequency > sketch_estimate(shard, victim->hash);
         }
-
-        prune_candidate = more_recent;
     }
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+    return true;
 }
 
 }  // namespace Internal
@@ -329,18 +632,25 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
+    Synchronization::atomic_store_relaxed(&max_cache_size, &size);
+    prune_cache(0);
+}
 
-    max_cache_size = size;
-    prune_cache();
+WEAK halide_memoization_cache_policy_t halide_memoization_cache_set_policy(halide_memoization_cache_policy_t policy) {
+    if (policy == halide_memoization_cache_policy_cost_aware) {
+        // The clock is read on every cache miss from now on.
+        halide_start_clock(nullptr);
+    }
+    return (halide_memoization_cache_policy_t)Synchronization::atomic_exchange_acquire(&memoization_policy, (int)policy);
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
+    uint64_t h = key_hash(cache_key, size);
+    int stats_slot = stats_slot_for_key(user_context, cache_key, size);
+    CacheShard &shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
@@ -355,7 +665,9 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
+    sketch_increment(shard, h);
+
+    CacheEntry *entry = shard.entries[bucket_for_hash(h)];
     while (entry != nullptr) {
         if (entry->hash == h && entry->key_size == (size_t)size &&
             keys_equal(entry->key, cache_key, size) &&
@@ -369,23 +681,23 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
             }
 
             if (all_bounds_equal) {
-                if (entry != most_recently_used) {
+                if (entry != shard.most_recently_used) {
                     halide_abort_if_false(user_context, entry->more_recent != nullptr);
                     if (entry->less_recent != nullptr) {
                         entry->less_recent->more_recent = entry->more_recent;
                     } else {
-                        halide_abort_if_false(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
+                        halide_abort_if_false(user_context, shard.least_recently_used == entry);
+                        shard.least_recently_used = entry->more_recent;
                     }
                     halide_abort_if_false(user_context, entry->more_recent != nullptr);
                     entry->more_recent->less_recent = entry->less_recent;
 
                     entry->more_recent = nullptr;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != nullptr) {
-                        most_recently_used->more_recent = entry;
+                    entry->less_recent = shard.most_recently_used;
+                    if (shard.most_recently_used != nullptr) {
+                        shard.most_recently_used->more_recent = entry;
                     }
-                    most_recently_used = entry;
+                    shard.most_recently_used = entry;
                 }
 
                 for (int32_t i = 0; i < tuple_count; i++) {
@@ -394,6 +706,7 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
                 }
 
                 entry->in_use_count += tuple_count;
+                shard.stats[stats_slot].hits++;
 
                 return 0;
             }
@@ -401,6 +714,14 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         entry = entry->next;
     }
 
+    shard.stats[stats_slot].misses++;
+
+    // Only the cost-aware policy needs to know how long the result takes to compute.
+    int64_t miss_time_ns = 0;
+    if (get_policy() == halide_memoization_cache_policy_cost_aware) {
+        miss_time_ns = halide_current_time_ns(user_context);
+    }
+
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -416,10 +737,11 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         CacheBlockHeader *header = get_pointer_to_header(buf->host);
         header->hash = h;
         header->entry = nullptr;
+        header->miss_time_ns = miss_time_ns;
     }
 
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_cache(shard);
 #endif
 
     return 1;
@@ -431,107 +753,141 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         bool has_eviction_key, uint64_t eviction_key) {
     debug(user_context) << "halide_memoization_cache_store has_eviction_key: " << has_eviction_key << " eviction_key " << eviction_key << " .\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheBlockHeader *first_header = get_pointer_to_header(tuple_buffers[0]->host);
+    uint64_t h = first_header->hash;
+    int64_t cost_ns = 0;
+    if (first_header->miss_time_ns != 0) {
+        cost_ns = halide_current_time_ns(user_context) - first_header->miss_time_ns;
+    }
+
+    int64_t added_size = 0;
+    {
+        for (int32_t i = 0; i < tuple_count; i++) {
+            halide_buffer_t *buf = tuple_buffers[i];
+            added_size += buf->size_in_bytes();
+        }
+    }
 
-    uint32_t index = h % kHashTableSize;
+    // Decide on admission before taking the lock of the key's shard, as
+    // it may need to look at the other shards.
+    bool admit = true;
+    if (get_policy() == halide_memoization_cache_policy_tinylfu &&
+        get_current_cache_size() + added_size > get_max_cache_size()) {
+        admit = admit_to_cache(h);
+    }
 
-    ScopedMutexLock lock(&memoization_lock);
+    int stats_slot = stats_slot_for_key(user_context, cache_key, size);
+    const int shard_index = shard_index_for_hash(h);
+    CacheShard &shard = cache_shards[shard_index];
+    {
+        ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
+        CacheEntry *entry = shard.entries[bucket_for_hash(h)];
+        while (entry != nullptr) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
+
+                bool all_bounds_equal = true;
+                bool no_host_pointers_equal = true;
+                {
+                    for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                        if (entry->buf[i].host == buf->host) {
+                            no_host_pointers_equal = false;
+                        }
                     }
                 }
-            }
-            if (all_bounds_equal) {
-                halide_abort_if_false(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+                if (all_bounds_equal) {
+                    halide_abort_if_false(user_context, no_host_pointers_equal);
+                    // This entry is still in use by the caller. Mark it as having no cache entry
+                    // so halide_memoization_cache_release can free the buffer.
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+                    }
+                    return halide_error_code_success;
                 }
-                return halide_error_code_success;
             }
+            entry = entry->next;
         }
-        entry = entry->next;
-    }
 
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
+        if (!admit) {
+            // As above, the caller frees the buffer on release.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+            }
+            shard.stats[stats_slot].rejections++;
+            return halide_error_code_success;
         }
-    }
-    current_cache_size += added_size;
-    prune_cache();
-
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
-                                 has_eviction_key, eviction_key);
-    }
-    if (!inited) {
-        current_cache_size -= added_size;
 
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+        add_to_shard_size(shard, added_size);
+        if (get_policy() != halide_memoization_cache_policy_cost_aware) {
+            prune_shard(shard);
         }
 
+        CacheEntry *new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
+        bool inited = false;
         if (new_entry) {
-            halide_free(user_context, new_entry);
+            inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
+                                     has_eviction_key, eviction_key);
         }
-        return halide_error_code_success;
-    }
+        if (!inited) {
+            add_to_shard_size(shard, -added_size);
 
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != nullptr) {
-        most_recently_used->more_recent = new_entry;
-    }
-    most_recently_used = new_entry;
-    if (least_recently_used == nullptr) {
-        least_recently_used = new_entry;
-    }
-    cache_entries[index] = new_entry;
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+            }
 
-    new_entry->in_use_count = tuple_count;
+            if (new_entry) {
+                halide_free(user_context, new_entry);
+            }
+            return halide_error_code_success;
+        }
 
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
-    }
+        new_entry->stats_slot = stats_slot;
+        new_entry->bytes = added_size;
+        new_entry->cost_ns = cost_ns;
+        link_entry(shard, new_entry);
+
+        halide_memoization_cache_stats_t &stats = shard.stats[stats_slot];
+        stats.entries++;
+        stats.bytes += added_size;
+
+        new_entry->in_use_count = tuple_count;
+
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+        }
 
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_cache(shard);
 #endif
+    }
+
+    // Make room in the other shards if nothing more could be evicted
+    // from the key's shard, or pick among all shards for the cost-aware
+    // policy.
+    if (get_current_cache_size() > get_max_cache_size()) {
+        prune_cache(shard_index + 1);
+    }
+
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
     return halide_error_code_success;
@@ -545,12 +901,13 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == nullptr) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
+        CacheShard &shard = shard_for_hash(header->hash);
+        ScopedMutexLock lock(&shard.lock);
 
         halide_abort_if_false(user_context, entry->in_use_count > 0);
         entry->in_use_count--;
 #if CACHE_DEBUGGING
-        validate_cache();
+        validate_cache(shard);
 #endif
     }
 
@@ -559,54 +916,95 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
 
 WEAK void halide_memoization_cache_cleanup() {
     debug(nullptr) << "halide_memoization_cache_cleanup\n";
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        entry_ref = nullptr;
-        while (entry != nullptr) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(nullptr, entry);
-            entry = next;
+    for (CacheShard &shard : cache_shards) {
+        for (auto &entry_ref : shard.entries) {
+            CacheEntry *entry = entry_ref;
+            entry_ref = nullptr;
+            while (entry != nullptr) {
+                CacheEntry *next = entry->next;
+                entry->destroy();
+                halide_free(nullptr, entry);
+                entry = next;
+            }
+        }
+        shard.current_size = 0;
+        shard.most_recently_used = nullptr;
+        shard.least_recently_used = nullptr;
+        memset(shard.sketch, 0, sizeof(shard.sketch));
+        shard.sketch_additions = 0;
+        memset(shard.stats, 0, sizeof(shard.stats));
+    }
+    for (char *&name : stats_pipeline_names) {
+        if (name != nullptr) {
+            halide_free(nullptr, name);
+            name = nullptr;
         }
     }
-    current_cache_size = 0;
-    most_recently_used = nullptr;
-    least_recently_used = nullptr;
 }
 
 WEAK void halide_memoization_cache_evict(void *user_context, uint64_t eviction_key) {
-    ScopedMutexLock lock(&memoization_lock);
+    for (CacheShard &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
 
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        if (entry != nullptr) {
-            CacheEntry **prev = &entry_ref;
+        for (auto &entry_ref : shard.entries) {
+            CacheEntry *entry = entry_ref;
             while (entry != nullptr) {
                 CacheEntry *next = entry->next;
                 if (entry->has_eviction_key && entry->eviction_key == eviction_key) {
-                    *prev = next;
-                    if (entry->more_recent != nullptr) {
-                        entry->more_recent->less_recent = entry->less_recent;
-                    } else {
-                        most_recently_used = entry->less_recent;
-                    }
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        least_recently_used = entry->more_recent;
-                    }
-                    entry->destroy();
-                    halide_free(user_context, entry);
-                } else {
-                    prev = &entry->next;
+                    remove_entry(user_context, shard, entry, false);
                 }
                 entry = next;
             }
         }
-    }
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_cache(shard);
 #endif
+    }
+}
+
+WEAK int halide_memoization_cache_get_stats(void *user_context, const char *pipeline_name,
+                                            halide_memoization_cache_stats_t *stats) {
+    if (stats == nullptr) {
+        return halide_error_code_buffer_argument_is_null;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    int slot = -1;
+    if (pipeline_name != nullptr) {
+        slot = find_stats_slot(user_context, (const uint8_t *)pipeline_name, strlen(pipeline_name), false);
+        if (slot < 0) {
+            return halide_error_code_success;
+        }
+    }
+
+    for (CacheShard &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
+        for (int i = 0; i < kMaxPipelineStats; i++) {
+            if (slot >= 0 && i != slot) {
+                continue;
+            }
+            const halide_memoization_cache_stats_t &s = shard.stats[i];
+            stats->hits += s.hits;
+            stats->misses += s.misses;
+            stats->evictions += s.evictions;
+            stats->rejections += s.rejections;
+            stats->entries += s.entries;
+            stats->bytes += s.bytes;
+        }
+    }
+    return halide_error_code_success;
+}
+
+WEAK void halide_memoization_cache_reset_stats() {
+    for (CacheShard &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
+        for (halide_memoization_cache_stats_t &s : shard.stats) {
+            s.hits = 0;
+            s.misses = 0;
+            s.evictions = 0;
+            s.rejections = 0;
+        }
+    }
 }
 
 namespace {
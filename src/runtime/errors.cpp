@@ -316,4 +316,19 @@ WEAK int halide_error_streaming_vscale_invalid(void *user_context, const char *f
     return halide_error_code_streaming_vscale_invalid;
 }
 
+WEAK int halide_error_scratch_too_small(void *user_context, uint64_t provided_size, uint64_t required_size) {
+    error(user_context)
+        << "The scratch memory passed to the pipeline (" << provided_size
+        << " bytes) is smaller than the " << required_size
+        << " bytes its allocations were planned into.";
+    return halide_error_code_scratch_too_small;
+}
+
+WEAK int halide_error_scratch_unaligned(void *user_context, int alignment) {
+    error(user_context)
+        << "The scratch memory passed to the pipeline is not aligned to a "
+        << alignment << " bytes boundary.";
+    return halide_error_code_scratch_unaligned;
+}
+
 }  // extern "C"
@@ -0,0 +1,29 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// For platforms where we don't know how to discover the NUMA topology or
+// place threads: the whole machine is one node.
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    return 1;
+}
+
+WEAK int halide_numa_pin_current_thread(int node) {
+    return 0;
+}
+
+WEAK int halide_numa_current_node() {
+    return -1;
+}
+
+WEAK void *halide_numa_malloc(void *user_context, size_t x) {
+    return halide_default_malloc(user_context, x);
+}
+
+WEAK void halide_numa_free(void *user_context, void *ptr) {
+    halide_default_free(user_context, ptr);
+}
+
+}  // extern "C"
@@ -131,6 +131,43 @@ WEAK int halide_get_num_threads() {
     return 1;
 }
 
+WEAK halide_thread_pool_scheduler_t halide_set_thread_pool_scheduler(halide_thread_pool_scheduler_t s) {
+    // With only one thread there is nothing to schedule.
+    return halide_thread_pool_scheduler_shared_queue;
+}
+
+WEAK halide_numa_policy_t halide_set_numa_policy(halide_numa_policy_t policy) {
+    return halide_numa_policy_none;
+}
+
+WEAK int halide_get_numa_node_count() {
+    return 1;
+}
+
+WEAK int halide_call_argv_async(void *user_context, int (*argv_fn)(void **), void **args,
+                                halide_async_call_done_t done, void *closure) {
+    // There is no other thread to run it on, so run it now.
+    done(user_context, argv_fn(args), closure);
+    return halide_error_code_success;
+}
+
+WEAK int halide_call_argv_batch(void *user_context, int (*argv_fn)(void **), int num_calls,
+                                void **const *args, int *exit_statuses) {
+    int first_failure = halide_error_code_success;
+    for (int i = 0; i < num_calls; i++) {
+        int exit_status = argv_fn(args[i]);
+        if (exit_statuses) {
+            exit_statuses[i] = exit_status;
+        } else if (exit_status != halide_error_code_success) {
+            return exit_status;
+        }
+        if (first_failure == halide_error_code_success) {
+            first_failure = exit_status;
+        }
+    }
+    return first_failure;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
@@ -232,6 +232,30 @@ halide_buffer_t *_halide_buffer_set_bounds(halide_buffer_t *buf,
     }
     return buf;
 }
+
+HALIDE_BUFFER_HELPER_ATTRS
+halide_buffer_t *_halide_buffer_batch_get(halide_buffer_t **batch, int i) {
+    return batch[i];
+}
+
+// Whether two buffers have the same type and shape. Either may be null,
+// in which case they don't.
+HALIDE_BUFFER_HELPER_ATTRS
+bool _halide_buffer_same_shape(const halide_buffer_t *a, const halide_buffer_t *b) {
+    if (a == nullptr || b == nullptr ||
+        !(a->type == b->type) ||
+        a->dimensions != b->dimensions) {
+        return false;
+    }
+    for (int i = 0; i < a->dimensions; i++) {
+        if (a->dim[i].min != b->dim[i].min ||
+            a->dim[i].extent != b->dim[i].extent ||
+            a->dim[i].stride != b->dim[i].stride) {
+            return false;
+        }
+    }
+    return true;
+}
 }
 
 #undef HALIDE_BUFFER_HELPER_ATTRS
@@ -0,0 +1,7 @@
+#ifdef BITS_64
+#define SYS_PERF_EVENT_OPEN 241
+#else
+#define SYS_PERF_EVENT_OPEN 364
+#endif
+
+#include "linux_perf_counters_common.h"
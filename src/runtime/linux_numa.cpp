@@ -0,0 +1,233 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+extern "C" {
+
+extern int open(const char *pathname, int flags, ...);
+extern ssize_t read(int fd, void *buf, size_t count);
+extern int sched_getaffinity(int pid, size_t cpusetsize, void *mask);
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+extern int munmap(void *addr, size_t length);
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The NUMA topology, as reported by /sys/devices/system/node. Nodes are
+// numbered densely in the order the kernel lists them, which is not
+// necessarily the kernel's own numbering.
+constexpr int MAX_NUMA_NODES = 64;
+constexpr int MAX_NUMA_CPUS = 1024;
+constexpr int NUMA_CPU_MASK_WORDS = MAX_NUMA_CPUS / 64;
+
+struct numa_topology_t {
+    bool initialized;
+    int num_nodes;
+    uint64_t node_cpus[MAX_NUMA_NODES][NUMA_CPU_MASK_WORDS];
+    uint64_t all_cpus[NUMA_CPU_MASK_WORDS];
+    // The affinity mask of the thread that first looked at the topology,
+    // before any thread was pinned. Threads are never pinned outside it,
+    // so that restrictions placed on the process (e.g. by taskset) hold.
+    uint64_t allowed_cpus[NUMA_CPU_MASK_WORDS];
+};
+
+WEAK numa_topology_t numa_topology = {};
+WEAK halide_mutex numa_topology_lock = {{0}};
+
+// Read a small sysfs file into buf as a nul-terminated string.
+WEAK bool numa_read_file(const char *path, char *buf, size_t size) {
+    const int O_RDONLY = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = 0;
+    return true;
+}
+
+// Parse a kernel list format string, e.g. "0-15,32-47", into a bitmask.
+WEAK void numa_parse_list(const char *s, uint64_t *mask, int mask_words) {
+    while (*s >= '0' && *s <= '9') {
+        int lo = 0;
+        while (*s >= '0' && *s <= '9') {
+            lo = lo * 10 + (*s++ - '0');
+        }
+        int hi = lo;
+        if (*s == '-') {
+            s++;
+            hi = 0;
+            while (*s >= '0' && *s <= '9') {
+                hi = hi * 10 + (*s++ - '0');
+            }
+        }
+        for (int i = lo; i <= hi && i < mask_words * 64; i++) {
+            mask[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+        if (*s == ',') {
+            s++;
+        }
+    }
+}
+
+WEAK void numa_initialize() {
+    ScopedMutexLock lock(&numa_topology_lock);
+    if (numa_topology.initialized) {
+        return;
+    }
+    numa_topology.num_nodes = 0;
+
+    if (sched_getaffinity(0, sizeof(numa_topology.allowed_cpus), numa_topology.allowed_cpus) < 0) {
+        memset(numa_topology.allowed_cpus, 0xff, sizeof(numa_topology.allowed_cpus));
+    }
+
+    char buf[1024];
+    uint64_t online[1] = {0};
+    if (numa_read_file("/sys/devices/system/node/online", buf, sizeof(buf))) {
+        numa_parse_list(buf, online, 1);
+    }
+    for (int id = 0; id < 64 && numa_topology.num_nodes < MAX_NUMA_NODES; id++) {
+        if (!(online[0] & ((uint64_t)1 << id))) {
+            continue;
+        }
+        char path[64];
+        char *end = path + sizeof(path);
+        char *dst = halide_string_to_string(path, end, "/sys/devices/system/node/node");
+        dst = halide_int64_to_string(dst, end, id, 1);
+        halide_string_to_string(dst, end, "/cpulist");
+        if (!numa_read_file(path, buf, sizeof(buf))) {
+            continue;
+        }
+        uint64_t *cpus = numa_topology.node_cpus[numa_topology.num_nodes];
+        numa_parse_list(buf, cpus, NUMA_CPU_MASK_WORDS);
+        bool any = false;
+        for (int w = 0; w < NUMA_CPU_MASK_WORDS; w++) {
+            numa_topology.all_cpus[w] |= cpus[w];
+            any |= cpus[w] != 0;
+        }
+        // Memory-only nodes have no cpus to pin to.
+        if (any) {
+            numa_topology.num_nodes++;
+        }
+    }
+    if (numa_topology.num_nodes == 0) {
+        // No sysfs (e.g. in some containers). Treat the machine as one node
+        // we know nothing about.
+        numa_topology.num_nodes = 1;
+    }
+    numa_topology.initialized = true;
+}
+
+ALWAYS_INLINE const numa_topology_t &get_numa_topology() {
+    if (!numa_topology.initialized) {
+        numa_initialize();
+    }
+    return numa_topology;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    return get_numa_topology().num_nodes;
+}
+
+WEAK int halide_numa_pin_current_thread(int node) {
+    const numa_topology_t &t = get_numa_topology();
+    const uint64_t *cpus = (node >= 0 && node < t.num_nodes) ? t.node_cpus[node] : t.all_cpus;
+    uint64_t mask[NUMA_CPU_MASK_WORDS];
+    bool any = false;
+    for (int w = 0; w < NUMA_CPU_MASK_WORDS; w++) {
+        mask[w] = cpus[w] & t.allowed_cpus[w];
+        any |= mask[w] != 0;
+    }
+    if (!any) {
+        // Either nothing is known about the topology, or none of the cpus
+        // of the node are allowed. Let the thread run anywhere it is
+        // allowed to.
+        memcpy(mask, t.allowed_cpus, sizeof(mask));
+    }
+    // pid 0 means the calling thread.
+    return sched_setaffinity(0, sizeof(uint64_t) * NUMA_CPU_MASK_WORDS, mask);
+}
+
+WEAK int halide_numa_current_node() {
+    const numa_topology_t &t = get_numa_topology();
+    if (t.num_nodes < 2) {
+        return -1;
+    }
+    uint64_t mask[NUMA_CPU_MASK_WORDS] = {0};
+    if (sched_getaffinity(0, sizeof(mask), mask) < 0) {
+        return -1;
+    }
+    for (int n = 0; n < t.num_nodes; n++) {
+        bool subset = true;
+        for (int w = 0; w < NUMA_CPU_MASK_WORDS; w++) {
+            subset &= (mask[w] & ~t.node_cpus[n][w]) == 0;
+        }
+        if (subset) {
+            return n;
+        }
+    }
+    return -1;
+}
+
+// Allocations at least this large get fresh pages from mmap, which the
+// kernel places on the node of the thread that first writes to them.
+// Smaller ones come from the default allocator, whose free lists recycle
+// memory without regard to where it lives.
+#define HALIDE_NUMA_MMAP_THRESHOLD (256 * 1024)
+
+WEAK void *halide_numa_malloc(void *user_context, size_t x) {
+    // Each allocation is preceded by a header of one alignment unit
+    // recording how it was made, so that halide_numa_free can undo it.
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    const size_t total = x + alignment;
+    char *base;
+    if (x >= HALIDE_NUMA_MMAP_THRESHOLD) {
+        const int PROT_READ_WRITE = 0x1 | 0x2;
+        const int MAP_PRIVATE_ANONYMOUS = 0x02 | 0x20;
+        base = (char *)mmap(nullptr, total, PROT_READ_WRITE, MAP_PRIVATE_ANONYMOUS, -1, 0);
+        if (base == (char *)-1) {
+            return nullptr;
+        }
+    } else {
+        base = (char *)halide_default_malloc(user_context, total);
+        if (!base) {
+            return nullptr;
+        }
+    }
+    // Only the header is written here, so at most one page is touched
+    // before the pipeline gets to it.
+    ((size_t *)base)[0] = total;
+    ((size_t *)base)[1] = x >= HALIDE_NUMA_MMAP_THRESHOLD;
+    return base + alignment;
+}
+
+WEAK void halide_numa_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    char *base = (char *)ptr - alignment;
+    if (((size_t *)base)[1]) {
+        munmap(base, ((size_t *)base)[0]);
+    } else {
+        halide_default_free(user_context, base);
+    }
+}
+
+}  // extern "C"
@@ -0,0 +1,284 @@
+#ifndef HALIDE_RUNTIME_LINUX_PERF_COUNTERS_COMMON_H
+#define HALIDE_RUNTIME_LINUX_PERF_COUNTERS_COMMON_H
+
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_atomics.h"
+#include "runtime_internal.h"
+
+#ifndef SYS_PERF_EVENT_OPEN
+#error "SYS_PERF_EVENT_OPEN must be defined before including linux_perf_counters_common.h"
+#endif
+
+extern "C" {
+
+extern int syscall(int num, ...);
+extern ssize_t read(int fd, void *buf, size_t count);
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Hardware counters for the profiler, read with perf_event_open each time
+// a thread moves from one Func to another. Every thread that runs
+// profiled Halide code gets its own group of counters, which are read
+// together, and the counts since the thread's previous transition are
+// billed to the Func it was working on. Unlike time, which is sampled,
+// these are exact totals over all threads.
+//
+// The runtime has no thread-local storage, so per-thread state lives in
+// a fixed table keyed by thread id. A thread claims a slot the first time
+// it makes a transition and keeps it from then on. Once a thread exits,
+// the kernel may give its id to a new thread, which then finds the old
+// thread's slot. The counters there stopped counting when the old thread
+// exited, so the new thread notices that they haven't moved since the last
+// transition, and opens its own. If the table fills up, a warning is
+// printed, and threads without a slot go uncounted.
+
+// The generic hardware events we count, in the same order as the
+// corresponding fields at the end of halide_profiler_func_stats.
+constexpr int kPerfNumCounters = 6;
+constexpr int kPerfMaxThreads = 256;
+
+// The start of struct perf_event_attr from linux/perf_event.h, as of
+// PERF_ATTR_SIZE_VER5.
+struct perf_event_attr_t {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+    uint64_t config2;
+    uint64_t branch_sample_type;
+    uint64_t sample_regs_user;
+    uint32_t sample_stack_user;
+    int32_t clockid;
+    uint64_t sample_regs_intr;
+    uint32_t aux_watermark;
+    uint16_t sample_max_stack;
+    uint16_t reserved;
+};
+
+constexpr uint32_t PERF_TYPE_HARDWARE = 0;
+constexpr uint64_t PERF_FORMAT_GROUP = 1 << 3;
+constexpr uint64_t PERF_ATTR_EXCLUDE_KERNEL = 1 << 5;
+constexpr uint64_t PERF_ATTR_EXCLUDE_HV = 1 << 6;
+constexpr unsigned long PERF_FLAG_FD_CLOEXEC = 1 << 3;
+
+// PERF_COUNT_HW_CPU_CYCLES, _INSTRUCTIONS, _CACHE_REFERENCES,
+// _CACHE_MISSES, _BRANCH_INSTRUCTIONS, and _BRANCH_MISSES.
+constexpr uint64_t perf_hw_events[kPerfNumCounters] = {0, 1, 2, 3, 4, 5};
+
+struct PerfThreadState {
+    // The thread that owns this slot, or zero if it is free.
+    int32_t tid;
+    // The group leader, or -1 if no counters could be opened.
+    int fd;
+    // The number of counters in the group, and which of the six each
+    // one is. Events the machine doesn't support are left out.
+    int num_events;
+    int events[kPerfNumCounters];
+    int event_fds[kPerfNumCounters];
+    // What this thread was working on at its last transition, and the
+    // counts at the time.
+    halide_profiler_instance_state *instance;
+    uint64_t instance_start_time;
+    int func;
+    uint64_t last[kPerfNumCounters];
+};
+
+WEAK PerfThreadState perf_threads[kPerfMaxThreads];
+WEAK int perf_open_failure_reported = 0;
+WEAK int perf_table_full_reported = 0;
+
+ALWAYS_INLINE bool perf_report_once(int *reported) {
+    using namespace Synchronization;
+    int expected = 0, desired = 1;
+    return atomic_cas_strong_sequentially_consistent(reported, &expected, &desired);
+}
+
+WEAK void perf_close_counters(PerfThreadState *t) {
+    if (t->fd >= 0) {
+        for (int i = 0; i < t->num_events; i++) {
+            close(t->event_fds[i]);
+        }
+        t->fd = -1;
+    }
+}
+
+WEAK void perf_open_counters(PerfThreadState *t) {
+    t->fd = -1;
+    t->num_events = 0;
+    for (int i = 0; i < kPerfNumCounters; i++) {
+        perf_event_attr_t attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = perf_hw_events[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.flags = PERF_ATTR_EXCLUDE_KERNEL | PERF_ATTR_EXCLUDE_HV;
+        // Count this thread on whichever cpu it runs.
+        int fd = syscall(SYS_PERF_EVENT_OPEN, &attr, 0, -1, t->fd, PERF_FLAG_FD_CLOEXEC);
+        if (fd < 0) {
+            if (t->fd < 0) {
+                // Without the first counter there is no group to add
+                // the others to.
+                break;
+            }
+            continue;
+        }
+        if (t->fd < 0) {
+            t->fd = fd;
+        }
+        t->events[t->num_events] = i;
+        t->event_fds[t->num_events] = fd;
+        t->num_events++;
+    }
+
+    if (t->fd < 0) {
+        if (perf_report_once(&perf_open_failure_reported)) {
+            print(nullptr) << "Warning: could not open hardware performance counters with "
+                           << "perf_event_open. Check /proc/sys/kernel/perf_event_paranoid. "
+                           << "The profile will not include hardware counters.\n";
+        }
+    }
+}
+
+// The state for the calling thread, claiming a slot if need be, or
+// nullptr if the table is full.
+WEAK PerfThreadState *perf_thread_state() {
+    using namespace Synchronization;
+
+    int32_t tid = halide_current_thread_id();
+    uint32_t h = (uint32_t)tid * 0x9e3779b9u;
+    for (int i = 0; i < kPerfMaxThreads; i++) {
+        PerfThreadState *t = &perf_threads[(h + i) % kPerfMaxThreads];
+        int32_t owner;
+        atomic_load_acquire(&t->tid, &owner);
+        if (owner == tid) {
+            return t;
+        }
+        if (owner == 0) {
+            int32_t expected = 0;
+            if (atomic_cas_strong_sequentially_consistent(&t->tid, &expected, &tid)) {
+                perf_open_counters(t);
+                return t;
+            }
+        }
+    }
+    if (perf_report_once(&perf_table_full_reported)) {
+        print(nullptr) << "Warning: more than " << kPerfMaxThreads << " threads have run code "
+                       << "profiled with hardware counters. The profile will not include "
+                       << "hardware counts from the rest.\n";
+    }
+    return nullptr;
+}
+
+ALWAYS_INLINE bool perf_counts_unchanged(const PerfThreadState *t, const uint64_t *now) {
+    for (int i = 0; i < kPerfNumCounters; i++) {
+        if (now[i] != t->last[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+WEAK bool perf_read_counters(const PerfThreadState *t, uint64_t *counts) {
+    uint64_t buf[kPerfNumCounters + 1];
+    ssize_t expected = (ssize_t)((t->num_events + 1) * sizeof(uint64_t));
+    if (read(t->fd, buf, sizeof(buf)) != expected) {
+        return false;
+    }
+    for (int i = 0; i < kPerfNumCounters; i++) {
+        counts[i] = 0;
+    }
+    for (int i = 0; i < t->num_events; i++) {
+        counts[t->events[i]] = buf[i + 1];
+    }
+    return true;
+}
+
+WEAK void perf_counters_transition(halide_profiler_instance_state *instance, int func) {
+    using namespace Synchronization;
+
+    PerfThreadState *t = perf_thread_state();
+    if (!t || t->fd < 0) {
+        return;
+    }
+    uint64_t now[kPerfNumCounters];
+    if (!perf_read_counters(t, now)) {
+        return;
+    }
+
+    // This thread has run user code since its last transition, so if its
+    // counters haven't moved, they were opened by an earlier thread with
+    // the same id that has since exited. Open our own, and don't bill the
+    // old thread's counts to anything.
+    if (perf_counts_unchanged(t, now)) {
+        perf_close_counters(t);
+        perf_open_counters(t);
+        t->instance = nullptr;
+        if (t->fd < 0 || !perf_read_counters(t, now)) {
+            return;
+        }
+    }
+
+    // Bill the counts since this thread's last transition to the Func it
+    // was then working on, provided that was in this same run of this
+    // pipeline. (Instances live on the stack, so a later run may well
+    // reuse the address of an earlier one.)
+    if (t->instance == instance &&
+        t->instance_start_time == instance->start_time) {
+        halide_profiler_func_stats &stats = instance->funcs[t->func];
+        uint64_t *counters = &stats.cycles;
+        for (int i = 0; i < kPerfNumCounters; i++) {
+            uint64_t delta = now[i] - t->last[i];
+            if (delta) {
+                atomic_fetch_add_sequentially_consistent(counters + i, delta);
+            }
+        }
+    }
+
+    t->instance = instance;
+    t->instance_start_time = instance->start_time;
+    t->func = func;
+    for (int i = 0; i < kPerfNumCounters; i++) {
+        t->last[i] = now[i];
+    }
+}
+
+WEAK __attribute__((destructor)) void halide_perf_counters_cleanup() {
+    for (PerfThreadState &t : perf_threads) {
+        if (t.tid) {
+            perf_close_counters(&t);
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+// Used in place of halide_profiler_set_current_func when compiling with
+// Target::ProfileHardwareCounters. Counters are read on every transition,
+// including those made by threads that don't hold the sampling token, but
+// only the token holder updates the current Func seen by the sampler.
+WEAK int halide_profiler_set_current_func_with_counters(halide_profiler_instance_state *instance, int func, int *sampling_token) {
+    Halide::Runtime::Internal::perf_counters_transition(instance, func);
+    if (sampling_token == nullptr || *sampling_token == 0) {
+        volatile int *ptr = &(instance->current_func);
+        *ptr = func;
+    }
+    return 0;
+}
+}
+
+#endif  // HALIDE_RUNTIME_LINUX_PERF_COUNTERS_COMMON_H
@@ -0,0 +1,7 @@
+#ifdef BITS_64
+#define SYS_PERF_EVENT_OPEN 298
+#else
+#define SYS_PERF_EVENT_OPEN 336
+#endif
+
+#include "linux_perf_counters_common.h"
@@ -1,18 +1,296 @@
 #include "HalideRuntime.h"
+#include "runtime_atomics.h"
 #include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
 
 extern "C" {
 
 extern void *malloc(size_t);
 extern void free(void *);
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// An optional pool of host allocations, enabled with
+// halide_reuse_host_allocations(). Requests are rounded up to one of a
+// set of size classes (four per power of two, from 64 bytes up to
+// 256MB), and freed blocks are kept on per-class free lists to satisfy
+// later requests of the same class without going back to malloc.
+//
+// Pooled blocks carry two words in front of the pointer returned: the
+// original malloc result with its low bit set, and the size class. Blocks
+// from halide_internal_aligned_alloc only carry the original pointer,
+// which is always even, so halide_default_free can tell the two apart
+// however the pool has been toggled in the meantime.
+//
+// Each block handed out from a free list is recorded by address in
+// host_pool_unreported_reuses, so that the profiler can bill the reuse to
+// the pipeline that made the allocation. The profiler can't tell which
+// allocator a pointer came from, so it only ever compares addresses
+// against that table, and never reads memory around a pointer unless the
+// pool has said it owns it.
+//
+// The runtime has no thread-local storage, so instead of a cache per
+// thread there are several arenas, and a thread picks one by hashing
+// the address of its stack. Threads run on separate stacks, so they
+// mostly stay out of each other's way.
+
+constexpr int kHostPoolMinClassBits = 6;
+constexpr int kHostPoolMaxClassBits = 28;
+constexpr int kHostPoolNumClasses = (kHostPoolMaxClassBits - kHostPoolMinClassBits) * 4 + 1;
+constexpr int kHostPoolNumArenas = 8;
+constexpr int kHostPoolNumUnreportedReuses = 1024;
+
+struct HostPoolArena {
+    halide_mutex lock;
+    void *free_lists[kHostPoolNumClasses];
+    // Statistics, updated with the lock held.
+    uint64_t allocations;
+    uint64_t reuses;
+    uint64_t bytes_allocated;
+    uint64_t bytes_reused;
+};
+
+WEAK HostPoolArena host_pool_arenas[kHostPoolNumArenas];
+WEAK int host_pool_enabled = 0;
+// The most memory the pool holds onto while it isn't in use. Freed blocks
+// that would take it over this are returned to the system instead.
+WEAK uintptr_t host_pool_limit = 64 * 1024 * 1024;
+WEAK uintptr_t host_pool_cached_bytes = 0;
+
+// Blocks reused from a free list, and not yet reported to the profiler
+// or freed, in a direct-mapped table indexed by a hash of their address.
+// A reuse that collides with an earlier one displaces it, so the
+// profiler may undercount reuses but never bills one twice. Empty slots
+// are null.
+WEAK void *host_pool_unreported_reuses[kHostPoolNumUnreportedReuses];
+
+ALWAYS_INLINE void **host_pool_unreported_reuse_slot(void *ptr) {
+    uintptr_t h = (uintptr_t)ptr;
+    h = (h >> 4) * 0x9e3779b9;
+    return &host_pool_unreported_reuses[(h >> 8) % kHostPoolNumUnreportedReuses];
+}
+
+// Forget that the block at ptr was reused, if it is still recorded.
+// Returns whether it was.
+ALWAYS_INLINE bool host_pool_take_unreported_reuse(void *ptr) {
+    using namespace Synchronization;
+
+    void **slot = host_pool_unreported_reuse_slot(ptr);
+    void *recorded;
+    atomic_load_relaxed(slot, &recorded);
+    if (recorded != ptr) {
+        return false;
+    }
+    void *expected = ptr;
+    void *desired = nullptr;
+    return atomic_cas_strong_sequentially_consistent(slot, &expected, &desired);
+}
+
+// The size class for an allocation of x bytes, or -1 if it is too large
+// to pool.
+ALWAYS_INLINE int host_pool_size_class(size_t x) {
+    if (x <= ((size_t)1 << kHostPoolMinClassBits)) {
+        return 0;
+    }
+    if (x > ((size_t)1 << kHostPoolMaxClassBits)) {
+        return -1;
+    }
+    // Classes between 2^(b-1) and 2^b are spaced 2^(b-3) apart.
+    const int b = 64 - __builtin_clzll((uint64_t)(x - 1));
+    const int q = (int)((x - 1) >> (b - 3)) - 4;
+    return (b - kHostPoolMinClassBits - 1) * 4 + q + 1;
+}
+
+ALWAYS_INLINE size_t host_pool_class_size(int c) {
+    if (c == 0) {
+        return (size_t)1 << kHostPoolMinClassBits;
+    }
+    const int b = (c - 1) / 4 + kHostPoolMinClassBits + 1;
+    const int q = (c - 1) % 4;
+    return ((size_t)(q + 5)) << (b - 3);
+}
+
+ALWAYS_INLINE HostPoolArena *host_pool_current_arena() {
+    uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+    sp = (sp >> 16) * 0x9e3779b9;
+    return &host_pool_arenas[(sp >> 8) % kHostPoolNumArenas];
+}
+
+WEAK void *host_pool_malloc(size_t x) {
+    using namespace Synchronization;
+
+    const int c = host_pool_size_class(x);
+    if (c < 0) {
+        return nullptr;
+    }
+    const size_t size = host_pool_class_size(c);
+
+    HostPoolArena *arena = host_pool_current_arena();
+    {
+        ScopedMutexLock lock(&arena->lock);
+        arena->allocations++;
+        arena->bytes_allocated += size;
+        void *ptr = arena->free_lists[c];
+        if (ptr) {
+            arena->free_lists[c] = ((void **)ptr)[0];
+            arena->reuses++;
+            arena->bytes_reused += size;
+            atomic_fetch_sub_sequentially_consistent(&host_pool_cached_bytes, (uintptr_t)size);
+            atomic_store_release(host_pool_unreported_reuse_slot(ptr), &ptr);
+            return ptr;
+        }
+    }
+
+    // Nothing to reuse. Allocate a new block with room in front for the
+    // two header words and for aligning the result.
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    void *orig = ::malloc(align_up(size, alignment) + alignment + 2 * sizeof(void *));
+    if (orig == nullptr) {
+        return nullptr;
+    }
+    void **ptr = (void **)align_up((uintptr_t)orig + 2 * sizeof(void *), alignment);
+    ptr[-1] = (void *)((uintptr_t)orig | 1);
+    ptr[-2] = (void *)(uintptr_t)c;
+    return ptr;
+}
+
+WEAK void host_pool_free(void *ptr) {
+    using namespace Synchronization;
+
+    void *orig = (void *)((uintptr_t)((void **)ptr)[-1] & ~(uintptr_t)1);
+    const int c = (int)(uintptr_t)((void **)ptr)[-2];
+    const size_t size = host_pool_class_size(c);
+
+    // A block freed before the profiler asked about it must not be
+    // mistaken for a reuse of a later allocation at the same address.
+    host_pool_take_unreported_reuse(ptr);
+
+    int enabled;
+    atomic_load_relaxed(&host_pool_enabled, &enabled);
+    if (enabled) {
+        uintptr_t limit;
+        atomic_load_relaxed(&host_pool_limit, &limit);
+        if (atomic_add_fetch_sequentially_consistent(&host_pool_cached_bytes, (uintptr_t)size) <= limit) {
+            HostPoolArena *arena = host_pool_current_arena();
+            ScopedMutexLock lock(&arena->lock);
+            ((void **)ptr)[0] = arena->free_lists[c];
+            arena->free_lists[c] = ptr;
+            return;
+        }
+        atomic_fetch_sub_sequentially_consistent(&host_pool_cached_bytes, (uintptr_t)size);
+    }
+    ::free(orig);
+}
+
+WEAK void host_pool_release_unused() {
+    using namespace Synchronization;
+
+    for (HostPoolArena &arena : host_pool_arenas) {
+        ScopedMutexLock lock(&arena.lock);
+        for (int c = 0; c < kHostPoolNumClasses; c++) {
+            while (void *ptr = arena.free_lists[c]) {
+                arena.free_lists[c] = ((void **)ptr)[0];
+                atomic_fetch_sub_sequentially_consistent(&host_pool_cached_bytes, (uintptr_t)host_pool_class_size(c));
+                ::free((void *)((uintptr_t)((void **)ptr)[-1] & ~(uintptr_t)1));
+            }
+        }
+    }
+}
+
+WEAK __attribute__((destructor)) void halide_host_allocation_pool_cleanup() {
+    host_pool_release_unused();
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
 
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    int enabled;
+    atomic_load_relaxed(&host_pool_enabled, &enabled);
+    if (enabled) {
+        if (void *ptr = host_pool_malloc(x)) {
+            return ptr;
+        }
+    }
     const size_t alignment = ::halide_internal_malloc_alignment();
     return ::halide_internal_aligned_alloc(alignment, x);
 }
 
 WEAK void halide_default_free(void *user_context, void *ptr) {
-    ::halide_internal_aligned_free(ptr);
+    if ((uintptr_t)((void **)ptr)[-1] & 1) {
+        host_pool_free(ptr);
+    } else {
+        ::halide_internal_aligned_free(ptr);
+    }
+}
+
+WEAK int halide_reuse_host_allocations(void *user_context, bool flag) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    int enabled = flag ? 1 : 0;
+    atomic_store_relaxed(&host_pool_enabled, &enabled);
+    if (!flag) {
+        host_pool_release_unused();
+    }
+    return halide_error_code_success;
+}
+
+WEAK int halide_release_unused_host_allocations(void *user_context) {
+    host_pool_release_unused();
+    return halide_error_code_success;
+}
+
+WEAK int64_t halide_host_allocation_pool_set_limit(int64_t size) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    if (size < 0) {
+        size = 0;
+    }
+    uintptr_t old_limit;
+    atomic_load_relaxed(&host_pool_limit, &old_limit);
+    uintptr_t new_limit = (uintptr_t)size;
+    atomic_store_relaxed(&host_pool_limit, &new_limit);
+    if ((int64_t)old_limit > size) {
+        // Everything cached may now be over the limit, and the free
+        // lists have no order to trim them by, so drop the lot.
+        host_pool_release_unused();
+    }
+    return (int64_t)old_limit;
+}
+
+WEAK void halide_host_allocation_pool_get_stats(struct halide_host_allocation_pool_stats_t *stats) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    *stats = halide_host_allocation_pool_stats_t{};
+    for (HostPoolArena &arena : host_pool_arenas) {
+        ScopedMutexLock lock(&arena.lock);
+        stats->allocations += arena.allocations;
+        stats->reuses += arena.reuses;
+        stats->bytes_allocated += arena.bytes_allocated;
+        stats->bytes_reused += arena.bytes_reused;
+    }
+    uintptr_t cached;
+    atomic_load_relaxed(&host_pool_cached_bytes, &cached);
+    stats->cached_bytes = (int64_t)cached;
+}
+
+WEAK uint64_t halide_host_allocation_pool_reused_bytes(void *ptr) {
+    // Only once the pool has confirmed that ptr is one of its blocks is it
+    // safe to read the header in front of it.
+    if (!ptr || !host_pool_take_unreported_reuse(ptr)) {
+        return 0;
+    }
+    return host_pool_class_size((int)(uintptr_t)((void **)ptr)[-2]);
 }
 }
 
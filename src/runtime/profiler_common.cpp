@@ -340,6 +340,8 @@ WEAK int halide_profiler_instance_end(void *user_context, halide_profiler_instan
         p->memory_total += instance->memory_total;
         p->memory_peak = max(p->memory_peak, instance->memory_peak);
         p->num_allocs += instance->num_allocs;
+        p->num_pooled_allocs += (int)instance->num_pooled_allocs;
+        p->memory_pooled += instance->memory_pooled;
         p->runs++;
         p->samples += instance->samples;
 
@@ -420,7 +422,8 @@ WEAK void halide_profiler_stack_peak_update(void *user_context,
 WEAK void halide_profiler_memory_allocate(void *user_context,
                                           halide_profiler_instance_state *instance,
                                           int func_id,
-                                          uint64_t incr) {
+                                          uint64_t incr,
+                                          void *ptr) {
     using namespace Halide::Runtime::Internal::Synchronization;
 
     // It's possible to have 'incr' equal to zero if the allocation is not
@@ -448,6 +451,12 @@ WEAK void halide_profiler_memory_allocate(void *user_context,
 
     uint64_t f_mem_current = atomic_add_fetch_sequentially_consistent(&func->memory_current, incr);
     sync_compare_max_and_swap(&func->memory_peak, f_mem_current);
+
+    // ptr is the allocation just made, if it came from halide_malloc.
+    if (uint64_t reused = halide_host_allocation_pool_reused_bytes(ptr)) {
+        atomic_add_fetch_sequentially_consistent(&instance->num_pooled_allocs, (uint64_t)1);
+        atomic_add_fetch_sequentially_consistent(&instance->memory_pooled, reused);
+    }
 }
 
 WEAK void halide_profiler_memory_free(void *user_context,
@@ -702,6 +711,12 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         "  name                   | time     percent | active|  parallel   | heap | peak | avg  |recompute|notes|";
     constexpr const char *column_legend_row_2 =
         "                         |                  |threads| loops| tasks|allocs|  mem |  mem |  ratio  |     |";
+    constexpr const char *hw_counter_row =
+        "NNNNNNNNNNNNNNNNNNNNNNNNN|CCCCCC|IIIIII|QQQQQQ|EEEEEE|XXXXXXXX|BBBBBB|WWWWWWWW|";
+    constexpr const char *hw_counter_legend_row_1 =
+        "  hardware counters      |      |      |      |     cache     |   branches    |";
+    constexpr const char *hw_counter_legend_row_2 =
+        "                         |cycles|instrs| IPC  | refs | misses | count| mispred|";
 
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
@@ -746,6 +761,11 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
             sstr << " heap allocations: " << p->num_allocs
                  << "  peak heap usage: ";
             emit_si(p->memory_peak);
+            if (p->num_pooled_allocs) {
+                sstr << "  reused from pool: " << p->num_pooled_allocs << " (";
+                emit_si(p->memory_pooled);
+                sstr << ")";
+            }
             sstr << "\n";
             halide_print(user_context, sstr.str());
         }
@@ -1003,6 +1023,8 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
             warning_narrow_vector_stores,
             warning_approximated_counters,
             warning_device_bouncing,
+            warning_cache_misses,
+            warning_branch_mispredicts,
             num_warning_kinds
         };
 
@@ -1245,6 +1267,38 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                     return true;
                 }
                 return false;
+            case warning_cache_misses:
+                // Only measured with -profile_hardware_counters. Stalling on
+                // memory: few instructions per cycle and a high miss rate.
+                if (fs->cycles &&
+                    fs->instructions < fs->cycles / 2 &&
+                    fs->cache_misses * 10 > fs->cache_references) {
+                    if (emit) {
+                        sstr << fs->name << " retires only " << (float)fs->instructions / fs->cycles
+                             << " instructions per cycle, and "
+                             << (int)(100 * fs->cache_misses / fs->cache_references)
+                             << "% of its cache references miss. It is likely limited by memory "
+                             << "bandwidth or latency. Consider computing it at a finer "
+                             << "granularity closer to its consumers, tiling so its working set "
+                             << "fits in cache, or reordering the storage of the Funcs it reads.";
+                    }
+                    return true;
+                }
+                return false;
+            case warning_branch_mispredicts:
+                // Only measured with -profile_hardware_counters.
+                if (fs->branches &&
+                    fs->branch_misses * 20 > fs->branches) {
+                    if (emit) {
+                        sstr << (int)(100 * fs->branch_misses / fs->branches)
+                             << "% of the branches taken while computing " << fs->name
+                             << " were mispredicted. Consider using select instead of "
+                             << "data-dependent control flow, or moving boundary conditions "
+                             << "out of the inner loop with specialize or a RoundUp tail.";
+                    }
+                    return true;
+                }
+                return false;
             case warning_narrow_vector_stores:
                 if (total_vector_stores > fs->scalar_stores * 10 &&
                     fs->bytes_stored < total_vector_stores * p->native_vector_bytes) {
@@ -1330,6 +1384,17 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
             pad_bytes_to(target);
         };
 
+        // Column separators, dimmed so the data stands out.
+        auto emit_separators = [&](int w) {
+            for (int i = 0; i < w; i++) {
+                if (support_colors) {
+                    sstr << "\033[38;5;238m\xe2\x94\x82\033[39m";
+                } else {
+                    sstr << "\xe2\x94\x82";
+                }
+            }
+        };
+
         auto print_func_row = [&](const halide_profiler_func_stats *fs,
                                   const CumulativeStats *cs) {
             sstr.clear();
@@ -1422,14 +1487,7 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                     break;
                 }
                 case '|':
-                    // Column separator, dimmed so the data stands out.
-                    for (int i = 0; i < w; i++) {
-                        if (support_colors) {
-                            sstr << "\033[38;5;238m\xe2\x94\x82\033[39m";
-                        } else {
-                            sstr << "\xe2\x94\x82";
-                        }
-                    }
+                    emit_separators(w);
                     break;
                 case 'Z': {
                     // Centered "(allocation)" placeholder in the time
@@ -1497,6 +1555,80 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
             print_func_row(fs, cs);
         }
 
+        // ---- Hardware counters ------------------------------------------
+        //
+        // A second table, in the same row order, for pipelines compiled
+        // with -profile_hardware_counters. Unlike time these are not
+        // sampled: they are exact totals over all threads, averaged per
+        // run.
+        bool have_hw_counters = false;
+        for (int i = 0; i < p->num_funcs; i++) {
+            have_hw_counters |= p->funcs[i].cycles != 0;
+        }
+        if (have_hw_counters) {
+            auto print_hw_counter_row = [&](const halide_profiler_func_stats *fs) {
+                sstr.clear();
+                apply_template(hw_counter_row, [&](char c, int w) {
+                    switch (c) {
+                    case 'N':
+                        emit_name(fs, w);
+                        break;
+                    case 'C':
+                        emit_normalized_counter(fs->cycles, p->runs, w);
+                        break;
+                    case 'I':
+                        emit_normalized_counter(fs->instructions, p->runs, w);
+                        break;
+                    case 'Q':
+                        if (fs->cycles) {
+                            emit_float((float)fs->instructions / fs->cycles, w);
+                        } else {
+                            pad_bytes_to(sstr.size() + w);
+                        }
+                        break;
+                    case 'E':
+                        emit_normalized_counter(fs->cache_references, p->runs, w);
+                        break;
+                    case 'X':
+                        if (fs->cache_references) {
+                            emit_percentage(fs->cache_misses, fs->cache_references, w);
+                        } else {
+                            pad_bytes_to(sstr.size() + w);
+                        }
+                        break;
+                    case 'B':
+                        emit_normalized_counter(fs->branches, p->runs, w);
+                        break;
+                    case 'W':
+                        if (fs->branches) {
+                            emit_percentage(fs->branch_misses, fs->branches, w);
+                        } else {
+                            pad_bytes_to(sstr.size() + w);
+                        }
+                        break;
+                    case '|':
+                        emit_separators(w);
+                        break;
+                    default:
+                        emit_literal_run(c, w);
+                        break;
+                    }
+                });
+                sstr << "\n";
+                halide_print(user_context, sstr.str());
+            };
+
+            halide_print(user_context, "\n");
+            print_legend_row(hw_counter_legend_row_1);
+            print_legend_row(hw_counter_legend_row_2);
+            for (int i = 0; i < f_stats_count; i++) {
+                const halide_profiler_func_stats *fs = f_stats[i];
+                if (fs->kind != halide_profiler_func_kind_allocation) {
+                    print_hw_counter_row(fs);
+                }
+            }
+        }
+
         // ---- Warning messages -------------------------------------------
         //
         // The per-Func rules discovered above are rendered here, plus a few
@@ -1563,8 +1695,8 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 sstr.clear();
                 sstr << "  - The pipeline allocates a significant amount of memory, and a "
                      << "lot of time is spent freeing it. Either fuse stages more aggressively "
-                     << "to use less memory, or consider a using caching allocator with "
-                     << "retention enabled to make freeing it cheaper.\n";
+                     << "to use less memory, or call halide_reuse_host_allocations(true) "
+                     << "to have freed memory pooled for reuse by later runs.\n";
                 print_wrapped(user_context, 4, max_cols, sstr.str());
             }
             for (int w = 0; w < num_warnings; w++) {
@@ -1583,6 +1715,23 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         halide_print(user_context, sstr.str());
     }
 
+    // The host allocation pool is shared by every pipeline, including
+    // ones that aren't profiled, so also report its totals for the whole
+    // process.
+    halide_host_allocation_pool_stats_t pool_stats;
+    halide_host_allocation_pool_get_stats(&pool_stats);
+    if (pool_stats.allocations) {
+        sstr.clear();
+        sstr << "host allocation pool (all pipelines): allocations: " << pool_stats.allocations
+             << "  reused from pool: " << pool_stats.reuses << " (";
+        emit_si(pool_stats.bytes_reused);
+        sstr << ")  held unused: ";
+        emit_si((uint64_t)pool_stats.cached_bytes);
+        sstr << "\n";
+        emit_dim(horiz_rule);
+        halide_print(user_context, sstr.str());
+    }
+
     if (const char *raw_str = getenv("HL_PROFILER_JSON_OUTPUT")) {
         // Dump the raw stats to a JSON file for offline analysis.
         void *f = halide_fopen(raw_str, "w");
@@ -1644,10 +1793,12 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 field_i("      ", "billed_runs", pp->billed_runs);
                 field_i("      ", "samples", pp->samples);
                 field_i("      ", "num_allocs", pp->num_allocs);
+                field_i("      ", "num_pooled_allocs", pp->num_pooled_allocs);
                 field_u64("      ", "time_ns", pp->time);
                 field_u64("      ", "memory_current", pp->memory_current);
                 field_u64("      ", "memory_peak", pp->memory_peak);
                 field_u64("      ", "memory_total", pp->memory_total);
+                field_u64("      ", "memory_pooled", pp->memory_pooled);
                 field_u64("      ", "active_threads_numerator", pp->active_threads_numerator);
                 field_u64("      ", "active_threads_denominator", pp->active_threads_denominator);
                 field_u64("      ", "native_vector_bytes", pp->native_vector_bytes);
@@ -1682,7 +1833,13 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                     field_u64("          ", "scalar_stores", fs->scalar_stores);
                     field_u64("          ", "vector_stores", fs->vector_stores);
                     field_u64("          ", "scatters", fs->scatters);
-                    field_u64("          ", "bytes_stored", fs->bytes_stored, true);
+                    field_u64("          ", "bytes_stored", fs->bytes_stored);
+                    field_u64("          ", "cycles", fs->cycles);
+                    field_u64("          ", "instructions", fs->instructions);
+                    field_u64("          ", "cache_references", fs->cache_references);
+                    field_u64("          ", "cache_misses", fs->cache_misses);
+                    field_u64("          ", "branches", fs->branches);
+                    field_u64("          ", "branch_misses", fs->branch_misses, true);
                     json << "        }";
 
                     // Flush periodically so we don't overflow the buffer for
@@ -1694,7 +1851,14 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 json << "\n      ]\n";
                 json << "    }";
             }
-            json << (first_pipeline ? "" : "\n") << "  ]\n}\n";
+            json << (first_pipeline ? "" : "\n") << "  ],\n";
+            json << "  \"host_allocation_pool\": {\n";
+            field_u64("    ", "allocations", pool_stats.allocations);
+            field_u64("    ", "bytes_allocated", pool_stats.bytes_allocated);
+            field_u64("    ", "reuses", pool_stats.reuses);
+            field_u64("    ", "bytes_reused", pool_stats.bytes_reused);
+            field_u64("    ", "cached_bytes", (uint64_t)pool_stats.cached_bytes, true);
+            json << "  }\n}\n";
             flush();
             fclose(f);
         }
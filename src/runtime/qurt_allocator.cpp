@@ -118,3 +118,28 @@ WEAK void halide_free(void *user_context, void *ptr) {
     halide_default_free(user_context, ptr);
 }
 }
+
+extern "C" {
+
+// The pool of pre-allocated buffers above is always in use on Hexagon, so
+// there is no host allocation pool to configure.
+WEAK int halide_reuse_host_allocations(void *user_context, bool flag) {
+    return halide_error_code_success;
+}
+
+WEAK int halide_release_unused_host_allocations(void *user_context) {
+    return halide_error_code_success;
+}
+
+WEAK int64_t halide_host_allocation_pool_set_limit(int64_t size) {
+    return 0;
+}
+
+WEAK void halide_host_allocation_pool_get_stats(struct halide_host_allocation_pool_stats_t *stats) {
+    *stats = halide_host_allocation_pool_stats_t{};
+}
+
+WEAK uint64_t halide_host_allocation_pool_reused_bytes(void *ptr) {
+    return 0;
+}
+}
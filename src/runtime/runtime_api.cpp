@@ -24,6 +24,8 @@ extern "C" void halide_unused_force_include_types();
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_buffer_copy,
     (void *)&halide_buffer_to_string,
+    (void *)&halide_call_argv_async,
+    (void *)&halide_call_argv_batch,
     (void *)&halide_can_use_target_features,
     (void *)&halide_cond_broadcast,
     (void *)&halide_cond_signal,
@@ -85,6 +87,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_error_param_too_small_i64,
     (void *)&halide_error_param_too_small_u64,
     (void *)&halide_error_requirement_failed,
+    (void *)&halide_error_scratch_too_small,
+    (void *)&halide_error_scratch_unaligned,
     (void *)&halide_error_specialize_fail,
     (void *)&halide_error_split_factor_not_positive,
     (void *)&halide_error_unaligned_host_ptr,
@@ -99,6 +103,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_get_gpu_device,
     (void *)&halide_get_library_symbol,
     (void *)&halide_get_num_threads,
+    (void *)&halide_get_numa_node_count,
     (void *)&halide_get_symbol,
     (void *)&halide_get_trace_file,
     (void *)&halide_hexagon_detach_device_handle,
@@ -117,14 +122,19 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_hexagon_set_performance_mode,
     (void *)&halide_hexagon_set_thread_priority,
     (void *)&halide_hexagon_wrap_device_handle,
+    (void *)&halide_host_allocation_pool_get_stats,
+    (void *)&halide_host_allocation_pool_set_limit,
     (void *)&halide_int64_to_string,
     (void *)&halide_join_thread,
     (void *)&halide_load_library,
     (void *)&halide_malloc,
     (void *)&halide_memoization_cache_cleanup,
     (void *)&halide_memoization_cache_evict,
+    (void *)&halide_memoization_cache_get_stats,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
+    (void *)&halide_memoization_cache_reset_stats,
+    (void *)&halide_memoization_cache_set_policy,
     (void *)&halide_memoization_cache_set_size,
     (void *)&halide_memoization_cache_store,
     (void *)&halide_metal_acquire_context,
@@ -148,6 +158,9 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_mutex_array_destroy,
     (void *)&halide_mutex_array_lock,
     (void *)&halide_mutex_array_unlock,
+    (void *)&halide_numa_free,
+    (void *)&halide_numa_malloc,
+    (void *)&halide_numa_pin_current_thread,
     (void *)&halide_opencl_detach_cl_mem,
     (void *)&halide_opencl_device_interface,
     (void *)&halide_opencl_get_cl_mem,
@@ -179,6 +192,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
     (void *)&halide_release_jit_module,
+    (void *)&halide_release_unused_host_allocations,
+    (void *)&halide_reuse_host_allocations,
     (void *)&halide_semaphore_init,
     (void *)&halide_semaphore_release,
     (void *)&halide_semaphore_try_acquire,
@@ -196,6 +211,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
     (void *)&halide_set_num_threads,
+    (void *)&halide_set_numa_policy,
+    (void *)&halide_set_thread_pool_scheduler,
     (void *)&halide_set_trace_file,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
@@ -208,6 +225,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_trace_helper,
     (void *)&halide_uint64_to_string,
     (void *)&halide_use_jit_module,
+    (void *)&halide_write_trace_ring,
     (void *)&halide_d3d12compute_acquire_context,
     (void *)&halide_d3d12compute_device_interface,
     (void *)&halide_d3d12compute_initialize_kernels,
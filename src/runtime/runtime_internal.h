@@ -166,7 +166,8 @@ WEAK void halide_profiler_stack_peak_update(void *user_context,
 WEAK void halide_profiler_memory_allocate(void *user_context,
                                           halide_profiler_instance_state *instance,
                                           int func_id,
-                                          uint64_t incr);
+                                          uint64_t incr,
+                                          void *ptr);
 WEAK void halide_profiler_memory_free(void *user_context,
                                       halide_profiler_instance_state *instance,
                                       int func_id,
@@ -191,6 +192,14 @@ WEAK void halide_enable_timer_interrupt();
 
 WEAK int halide_host_cpu_count();
 
+// NUMA topology and thread placement, provided by linux_numa.cpp or
+// fake_numa.cpp. Nodes are numbered from zero. Pinning to a negative node
+// unpins the thread. halide_numa_current_node returns the node the calling
+// thread's affinity mask is confined to, or -1 if it may run on several.
+WEAK int halide_host_numa_node_count();
+WEAK int halide_numa_pin_current_thread(int node);
+WEAK int halide_numa_current_node();
+
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
 WEAK int halide_device_and_host_free(void *user_context, struct halide_buffer_t *buf);
@@ -214,6 +223,12 @@ struct halide_pseudostack_slot_t {
 WEAK void halide_use_jit_module();
 WEAK void halide_release_jit_module();
 
+// If ptr came from halide_malloc, and reused memory held by the host
+// allocation pool, the size of the block. Zero otherwise, and for any
+// later call with the same allocation. Never reads memory at ptr unless
+// the pool handed it out.
+WEAK uint64_t halide_host_allocation_pool_reused_bytes(void *ptr);
+
 // These are all intended to be inlined into other pieces of runtime code;
 // they are not intended to be called or replaced by user code.
 WEAK_INLINE int halide_internal_malloc_alignment();
@@ -87,6 +87,11 @@ struct work {
     int next_semaphore;
     // which condition variable is the owner sleeping on. nullptr if it isn't sleeping.
     bool owner_is_sleeping;
+    // The NUMA node whose workers should prefer this job, or -1 for any.
+    int numa_node;
+    // True if no thread owns this job and waits for it to finish. The
+    // last worker to finish with it frees it instead.
+    bool detached;
 
     ALWAYS_INLINE bool make_runnable() {
         for (; next_semaphore < task.num_semaphores; next_semaphore++) {
@@ -109,6 +114,43 @@ struct work {
     }
 };
 
+// A pipeline run by halide_call_argv_async. Its job is the first member,
+// so that freeing the job frees the whole call.
+struct async_call {
+    work job;
+    int (*argv_fn)(void **);
+    void **args;
+    halide_async_call_done_t done;
+    void *closure;
+};
+
+WEAK int async_call_task(void *user_context, int idx, uint8_t *closure) {
+    async_call *call = (async_call *)closure;
+    int exit_status = call->argv_fn(call->args);
+    call->done(user_context, exit_status, call->closure);
+    // The exit status has been passed on, and there are no sibling jobs
+    // to cancel.
+    return halide_error_code_success;
+}
+
+// A batch of calls run by halide_call_argv_batch.
+struct batch_call {
+    int (*argv_fn)(void **);
+    void **const *args;
+    int *exit_statuses;
+};
+
+WEAK int batch_call_task(void *user_context, int idx, uint8_t *closure) {
+    batch_call *batch = (batch_call *)closure;
+    int exit_status = batch->argv_fn(batch->args[idx]);
+    if (batch->exit_statuses) {
+        batch->exit_statuses[idx] = exit_status;
+        // Carry on with the rest of the batch.
+        return halide_error_code_success;
+    }
+    return exit_status;
+}
+
 ALWAYS_INLINE int clamp_num_threads(int threads) {
     if (threads > MAX_THREADS) {
         return MAX_THREADS;
@@ -219,6 +261,583 @@ struct work_queue_t {
 
 WEAK work_queue_t work_queue = {};
 
+// The NUMA placement policy (see halide_numa_policy_t). Only written with
+// work_queue.mutex held. Unlike the work queue, this survives
+// halide_shutdown_thread_pool.
+struct numa_state_t {
+    // Whether HL_NUMA_POLICY has been consulted.
+    int initialized;
+
+    int policy;
+
+    // Bumped whenever the policy changes. Workers compare it against the
+    // value when they last pinned themselves.
+    int generation;
+
+    int num_nodes;
+};
+
+WEAK numa_state_t numa_state = {};
+
+ALWAYS_INLINE bool numa_initialized() {
+    int initialized;
+    Synchronization::atomic_load_acquire(&numa_state.initialized, &initialized);
+    return initialized != 0;
+}
+
+ALWAYS_INLINE int numa_policy() {
+    int policy;
+    Synchronization::atomic_load_relaxed(&numa_state.policy, &policy);
+    return policy;
+}
+
+WEAK void numa_initialize_already_locked() {
+    if (!numa_state.initialized) {
+        numa_state.num_nodes = halide_host_numa_node_count();
+        if (numa_state.num_nodes < 1) {
+            numa_state.num_nodes = 1;
+        }
+        const char *s = getenv("HL_NUMA_POLICY");
+        if (s && strncmp(s, "node_local", 11) == 0) {
+            int policy = halide_numa_policy_node_local;
+            Synchronization::atomic_store_relaxed(&numa_state.policy, &policy);
+            numa_state.generation++;
+        }
+        int initialized = 1;
+        Synchronization::atomic_store_release(&numa_state.initialized, &initialized);
+    }
+}
+
+// The node a worker is pinned to under the node_local policy. The thread
+// that calls into the pipeline gets the first share of a parallel loop, so
+// the workers start at node one, to balance the nodes when the thread count
+// is not a multiple of the node count.
+ALWAYS_INLINE int numa_worker_node(int worker_index) {
+    return (worker_index + 1) % numa_state.num_nodes;
+}
+
+// The work-stealing scheduler for halide_do_par_for (see
+// halide_thread_pool_scheduler_t). Each parallel loop becomes a ws_job owned
+// by the calling thread. Every thread that runs part of a work-stolen loop
+// has a bounded Chase-Lev deque of ranges of its iterations, found by thread
+// id. While running a range, a thread splits the back half of what remains
+// of it off onto its deque whenever fewer than WS_SPLIT_THRESHOLD ranges of
+// the loop it is running are there waiting to be stolen. Ranges are thus
+// split lazily, only as fast as thieves take them. Idle threads steal from
+// the top of deques picked at random.
+//
+// A nested parallel loop (or stolen work run by a thread waiting for its
+// own loop to finish) pushes onto the same deque as the loops it is nested
+// in, above their ranges, and only ever pops its own ranges back off. Worker
+// threads keep their deque until the thread pool is shut down. Other
+// threads give theirs back when their outermost work-stolen loop returns.
+//
+// None of this touches work_queue.mutex except to spawn threads, and to
+// sleep and wake. Parallel loop jobs never have semaphores or a nonzero
+// min_threads, so they take no part in the threads_reserved accounting.
+
+// The capacity of each deque. Must be a power of two. If a deque fills up
+// (which takes loops nested WS_DEQUE_SIZE / WS_SPLIT_THRESHOLD deep), its
+// owner runs ranges without splitting them further.
+constexpr int WS_DEQUE_SIZE = 64;
+
+// The number of ranges of the loop it is running that a thread keeps on its
+// deque for thieves. More than one lets several idle threads start on a
+// newly-started loop at once.
+constexpr int WS_SPLIT_THRESHOLD = 4;
+
+// Enough deques for every worker thread, with headroom for other threads
+// calling halide_do_par_for. If they run out, loops fall back to the shared
+// queue, and thieves run stolen ranges without splitting them.
+constexpr int WS_NUM_DEQUES = MAX_THREADS + 64;
+
+// Values of ws_deque::owner other than the key of a thread.
+constexpr uintptr_t WS_DEQUE_NEVER_OWNED = 0;
+constexpr uintptr_t WS_DEQUE_RELEASED = 1;
+
+struct ws_job {
+    halide_task_t fn;
+    uint8_t *closure;
+    void *user_context;
+
+    // The number of iterations not yet completed. The owner returns (and
+    // this object goes out of scope) as soon as this reaches zero, so a
+    // thread must not touch the job after decrementing it.
+    int remaining;
+
+    // The first error returned by any iteration.
+    int exit_status;
+};
+
+struct ws_range {
+    ws_job *job;
+    int min, extent;
+};
+
+struct ws_deque {
+    // The ws_thread_key of the thread this deque belongs to, or one of the
+    // values above. Only the owner may push and pop at the bottom. Anyone
+    // may steal from the top at any time.
+    uintptr_t owner;
+
+    // The number of calls to ws_acquire_deque by the owner not yet matched
+    // by a call to ws_release_deque. Only accessed by the owner.
+    int depth;
+
+    // Set if the owner is a worker thread, which keeps the deque even while
+    // depth is zero. Only accessed by the owner.
+    bool pinned;
+
+    // The state of the owner's generator of random victims. Only accessed
+    // by the owner.
+    uint32_t rng;
+
+    // Monotonically increasing indices, compared via their signed
+    // difference so wraparound is harmless.
+    uintptr_t top, bottom;
+
+    // Each field of a slot is accessed atomically, but a slot as a whole is
+    // not. A thief's read of a slot is only used if its subsequent CAS on top
+    // succeeds, which guarantees the owner did not overwrite the slot in the
+    // meantime.
+    ws_range slots[WS_DEQUE_SIZE];
+};
+
+struct work_stealing_state_t {
+    // Whether HL_THREAD_POOL_SCHEDULER has been consulted. Only written with
+    // work_queue.mutex held.
+    int initialized;
+
+    // The scheduler new calls to halide_do_par_for should use.
+    int enabled;
+
+    // WS_NUM_DEQUES deques, allocated the first time a loop is scheduled
+    // by work stealing. Published with release semantics.
+    ws_deque *deques;
+
+    // One more than the highest index of any deque ever claimed. Threads
+    // only look for their own deque, and for victims, below this.
+    int num_deques_used;
+
+    // The number of threads that have announced they are about to sleep on
+    // one of the work queue condition variables. Anyone who makes new work
+    // stealable, or finishes a job, must check this afterwards and wake the
+    // sleepers if it is nonzero.
+    int sleepers;
+
+    // Nonzero while some thread that made work stealable is on its way to
+    // wake the sleepers. Others that push in the meantime can leave the
+    // wakeup to it. Cleared with work_queue.mutex held, just before the
+    // wakeup.
+    int wake_pending;
+};
+
+WEAK work_stealing_state_t ws_state = {};
+
+ALWAYS_INLINE bool ws_enabled() {
+    int enabled;
+    Synchronization::atomic_load_relaxed(&ws_state.enabled, &enabled);
+    return enabled != 0;
+}
+
+ALWAYS_INLINE bool ws_initialized() {
+    int initialized;
+    Synchronization::atomic_load_acquire(&ws_state.initialized, &initialized);
+    return initialized != 0;
+}
+
+ALWAYS_INLINE ws_deque *ws_deques() {
+    ws_deque *deques;
+    Synchronization::atomic_load_acquire(&ws_state.deques, &deques);
+    return deques;
+}
+
+// Called with work_queue.mutex held.
+WEAK void ws_initialize_already_locked() {
+    if (!ws_state.initialized) {
+        const char *s = getenv("HL_THREAD_POOL_SCHEDULER");
+        if (s && strncmp(s, "work_stealing", 14) == 0) {
+            int enabled = 1;
+            Synchronization::atomic_store_relaxed(&ws_state.enabled, &enabled);
+        }
+        int initialized = 1;
+        Synchronization::atomic_store_release(&ws_state.initialized, &initialized);
+    }
+    if (ws_state.enabled && !ws_state.deques) {
+        ws_deque *deques = (ws_deque *)malloc(sizeof(ws_deque) * WS_NUM_DEQUES);
+        if (deques) {
+            memset(deques, 0, sizeof(ws_deque) * WS_NUM_DEQUES);
+            Synchronization::atomic_store_release(&ws_state.deques, &deques);
+        } else {
+            // Can't allocate the deques, so stay on the shared queue.
+            int enabled = 0;
+            Synchronization::atomic_store_relaxed(&ws_state.enabled, &enabled);
+        }
+    }
+}
+
+ALWAYS_INLINE void ws_store_slot(ws_range *slot, const ws_range &r) {
+    ws_job *job = r.job;
+    int min = r.min, extent = r.extent;
+    Synchronization::atomic_store_relaxed(&slot->job, &job);
+    Synchronization::atomic_store_relaxed(&slot->min, &min);
+    Synchronization::atomic_store_relaxed(&slot->extent, &extent);
+}
+
+ALWAYS_INLINE void ws_load_slot(ws_range *slot, ws_range *r) {
+    Synchronization::atomic_load_relaxed(&slot->job, &r->job);
+    Synchronization::atomic_load_relaxed(&slot->min, &r->min);
+    Synchronization::atomic_load_relaxed(&slot->extent, &r->extent);
+}
+
+// Push onto the bottom. Only the owner may call this. Returns false if the
+// deque is full.
+WEAK bool ws_push(ws_deque *d, const ws_range &r) {
+    uintptr_t b, t;
+    Synchronization::atomic_load_relaxed(&d->bottom, &b);
+    Synchronization::atomic_load_acquire(&d->top, &t);
+    if ((intptr_t)(b - t) >= WS_DEQUE_SIZE) {
+        return false;
+    }
+    ws_store_slot(&d->slots[b % WS_DEQUE_SIZE], r);
+    uintptr_t new_b = b + 1;
+    Synchronization::atomic_store_release(&d->bottom, &new_b);
+    return true;
+}
+
+// Pop from the bottom, but only a range pushed at or above index base.
+// Only the owner may call this.
+WEAK bool ws_pop(ws_deque *d, uintptr_t base, ws_range *r) {
+    uintptr_t b;
+    Synchronization::atomic_load_relaxed(&d->bottom, &b);
+    if ((intptr_t)(b - base) <= 0) {
+        return false;
+    }
+    b--;
+    Synchronization::atomic_store_relaxed(&d->bottom, &b);
+    Synchronization::atomic_thread_fence_sequentially_consistent();
+    uintptr_t t;
+    Synchronization::atomic_load_relaxed(&d->top, &t);
+    bool result = false;
+    if ((intptr_t)(b - t) >= 0) {
+        ws_load_slot(&d->slots[b % WS_DEQUE_SIZE], r);
+        result = true;
+        if (b == t) {
+            // Last element: race any thieves for it.
+            uintptr_t new_t = t + 1;
+            result = Synchronization::atomic_cas_strong_sequentially_consistent(&d->top, &t, &new_t);
+            b++;
+            Synchronization::atomic_store_relaxed(&d->bottom, &b);
+        }
+    } else {
+        b++;
+        Synchronization::atomic_store_relaxed(&d->bottom, &b);
+    }
+    return result;
+}
+
+// Steal from the top. Anyone may call this.
+WEAK bool ws_steal(ws_deque *d, ws_range *r) {
+    uintptr_t t, b;
+    Synchronization::atomic_load_acquire(&d->top, &t);
+    Synchronization::atomic_thread_fence_sequentially_consistent();
+    Synchronization::atomic_load_acquire(&d->bottom, &b);
+    if ((intptr_t)(b - t) <= 0) {
+        return false;
+    }
+    ws_load_slot(&d->slots[t % WS_DEQUE_SIZE], r);
+    uintptr_t new_t = t + 1;
+    return Synchronization::atomic_cas_strong_sequentially_consistent(&d->top, &t, &new_t);
+}
+
+ALWAYS_INLINE bool ws_has_work(ws_deque *d) {
+    uintptr_t t, b;
+    Synchronization::atomic_load_acquire(&d->top, &t);
+    Synchronization::atomic_load_acquire(&d->bottom, &b);
+    return (intptr_t)(b - t) > 0;
+}
+
+// The number of ranges pushed at or above index base that have been
+// neither popped nor stolen. Only the owner may call this.
+ALWAYS_INLINE int ws_stealable_since(ws_deque *d, uintptr_t base) {
+    uintptr_t t, b;
+    Synchronization::atomic_load_acquire(&d->top, &t);
+    Synchronization::atomic_load_relaxed(&d->bottom, &b);
+    if ((intptr_t)(t - base) > 0) {
+        base = t;
+    }
+    return (int)(intptr_t)(b - base);
+}
+
+ALWAYS_INLINE uintptr_t ws_bottom(ws_deque *d) {
+    uintptr_t b;
+    Synchronization::atomic_load_relaxed(&d->bottom, &b);
+    return b;
+}
+
+ALWAYS_INLINE int ws_num_deques_used() {
+    int n;
+    Synchronization::atomic_load_acquire(&ws_state.num_deques_used, &n);
+    return n;
+}
+
+// Identifies the calling thread in ws_deque::owner.
+ALWAYS_INLINE uintptr_t ws_thread_key() {
+    return (uintptr_t)(uint32_t)halide_current_thread_id() + 2;
+}
+
+// A nonzero seed for ws_random, different for each thread.
+ALWAYS_INLINE uint32_t ws_random_seed() {
+    return ((uint32_t)ws_thread_key() * 2654435761u) | 1;
+}
+
+// xorshift32. The state must be nonzero.
+ALWAYS_INLINE uint32_t ws_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Find the calling thread's deque, or claim the first free one if it has
+// none. Worker threads pass pin = true to keep it until shutdown. Each
+// successful call must be matched by a call to ws_release_deque. Returns
+// nullptr if they are all taken.
+WEAK ws_deque *ws_acquire_deque(bool pin) {
+    ws_deque *deques = ws_deques();
+    if (!deques) {
+        return nullptr;
+    }
+    const uintptr_t key = ws_thread_key();
+    while (true) {
+        const int n = ws_num_deques_used();
+        int free_index = -1;
+        uintptr_t free_owner = WS_DEQUE_NEVER_OWNED;
+        for (int i = 0; i < n; i++) {
+            uintptr_t owner;
+            Synchronization::atomic_load_relaxed(&deques[i].owner, &owner);
+            if (owner == key) {
+                deques[i].depth++;
+                deques[i].pinned |= pin;
+                return &deques[i];
+            } else if (owner == WS_DEQUE_RELEASED && free_index < 0) {
+                free_index = i;
+                free_owner = owner;
+            }
+        }
+        if (free_index < 0) {
+            if (n == WS_NUM_DEQUES) {
+                return nullptr;
+            }
+            free_index = n;
+        }
+        ws_deque *d = &deques[free_index];
+        uintptr_t desired = key;
+        if (Synchronization::atomic_cas_strong_sequentially_consistent(&d->owner, &free_owner, &desired)) {
+            d->depth = 1;
+            d->pinned = pin;
+            d->rng = ws_random_seed();
+            int used = n;
+            int new_used = free_index + 1;
+            while (used < new_used &&
+                   !Synchronization::atomic_cas_weak_relacq_relaxed(&ws_state.num_deques_used, &used, &new_used)) {
+            }
+            return d;
+        }
+        // Someone else claimed it first. Look again.
+    }
+}
+
+// Undo a call to ws_acquire_deque, giving the deque back if the owner is
+// not a worker and is done with it. The owner must have popped, or lost to
+// thieves, every range it pushed since the matching call.
+ALWAYS_INLINE void ws_release_deque(ws_deque *d) {
+    if (--d->depth == 0 && !d->pinned) {
+        uintptr_t released = WS_DEQUE_RELEASED;
+        Synchronization::atomic_store_release(&d->owner, &released);
+    }
+}
+
+// Is there anything to steal? Used by threads deciding whether to sleep.
+WEAK bool ws_any_work() {
+    ws_deque *deques = ws_deques();
+    if (!deques) {
+        return false;
+    }
+    const int n = ws_num_deques_used();
+    for (int i = 0; i < n; i++) {
+        if (ws_has_work(&deques[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Steal a range from any deque, drawing victims from the random state
+// rng. If a few random victims have nothing, try every deque in turn from
+// a random one. Only returns false if every deque was observed to be
+// empty.
+WEAK bool ws_steal_any(uint32_t *rng, ws_range *r) {
+    ws_deque *deques = ws_deques();
+    if (!deques) {
+        return false;
+    }
+    while (true) {
+        const int n = ws_num_deques_used();
+        if (n == 0) {
+            return false;
+        }
+        for (int j = 0; j < 4 && j < n; j++) {
+            ws_deque *d = &deques[ws_random(rng) % (uint32_t)n];
+            if (ws_has_work(d) && ws_steal(d, r)) {
+                return true;
+            }
+        }
+        bool saw_work = false;
+        const int start = (int)(ws_random(rng) % (uint32_t)n);
+        for (int j = 0; j < n; j++) {
+            ws_deque *d = &deques[(start + j) % n];
+            if (ws_has_work(d)) {
+                saw_work = true;
+                if (ws_steal(d, r)) {
+                    return true;
+                }
+            }
+        }
+        if (!saw_work) {
+            return false;
+        }
+    }
+}
+
+// Called after making work stealable. Any thread that is asleep, or has
+// announced it is about to sleep, may have decided there was nothing to
+// steal before we pushed, so wake everyone. The sleeping thread increments
+// ws_state.sleepers before its final check for work, so between that and
+// the fence here, at least one of us sees the other.
+//
+// Only one pusher at a time takes the mutex to do this. A sleeper holds the
+// mutex from its final check for work until it waits, and the pusher that
+// set ws_state.wake_pending clears it and wakes everyone under the mutex,
+// so any push that saw the flag set is followed by a wakeup that no sleeper
+// can miss. The A/B team sizing is left alone: a B team worker that wakes
+// finds the stealable work before it goes back to sleep.
+WEAK void ws_wake_idle() {
+    Synchronization::atomic_thread_fence_sequentially_consistent();
+    int sleepers;
+    Synchronization::atomic_load_relaxed(&ws_state.sleepers, &sleepers);
+    int expected = 0, desired = 1;
+    if (sleepers > 0 &&
+        Synchronization::atomic_cas_strong_sequentially_consistent(&ws_state.wake_pending, &expected, &desired)) {
+        halide_mutex_lock(&work_queue.mutex);
+        int zero = 0;
+        Synchronization::atomic_store_sequentially_consistent(&ws_state.wake_pending, &zero);
+        work_queue.wake_a_team.broadcast();
+        work_queue.wake_b_team.broadcast();
+        work_queue.wake_owners.broadcast();
+        work_queue.wake_from_semaphore.broadcast();
+        halide_mutex_unlock(&work_queue.mutex);
+    }
+}
+
+// Execute a range of a job. If we have a deque, split the back half of what
+// remains off onto it whenever fewer than WS_SPLIT_THRESHOLD of the ranges
+// we pushed since index base are waiting there for thieves. Once the range
+// is done, keep popping those ranges until there are none left.
+WEAK void ws_run(ws_deque *d, uintptr_t base, ws_range r) {
+    while (true) {
+        ws_job *job = r.job;
+        int done = 0;
+        while (done < r.extent) {
+            int left = r.extent - done;
+            if (d && left > 1 && ws_stealable_since(d, base) < WS_SPLIT_THRESHOLD) {
+                int half = left / 2;
+                ws_range back = {job, r.min + r.extent - half, half};
+                if (ws_push(d, back)) {
+                    r.extent -= half;
+                    ws_wake_idle();
+                    continue;
+                }
+            }
+            int result = halide_do_task(job->user_context, job->fn, r.min + done, job->closure);
+            if (result != halide_error_code_success) {
+                log_message("Saw thread pool saw error from task: " << result);
+                int expected = halide_error_code_success;
+                Synchronization::atomic_cas_strong_sequentially_consistent(&job->exit_status, &expected, &result);
+            }
+            done++;
+        }
+
+        if (Synchronization::atomic_sub_fetch_sequentially_consistent(&job->remaining, done) == 0) {
+            // The job is complete, and its owner may return at any moment, so
+            // don't touch it again. The owner announces its intent to sleep
+            // just like an idle worker.
+            Synchronization::atomic_thread_fence_sequentially_consistent();
+            int sleepers;
+            Synchronization::atomic_load_relaxed(&ws_state.sleepers, &sleepers);
+            if (sleepers > 0) {
+                halide_mutex_lock(&work_queue.mutex);
+                work_queue.wake_owners.broadcast();
+                halide_mutex_unlock(&work_queue.mutex);
+            }
+        }
+
+        if (!d || !ws_pop(d, base, &r)) {
+            return;
+        }
+    }
+}
+
+// Run stolen work until there is none left. Worker threads pass pin = true
+// to keep their deque. Called without work_queue.mutex held.
+WEAK void ws_help(bool pin) {
+    // This may return nullptr, in which case we run stolen ranges without
+    // splitting them further.
+    ws_deque *d = ws_acquire_deque(pin);
+    uint32_t local_rng = ws_random_seed();
+    uint32_t *rng = d ? &d->rng : &local_rng;
+    const uintptr_t base = d ? ws_bottom(d) : 0;
+    ws_range r;
+    while (ws_steal_any(rng, &r)) {
+        ws_run(d, base, r);
+    }
+    if (d) {
+        ws_release_deque(d);
+    }
+}
+
+ALWAYS_INLINE bool ws_job_running(ws_job *job) {
+    int remaining;
+    Synchronization::atomic_load_acquire(&job->remaining, &remaining);
+    return remaining != 0;
+}
+
+// Called with work_queue.mutex held, by a thread that found nothing to run
+// on the shared queue. Returns true if the thread helped with stolen work
+// instead of sleeping, or if the work-stolen loop it owns (if any) has
+// finished, in which case the caller should look again. Otherwise the
+// thread has announced it is about to sleep, and must decrement
+// ws_state.sleepers once it wakes.
+WEAK bool ws_help_or_prepare_to_sleep(ws_job *owned_ws_job, bool is_worker) {
+    Synchronization::atomic_fetch_add_sequentially_consistent(&ws_state.sleepers, 1);
+    Synchronization::atomic_thread_fence_sequentially_consistent();
+    // Whoever finished the last range of our loop may have looked for
+    // sleepers before we announced ourselves, so check it again.
+    const bool owned_ws_job_done = owned_ws_job && !ws_job_running(owned_ws_job);
+    if (owned_ws_job_done || ws_any_work()) {
+        Synchronization::atomic_fetch_sub_sequentially_consistent(&ws_state.sleepers, 1);
+        if (!owned_ws_job_done) {
+            halide_mutex_unlock(&work_queue.mutex);
+            ws_help(is_worker);
+            halide_mutex_lock(&work_queue.mutex);
+        }
+        return true;
+    }
+    return false;
+}
+
 #if EXTENDED_DEBUG
 
 WEAK void print_job(work *job, const char *indent, const char *prefix = nullptr) {
@@ -262,6 +881,14 @@ WEAK void worker_thread_stall(work *owned_job) {
     work_queue.owners_sleeping--;
 }
 
+// Like worker_thread_stall, for a thread waiting for the rest of a
+// work-stolen parallel loop it owns.
+WEAK void worker_thread_stall_on_ws_job() {
+    work_queue.owners_sleeping++;
+    work_queue.wake_owners.wait(&work_queue.mutex);
+    work_queue.owners_sleeping--;
+}
+
 WEAK void worker_thread_idle() {
     work_queue.workers_sleeping++;
     if (work_queue.a_team_size > work_queue.target_a_team_size) {
@@ -286,11 +913,39 @@ WEAK void worker_thread_blocked_on_semaphore() {
     work_queue.workers_sleeping--;
 }
 
-WEAK void worker_thread_already_locked(work *owned_job) {
-    while (owned_job ? owned_job->running() : !work_queue.shutdown) {
+// worker_index is the index of the calling thread in work_queue.threads,
+// or -1 if the caller is the owner of a job rather than a worker. The owner
+// of a work-stolen parallel loop passes it as owned_ws_job, and is treated
+// like the owner of a job on the shared queue until the loop is done.
+WEAK void worker_thread_already_locked(work *owned_job, int worker_index = -1,
+                                       ws_job *owned_ws_job = nullptr) {
+    // The NUMA node this thread is pinned to, or -1, and the value of
+    // numa_state.generation when we set it.
+    int numa_node = -1, numa_generation = 0;
+
+    while (owned_job    ? owned_job->running() :
+           owned_ws_job ? ws_job_running(owned_ws_job) :
+                          !work_queue.shutdown) {
+        if (worker_index >= 0 && numa_generation != numa_state.generation) {
+            numa_generation = numa_state.generation;
+            numa_node = (numa_state.policy == halide_numa_policy_node_local &&
+                         numa_state.num_nodes > 1) ?
+                            numa_worker_node(worker_index) :
+                            -1;
+            halide_mutex_unlock(&work_queue.mutex);
+            halide_numa_pin_current_thread(numa_node);
+            halide_mutex_lock(&work_queue.mutex);
+            continue;
+        }
+
         work *job = work_queue.jobs;
         work **prev_ptr = &work_queue.jobs;
 
+        // The first job we could have run, but which is meant for another
+        // NUMA node. We only take it if there is nothing for this node.
+        work *remote_job = nullptr;
+        work **remote_prev_ptr = nullptr;
+
         // Did we pass over a job that we could otherwise run, but for an
         // unavailable semaphore? If so, a future semaphore release (not
         // just newly-enqueued work) can make us runnable.
@@ -346,7 +1001,11 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             if (!enough_threads) {
                 log_message("Not enough threads for job " << job->task.name << " available: " << threads_available << " min_threads: " << job->task.min_threads);
             }
-            bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) || job->task.min_threads == 0;
+            // A thread waiting for a job it owns doesn't take on a whole
+            // detached pipeline, which would hold up the job it owns.
+            bool can_use_this_thread_stack = (!owned_job && !owned_ws_job) ||
+                                             (owned_job && job->siblings == owned_job->siblings) ||
+                                             (job->task.min_threads == 0 && !job->detached);
             if (!can_use_this_thread_stack) {
                 log_message("Cannot run job " << job->task.name << " on this thread.");
             }
@@ -356,7 +1015,13 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             }
 
             if (enough_threads && can_use_this_thread_stack && can_add_worker) {
-                if (job->make_runnable()) {
+                if (numa_node >= 0 && job->numa_node >= 0 && job->numa_node != numa_node) {
+                    log_message("Job " << job->task.name << " is for another NUMA node.");
+                    if (!remote_job) {
+                        remote_job = job;
+                        remote_prev_ptr = prev_ptr;
+                    }
+                } else if (job->make_runnable()) {
                     break;
                 } else {
                     log_message("Cannot acquire semaphores for " << job->task.name);
@@ -367,18 +1032,32 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             job = job->next_job;
         }
 
+        if (!job && remote_job && remote_job->make_runnable()) {
+            job = remote_job;
+            prev_ptr = remote_prev_ptr;
+        }
+
         if (!job) {
-            // There is no runnable job. Go to sleep.
+            // There is no runnable job on the shared queue. If parallel loops
+            // are being work-stolen, help with those instead.
+            if (ws_help_or_prepare_to_sleep(owned_ws_job, worker_index >= 0)) {
+                continue;
+            }
+
+            // Go to sleep.
             // The "stall" and "idle" function calls are not strictly necessary
             // and could be inlined here, but having symbols for these situations
             // is very informative when profiling.
             if (owned_job) {
                 worker_thread_stall(owned_job);
+            } else if (owned_ws_job) {
+                worker_thread_stall_on_ws_job();
             } else if (blocked_on_semaphore) {
                 worker_thread_blocked_on_semaphore();
             } else {
                 worker_thread_idle();
             }
+            Synchronization::atomic_fetch_sub_sequentially_consistent(&ws_state.sleepers, 1);
             continue;
         }
 
@@ -494,6 +1173,14 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
         log_message("Done working on job " << job->task.name);
 
+        if (job->detached) {
+            // There is no owner to wake.
+            if (!job->running()) {
+                free(job);
+            }
+            continue;
+        }
+
         if (wake_owners ||
             (job->active_workers == 0 && (job->task.extent == 0 || job->exit_status != halide_error_code_success) && job->owner_is_sleeping)) {
             // The job is done or some owned job failed via sibling linkage. Wake up the owner.
@@ -503,12 +1190,19 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 }
 
 WEAK void worker_thread(void *arg) {
+    // The argument is the index of this thread in work_queue.threads.
     halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked((work *)arg);
+    worker_thread_already_locked(nullptr, (int)(intptr_t)arg);
     halide_mutex_unlock(&work_queue.mutex);
 }
 
-WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+WEAK void spawn_worker_already_locked() {
+    int index = work_queue.threads_created++;
+    work_queue.a_team_size++;
+    work_queue.threads[index] = halide_spawn_thread(worker_thread, (void *)(intptr_t)index);
+}
+
+WEAK void initialize_work_queue_already_locked() {
     if (!work_queue.initialized) {
         work_queue.assert_zeroed();
 
@@ -521,6 +1215,11 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         work_queue.desired_threads_working = clamp_num_threads(work_queue.desired_threads_working);
         work_queue.initialized = true;
     }
+    numa_initialize_already_locked();
+}
+
+WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+    initialize_work_queue_already_locked();
 
     // Gather some information about the work.
 
@@ -577,9 +1276,7 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
                 (work_queue.threads_created + 1) - work_queue.threads_reserved < min_threads)) {
             // We might need to make some new threads, if work_queue.desired_threads_working has
             // increased, or if there aren't enough threads to complete this new task.
-            work_queue.a_team_size++;
-            work_queue.threads[work_queue.threads_created++] =
-                halide_spawn_thread(worker_thread, nullptr);
+            spawn_worker_already_locked();
         }
         log_message("enqueue_work_already_locked top level job " << jobs[0].task.name << " with min_threads " << min_threads << " work_queue.threads_created " << work_queue.threads_created << " work_queue.threads_reserved " << work_queue.threads_reserved);
         if (job_has_acquires || job_may_block) {
@@ -643,6 +1340,80 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
     }
 }
 
+// Decide whether a new parallel loop should be work-stolen, and if so make
+// sure the deques and worker threads it needs exist. Only takes the lock
+// when something needs initializing.
+WEAK bool ws_prepare() {
+    if (ws_initialized() && !ws_enabled()) {
+        return false;
+    }
+
+    bool initialized;
+    int threads_created, desired_threads_working;
+    Synchronization::atomic_load_relaxed(&work_queue.initialized, &initialized);
+    Synchronization::atomic_load_relaxed(&work_queue.threads_created, &threads_created);
+    Synchronization::atomic_load_relaxed(&work_queue.desired_threads_working, &desired_threads_working);
+    if (!ws_initialized() || !ws_deques() || !initialized ||
+        (threads_created < MAX_THREADS && threads_created < desired_threads_working - 1)) {
+        halide_mutex_lock(&work_queue.mutex);
+        ws_initialize_already_locked();
+        if (ws_state.enabled) {
+            initialize_work_queue_already_locked();
+            while (work_queue.threads_created < MAX_THREADS &&
+                   work_queue.threads_created < work_queue.desired_threads_working - 1) {
+                spawn_worker_already_locked();
+            }
+        }
+        halide_mutex_unlock(&work_queue.mutex);
+    }
+    return ws_enabled() && ws_deques();
+}
+
+// Run a parallel loop using work stealing. Returns false without doing
+// anything if no deque is available, in which case the caller should use
+// the shared queue instead.
+WEAK bool ws_do_par_for(void *user_context, halide_task_t f,
+                        int min, int size, uint8_t *closure, int *exit_status) {
+    ws_deque *d = ws_acquire_deque(false);
+    if (!d) {
+        return false;
+    }
+    const uintptr_t base = ws_bottom(d);
+
+    ws_job job;
+    job.fn = f;
+    job.closure = closure;
+    job.user_context = user_context;
+    job.remaining = size;
+    job.exit_status = halide_error_code_success;
+
+    ws_run(d, base, {&job, min, size});
+
+    // None of the ranges we pushed are left on our deque, but thieves may
+    // still be running parts of this job. Help out with whatever is
+    // stealable (possibly from other jobs) until they are done.
+    ws_range r;
+    while (ws_job_running(&job) && ws_steal_any(&d->rng, &r)) {
+        ws_run(d, base, r);
+    }
+    ws_release_deque(d);
+
+    // The rest of the job is being run by other threads, which may be
+    // blocked on work in the shared queue (e.g. in a nested
+    // halide_do_parallel_tasks). Wait like the owner of a job there, which
+    // runs whatever shared jobs the threads_reserved and min_threads rules
+    // allow an owner to, rather than sleeping while holding a thread that
+    // the shared queue counts as available.
+    if (ws_job_running(&job)) {
+        halide_mutex_lock(&work_queue.mutex);
+        worker_thread_already_locked(nullptr, -1, &job);
+        halide_mutex_unlock(&work_queue.mutex);
+    }
+
+    Synchronization::atomic_load_relaxed(&job.exit_status, exit_status);
+    return true;
+}
+
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_loop_task_t custom_do_loop_task = halide_default_do_loop_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
@@ -682,30 +1453,64 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
         return halide_error_code_success;
     }
 
-    work job;
-    job.task.fn = nullptr;
-    job.task.min = min;
-    job.task.extent = size;
-    job.task.serial = false;
-    job.task.semaphores = nullptr;
-    job.task.num_semaphores = 0;
-    job.task.closure = closure;
-    job.task.min_threads = 0;
-    job.task.name = nullptr;
-    job.task_fn = f;
-    job.user_context = user_context;
-    job.exit_status = halide_error_code_success;
-    job.active_workers = 0;
-    job.next_semaphore = 0;
-    job.owner_is_sleeping = false;
-    job.siblings = &job;  // guarantees no other job points to the same siblings.
-    job.sibling_count = 0;
-    job.parent_job = nullptr;
+    int exit_status;
+    if (ws_prepare() &&
+        ws_do_par_for(user_context, f, min, size, closure, &exit_status)) {
+        return exit_status;
+    }
+
+    if (!numa_initialized()) {
+        halide_mutex_lock(&work_queue.mutex);
+        numa_initialize_already_locked();
+        halide_mutex_unlock(&work_queue.mutex);
+    }
+
+    // Under the node_local NUMA policy, a loop started from a thread that
+    // can run anywhere is divided into one contiguous range per node, and a
+    // loop started from a thread confined to one node prefers that node.
+    int num_jobs = 1, home_node = -1;
+    if (numa_policy() == halide_numa_policy_node_local && numa_state.num_nodes > 1) {
+        home_node = halide_numa_current_node();
+        if (home_node < 0) {
+            num_jobs = size < numa_state.num_nodes ? size : numa_state.num_nodes;
+        }
+    }
+
+    work *jobs = (work *)__builtin_alloca(sizeof(work) * num_jobs);
+    for (int i = 0; i < num_jobs; i++) {
+        const int begin = (int)(((int64_t)size * i) / num_jobs);
+        const int end = (int)(((int64_t)size * (i + 1)) / num_jobs);
+        work &job = jobs[i];
+        job.task.fn = nullptr;
+        job.task.min = min + begin;
+        job.task.extent = end - begin;
+        job.task.serial = false;
+        job.task.semaphores = nullptr;
+        job.task.num_semaphores = 0;
+        job.task.closure = closure;
+        job.task.min_threads = 0;
+        job.task.name = nullptr;
+        job.task_fn = f;
+        job.user_context = user_context;
+        job.exit_status = halide_error_code_success;
+        job.active_workers = 0;
+        job.next_semaphore = 0;
+        job.owner_is_sleeping = false;
+        job.parent_job = nullptr;
+        job.numa_node = num_jobs > 1 ? i : home_node;
+        job.detached = false;
+    }
     halide_mutex_lock(&work_queue.mutex);
-    enqueue_work_already_locked(1, &job, nullptr);
-    worker_thread_already_locked(&job);
+    enqueue_work_already_locked(num_jobs, jobs, nullptr);
+    exit_status = halide_error_code_success;
+    for (int i = 0; i < num_jobs; i++) {
+        worker_thread_already_locked(jobs + i);
+        if (jobs[i].exit_status != halide_error_code_success) {
+            exit_status = jobs[i].exit_status;
+        }
+    }
     halide_mutex_unlock(&work_queue.mutex);
-    return job.exit_status;
+    return exit_status;
 }
 
 WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
@@ -727,6 +1532,8 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
         jobs[i].next_semaphore = 0;
         jobs[i].owner_is_sleeping = false;
         jobs[i].parent_job = (work *)task_parent;
+        jobs[i].numa_node = -1;
+        jobs[i].detached = false;
     }
 
     if (num_tasks == 0) {
@@ -748,6 +1555,73 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
     return exit_status;
 }
 
+WEAK int halide_call_argv_async(void *user_context, int (*argv_fn)(void **), void **args,
+                                halide_async_call_done_t done, void *closure) {
+    async_call *call = (async_call *)malloc(sizeof(async_call));
+    if (call == nullptr) {
+        return halide_error_code_out_of_memory;
+    }
+    call->argv_fn = argv_fn;
+    call->args = args;
+    call->done = done;
+    call->closure = closure;
+
+    work &job = call->job;
+    job.task.fn = nullptr;
+    job.task.min = 0;
+    job.task.extent = 1;
+    job.task.serial = false;
+    job.task.semaphores = nullptr;
+    job.task.num_semaphores = 0;
+    job.task.closure = (uint8_t *)call;
+    job.task.min_threads = 0;
+    job.task.name = "halide_call_argv_async";
+    job.task_fn = async_call_task;
+    job.user_context = user_context;
+    job.exit_status = halide_error_code_success;
+    job.active_workers = 0;
+    job.next_semaphore = 0;
+    job.owner_is_sleeping = false;
+    job.parent_job = nullptr;
+    job.numa_node = -1;
+    job.detached = true;
+
+    halide_mutex_lock(&work_queue.mutex);
+    initialize_work_queue_already_locked();
+    // This thread won't run the job, so there must be a worker that can.
+    if (work_queue.threads_created == 0) {
+        spawn_worker_already_locked();
+    }
+    enqueue_work_already_locked(1, &job, nullptr);
+    // enqueue_work_already_locked counts on the calling thread to take one
+    // of the tasks it enqueues, so make sure a worker is awake to take it.
+    if (work_queue.target_a_team_size < 1) {
+        work_queue.target_a_team_size = 1;
+        if (work_queue.a_team_size < 1) {
+            work_queue.wake_b_team.broadcast();
+        }
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    return halide_error_code_success;
+}
+
+WEAK int halide_call_argv_batch(void *user_context, int (*argv_fn)(void **), int num_calls,
+                                void **const *args, int *exit_statuses) {
+    batch_call batch;
+    batch.argv_fn = argv_fn;
+    batch.args = args;
+    batch.exit_statuses = exit_statuses;
+    int exit_status = halide_do_par_for(user_context, batch_call_task, 0, num_calls, (uint8_t *)&batch);
+    if (exit_status == halide_error_code_success && exit_statuses) {
+        for (int i = 0; i < num_calls; i++) {
+            if (exit_statuses[i] != halide_error_code_success) {
+                return exit_statuses[i];
+            }
+        }
+    }
+    return exit_status;
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(nullptr, "halide_set_num_threads: must be >= 0.");
@@ -765,6 +1639,44 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
+WEAK halide_thread_pool_scheduler_t halide_set_thread_pool_scheduler(halide_thread_pool_scheduler_t s) {
+    halide_mutex_lock(&work_queue.mutex);
+    // Consult HL_THREAD_POOL_SCHEDULER first, so that it can't later
+    // override this call.
+    ws_initialize_already_locked();
+    halide_thread_pool_scheduler_t old = ws_state.enabled ?
+                                             halide_thread_pool_scheduler_work_stealing :
+                                             halide_thread_pool_scheduler_shared_queue;
+    int enabled = (s == halide_thread_pool_scheduler_work_stealing) ? 1 : 0;
+    Synchronization::atomic_store_relaxed(&ws_state.enabled, &enabled);
+    ws_initialize_already_locked();
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK halide_numa_policy_t halide_set_numa_policy(halide_numa_policy_t policy) {
+    halide_mutex_lock(&work_queue.mutex);
+    // Consult HL_NUMA_POLICY first, so that it can't later override this
+    // call.
+    numa_initialize_already_locked();
+    halide_numa_policy_t old = (halide_numa_policy_t)numa_state.policy;
+    if (policy != old) {
+        int p = policy;
+        Synchronization::atomic_store_relaxed(&numa_state.policy, &p);
+        numa_state.generation++;
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK int halide_get_numa_node_count() {
+    halide_mutex_lock(&work_queue.mutex);
+    numa_initialize_already_locked();
+    int n = numa_state.num_nodes;
+    halide_mutex_unlock(&work_queue.mutex);
+    return n;
+}
+
 WEAK int halide_get_num_threads() {
     halide_mutex_lock(&work_queue.mutex);
     int n = work_queue.desired_threads_working;
@@ -792,6 +1704,15 @@ WEAK void halide_shutdown_thread_pool() {
 
         // Tidy up
         work_queue.reset();
+
+        // Free the work-stealing deques. They are reallocated on next use.
+        // The choice of scheduler persists.
+        ws_deque *deques = ws_state.deques;
+        ws_deque *null_deques = nullptr;
+        Synchronization::atomic_store_release(&ws_state.deques, &null_deques);
+        int zero = 0;
+        Synchronization::atomic_store_relaxed(&ws_state.num_deques_used, &zero);
+        free(deques);
     }
 }
 
@@ -169,6 +169,296 @@ WEAK ScopedSpinLock::AtomicFlag halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = nullptr;
 
+// State for the ring-buffer mode selected by HL_TRACE_RING. Each thread
+// claims a ring the first time it records an event, and from then on is
+// the only thread to record into it, so recording an event takes no locks
+// and touches no shared cache lines. The events of a ring are taken from
+// it by an atomic exchange, both to record an event and to write them
+// out, so that the rings can be written out while pipelines run. Rings
+// are given back when they are written out. Names are interned by their
+// contents in a lock-free table. The index of the name's slot is its id
+// in the output.
+const static int trace_ring_max_threads = 256;
+const static int trace_ring_max_names = 4096;
+
+// The storage of a ring: a count followed by the events themselves.
+struct TraceRingEvents {
+    // The number of events recorded. The most recent ones are at
+    // events()[(count - 1) & mask] and before.
+    uint64_t count;
+
+    ALWAYS_INLINE halide_trace_ring_event_t *events() {
+        return (halide_trace_ring_event_t *)(this + 1);
+    }
+};
+
+struct TraceRing {
+    // The thread that owns this ring, or zero if it is unclaimed. It is
+    // only set back to zero by halide_write_trace_ring while it holds
+    // the events of the ring.
+    int32_t tid;
+    // The number of ids handed out by this ring.
+    int32_t next_id;
+    // The storage of the ring, nullptr if it has none, or
+    // trace_ring_busy() while a thread holds it.
+    TraceRingEvents *events;
+};
+
+ALWAYS_INLINE TraceRingEvents *trace_ring_busy() {
+    return (TraceRingEvents *)(uintptr_t)1;
+}
+
+struct TraceRingName {
+    // A copy of the name, owned by the table, or nullptr if the slot is free.
+    char *name;
+    // The hash of the name with the low bit set, or zero if it has not
+    // been written yet.
+    uint32_t hash;
+};
+
+WEAK int halide_trace_ring_mode = -1;  // -1 indicates uninitialized
+WEAK const char *halide_trace_ring_file_name = nullptr;
+WEAK uint64_t halide_trace_ring_mask = 0;
+WEAK TraceRing halide_trace_rings[trace_ring_max_threads];
+WEAK TraceRingName halide_trace_ring_names[trace_ring_max_names];
+// Events dropped because every ring was claimed, or every name slot was
+// in use. Each is reported once through halide_print.
+WEAK uint32_t halide_trace_ring_dropped_events = 0;
+WEAK int halide_trace_ring_out_of_rings = 0;
+WEAK int halide_trace_ring_out_of_names = 0;
+// Serializes calls to halide_write_trace_ring.
+WEAK ScopedSpinLock::AtomicFlag halide_trace_ring_write_lock = 0;
+
+WEAK int trace_ring_init(void *user_context) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    ScopedSpinLock lock(&halide_trace_file_lock);
+    int mode;
+    atomic_load_relaxed(&halide_trace_ring_mode, &mode);
+    if (mode < 0) {
+        const char *file_name = getenv("HL_TRACE_RING");
+        mode = (file_name && *file_name) ? 1 : 0;
+        if (mode) {
+            const char *size_str = getenv("HL_TRACE_RING_SIZE");
+            int size = size_str ? atoi(size_str) : 0;
+            if (size <= 0) {
+                size = 65536;
+            }
+            // Round up to a power of two so that the position in the
+            // ring is a mask rather than a division.
+            uint64_t capacity = 1;
+            while (capacity < (uint64_t)size) {
+                capacity *= 2;
+            }
+            halide_trace_ring_mask = capacity - 1;
+            halide_trace_ring_file_name = file_name;
+            halide_start_clock(user_context);
+        }
+        atomic_store_release(&halide_trace_ring_mode, &mode);
+    }
+    return mode;
+}
+
+ALWAYS_INLINE bool trace_ring_enabled(void *user_context) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    int mode;
+    atomic_load_acquire(&halide_trace_ring_mode, &mode);
+    if (mode < 0) {
+        mode = trace_ring_init(user_context);
+    }
+    return mode > 0;
+}
+
+// Print a message the first time a flag is set.
+WEAK void trace_ring_report_once(void *user_context, int *flag, const char *msg) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    int expected = 0, desired = 1;
+    if (atomic_cas_strong_sequentially_consistent(flag, &expected, &desired)) {
+        halide_print(user_context, msg);
+    }
+}
+
+// The ring of the calling thread, claiming one if need be, or nullptr
+// if they have all been claimed.
+WEAK TraceRing *trace_ring_for_current_thread(void *user_context, int32_t tid) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    uint32_t h = (uint32_t)tid * 0x9e3779b9u;
+    for (int i = 0; i < trace_ring_max_threads; i++) {
+        TraceRing *r = &halide_trace_rings[(h + i) % trace_ring_max_threads];
+        int32_t owner;
+        atomic_load_acquire(&r->tid, &owner);
+        if (owner == tid) {
+            return r;
+        }
+        if (owner == 0) {
+            int32_t expected = 0;
+            if (atomic_cas_strong_sequentially_consistent(&r->tid, &expected, &tid)) {
+                return r;
+            }
+        }
+    }
+    trace_ring_report_once(user_context, &halide_trace_ring_out_of_rings,
+                           "HL_TRACE_RING: every ring has been claimed by another thread, "
+                           "so events from further threads are dropped until the rings "
+                           "are written out by halide_write_trace_ring.\n");
+    return nullptr;
+}
+
+// Take the events of a ring to write them out, waiting for the thread
+// recording into them if need be. Returns nullptr if the ring has no
+// storage.
+WEAK TraceRingEvents *trace_ring_take(TraceRing *r) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    TraceRingEvents *events;
+    atomic_load_acquire(&r->events, &events);
+    while (true) {
+        if (events == nullptr) {
+            return nullptr;
+        }
+        if (events == trace_ring_busy()) {
+            halide_thread_yield();
+            atomic_load_acquire(&r->events, &events);
+            continue;
+        }
+        TraceRingEvents *busy = trace_ring_busy();
+        if (atomic_cas_strong_sequentially_consistent(&r->events, &events, &busy)) {
+            return events;
+        }
+    }
+}
+
+// Hold the events of the calling thread's ring so as to record into them.
+// Returns false if the ring was given back by halide_write_trace_ring
+// since it was claimed, in which case the thread should claim one again.
+// Otherwise, *events is nullptr if the ring has no storage and none could
+// be allocated.
+WEAK bool trace_ring_hold(TraceRing *r, int32_t tid, TraceRingEvents **events) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    TraceRingEvents *e;
+    while ((e = atomic_exchange_acquire(&r->events, trace_ring_busy())) == trace_ring_busy()) {
+        halide_thread_yield();
+    }
+    // The owner of a ring only changes from this thread while the ring's
+    // events are held by someone else.
+    int32_t owner;
+    atomic_load_relaxed(&r->tid, &owner);
+    if (owner != tid) {
+        atomic_store_release(&r->events, &e);
+        return false;
+    }
+    if (e == nullptr) {
+        // A ring given back by halide_write_trace_ring gets its storage
+        // back once the events have been written out, but may be claimed
+        // again before then.
+        e = (TraceRingEvents *)malloc(sizeof(TraceRingEvents) + (halide_trace_ring_mask + 1) * sizeof(halide_trace_ring_event_t));
+        if (e == nullptr) {
+            atomic_store_release(&r->events, &e);
+        } else {
+            e->count = 0;
+        }
+    }
+    *events = e;
+    return true;
+}
+
+WEAK uint32_t trace_ring_intern(void *user_context, const char *name) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    // Names are compared by contents rather than by address, as the
+    // pipeline a name belongs to may be freed, and another one loaded at
+    // the same address.
+    uint32_t h = 2166136261u;
+    size_t len = 0;
+    for (; name[len]; len++) {
+        h = (h ^ (uint8_t)name[len]) * 16777619u;
+    }
+    h |= 1;
+    char *copy = nullptr;
+    for (int i = 0; i < trace_ring_max_names; i++) {
+        uint32_t index = (h + i) % trace_ring_max_names;
+        TraceRingName *n = &halide_trace_ring_names[index];
+        char *existing;
+        atomic_load_acquire(&n->name, &existing);
+        if (existing == nullptr) {
+            if (copy == nullptr) {
+                copy = (char *)malloc(len + 1);
+                if (copy == nullptr) {
+                    return 0xffffffff;
+                }
+                memcpy(copy, name, len + 1);
+            }
+            char *expected = nullptr;
+            if (atomic_cas_strong_sequentially_consistent(&n->name, &expected, &copy)) {
+                atomic_store_release(&n->hash, &h);
+                return index;
+            }
+            existing = expected;
+        }
+        // The hash may not have been written yet by the thread that
+        // claimed the slot, in which case compare the names.
+        uint32_t existing_hash;
+        atomic_load_acquire(&n->hash, &existing_hash);
+        if ((existing_hash == h || existing_hash == 0) && strcmp(existing, name) == 0) {
+            free(copy);
+            return index;
+        }
+    }
+    free(copy);
+    trace_ring_report_once(user_context, &halide_trace_ring_out_of_names,
+                           "HL_TRACE_RING: too many distinct Func and pipeline names; "
+                           "further ones are recorded as <unknown>.\n");
+    return 0xffffffff;
+}
+
+WEAK int32_t trace_ring_record(void *user_context, const halide_trace_event_t *e) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    switch (e->event) {
+    case halide_trace_begin_realization:
+    case halide_trace_end_realization:
+    case halide_trace_produce:
+    case halide_trace_end_produce:
+    case halide_trace_begin_pipeline:
+    case halide_trace_end_pipeline:
+        break;
+    default:
+        return 0;
+    }
+
+    int32_t tid = halide_current_thread_id();
+    TraceRing *r;
+    TraceRingEvents *events = nullptr;
+    while ((r = trace_ring_for_current_thread(user_context, tid)) &&
+           !trace_ring_hold(r, tid, &events)) {
+        // The ring was given back; claim one again.
+    }
+    if (!events) {
+        atomic_fetch_add_sequentially_consistent(&halide_trace_ring_dropped_events, 1);
+        return 0;
+    }
+    // Ids only need to be unique among events that are live at the same
+    // time, so each thread hands out its own, tagged with its ring.
+    int32_t id = (int32_t)((((r - halide_trace_rings) + 1) << 22) | (r->next_id++ & 0x3fffff));
+    halide_trace_ring_event_t *ev = events->events() + (events->count & halide_trace_ring_mask);
+    ev->time = (uint64_t)halide_current_time_ns(user_context);
+    ev->id = id;
+    ev->parent_id = e->parent_id;
+    ev->name = trace_ring_intern(user_context, e->func);
+    ev->event = e->event;
+    events->count++;
+    atomic_store_release(&r->events, &events);
+    return id;
+}
+
+WEAK bool trace_ring_write(int fd, const void *data, size_t size) {
+    return size == 0 || write(fd, data, size) == (ssize_t)size;
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -178,6 +468,10 @@ extern "C" {
 WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t *e) {
     using namespace Halide::Runtime::Internal::Synchronization;
 
+    if (trace_ring_enabled(user_context)) {
+        return trace_ring_record(user_context, e);
+    }
+
     static int32_t ids = 1;
 
     int32_t my_id = atomic_fetch_add_sequentially_consistent(&ids, 1);
@@ -399,7 +693,124 @@ WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
     return (*halide_custom_trace)(user_context, e);
 }
 
+WEAK int halide_write_trace_ring(void *user_context, int fd) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    ScopedSpinLock lock(&halide_trace_ring_write_lock);
+
+    // Take the events of every ring, and give the rings back, so that
+    // threads that have exited don't keep theirs for good. The rings are
+    // left without storage until their events have been written out, so
+    // a thread that records meanwhile claims a ring and allocates it
+    // afresh rather than waiting for the write.
+    TraceRingEvents *taken[trace_ring_max_threads];
+    int32_t tids[trace_ring_max_threads];
+    halide_trace_ring_header_t header;
+    header.magic = HALIDE_TRACE_RING_MAGIC;
+    header.num_threads = 0;
+    for (int i = 0; i < trace_ring_max_threads; i++) {
+        TraceRing *r = &halide_trace_rings[i];
+        taken[i] = nullptr;
+        TraceRingEvents *events = trace_ring_take(r);
+        if (!events) {
+            continue;
+        }
+        atomic_load_relaxed(&r->tid, &tids[i]);
+        int32_t zero = 0;
+        atomic_store_relaxed(&r->tid, &zero);
+        if (tids[i] && events->count) {
+            taken[i] = events;
+            events = nullptr;
+            header.num_threads++;
+        }
+        atomic_store_release(&r->events, &events);
+    }
+
+    // Every name used by the events taken was interned before they were
+    // recorded.
+    uint32_t num_names = 0;
+    for (int i = 0; i < trace_ring_max_names; i++) {
+        char *name;
+        atomic_load_acquire(&halide_trace_ring_names[i].name, &name);
+        if (name) {
+            num_names = i + 1;
+        }
+    }
+    header.num_names = num_names;
+    header.num_dropped_events = atomic_exchange_acquire(&halide_trace_ring_dropped_events, (uint32_t)0);
+    int zero = 0;
+    atomic_store_relaxed(&halide_trace_ring_out_of_rings, &zero);
+    atomic_store_relaxed(&halide_trace_ring_out_of_names, &zero);
+
+    bool success = trace_ring_write(fd, &header, sizeof(header));
+    for (uint32_t i = 0; success && i < num_names; i++) {
+        const char *name = halide_trace_ring_names[i].name;
+        uint32_t len = name ? strlen(name) : 0;
+        success = trace_ring_write(fd, &len, sizeof(len)) &&
+                  trace_ring_write(fd, name, len);
+    }
+    uint64_t capacity = halide_trace_ring_mask + 1;
+    for (int i = 0; i < trace_ring_max_threads; i++) {
+        TraceRingEvents *events = taken[i];
+        if (!events) {
+            continue;
+        }
+        if (success) {
+            uint64_t count = events->count;
+            uint64_t num_events = count < capacity ? count : capacity;
+            halide_trace_ring_thread_t thread;
+            thread.thread_id = tids[i];
+            thread.num_events = (uint32_t)num_events;
+            success = trace_ring_write(fd, &thread, sizeof(thread));
+            // The oldest event may not be at the start of the ring, in which
+            // case the events wrap around the end.
+            uint64_t start = (count - num_events) & halide_trace_ring_mask;
+            uint64_t first = num_events < capacity - start ? num_events : capacity - start;
+            success = success &&
+                      trace_ring_write(fd, events->events() + start, first * sizeof(halide_trace_ring_event_t)) &&
+                      trace_ring_write(fd, events->events(), (num_events - first) * sizeof(halide_trace_ring_event_t));
+        }
+        // Give the storage back to the ring, unless a thread that claimed
+        // the ring meanwhile has allocated it some more.
+        events->count = 0;
+        TraceRingEvents *expected = nullptr;
+        if (!atomic_cas_strong_sequentially_consistent(&halide_trace_rings[i].events, &expected, &events)) {
+            free(events);
+        }
+    }
+    if (!success) {
+        error(user_context) << "Could not write trace ring buffers";
+        return halide_error_code_trace_failed;
+    }
+    return halide_error_code_success;
+}
+
 WEAK int halide_shutdown_trace() {
+    if (halide_trace_ring_mode > 0) {
+        int ret = halide_error_code_success;
+        void *file = halide_fopen(halide_trace_ring_file_name, "wb");
+        if (file) {
+            ret = halide_write_trace_ring(nullptr, fileno(file));
+            if (fclose(file) != 0) {
+                ret = halide_error_code_trace_failed;
+            }
+        } else {
+            ret = halide_error_code_trace_failed;
+        }
+        for (TraceRing &r : halide_trace_rings) {
+            free(r.events);
+            r.events = nullptr;
+            r.tid = 0;
+            r.next_id = 0;
+        }
+        for (TraceRingName &n : halide_trace_ring_names) {
+            free(n.name);
+            n.name = nullptr;
+            n.hash = 0;
+        }
+        halide_trace_ring_mode = -1;
+        return ret;
+    }
     if (halide_trace_file_internally_opened) {
         int ret = fclose(halide_trace_file_internally_opened);
         halide_trace_file = 0;
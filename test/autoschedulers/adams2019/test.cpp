@@ -56,6 +56,32 @@ bool test_caching(Pipeline &p1, Pipeline &p2, const Target &target) {
     return true;
 }
 
+bool test_thread_count(Pipeline &p1, Pipeline &p2, const Target &target) {
+    constexpr int parallelism = 32;
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", std::to_string(parallelism)},
+            {"random_dropout", "90"},
+            {"random_dropout_seed", "42"},
+            {"weights_path", weights_path},
+            {"beam_size", "8"},
+        });
+
+    // Expand the states of each beam search step on one thread, then on
+    // several.
+    set_env_variable("HL_COMPILE_THREADS", "1", 1);
+    auto results_serial = p1.apply_autoscheduler(target, params);
+
+    set_env_variable("HL_COMPILE_THREADS", "4", 1);
+    auto results_parallel = p2.apply_autoscheduler(target, params);
+
+    // The Funcs of the two pipelines have different names, so compare
+    // the featurizations of the schedules found rather than their source.
+    return !results_serial.featurization.empty() &&
+           results_serial.featurization == results_parallel.featurization;
+}
+
 int main(int argc, char **argv) {
     if (argc != 3 || !strlen(argv[1]) || !strlen(argv[2])) {
         fprintf(stderr, "Usage: %s <autoscheduler-lib> <weights-path>\n", argv[0]);
@@ -212,6 +238,38 @@ int main(int argc, char **argv) {
         }
     }
 
+    // The same stencil chain, scheduled on different numbers of threads
+    if (true) {
+        Pipeline p1;
+        Pipeline p2;
+        for (int test_condition = 0; test_condition < 2; test_condition++) {
+            const int N = 8;
+            Func f[N];
+            f[0](x, y) = (x + y) * (x + 2 * y) * (x + 3 * y);
+            for (int i = 1; i < N; i++) {
+                Expr e = 0;
+                for (int dy = -2; dy <= 2; dy++) {
+                    for (int dx = -2; dx <= 2; dx++) {
+                        e += f[i - 1](x + dx, y + dy);
+                    }
+                }
+                f[i](x, y) = e;
+            }
+            f[N - 1].set_estimate(x, 0, 2048).set_estimate(y, 0, 2048);
+
+            if (test_condition) {
+                p2 = Pipeline(f[N - 1]);
+            } else {
+                p1 = Pipeline(f[N - 1]);
+            }
+        }
+
+        if (!test_thread_count(p1, p2, target)) {
+            std::cerr << "Schedules found on different numbers of threads differ" << std::endl;
+            return 1;
+        }
+    }
+
     // An outer product
     if (true) {
         Pipeline p1;
@@ -0,0 +1,120 @@
+#include "Halide.h"
+
+#include <atomic>
+#include <future>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+std::atomic<int> errors_reported{0};
+
+void my_error(JITUserContext *user_context, const char *msg) {
+    errors_reported++;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const Target t = get_jit_target_from_environment();
+
+    Param<int> offset("offset");
+    ImageParam in(Int(32), 2, "in");
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = in(x, y) * 2 + offset;
+    f.parallel(y);
+
+    Callable c = f.compile_to_callable({in, offset}, t);
+
+    Buffer<int> input(64, 64);
+    input.fill([](int x, int y) { return x + y * 64; });
+
+    {
+        // Many calls in flight at once, each with its own output.
+        const int n = 16;
+        std::vector<Buffer<int>> outputs;
+        std::vector<AsyncCall> calls;
+        std::atomic<int> done_count{0};
+        for (int i = 0; i < n; i++) {
+            outputs.emplace_back(64, 64);
+            // The scalar is copied, so it needn't outlive the call to call_async.
+            int o = i * 1000;
+            calls.push_back(c.call_async(input, o, outputs.back()));
+            calls.back().on_done([&](int result) { done_count++; });
+        }
+        for (int i = 0; i < n; i++) {
+            if (calls[i].wait() != 0) {
+                printf("Call %d failed\n", i);
+                return 1;
+            }
+            if (!calls[i].done()) {
+                printf("Call %d not done after wait()\n", i);
+                return 1;
+            }
+            outputs[i].for_each_element([&](int x, int y) {
+                int correct = (x + y * 64) * 2 + i * 1000;
+                if (outputs[i](x, y) != correct) {
+                    printf("outputs[%d](%d, %d) = %d instead of %d\n", i, x, y, outputs[i](x, y), correct);
+                    exit(1);
+                }
+            });
+        }
+        if (done_count != n) {
+            printf("%d on_done callbacks ran instead of %d\n", (int)done_count, n);
+            return 1;
+        }
+
+        // A callback added after the call has finished runs right away.
+        bool called = false;
+        calls[0].on_done([&](int result) { called = (result == 0); });
+        if (!called) {
+            printf("on_done callback was not run on a finished call\n");
+            return 1;
+        }
+    }
+
+    {
+        // The handle can be dropped before the call finishes.
+        Buffer<int> out(64, 64);
+        std::promise<int> finished;
+        c.call_async(input, 1, out).on_done([&](int result) { finished.set_value(result); });
+        finished.get_future().wait();
+        if (out(3, 4) != (3 + 4 * 64) * 2 + 1) {
+            printf("Call with a dropped handle computed the wrong result\n");
+            return 1;
+        }
+    }
+
+    {
+        // Failures are reported through the context's error handler, and
+        // the exit status is returned by wait().
+        JITUserContext ctx;
+        ctx.handlers.custom_error = my_error;
+        Buffer<int> too_big(128, 128);
+        AsyncCall call = c.call_async(&ctx, input, 0, too_big);
+        if (call.wait() == 0 || errors_reported != 1) {
+            printf("An out-of-bounds call didn't fail as expected\n");
+            return 1;
+        }
+
+        // Once the call has finished, its context can be passed to another.
+        Buffer<int> out(64, 64);
+        if (c.call_async(&ctx, input, 0, out).wait() != 0) {
+            printf("A context couldn't be reused once its call had finished\n");
+            return 1;
+        }
+    }
+
+    {
+        AsyncCall call;
+        if (call.defined()) {
+            printf("A default-constructed AsyncCall should not be defined\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int check(const Callable &c, int w, int h, int variants_expected) {
+    Buffer<int> in(w, h), out(w, h);
+    in.fill([](int x, int y) { return x + y * 3; });
+    if (c(in, 5, out) != 0) {
+        printf("Call failed for %dx%d\n", w, h);
+        return 1;
+    }
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int correct = (x + y * 3) * 2 + 5;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d for %dx%d\n", x, y, out(x, y), correct, w, h);
+                return 1;
+            }
+        }
+    }
+    if (c.num_specialized_variants() != variants_expected) {
+        printf("%d variants instead of %d after a %dx%d call\n",
+               c.num_specialized_variants(), variants_expected, w, h);
+        return 1;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    ImageParam in(Int(32), 2, "in");
+    Param<int> offset("offset");
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = in(x, y) * 2 + offset;
+    f.vectorize(x, 8, TailStrategy::GuardWithIf);
+
+    Pipeline p(f);
+    Callable c = p.compile_to_specializing_callable({in, offset}, get_jit_target_from_environment(), 3, 2);
+
+    // Specialized on the third call with a shape, but only twice.
+    if (check(c, 100, 50, 0) ||
+        check(c, 100, 50, 0) ||
+        check(c, 100, 50, 1) ||
+        check(c, 100, 50, 1) ||
+        check(c, 37, 20, 1) ||
+        check(c, 37, 20, 1) ||
+        check(c, 37, 20, 2) ||
+        check(c, 64, 64, 2) ||
+        check(c, 64, 64, 2) ||
+        check(c, 64, 64, 2) ||
+        check(c, 100, 50, 2) ||
+        check(c, 37, 20, 2)) {
+        return 1;
+    }
+
+    // A bounds query uses the generic code.
+    Buffer<int> query_in(nullptr, 0, 0), query_out(nullptr, 10, 10);
+    if (c(query_in, 0, query_out) != 0 || query_in.dim(0).extent() != 10) {
+        printf("Bounds query failed\n");
+        return 1;
+    }
+
+    // The constraints used to compile the variants were never set on the
+    // caller's parameters.
+    if (in.parameter().extent_constraint(0).defined() ||
+        in.parameter().stride_constraint(1).defined() ||
+        in.parameter().host_alignment() != 4) {
+        printf("A variant's constraints leaked into the ImageParam\n");
+        return 1;
+    }
+    in.set(Buffer<int>(13, 7));
+    offset.set(1);
+    p.realize({13, 7});
+
+    // A variant is never less strict about alignment than the generic code.
+    {
+        ImageParam in2(Int(32), 1, "in2");
+        Func g("g");
+        g(x) = in2(x) + 1;
+        in2.set_host_alignment(32);
+        Pipeline p2(g);
+        p2.jit_handlers().custom_error = [](JITUserContext *, const char *) {};
+        Callable c2 = p2.compile_to_specializing_callable({in2}, get_jit_target_from_environment(), 1, 1);
+        Buffer<int> storage(64), out2(16);
+        // 16-byte, but not 32-byte, aligned.
+        int *p16 = storage.data();
+        while (((uintptr_t)p16 % 32) != 16) {
+            p16++;
+        }
+        Buffer<int> misaligned(p16, 16);
+        for (int i = 0; i < 3; i++) {
+            if (c2(misaligned, out2) == 0) {
+                printf("A buffer violating the declared alignment was accepted\n");
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "Halide.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace Halide;
+using Halide::Internal::JITSharedRuntime;
+
+// Check that the host allocation pool reuses the memory of intermediate
+// Funcs across runs of a pipeline, that the profiler bills the reuses to
+// the pipeline, that it respects its size limit, and that results are
+// unaffected when several threads share it.
+
+namespace {
+
+Target profiled_target;
+uint64_t pooled_allocs = 0, memory_pooled = 0;
+
+// Snapshot the pool reuses billed to the running instance at the end of
+// the pipeline, before they are folded into the pipeline's statistics.
+int32_t capture_pooled_allocs(JITUserContext *, const halide_trace_event_t *e) {
+    if (e->event != halide_trace_end_pipeline) {
+        return 0;
+    }
+    using GetStateFn = halide_profiler_state *(*)();
+    auto get_state = (GetStateFn)JITSharedRuntime::find_symbol(profiled_target, "halide_profiler_get_state");
+    if (get_state && get_state()->instances) {
+        pooled_allocs = get_state()->instances->num_pooled_allocs;
+        memory_pooled = get_state()->instances->memory_pooled;
+    }
+    return 0;
+}
+
+bool check_output(const Buffer<int> &out) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = 2 * (x + y) + 1;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support the host allocation pool.\n");
+        return 0;
+    }
+
+    Func f("f"), g("g"), h("h");
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    h(x, y) = g(x, y) + 1;
+    // f is too large for the stack, so each run makes a heap allocation
+    // for it.
+    Var yo, yi;
+    f.compute_root();
+    h.split(y, yo, yi, 16).parallel(yo);
+    g.compute_at(h, yo);
+
+    const int w = 256, ht = 256;
+    Callable c = h.compile_to_callable({});
+
+    {
+        // Nothing is pooled unless the pool is turned on.
+        Buffer<int> out(w, ht);
+        halide_host_allocation_pool_stats_t before = JITSharedRuntime::host_allocation_pool_get_stats();
+        if (c(out) != 0 || !check_output(out)) {
+            return 1;
+        }
+        halide_host_allocation_pool_stats_t after = JITSharedRuntime::host_allocation_pool_get_stats();
+        if (after.allocations != before.allocations) {
+            printf("Pool was used while disabled\n");
+            return 1;
+        }
+    }
+
+    JITSharedRuntime::reuse_host_allocations(true);
+
+    {
+        // Later runs reuse the allocations of earlier ones.
+        Buffer<int> out(w, ht);
+        halide_host_allocation_pool_stats_t before = JITSharedRuntime::host_allocation_pool_get_stats();
+        for (int i = 0; i < 10; i++) {
+            if (c(out) != 0 || !check_output(out)) {
+                return 1;
+            }
+        }
+        halide_host_allocation_pool_stats_t after = JITSharedRuntime::host_allocation_pool_get_stats();
+        uint64_t allocations = after.allocations - before.allocations;
+        uint64_t reuses = after.reuses - before.reuses;
+        if (allocations == 0 || reuses * 2 < allocations) {
+            printf("%d allocations, of which %d were reused\n", (int)allocations, (int)reuses);
+            return 1;
+        }
+        if (after.cached_bytes <= 0) {
+            printf("Pool holds no memory after running\n");
+            return 1;
+        }
+    }
+
+    {
+        // The profiler bills reuses to the pipeline that made the
+        // allocation.
+        Func pf("pf"), pg("pg");
+        pf(x, y) = x + y;
+        pg(x, y) = pf(x, y) * 2 + 1;
+        pf.compute_root();
+        Pipeline p(pg);
+        p.trace_pipeline();
+        p.jit_handlers().custom_trace = capture_pooled_allocs;
+        profiled_target = get_jit_target_from_environment().with_feature(Target::Profile);
+        p.compile_jit(profiled_target);
+
+        Buffer<int> out(w, ht);
+        for (int i = 0; i < 2; i++) {
+            p.realize(out, profiled_target);
+            if (!check_output(out)) {
+                return 1;
+            }
+        }
+        if (pooled_allocs == 0 || memory_pooled < (uint64_t)(w * ht * sizeof(int))) {
+            printf("The second run of a profiled pipeline was billed %d pool reuses of %d bytes\n",
+                   (int)pooled_allocs, (int)memory_pooled);
+            return 1;
+        }
+    }
+
+    {
+        // The pool never holds more than its limit.
+        const int64_t limit = 16 * 1024;
+        JITSharedRuntime::host_allocation_pool_set_limit(limit);
+        Buffer<int> out(w, ht);
+        for (int i = 0; i < 4; i++) {
+            if (c(out) != 0 || !check_output(out)) {
+                return 1;
+            }
+        }
+        halide_host_allocation_pool_stats_t stats = JITSharedRuntime::host_allocation_pool_get_stats();
+        if (stats.cached_bytes > limit) {
+            printf("Pool holds %d bytes, over its limit of %d\n", (int)stats.cached_bytes, (int)limit);
+            return 1;
+        }
+        JITSharedRuntime::host_allocation_pool_set_limit(64 * 1024 * 1024);
+    }
+
+    {
+        // Several threads running the pipeline at once.
+        const int num_threads = 8, iterations = 20;
+        std::vector<std::thread> threads;
+        std::vector<int> failed(num_threads, 0);
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t]() {
+                Buffer<int> out(w, ht);
+                for (int i = 0; i < iterations; i++) {
+                    if (c(out) != 0 || !check_output(out)) {
+                        failed[t] = 1;
+                        return;
+                    }
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        for (int fail : failed) {
+            if (fail) {
+                return 1;
+            }
+        }
+    }
+
+    {
+        // Releasing the pool returns everything to the system.
+        JITSharedRuntime::release_unused_host_allocations();
+        halide_host_allocation_pool_stats_t stats = JITSharedRuntime::host_allocation_pool_get_stats();
+        if (stats.cached_bytes != 0) {
+            printf("Pool still holds %d bytes after release\n", (int)stats.cached_bytes);
+            return 1;
+        }
+    }
+
+    JITSharedRuntime::reuse_host_allocations(false);
+
+    printf("Success!\n");
+    return 0;
+}
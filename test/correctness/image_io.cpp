@@ -401,6 +401,73 @@ void test_negative_extents() {
     expect_load_fails(pgm_name.str(), "a .pgm with a negative extent");
 }
 
+// load_mapped should see the same pixels as load_image, without copying
+// them, and writes through create_mapped should land in the file.
+void test_mapped() {
+    Buffer<float> buf(37, 19, 3, 1);
+    buf.for_each_element([&](int x, int y, int c, int w) {
+        buf(x, y, c, w) = x + y * 100 + c * 10000;
+    });
+
+    for (std::string format : {"npy", "tmp", "mat"}) {
+        std::ostringstream o;
+        o << Internal::get_test_tmp_dir() << "test_mapped." << format;
+        std::string filename = o.str();
+        Tools::save_image(buf, filename);
+
+        Buffer<float> mapped;
+        if (!Tools::load_mapped(filename, &mapped)) {
+            std::cout << "load_mapped failed for ." << format << "\n";
+            exit(1);
+        }
+        Buffer<float> reloaded = Tools::load_image(filename);
+        bool match = mapped.dimensions() == reloaded.dimensions();
+        reloaded.for_each_element([&](const int *pos) {
+            match = match && mapped(pos) == reloaded(pos);
+        });
+        if (!match) {
+            std::cout << "load_mapped and load_image disagree for ." << format << "\n";
+            exit(1);
+        }
+
+        // Mapped images are copy-on-write.
+        mapped(0, 0, 0, 0) = -1.0f;
+        Buffer<float> unchanged = Tools::load_image(filename);
+        if (unchanged(0, 0, 0, 0) != buf(0, 0, 0, 0)) {
+            std::cout << "Writing to a loaded mapped image changed the ." << format << " file\n";
+            exit(1);
+        }
+
+        o << ".created." << format;
+        std::string created_name = o.str();
+        {
+            Buffer<float> created;
+            if (!Tools::create_mapped(created_name, halide_type_of<float>(), {37, 19, 3, 1}, &created)) {
+                std::cout << "create_mapped failed for ." << format << "\n";
+                exit(1);
+            }
+            created.copy_from(buf);
+        }
+        Buffer<float> created = Tools::load_image(created_name);
+        match = true;
+        buf.for_each_element([&](const int *pos) {
+            match = match && created(pos) == buf(pos);
+        });
+        if (!match) {
+            std::cout << "create_mapped wrote the wrong data to ." << format << "\n";
+            exit(1);
+        }
+
+        o << ".saved." << format;
+        std::string saved_name = o.str();
+        if (!Tools::save_mapped(buf, saved_name) ||
+            Internal::read_entire_file(saved_name) != Internal::read_entire_file(filename)) {
+            std::cout << "save_mapped and save_image disagree for ." << format << "\n";
+            exit(1);
+        }
+    }
+}
+
 #ifndef HALIDE_NO_PNG
 void test_png_unsupported_bit_depth() {
     // A 1-bit grayscale PNG is a valid file, but load_png only supports 8- and
@@ -464,6 +531,7 @@ int main(int argc, char **argv) {
     test_png_unsupported_bit_depth();
 #endif
     test_negative_extents();
+    test_mapped();
     printf("Success!\n");
     return 0;
 }
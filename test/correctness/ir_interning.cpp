@@ -0,0 +1,123 @@
+#include "Halide.h"
+
+#include <sstream>
+#include <thread>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+std::string lower_to_string(Func f, bool intern) {
+    // The same tag each time, so that the names made by the two lowerings
+    // match.
+    ScopedUniqueNameContext names("ir_interning");
+    std::optional<ScopedIRInterning> interning;
+    if (intern) {
+        interning.emplace();
+    }
+    Module m = f.compile_to_module(f.infer_arguments(), "ir_interning", get_host_target());
+    std::ostringstream s;
+    s << m;
+    return s.str();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Expr x = Variable::make(Int(32), "x");
+    Expr y = Variable::make(Int(32), "y");
+    Expr e1, e2, e3, p1, p2;
+    {
+        ScopedIRInterning interning;
+
+        Expr x1 = Variable::make(Int(32), "x");
+        Expr x2 = Variable::make(Int(32), "x");
+        if (!x1.same_as(x2)) {
+            printf("Equal Variables were not interned\n");
+            return 1;
+        }
+
+        // Constants are compared by value.
+        e1 = min(x1 * 3 + 1, Variable::make(Int(32), "y") - 2);
+        e2 = min(x2 * 3 + 1, Variable::make(Int(32), "y") - 2);
+        e3 = min(x2 * 3 + 1, Variable::make(Int(32), "y") - 3);
+        if (!e1.same_as(e2) || e1.same_as(e3) || equal(e1, e3)) {
+            printf("Interning failed: %s %s %s\n", e1.same_as(e2) ? "" : "e1 != e2",
+                   e1.same_as(e3) ? "e1 == e3" : "", equal(e1, e3) ? "equal(e1, e3)" : "");
+            return 1;
+        }
+
+        // An operand built outside the scope means the node can't be
+        // interned, but it must still compare equal.
+        Expr a = x + 1, b = x + 1;
+        if (a.same_as(b) || !equal(a, b)) {
+            printf("Nodes with uninterned operands were interned\n");
+            return 1;
+        }
+
+        // Variables that refer to a parameter are never merged, as
+        // IREquality ignores the parameter.
+        Param<int> p("x");
+        p1 = Variable::make(Int(32), "x", p.parameter());
+        p2 = Variable::make(Int(32), "x");
+        if (p1.same_as(p2) || !equal(p1, p2) || p1.as<Variable>()->param.name() != "x") {
+            printf("A Variable with a parameter was merged\n");
+            return 1;
+        }
+
+        // Interned nodes carry their scope and structural hash.
+        if (!e1.get()->intern_scope || e1.get()->intern_scope != e3.get()->intern_scope ||
+            !e1.get()->structural_hash || a.get()->structural_hash) {
+            printf("Interned nodes were not marked\n");
+            return 1;
+        }
+
+        // The table keeps its nodes alive until the scope ends.
+        if (e1.get()->ref_count.atomic_get() != 3) {
+            printf("Unexpected reference count %d\n", e1.get()->ref_count.atomic_get());
+            return 1;
+        }
+    }
+
+    // After the scope ends, the nodes are ordinary nodes again, but keep
+    // their hashes.
+    if (e1.get()->ref_count.atomic_get() != 2 || e1.get()->intern_scope ||
+        !e1.get()->structural_hash ||
+        !equal(e1, min(x * 3 + 1, y - 2)) || equal(e1, e3)) {
+        printf("Interned nodes did not survive the end of their scope\n");
+        return 1;
+    }
+
+    // Equal nodes interned by different scopes, here on another thread,
+    // have the same hash, and compare equal.
+    Expr e4;
+    std::thread([&]() {
+        ScopedIRInterning interning;
+        e4 = min(Variable::make(Int(32), "x") * 3 + 1, Variable::make(Int(32), "y") - 2);
+    }).join();
+    if (e4.same_as(e1) || e4.get()->structural_hash != e1.get()->structural_hash ||
+        !equal(e1, e4) || !graph_equal(e1, e4) || equal(e3, e4)) {
+        printf("Nodes interned by different scopes did not compare correctly\n");
+        return 1;
+    }
+
+    // Lowering with interning produces the same code.
+    Func f("f"), g("g");
+    Var vx("vx"), vy("vy");
+    ImageParam in(Float(32), 2, "in");
+    g(vx, vy) = in(vx, vy) * 2 + in(vx + 1, vy) + in(vx, vy + 1);
+    f(vx, vy) = g(vx - 1, vy) + g(vx + 1, vy) + g(vx, vy - 1) + g(vx, vy + 1);
+    Var vxo, vxi;
+    f.split(vx, vxo, vxi, 16).vectorize(vxi, 8).parallel(vy);
+    g.compute_at(f, vy).vectorize(vx, 8);
+    std::string plain = lower_to_string(f, false);
+    std::string interned = lower_to_string(f, true);
+    if (plain != interned) {
+        printf("Lowering with interning changed the result:\n%s\nvs\n%s\n", plain.c_str(), interned.c_str());
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
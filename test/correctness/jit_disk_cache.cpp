@@ -0,0 +1,201 @@
+// Exercises the on-disk JIT object cache (HL_JIT_CACHE_DIR) that
+// Pipeline::compile_jit and Pipeline::compile_to_callable use to skip lowering
+// and LLVM codegen for pipelines compiled by an earlier process. Only
+// meaningful when Halide was built with serialization support (the cache keys
+// pipelines by their serialized form); TEST_WITH_SERIALIZATION is defined by
+// CMake in that case.
+//
+// As in generator_cache.cpp, each compilation runs in a *separate child
+// process* (by re-exec'ing this test with --jit), as a real warm start would.
+// Each child reports the cache counters it observed through its exit code.
+
+#include "Halide.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace Halide;
+
+#ifdef TEST_WITH_SERIALIZATION
+
+namespace {
+
+namespace fs = std::filesystem;
+
+#define check(cond)                                                       \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            std::cerr << "FAILED: " #cond " (line " << __LINE__ << ")\n"; \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+// Exit codes used by the child to report what happened.
+enum ChildResult {
+    kWrongOutput = 10,
+    kMissAndStore = 11,
+    kHit = 12,
+    kOther = 13,
+};
+
+std::string error_message;
+
+void record_error(JITUserContext *, const char *msg) {
+    error_message += msg;
+}
+
+// Compile and run a small pipeline, then report whether the object code came
+// from the cache. `mode` selects compile_jit ("realize") or
+// compile_to_callable ("callable"); `offset` changes the algorithm. Making
+// `other_funcs` Funcs and Vars first changes the unique names the pipeline
+// gets, but not what it computes. In "error" mode, the pipeline is realized
+// into an output that is too small for it, and the error message is
+// written to `error_file`.
+int jit_one(const std::string &mode, int offset, int other_funcs, const std::string &error_file) {
+    for (int i = 0; i < other_funcs; i++) {
+        Func other_f, other_g;
+        Var other_x;
+        other_f(other_x) = other_x;
+    }
+
+    ImageParam input(Int(32), 1, "input");
+    Func f, g;
+    Var x;
+    f(x) = input(x) * 3;
+    g(x) = f(x) + f(x + 1) + offset;
+    f.compute_root().vectorize(x, 8);
+
+    Buffer<int32_t> in(65), out(64);
+    in.for_each_element([&](int x) { in(x) = x * 7 - 5; });
+    input.set(in);
+
+    if (mode == "error") {
+        g.output_buffer().dim(0).set_extent(64);
+        Pipeline p(g);
+        p.jit_handlers().custom_error = record_error;
+        Buffer<int32_t> too_small(32);
+        p.realize(too_small);
+        std::ofstream(error_file) << error_message;
+        if (error_message.empty()) {
+            return kWrongOutput;
+        }
+        const JITDiskCacheStats stats = Pipeline::get_jit_disk_cache_stats();
+        return stats.hits == 1 ? kHit : stats.stores == 1 ? kMissAndStore : kOther;
+    } else if (mode == "callable") {
+        Callable c = g.compile_to_callable({input});
+        if (c(in, out) != 0) {
+            return kOther;
+        }
+    } else {
+        g.realize(out);
+    }
+
+    for (int i = 0; i < out.width(); i++) {
+        if (out(i) != in(i) * 3 + in(i + 1) * 3 + offset) {
+            return kWrongOutput;
+        }
+    }
+
+    const JITDiskCacheStats stats = Pipeline::get_jit_disk_cache_stats();
+    if (stats.hits == 1 && stats.misses == 0 && stats.stores == 0 && stats.bytes_loaded > 0) {
+        return kHit;
+    }
+    if (stats.hits == 0 && stats.misses == 1 && stats.stores == 1 && stats.bytes_stored > 0) {
+        return kMissAndStore;
+    }
+    return kOther;
+}
+
+void set_cache_dir(const std::string &dir) {
+#ifdef _WIN32
+    _putenv_s("HL_JIT_CACHE_DIR", dir.c_str());
+#else
+    setenv("HL_JIT_CACHE_DIR", dir.c_str(), /*overwrite*/ 1);
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    // Child mode: perform exactly one JIT compilation and exit.
+    if (argc >= 5 && std::string(argv[1]) == "--jit") {
+        return jit_one(argv[2], std::atoi(argv[3]), std::atoi(argv[4]), argc > 5 ? argv[5] : "");
+    }
+
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] The JIT object cache is not used for WebAssembly.\n");
+        return 0;
+    }
+
+    const std::string self = fs::absolute(argv[0]).string();
+    const fs::path tmp =
+        fs::temp_directory_path() / ("hljc_" + std::to_string(std::random_device{}()));
+    fs::remove_all(tmp);
+    fs::create_directories(tmp);
+
+    // Children inherit HL_JIT_CACHE_DIR from our environment.
+    set_cache_dir(tmp.string());
+
+    const auto run = [&](const std::string &mode, const std::string &offset,
+                         const std::string &other_funcs = "0", const std::string &error_file = "") {
+        return Internal::run_process({self, "--jit", mode, offset, other_funcs, error_file});
+    };
+    const auto read_file = [](const fs::path &path) {
+        std::ifstream in(path);
+        std::stringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    };
+
+    // 1. A cold start compiles and populates the cache.
+    check(run("realize", "1") == kMissAndStore);
+
+    // 2. A warm start with the same pipeline loads the object instead.
+    check(run("realize", "1") == kHit);
+
+    // 2b. So does one that named other things first, as the key uses
+    //     canonical names rather than the ones unique_name made.
+    check(run("realize", "1", "3") == kHit);
+
+    // 2c. The code is compiled with the canonical names too, so an error
+    //     reports the same names whether the code came from the cache or
+    //     not, and whatever the process named first.
+    check(run("error", "1", "3", (tmp / "error_a.txt").string()) == kMissAndStore);
+    check(run("error", "1", "0", (tmp / "error_b.txt").string()) == kHit);
+    const fs::path other_dir = tmp / "other";
+    fs::create_directories(other_dir);
+    set_cache_dir(other_dir.string());
+    check(run("error", "1", "0", (tmp / "error_c.txt").string()) == kMissAndStore);
+    set_cache_dir(tmp.string());
+    const std::string error_a = read_file(tmp / "error_a.txt");
+    check(!error_a.empty());
+    check(error_a == read_file(tmp / "error_b.txt"));
+    check(error_a == read_file(tmp / "error_c.txt"));
+
+    // 3. A different algorithm must not reuse the cached object.
+    check(run("realize", "2") == kMissAndStore);
+
+    // 4. compile_to_callable has a different argument list, so it gets its
+    //    own entry, which is then reused.
+    check(run("callable", "1") == kMissAndStore);
+    check(run("callable", "1") == kHit);
+
+    fs::remove_all(tmp);
+    printf("Success!\n");
+    return 0;
+}
+
+#else  // TEST_WITH_SERIALIZATION
+
+int main() {
+    printf("[SKIP] jit_disk_cache requires WITH_SERIALIZATION.\n");
+    return 0;
+}
+
+#endif  // TEST_WITH_SERIALIZATION
@@ -0,0 +1,192 @@
+#include "Halide.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace Halide;
+using Halide::Internal::JITSharedRuntime;
+
+// Check the per-pipeline statistics and the eviction policies of the
+// memoization cache, and that it gives correct results when used from
+// several threads at once.
+
+namespace {
+
+const int size = 64;
+const int entry_bytes = size * size;
+
+// A pipeline named `name` that memoizes one size x size uint8 Func
+// depending on p.
+Func make_pipeline(const std::string &name, const Param<int> &p) {
+    Func f(name + "_f"), g(name);
+    Var x, y;
+    f(x, y) = cast<uint8_t>(x + y + p);
+    g(x, y) = f(x, y) + 1;
+    f.compute_root().memoize();
+    return g;
+}
+
+bool check_output(const Buffer<uint8_t> &out, int p) {
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            uint8_t correct = (uint8_t)(x + y + p + 1);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool run(Func g, Param<int> &param, int p) {
+    param.set(p);
+    Buffer<uint8_t> out = g.realize({size, size});
+    return check_output(out, p);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support memoization cache statistics.\n");
+        return 0;
+    }
+
+    Param<int> p;
+    Func a = make_pipeline("memo_stats_a", p);
+    Func b = make_pipeline("memo_stats_b", p);
+
+    {
+        // Hits and misses are counted per pipeline.
+        if (!run(a, p, 1) || !run(a, p, 1) || !run(a, p, 2) || !run(b, p, 1)) {
+            return 1;
+        }
+
+        halide_memoization_cache_stats_t sa = JITSharedRuntime::memoization_cache_get_stats("memo_stats_a");
+        halide_memoization_cache_stats_t sb = JITSharedRuntime::memoization_cache_get_stats("memo_stats_b");
+        halide_memoization_cache_stats_t total = JITSharedRuntime::memoization_cache_get_stats();
+        halide_memoization_cache_stats_t unknown = JITSharedRuntime::memoization_cache_get_stats("memo_stats_c");
+        halide_memoization_cache_stats_t prefix = JITSharedRuntime::memoization_cache_get_stats("memo_stats_");
+        if (sa.hits != 1 || sa.misses != 2 || sa.entries != 2 || sa.bytes != 2 * entry_bytes) {
+            printf("Wrong stats for memo_stats_a: %d hits, %d misses, %d entries, %d bytes\n",
+                   (int)sa.hits, (int)sa.misses, (int)sa.entries, (int)sa.bytes);
+            return 1;
+        }
+        if (sb.hits != 0 || sb.misses != 1 || sb.entries != 1) {
+            printf("Wrong stats for memo_stats_b: %d hits, %d misses, %d entries\n",
+                   (int)sb.hits, (int)sb.misses, (int)sb.entries);
+            return 1;
+        }
+        if (total.hits != 1 || total.misses != 3 || total.entries != 3) {
+            printf("Wrong total stats: %d hits, %d misses, %d entries\n",
+                   (int)total.hits, (int)total.misses, (int)total.entries);
+            return 1;
+        }
+        if (unknown.hits != 0 || unknown.misses != 0 || prefix.hits != 0 || prefix.misses != 0) {
+            printf("Unknown pipeline has stats\n");
+            return 1;
+        }
+    }
+
+    const halide_memoization_cache_policy_t policies[] = {
+        halide_memoization_cache_policy_lru,
+        halide_memoization_cache_policy_cost_aware,
+        halide_memoization_cache_policy_tinylfu,
+    };
+    for (halide_memoization_cache_policy_t policy : policies) {
+        // Every policy stays within the size limit.
+        JITSharedRuntime::memoization_cache_set_policy(policy);
+        JITSharedRuntime::memoization_cache_set_size(1);
+        JITSharedRuntime::memoization_cache_reset_stats();
+        const int64_t limit = 3 * entry_bytes + entry_bytes / 2;
+        JITSharedRuntime::memoization_cache_set_size(limit);
+
+        for (int i = 0; i < 20; i++) {
+            if (!run(a, p, i % 7) || !run(b, p, i % 5)) {
+                return 1;
+            }
+        }
+
+        halide_memoization_cache_stats_t total = JITSharedRuntime::memoization_cache_get_stats();
+        if (total.bytes > limit || total.hits + total.misses != 40) {
+            printf("Policy %d: %d bytes cached, %d hits, %d misses\n",
+                   (int)policy, (int)total.bytes, (int)total.hits, (int)total.misses);
+            return 1;
+        }
+        if (total.evictions + total.rejections == 0) {
+            printf("Policy %d never evicted anything\n", (int)policy);
+            return 1;
+        }
+    }
+
+    {
+        // TinyLFU doesn't let a result that has been asked for once
+        // displace one that has been asked for repeatedly.
+        JITSharedRuntime::memoization_cache_set_policy(halide_memoization_cache_policy_tinylfu);
+        JITSharedRuntime::memoization_cache_set_size(1);
+        JITSharedRuntime::memoization_cache_set_size(entry_bytes + entry_bytes / 2);
+        JITSharedRuntime::memoization_cache_reset_stats();
+
+        for (int i = 0; i < 4; i++) {
+            if (!run(a, p, 100)) {
+                return 1;
+            }
+        }
+        if (!run(a, p, 101) || !run(a, p, 100)) {
+            return 1;
+        }
+
+        halide_memoization_cache_stats_t sa = JITSharedRuntime::memoization_cache_get_stats("memo_stats_a");
+        if (sa.rejections != 1 || sa.hits != 4 || sa.misses != 2) {
+            printf("TinyLFU: %d rejections, %d hits, %d misses\n",
+                   (int)sa.rejections, (int)sa.hits, (int)sa.misses);
+            return 1;
+        }
+        JITSharedRuntime::memoization_cache_set_policy(halide_memoization_cache_policy_lru);
+    }
+
+    {
+        // Lookups from several threads at once, on a cache too small to
+        // hold everything.
+        JITSharedRuntime::memoization_cache_set_size(8 * entry_bytes);
+        JITSharedRuntime::memoization_cache_reset_stats();
+
+        Callable c = a.compile_to_callable({p});
+        const int num_threads = 8, iterations = 50;
+        std::vector<std::thread> threads;
+        std::vector<int> failed(num_threads, 0);
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t]() {
+                Buffer<uint8_t> out(size, size);
+                for (int i = 0; i < iterations; i++) {
+                    int value = (t * 7 + i) % 12;
+                    if (c(value, out) != 0 || !check_output(out, value)) {
+                        failed[t] = 1;
+                        return;
+                    }
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        for (int f : failed) {
+            if (f) {
+                return 1;
+            }
+        }
+
+        halide_memoization_cache_stats_t total = JITSharedRuntime::memoization_cache_get_stats();
+        if (total.hits + total.misses != num_threads * iterations || total.hits == 0) {
+            printf("Threads: %d hits, %d misses\n", (int)total.hits, (int)total.misses);
+            return 1;
+        }
+    }
+
+    // Return cache size to default.
+    JITSharedRuntime::memoization_cache_set_size(0);
+
+    printf("Success!\n");
+    return 0;
+}
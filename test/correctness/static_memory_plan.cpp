@@ -0,0 +1,206 @@
+#include "Halide.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Halide;
+
+// Check that with the static_memory_plan target feature, the constant-sized
+// intermediates of a pipeline are packed into one arena, that
+// intermediates that are not live at the same time share memory, and
+// that results are unaffected.
+
+namespace {
+
+int malloc_count = 0;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    malloc_count++;
+    void *orig = malloc(x + 128);
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+int errors_reported = 0;
+
+void my_error(JITUserContext *user_context, const char *msg) {
+    errors_reported++;
+}
+
+const int size = 100000;
+
+// A chain of compute_root stages, each too large for the stack.
+Func make_pipeline() {
+    Func f0("f0"), f1("f1"), f2("f2"), f3("f3"), out("out");
+    Var x;
+    f0(x) = x;
+    f1(x) = f0(x) + f0(x + 1);
+    f2(x) = f1(x) * 2;
+    f3(x) = f2(x) + f2(x + 1);
+    out(x) = f3(x);
+    f0.compute_root();
+    f1.compute_root();
+    f2.compute_root();
+    f3.compute_root();
+    out.bound(x, 0, size);
+    return out;
+}
+
+int run(Func out, const Target &t) {
+    out.jit_handlers().custom_malloc = my_malloc;
+    out.jit_handlers().custom_free = my_free;
+    malloc_count = 0;
+    Buffer<int> result = out.realize({size}, t);
+    for (int x = 0; x < size; x++) {
+        int correct = 8 * x + 8;
+        if (result(x) != correct) {
+            printf("result(%d) = %d instead of %d\n", x, result(x), correct);
+            return -1;
+        }
+    }
+    return malloc_count;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    int unplanned = run(make_pipeline(), t);
+    if (unplanned < 0) {
+        return 1;
+    }
+    if (unplanned != 4) {
+        printf("Expected 4 allocations without planning, got %d\n", unplanned);
+        return 1;
+    }
+
+    Target planned_target = t.with_feature(Target::StaticMemoryPlan);
+    int planned = run(make_pipeline(), planned_target);
+    if (planned < 0) {
+        return 1;
+    }
+    if (planned != 1) {
+        printf("Expected 1 allocation with planning, got %d\n", planned);
+        return 1;
+    }
+
+    {
+        // At most two of the intermediates are live at once, so the arena
+        // should be about the size of two of them.
+        Module m = make_pipeline().compile_to_module({}, "static_memory_plan", planned_target.with_feature(Target::JIT));
+        int64_t arena_size = Internal::scratch_arena_size(m.functions()[0].body);
+        const int64_t stage_size = (size + 2) * sizeof(int);
+        if (arena_size < 2 * stage_size || arena_size >= 3 * stage_size) {
+            printf("Arena of %d bytes for intermediates of %d bytes\n", (int)arena_size, (int)stage_size);
+            return 1;
+        }
+    }
+
+    {
+        // Ahead-of-time compiled pipelines take memory for the arena as
+        // a trailing argument.
+        Target aot_target = planned_target.without_feature(Target::JIT);
+        Module m = make_pipeline().compile_to_module({}, "static_memory_plan", aot_target);
+        const auto &args = m.functions()[0].args;
+        bool found = false;
+        for (const auto &arg : args) {
+            found |= (arg.name == "__scratch" && arg.type.is_handle() && arg.is_input());
+        }
+        if (!found) {
+            printf("No __scratch argument in ahead-of-time compiled pipeline\n");
+            return 1;
+        }
+    }
+
+    {
+        // Callers can pass in the memory for the arena by giving the
+        // pipeline arguments named __scratch and __scratch_size. The
+        // memory must be aligned to the native vector width, as
+        // halide_malloc would align it.
+        Param<void *> scratch("__scratch");
+        Param<uint64_t> scratch_size("__scratch_size");
+        Func out = make_pipeline();
+        out.jit_handlers().custom_malloc = my_malloc;
+        out.jit_handlers().custom_free = my_free;
+        Callable c = out.compile_to_callable({scratch, scratch_size}, planned_target);
+
+        const int64_t stage_size = (size + 2) * sizeof(int);
+        const uint64_t enough = 3 * stage_size;
+        std::vector<uint8_t> storage(enough + 128);
+        void *memory = (void *)((((size_t)storage.data() + 127) >> 7) << 7);
+
+        auto check = [&](const Buffer<int> &result) {
+            for (int x = 0; x < size; x++) {
+                int correct = 8 * x + 8;
+                if (result(x) != correct) {
+                    printf("result(%d) = %d instead of %d\n", x, result(x), correct);
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        Buffer<int> result(size);
+        malloc_count = 0;
+        if (c(memory, enough, result) != 0 || !check(result)) {
+            printf("Call with caller-supplied scratch memory failed\n");
+            return 1;
+        }
+        if (malloc_count != 0) {
+            printf("Expected no allocations with caller-supplied scratch memory, got %d\n", malloc_count);
+            return 1;
+        }
+
+        result.fill(0);
+        malloc_count = 0;
+        if (c((void *)nullptr, (uint64_t)0, result) != 0 || !check(result)) {
+            printf("Call without scratch memory failed\n");
+            return 1;
+        }
+        if (malloc_count != 1) {
+            printf("Expected 1 allocation without scratch memory, got %d\n", malloc_count);
+            return 1;
+        }
+
+        // Memory that is too small for the arena is an error.
+        JITUserContext ctx;
+        ctx.handlers.custom_error = my_error;
+        malloc_count = 0;
+        int status = c(&ctx, memory, (uint64_t)stage_size, result);
+        if (status != halide_error_code_scratch_too_small || errors_reported != 1) {
+            printf("Call with too little scratch memory returned %d and reported %d errors\n",
+                   status, errors_reported);
+            return 1;
+        }
+        if (malloc_count != 0) {
+            printf("Call with too little scratch memory allocated anyway\n");
+            return 1;
+        }
+
+        // So is memory that isn't aligned to the native vector width.
+        malloc_count = 0;
+        status = c(&ctx, (void *)((uint8_t *)memory + 1), enough - 1, result);
+        if (status != halide_error_code_scratch_unaligned || errors_reported != 2) {
+            printf("Call with unaligned scratch memory returned %d and reported %d errors\n",
+                   status, errors_reported);
+            return 1;
+        }
+        if (malloc_count != 0) {
+            printf("Call with unaligned scratch memory allocated anyway\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
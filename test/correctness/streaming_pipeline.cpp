@@ -0,0 +1,142 @@
+#include "Halide.h"
+#include "halide_streaming.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+namespace {
+
+const int width = 97, height = 301;
+
+// The number of times each row of blur_y has been stored to, offset by
+// one, as the first row is -1.
+int blur_y_stores[height + 2];
+
+int count_stores(JITUserContext *, const halide_trace_event_t *e) {
+    if (e->event == halide_trace_store && strcmp(e->func, "blur_y") == 0) {
+        blur_y_stores[e->coordinates[1] + 1]++;
+    }
+    return 0;
+}
+
+// Run the streaming pipeline over the input, and check the output against
+// the correct result. Returns the error from the streaming pipeline, if
+// any.
+int stream(Callable &c, RowBoundary boundary, int strip_height, int push_height,
+           const Buffer<uint16_t> &input, const Buffer<uint16_t> &correct) {
+    JITUserContext ctx;
+    ctx.handlers.custom_trace = count_stores;
+    memset(blur_y_stores, 0, sizeof(blur_y_stores));
+
+    Buffer<uint16_t> output(width, height);
+    int rows_seen = 0;
+    StreamingPipeline<uint16_t> streamer(
+        [&](halide_buffer_t *i, halide_buffer_t *o, halide_buffer_t **state) {
+            return c(&ctx, i, state[0], o);
+        },
+        1, {width, 0}, {width, 0}, strip_height, boundary,
+        [&](const Runtime::Buffer<uint16_t> &strip) {
+            if (strip.dim(1).min() != rows_seen) {
+                printf("Strip starts at row %d instead of %d\n", strip.dim(1).min(), rows_seen);
+                exit(1);
+            }
+            rows_seen += strip.dim(1).extent();
+            output.get()->copy_from(strip);
+        },
+        7);
+
+    for (int y0 = 0; y0 < height; y0 += push_height) {
+        Buffer<uint16_t> strip = input.cropped(1, y0, std::min(push_height, height - y0));
+        int result = streamer.push(*strip.get());
+        if (result != 0) {
+            return result;
+        }
+    }
+    int result = streamer.finish();
+    if (result != 0) {
+        return result;
+    }
+    if (streamer.output_rows() != height) {
+        printf("Produced %d rows instead of %d\n", streamer.output_rows(), height);
+        exit(1);
+    }
+
+    output.for_each_element([&](int x, int y) {
+        if (output(x, y) != correct(x, y)) {
+            printf("strip_height %d, push_height %d: output(%d, %d) = %d instead of %d\n",
+                   strip_height, push_height, x, y, output(x, y), correct(x, y));
+            exit(1);
+        }
+    });
+
+    // The rows of blur_y in the halo between strips are carried from
+    // one strip to the next, so each row is computed once.
+    for (int y = -1; y <= height; y++) {
+        if (blur_y_stores[y + 1] != width + 2) {
+            printf("strip_height %d, push_height %d: row %d of blur_y was stored to %d times instead of %d\n",
+                   strip_height, push_height, y, blur_y_stores[y + 1], width + 2);
+            exit(1);
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    // A separable blur, with a boundary condition in x only. The streaming
+    // pipeline supplies the rows above and below the image.
+    ImageParam in(UInt(16), 2, "in");
+    ImageParam state(UInt(8), 1, "state");
+    Var x("x"), y("y");
+    Func clamped("clamped"), blur_y("blur_y"), blur_x("blur_x");
+    clamped(x, y) = in(clamp(x, 0, width - 1), y);
+    blur_y(x, y) = clamped(x, y - 2) + clamped(x, y) * 2 + clamped(x, y + 1);
+    blur_x(x, y) = blur_y(x - 1, y - 1) + blur_y(x, y) + blur_y(x + 1, y + 1);
+
+    // Slide blur_y down each strip, and carry the rows of it the next
+    // strip needs across to it.
+    blur_y.store_root().compute_at(blur_x, y).fold_storage(y, 4).carry_storage(state).trace_stores();
+
+    Callable c = blur_x.compile_to_callable({in, state});
+
+    Buffer<uint16_t> input(width, height);
+    input.fill([](int x, int y) { return (uint16_t)((x * 7 + y * 13) % 257); });
+
+    for (RowBoundary boundary : {RowBoundary::RepeatEdge, RowBoundary::ConstantExterior}) {
+        // The result for the whole image, with the same edge handling.
+        Func edge("edge"), by("by"), whole("whole");
+        if (boundary == RowBoundary::RepeatEdge) {
+            edge(x, y) = input(clamp(x, 0, width - 1), clamp(y, 0, height - 1));
+        } else {
+            edge(x, y) = select(y < 0 || y >= height, cast<uint16_t>(7),
+                                input(clamp(x, 0, width - 1), clamp(y, 0, height - 1)));
+        }
+        by(x, y) = edge(x, y - 2) + edge(x, y) * 2 + edge(x, y + 1);
+        whole(x, y) = by(x - 1, y - 1) + by(x, y) + by(x + 1, y + 1);
+        Buffer<uint16_t> correct = whole.realize({width, height});
+
+        for (int strip_height : {1, 8, 32, 1000}) {
+            for (int push_height : {1, 5, 64, height}) {
+                if (stream(c, boundary, strip_height, push_height, input, correct) != 0) {
+                    printf("Streaming failed\n");
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // The pipeline reads rows above and below the image, so with no
+    // boundary it must fail.
+    Buffer<uint16_t> unused(width, height);
+    if (stream(c, RowBoundary::None, 8, 64, input, unused) != halide_error_code_bad_dimensions) {
+        printf("Streaming without a boundary should have failed\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -253,6 +253,11 @@ int main(int argc, char **argv) {
         {"x86-64-windows-d3d12compute-hlsl_sm62", "x86-64-windows-d3d12compute-hlsl_sm62", "x86-64-windows-d3d12compute-hlsl_sm62"},
         {"x86-64-windows-d3d12compute-hlsl_sm69", "x86-64-windows-d3d12compute", "x86-64-windows-d3d12compute"},
         {"x86-64-windows-d3d12compute-hlsl_sm69", "x86-64-windows-d3d12compute-hlsl_sm60", "x86-64-windows-d3d12compute-hlsl_sm60"},
+        {"x86-64-linux-static_memory_plan", "x86-64-linux", "x86-64-linux"},
+        {"x86-64-linux-static_memory_plan", "x86-64-linux-static_memory_plan", "x86-64-linux"},
+        {"x86-64-linux-batch_entry_point", "x86-64-linux-batch_entry_point", "x86-64-linux"},
+        {"x86-64-linux-profile_hardware_counters", "x86-64-linux", "x86-64-linux-profile_hardware_counters"},
+        {"x86-64-linux-profile-profile_hardware_counters", "x86-64-linux-profile", "x86-64-linux-profile_hardware_counters"},
     };
     for (const auto &test : gcd_tests) {
         Target result{};
@@ -0,0 +1,48 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using Halide::Internal::JITSharedRuntime;
+
+// Check that nested parallel loops are computed correctly under each NUMA
+// placement policy. On a machine with one node the policies do nothing, but
+// the plumbing is still exercised.
+
+int main(int argc, char **argv) {
+    Var x, y, z;
+    Func f, g;
+
+    f(x, y, z) = x * y + z * 3 + 1;
+    g(x, y, z) = f(x, y, z) + f(x + 1, y, z);
+
+    f.compute_at(g, y).parallel(x);
+    g.parallel(z).parallel(y);
+
+    for (halide_numa_policy_t policy : {halide_numa_policy_node_local, halide_numa_policy_none}) {
+        JITSharedRuntime::set_numa_policy(policy);
+
+        Buffer<int> im = g.realize({64, 64, 64});
+
+        for (int z = 0; z < 64; z++) {
+            for (int y = 0; y < 64; y++) {
+                for (int x = 0; x < 64; x++) {
+                    int correct = x * y + z * 3 + 1 + (x + 1) * y + z * 3 + 1;
+                    if (im(x, y, z) != correct) {
+                        printf("im(%d, %d, %d) = %d instead of %d with NUMA policy %d\n",
+                               x, y, z, im(x, y, z), correct, (int)policy);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    JITSharedRuntime::set_numa_policy(halide_numa_policy_node_local);
+    if (JITSharedRuntime::set_numa_policy(halide_numa_policy_none) != halide_numa_policy_node_local) {
+        printf("set_numa_policy should return the previous policy\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using namespace Halide;
+using Halide::Internal::JITSharedRuntime;
+
+// Stress the work-stealing thread pool scheduler. Every iteration of nested
+// parallel loops of many shapes must run exactly once, whatever the number
+// of threads, when some iteration fails, and when several threads call into
+// pipelines at once.
+
+const int num_slots = 4;
+const int max_size = 128;
+std::atomic<int> visits[num_slots][max_size][max_size];
+
+extern "C" HALIDE_EXPORT_SYMBOL int visit(int slot, int x, int y) {
+    visits[slot][y][x]++;
+    // An uneven amount of work per iteration, so that threads run out of
+    // work at different times and have to steal.
+    volatile int busy = 0;
+    for (int i = 0; i < (x * 7 + y * 13) % 500; i++) {
+        busy = busy + i;
+    }
+    return x + y;
+}
+HalideExtern_3(int, visit, int, int, int);
+
+struct ErrorContext : JITUserContext {
+    std::atomic<bool> error_occurred{false};
+};
+
+void my_error(JITUserContext *u, const char *msg) {
+    ((ErrorContext *)u)->error_occurred = true;
+}
+
+// Make a pipeline that visits each point of its output once, in parallel
+// loops over y and x, and fails at (bad_x, bad_y).
+Pipeline make_pipeline(int slot, Param<int> &bad_x, Param<int> &bad_y) {
+    Func f;
+    Var x, y;
+    f(x, y) = require(x != bad_x || y != bad_y, visit(slot, x, y), "visited the bad point");
+    f.parallel(x).parallel(y);
+    Pipeline p(f);
+    p.compile_jit();
+    return p;
+}
+
+bool check(int slot, int w, int h, int bad_x, int bad_y) {
+    bool ok = true;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int expected = (x == bad_x && y == bad_y) ? 0 : 1;
+            int actual = visits[slot][y][x].exchange(0);
+            if (actual != expected) {
+                printf("Slot %d: (%d, %d) of %dx%d was visited %d times instead of %d\n",
+                       slot, x, y, w, h, actual, expected);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+// Realize a sequence of shapes, failing at one point of every third.
+bool run(Pipeline &p, int slot, Param<int> &bad_x, Param<int> &bad_y, int reps, uint32_t seed) {
+    for (int i = 0; i < reps; i++) {
+        seed = seed * 1103515245 + 12345;
+        const int w = 1 + (seed >> 8) % max_size;
+        const int h = 1 + (seed >> 16) % max_size;
+        const bool fail = (i % 3 == 0);
+        bad_x.set(fail ? (int)((seed >> 4) % w) : -1);
+        bad_y.set(fail ? (int)((seed >> 12) % h) : -1);
+        ErrorContext ctx;
+        ctx.handlers.custom_error = my_error;
+        Buffer<int> out(w, h);
+        p.realize(&ctx, out);
+        if (fail && !ctx.error_occurred) {
+            printf("Slot %d: there was supposed to be an error\n", slot);
+            return false;
+        }
+        // Every other iteration of a loop still runs when one fails.
+        if (!check(slot, w, h, bad_x.get(), bad_y.get())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support threads.\n");
+        return 0;
+    }
+
+    for (int s = 0; s < num_slots; s++) {
+        for (int y = 0; y < max_size; y++) {
+            for (int x = 0; x < max_size; x++) {
+                visits[s][y][x] = 0;
+            }
+        }
+    }
+
+    JITSharedRuntime::set_thread_pool_scheduler(halide_thread_pool_scheduler_work_stealing);
+
+    std::vector<Param<int>> bad_x(num_slots), bad_y(num_slots);
+    std::vector<Pipeline> pipelines;
+    for (int s = 0; s < num_slots; s++) {
+        pipelines.push_back(make_pipeline(s, bad_x[s], bad_y[s]));
+    }
+
+    for (int threads : {1, 2, 3, 8, 16}) {
+        JITSharedRuntime::set_num_threads(threads);
+        if (!run(pipelines[0], 0, bad_x[0], bad_y[0], 30, threads)) {
+            return 1;
+        }
+    }
+
+    // Several application threads at once, each with its own deque.
+    JITSharedRuntime::set_num_threads(8);
+    std::atomic<bool> ok{true};
+    std::vector<std::thread> threads;
+    for (int s = 0; s < num_slots; s++) {
+        threads.emplace_back([&, s]() {
+            if (!run(pipelines[s], s, bad_x[s], bad_y[s], 20, s + 100)) {
+                ok = false;
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    if (!ok) {
+        return 1;
+    }
+
+    JITSharedRuntime::set_thread_pool_scheduler(halide_thread_pool_scheduler_shared_queue);
+    JITSharedRuntime::set_num_threads(0);
+
+    printf("Success!\n");
+    return 0;
+}
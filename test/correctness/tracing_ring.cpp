@@ -0,0 +1,347 @@
+#include "Halide.h"
+#include "HalideRuntime.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Halide;
+
+// Tests the ring-buffer trace mode selected by HL_TRACE_RING, and, if the
+// path to util/HalideTraceToJSON is given as the first argument, that the
+// file it writes converts to Chrome trace JSON.
+
+namespace {
+
+using TraceFn = int32_t (*)(void *, const halide_trace_event_t *);
+using WriteRingFn = int (*)(void *, int);
+
+const int ring_size = 16;
+
+struct Thread {
+    int32_t thread_id;
+    std::vector<halide_trace_ring_event_t> events;
+};
+
+struct RingFile {
+    halide_trace_ring_header_t header;
+    std::vector<std::string> names;
+    std::vector<Thread> threads;
+};
+
+WriteRingFn write_ring = nullptr;
+TraceFn default_trace = nullptr;
+
+// Write the rings to a file and read them back in.
+bool write_and_read(const std::string &filename, RingFile *result) {
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (!f) {
+        printf("Could not open %s\n", filename.c_str());
+        return false;
+    }
+    int ret = write_ring(nullptr, fileno(f));
+    fclose(f);
+    if (ret != 0) {
+        printf("halide_write_trace_ring failed\n");
+        return false;
+    }
+
+    f = fopen(filename.c_str(), "rb");
+    bool ok = f && fread(&result->header, sizeof(result->header), 1, f) == 1 &&
+              result->header.magic == HALIDE_TRACE_RING_MAGIC;
+    result->names.clear();
+    for (uint32_t i = 0; ok && i < result->header.num_names; i++) {
+        uint32_t len = 0;
+        ok = fread(&len, sizeof(len), 1, f) == 1;
+        std::string name(len, ' ');
+        ok = ok && (len == 0 || fread(&name[0], 1, len, f) == len);
+        result->names.push_back(name);
+    }
+    result->threads.clear();
+    for (uint32_t i = 0; ok && i < result->header.num_threads; i++) {
+        halide_trace_ring_thread_t t;
+        ok = fread(&t, sizeof(t), 1, f) == 1;
+        Thread thread{t.thread_id, std::vector<halide_trace_ring_event_t>(ok ? t.num_events : 0)};
+        ok = ok && (thread.events.empty() ||
+                    fread(thread.events.data(), sizeof(halide_trace_ring_event_t), thread.events.size(), f) == thread.events.size());
+        result->threads.push_back(std::move(thread));
+    }
+    if (f) {
+        fclose(f);
+    }
+    if (!ok) {
+        printf("%s is truncated\n", filename.c_str());
+    }
+    return ok;
+}
+
+std::string name_of(const RingFile &file, uint32_t index) {
+    return index < file.names.size() ? file.names[index] : "<unknown>";
+}
+
+bool is_begin(int32_t event) {
+    return event == halide_trace_begin_pipeline ||
+           event == halide_trace_begin_realization ||
+           event == halide_trace_produce;
+}
+
+// Check that the events of a thread are oldest first, with consecutive ids.
+bool check_order(const Thread &t) {
+    for (size_t i = 1; i < t.events.size(); i++) {
+        const halide_trace_ring_event_t &e = t.events[i];
+        const halide_trace_ring_event_t &prev = t.events[i - 1];
+        if (e.time < prev.time || (e.id & 0x3fffff) != ((prev.id + 1) & 0x3fffff)) {
+            printf("Events %d and %d of thread %d are out of order\n", (int)i - 1, (int)i, t.thread_id);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check that the events of a thread are in order, and that every end
+// event whose begin is in the ring matches it. If the ring has wrapped
+// around, the events before the first complete pipeline may have lost
+// their begin events.
+bool check_thread(const RingFile &file, const Thread &t) {
+    if (!check_order(t)) {
+        return false;
+    }
+    std::map<int32_t, halide_trace_ring_event_t> open;
+    bool seen_pipeline = t.events.size() < ring_size;
+    for (size_t i = 0; i < t.events.size(); i++) {
+        const halide_trace_ring_event_t &e = t.events[i];
+        if (e.event == halide_trace_begin_pipeline) {
+            seen_pipeline = true;
+        }
+        if (is_begin(e.event)) {
+            open[e.id] = e;
+            continue;
+        }
+        auto it = open.find(e.parent_id);
+        if (it != open.end()) {
+            if (it->second.name != e.name || it->second.event + 1 != e.event) {
+                printf("End event %s doesn't match its begin event %s\n",
+                       name_of(file, e.name).c_str(), name_of(file, it->second.name).c_str());
+                return false;
+            }
+            open.erase(it);
+        } else if (seen_pipeline) {
+            printf("End event %d of thread %d has no begin event\n", (int)i, t.thread_id);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Record a pipeline begin and end event for the given name.
+void trace_pipeline_events(const char *name) {
+    halide_trace_event_t e = {};
+    e.func = name;
+    e.event = halide_trace_begin_pipeline;
+    e.parent_id = 0;
+    int32_t id = default_trace(nullptr, &e);
+    e.event = halide_trace_end_pipeline;
+    e.parent_id = id;
+    default_trace(nullptr, &e);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+    return 0;
+#else
+    const Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] The ring trace mode can't be read back from WebAssembly.\n");
+        return 0;
+    }
+
+    Internal::TemporaryFile ring_tmp("tracing_ring", ".bin");
+    Internal::TemporaryFile json_tmp("tracing_ring", ".json");
+    const std::string &ring_file = ring_tmp.pathname();
+    const std::string &json_file = json_tmp.pathname();
+    setenv("HL_TRACE_RING", ring_file.c_str(), 1);
+    setenv("HL_TRACE_RING_SIZE", std::to_string(ring_size).c_str(), 1);
+
+    Var x("x");
+    Func f("ring_f"), g("ring_g");
+    f(x) = x * 2;
+    g(x) = f(x) + 1;
+    f.compute_root().trace_realizations();
+    g.trace_realizations();
+    Pipeline p(g);
+    p.compile_jit(target);
+
+    // Each run records a handful of events, fewer than fit in a ring.
+    Buffer<int> out = p.realize({64}, target);
+
+    write_ring = (WriteRingFn)Internal::JITSharedRuntime::find_symbol(target, "halide_write_trace_ring");
+    default_trace = (TraceFn)Internal::JITSharedRuntime::find_symbol(target, "halide_default_trace");
+    if (!write_ring || !default_trace) {
+        printf("Could not find the ring trace functions in the JIT runtime\n");
+        return 1;
+    }
+
+    RingFile file;
+    if (!write_and_read(ring_file, &file)) {
+        return 1;
+    }
+    if (file.threads.size() != 1) {
+        printf("Events from %d threads instead of 1\n", (int)file.threads.size());
+        return 1;
+    }
+    const size_t events_per_run = file.threads[0].events.size();
+    if (events_per_run < 8 || events_per_run >= ring_size) {
+        printf("%d events from one run\n", (int)events_per_run);
+        return 1;
+    }
+    if (!check_thread(file, file.threads[0])) {
+        return 1;
+    }
+    for (const halide_trace_ring_event_t &e : file.threads[0].events) {
+        std::string name = name_of(file, e.name);
+        if (e.event != halide_trace_begin_pipeline && e.event != halide_trace_end_pipeline &&
+            name != "ring_f" && name != "ring_g") {
+            printf("Unexpected name %s\n", name.c_str());
+            return 1;
+        }
+    }
+
+    // Enough runs to wrap around the ring several times. Only the most
+    // recent events are kept, oldest first.
+    for (int i = 0; i < 5; i++) {
+        p.realize(out, target);
+    }
+    if (!write_and_read(ring_file, &file)) {
+        return 1;
+    }
+    if (file.threads.size() != 1 || file.threads[0].events.size() != ring_size) {
+        printf("Expected one full ring of %d events\n", ring_size);
+        return 1;
+    }
+    if (!check_thread(file, file.threads[0]) ||
+        file.threads[0].events.back().event != halide_trace_end_pipeline) {
+        printf("The ring doesn't end with the last run\n");
+        return 1;
+    }
+
+    // Names are interned by contents, not by address.
+    char name[16];
+    snprintf(name, sizeof(name), "first");
+    trace_pipeline_events(name);
+    snprintf(name, sizeof(name), "second");
+    trace_pipeline_events(name);
+    if (!write_and_read(ring_file, &file) || file.threads.size() != 1 ||
+        file.threads[0].events.size() != 4 ||
+        name_of(file, file.threads[0].events[0].name) != "first" ||
+        name_of(file, file.threads[0].events[2].name) != "second") {
+        printf("Names were not interned by their contents\n");
+        return 1;
+    }
+
+    // Rings are given back when they are written out, so threads that
+    // come and go don't use them up for good. Meanwhile, events from
+    // threads that can't get a ring are counted.
+    const int num_threads = 300;
+    for (int i = 0; i < num_threads; i++) {
+        std::thread t([]() { trace_pipeline_events("churn"); });
+        t.join();
+    }
+    if (!write_and_read(ring_file, &file) || file.threads.size() != 256 ||
+        file.header.num_dropped_events != 2 * (num_threads - 256)) {
+        printf("Dropped events were not counted\n");
+        return 1;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        std::thread t([]() { trace_pipeline_events("churn"); });
+        t.join();
+        if (i % 100 == 99 && !write_and_read(ring_file, &file)) {
+            return 1;
+        }
+        if (i % 100 == 99 && (file.threads.size() != 100 || file.header.num_dropped_events != 0)) {
+            printf("Rings were not given back when written out\n");
+            return 1;
+        }
+    }
+
+    // The rings can be written out while other threads record into them.
+    // A pipeline's begin and end events may then be written out
+    // separately, so only check the order and names of the events.
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> recorders;
+    for (int i = 0; i < 4; i++) {
+        recorders.emplace_back([&]() {
+            while (!stop) {
+                trace_pipeline_events("concurrent");
+            }
+        });
+    }
+    bool concurrent_ok = true;
+    for (int i = 0; concurrent_ok && i < 100; i++) {
+        concurrent_ok = write_and_read(ring_file, &file);
+        for (const Thread &t : file.threads) {
+            concurrent_ok = concurrent_ok && check_order(t);
+            for (const halide_trace_ring_event_t &e : t.events) {
+                if (name_of(file, e.name) != "concurrent") {
+                    printf("Unexpected name %s while recording concurrently\n", name_of(file, e.name).c_str());
+                    concurrent_ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    stop = true;
+    for (auto &t : recorders) {
+        t.join();
+    }
+    if (!concurrent_ok) {
+        return 1;
+    }
+
+    // Round trip through the converter.
+    if (argc > 1) {
+        p.realize(out, target);
+        FILE *f = fopen(ring_file.c_str(), "wb");
+        if (!f || write_ring(nullptr, fileno(f)) != 0) {
+            printf("Could not write %s\n", ring_file.c_str());
+            return 1;
+        }
+        fclose(f);
+        std::string cmd = std::string(argv[1]) + " -i " + ring_file + " -o " + json_file;
+        if (system(cmd.c_str()) != 0) {
+            printf("%s failed\n", cmd.c_str());
+            return 1;
+        }
+        std::ifstream json(json_file);
+        std::stringstream contents;
+        contents << json.rdbuf();
+        std::string s = contents.str();
+        for (const char *expected : {"\"traceEvents\"", "\"name\": \"ring_f\"", "\"name\": \"ring_g\"", "\"ph\": \"X\""}) {
+            if (s.find(expected) == std::string::npos) {
+                printf("%s is missing %s\n", json_file.c_str(), expected);
+                return 1;
+            }
+        }
+    }
+
+    // Write the rings out now rather than at exit, after the temporary
+    // file is gone.
+    using ShutdownFn = int (*)();
+    auto shutdown = (ShutdownFn)Internal::JITSharedRuntime::find_symbol(target, "halide_shutdown_trace");
+    if (!shutdown || shutdown() != 0) {
+        printf("halide_shutdown_trace failed\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -11,8 +11,8 @@ using namespace Halide::Runtime;
 const int kSize = 32;
 
 void verify(const Buffer<int32_t, 3> &img, float f1, float f2) {
-    for (int i = 0; i < kSize; i++) {
-        for (int j = 0; j < kSize; j++) {
+    for (int i = 0; i < img.width(); i++) {
+        for (int j = 0; j < img.height(); j++) {
             for (int c = 0; c < 3; c++) {
                 int expected = (int32_t)(c * (i > j ? i : j) * f1 / f2);
                 if (img(i, j, c) != expected) {
@@ -49,6 +49,54 @@ int main(int argc, char **argv) {
     }
     verify(output, arg0, arg1);
 
+    // Verify that a batch of calls with differing arguments and output
+    // sizes, made via halide_call_argv_batch, produces the correct results.
+    const int kBatch = 20;
+    float scales[kBatch];
+    float one = 1.0f;
+    Buffer<int32_t, 3> outputs[kBatch];
+    void *batch_args[kBatch][3];
+    void **batch_argvs[kBatch];
+    int exit_statuses[kBatch];
+    for (int i = 0; i < kBatch; i++) {
+        scales[i] = i * 0.5f;
+        outputs[i] = Buffer<int32_t, 3>(kSize - i, kSize + i, 3);
+        batch_args[i][0] = &scales[i];
+        batch_args[i][1] = &one;
+        batch_args[i][2] = (halide_buffer_t *)outputs[i];
+        batch_argvs[i] = batch_args[i];
+    }
+    result = halide_call_argv_batch(nullptr, argvcall_argv, kBatch, batch_argvs, exit_statuses);
+    if (result != 0) {
+        fprintf(stderr, "Batch result: %d\n", result);
+        exit(1);
+    }
+    for (int i = 0; i < kBatch; i++) {
+        verify(outputs[i], scales[i], 1.0f);
+    }
+
+    // A failing call in the batch doesn't stop the others when the exit
+    // statuses are requested.
+    Buffer<int32_t, 3> bad_output(kSize, kSize, 2);
+    batch_args[kBatch / 2][2] = (halide_buffer_t *)bad_output;
+    for (int i = 0; i < kBatch; i++) {
+        outputs[i].fill(-1);
+    }
+    result = halide_call_argv_batch(nullptr, argvcall_argv, kBatch, batch_argvs, exit_statuses);
+    if (result == 0 || exit_statuses[kBatch / 2] != result) {
+        fprintf(stderr, "Batch with a bad output should have failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < kBatch; i++) {
+        if (i != kBatch / 2) {
+            if (exit_statuses[i] != 0) {
+                fprintf(stderr, "Call %d in the batch failed: %d\n", i, exit_statuses[i]);
+                exit(1);
+            }
+            verify(outputs[i], scales[i], 1.0f);
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,129 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "batch_entry_point.h"
+
+using namespace Halide::Runtime;
+
+int mallocs = 0;
+
+void *my_halide_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x + 40);
+    // Round up to next multiple of 32. Should add at least 8 bytes so we can fit the original pointer.
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_halide_free(void *user_context, void *ptr) {
+    if (!ptr) return;
+    free(((void **)ptr)[-1]);
+}
+
+int errors = 0;
+
+void my_halide_error(void *user_context, const char *msg) {
+    errors++;
+}
+
+const int kBatch = 12;
+
+// The shape of each image in the batch. Runs of images share a shape.
+int width(int i) {
+    return 5 + 3 * (i / 4) - (i % 4 == 3);
+}
+
+int height(int i) {
+    return 7 - (i / 4);
+}
+
+int main(int argc, char **argv) {
+    halide_set_custom_malloc(my_halide_malloc);
+    halide_set_custom_free(my_halide_free);
+    halide_set_error_handler(my_halide_error);
+
+    Buffer<uint8_t, 2> inputs[kBatch], outputs[kBatch], correct[kBatch];
+    halide_buffer_t *input_ptrs[kBatch], *output_ptrs[kBatch];
+    for (int i = 0; i < kBatch; i++) {
+        inputs[i] = Buffer<uint8_t, 2>(width(i) + 1, height(i) + 1);
+        inputs[i].for_each_element([&](int x, int y) {
+            inputs[i](x, y) = (uint8_t)(x * 17 + y * 5 + i * 31);
+        });
+        outputs[i] = Buffer<uint8_t, 2>(width(i), height(i));
+        correct[i] = Buffer<uint8_t, 2>(width(i), height(i));
+        input_ptrs[i] = inputs[i];
+        output_ptrs[i] = outputs[i];
+
+        int result = batch_entry_point(inputs[i], 3, correct[i]);
+        if (result != 0) {
+            printf("Call %d failed: %d\n", i, result);
+            return 1;
+        }
+    }
+
+    // The batch allocates the intermediate once, at the largest size any
+    // image needs, rather than once per image.
+    mallocs = 0;
+    int result = batch_entry_point_batch(input_ptrs, 3, output_ptrs, kBatch);
+    if (result != 0) {
+        printf("Batch failed: %d\n", result);
+        return 1;
+    }
+    if (mallocs != 1) {
+        printf("The batch made %d calls to halide_malloc instead of 1\n", mallocs);
+        return 1;
+    }
+    for (int i = 0; i < kBatch; i++) {
+        outputs[i].for_each_element([&](int x, int y) {
+            if (outputs[i](x, y) != correct[i](x, y)) {
+                printf("outputs[%d](%d, %d) = %d instead of %d\n",
+                       i, x, y, outputs[i](x, y), correct[i](x, y));
+                exit(1);
+            }
+        });
+    }
+
+    // An empty batch does nothing.
+    result = batch_entry_point_batch(input_ptrs, 3, output_ptrs, 0);
+    if (result != 0) {
+        printf("Empty batch failed: %d\n", result);
+        return 1;
+    }
+
+    // The checks are still made for each new shape: an input too small for
+    // its output partway through the batch is an error, and the images
+    // after it are not run.
+    Buffer<uint8_t, 2> small_input(width(kBatch - 1), height(kBatch - 1) + 1);
+    Buffer<uint8_t, 2> untouched(width(kBatch - 1), height(kBatch - 1));
+    untouched.fill(0);
+    input_ptrs[kBatch - 2] = small_input;
+    output_ptrs[kBatch - 1] = untouched;
+    result = batch_entry_point_batch(input_ptrs, 3, output_ptrs, kBatch);
+    if (result != halide_error_code_access_out_of_bounds || errors != 1) {
+        printf("Batch with a bad input returned %d with %d errors\n", result, errors);
+        return 1;
+    }
+    if (!untouched.all_equal(0)) {
+        printf("The batch ran an image after the one that failed\n");
+        return 1;
+    }
+
+    // A null buffer is an error too, and is caught before the sizes of the
+    // shared allocations are found.
+    input_ptrs[kBatch - 2] = inputs[kBatch - 2];
+    input_ptrs[kBatch - 1] = nullptr;
+    output_ptrs[kBatch - 1] = outputs[kBatch - 1];
+    errors = 0;
+    result = batch_entry_point_batch(input_ptrs, 3, output_ptrs, kBatch);
+    if (result != halide_error_code_buffer_argument_is_null || errors != 1) {
+        printf("Batch with a null input returned %d with %d errors\n", result, errors);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "Halide.h"
+
+namespace {
+
+class BatchEntryPoint : public Halide::Generator<BatchEntryPoint> {
+public:
+    Input<Buffer<uint8_t, 2>> input{"input"};
+    Input<int> offset{"offset"};
+    Output<Buffer<uint8_t, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        Func sum("sum");
+
+        // An intermediate that must be allocated on the heap, with a size
+        // that depends on the shape of the output.
+        sum(x, y) = cast<uint16_t>(input(x, y)) + input(x + 1, y);
+        output(x, y) = cast<uint8_t>((sum(x, y) + sum(x, y + 1) + offset) / 4);
+
+        sum.compute_root();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(BatchEntryPoint, batch_entry_point)
@@ -0,0 +1,52 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+#include "profiler_counters_multitarget.h"
+
+#include <cstdio>
+
+using namespace Halide::Runtime;
+
+// The first sub-target reads hardware performance counters and the second
+// doesn't, but they share one runtime, which must provide the counters.
+
+namespace {
+
+bool saw_counters_target = false;
+
+int my_can_use_target_features(int count, const uint64_t *features) {
+    const int word = halide_target_feature_profile_hardware_counters / 64;
+    const int bit = halide_target_feature_profile_hardware_counters % 64;
+    if (features[word] & (1ULL << bit)) {
+        saw_counters_target = true;
+    }
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    halide_set_custom_can_use_target_features(my_can_use_target_features);
+
+    const int size = 1024;
+    Buffer<int32_t, 1> input(size + 1), output(size);
+    input.for_each_element([&](int x) { input(x) = x; });
+
+    if (profiler_counters_multitarget(input, output) != 0) {
+        printf("Pipeline failed\n");
+        return 1;
+    }
+    if (!saw_counters_target) {
+        printf("The sub-target with hardware counters was never considered\n");
+        return 1;
+    }
+    for (int x = 0; x < size; x++) {
+        int correct = (2 * x + 1) * 2;
+        if (output(x) != correct) {
+            printf("output(%d) = %d instead of %d\n", x, output(x), correct);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
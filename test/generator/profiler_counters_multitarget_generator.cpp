@@ -0,0 +1,21 @@
+#include "Halide.h"
+
+namespace {
+
+class ProfilerCountersMultitarget : public Halide::Generator<ProfilerCountersMultitarget> {
+public:
+    Input<Buffer<int32_t, 1>> input{"input"};
+    Output<Buffer<int32_t, 1>> output{"output"};
+
+    void generate() {
+        Var x;
+        Func blur("blur");
+        blur(x) = input(x) + input(x + 1);
+        output(x) = blur(x) * 2;
+        blur.compute_root();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ProfilerCountersMultitarget, profiler_counters_multitarget)
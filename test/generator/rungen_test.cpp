@@ -92,8 +92,35 @@ int main(int argc, char **argv) {
         check(out.str() == expected_out);
     }
 
-    // TODO: add more here; all this does is verify that we can instantiate correctly
-    // and that 'describe' parses the metadata as expected.
+    {
+        std::ostringstream out, err;
+        capture_cout = &out;
+        capture_cerr = &err;
+
+        std::set<std::string> seen_args;
+        r.parse_one("runtime_factor", "2", &seen_args);
+        r.validate(seen_args, "", "", true);
+        r.load_inputs("[32,32,3]");
+        std::vector<Shape> constrained_shapes = r.run_bounds_query();
+        r.adapt_input_buffers(constrained_shapes);
+        r.allocate_output_buffers(constrained_shapes);
+
+        r.set_parsable_output(true);
+        r.run_for_concurrent_benchmark(3, 0.05, {1, 2});
+
+        check(err.str() == "");
+        for (const char *key : {"example  NUM_THREADS_1_CALLS_PER_SEC  ",
+                                "example  NUM_THREADS_1_P99_MSEC  ",
+                                "example  NUM_THREADS_2_CONCURRENT_CALLERS  3\n",
+                                "example  NUM_THREADS_2_P999_MSEC  ",
+                                "example  HALIDE_TARGET  "}) {
+            check(out.str().find(key) != std::string::npos, "Missing concurrent benchmark output");
+        }
+    }
+
+    // TODO: add more here; all this does is verify that we can instantiate correctly,
+    // that 'describe' parses the metadata as expected, and that the concurrent
+    // benchmark reports what it should.
 
     std::cout << "Success!\n";
     return 0;
@@ -0,0 +1,132 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+using namespace Halide::Internal;
+using namespace Halide::Tools;
+
+// Measure how long it takes to deserialize a large pipeline from a
+// memory-mapped file and from a stream, and how much memory the
+// deserialized pipelines take up.
+
+namespace {
+
+Pipeline make_pipeline(int stages) {
+    ImageParam input(Float(32), 2, "input");
+    Var x("x"), y("y");
+    std::vector<Func> fs;
+    fs.emplace_back("f0");
+    fs[0](x, y) = input(x, y);
+    for (int i = 1; i < stages; i++) {
+        Func f("f" + std::to_string(i));
+        const Func &g = fs.back();
+        // Generated pipelines often reuse an Expr many times over, which
+        // makes the IR a DAG much smaller than the tree it represents.
+        Expr e = g(x, y);
+        for (int j = 0; j < 6; j++) {
+            e = select(e > 0.5f, e * 0.5f, e + g(x + j, y - j));
+        }
+        f(x, y) = e;
+        fs.push_back(f);
+    }
+    return Pipeline(fs.back());
+}
+
+class CountNodes : public IRGraphVisitor {
+    std::set<const IRNode *> seen;
+
+public:
+    int count = 0;
+
+protected:
+    using IRGraphVisitor::include;
+    void include(const Expr &e) override {
+        if (seen.insert(e.get()).second) {
+            count++;
+        }
+        IRGraphVisitor::include(e);
+    }
+};
+
+int count_nodes(const Pipeline &p) {
+    CountNodes counter;
+    for (const Func &f : p.outputs()) {
+        std::map<std::string, Function> env = find_transitive_calls(f.function());
+        for (const auto &it : env) {
+            for (const Expr &e : it.second.definition().values()) {
+                e.accept(&counter);
+            }
+        }
+    }
+    return counter.count;
+}
+
+size_t resident_bytes() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifndef TEST_WITH_SERIALIZATION
+    printf("[SKIP] Serialization isn't enabled in this build of Halide.\n");
+    return 0;
+#else
+    const std::string filename = get_test_tmp_dir() + "halide_test_performance_deserialization.hlpipe";
+    Pipeline p = make_pipeline(200);
+    serialize_pipeline(p, filename);
+    const size_t file_size = file_stat(filename).file_size;
+
+    double mapped = benchmark(1, 5, [&]() {
+        deserialize_pipeline(filename, {});
+    });
+    double streamed = benchmark(1, 5, [&]() {
+        std::ifstream in(filename, std::ios::binary | std::ios::in);
+        deserialize_pipeline(in, {});
+    });
+    printf("Deserializing a %d KB pipeline: %f ms from a mapped file, %f ms from a stream\n",
+           (int)(file_size / 1024), mapped * 1e3, streamed * 1e3);
+
+    // Subexpressions shared in the original must be shared again, rather
+    // than rebuilt once per use.
+    const int nodes = count_nodes(p);
+    Pipeline q = deserialize_pipeline(filename, {});
+    const int deserialized_nodes = count_nodes(q);
+    if (nodes != deserialized_nodes) {
+        printf("The original pipeline has %d distinct Expr nodes, but the deserialized one has %d\n",
+               nodes, deserialized_nodes);
+        return 1;
+    }
+
+    const int copies = 10;
+    const size_t before = resident_bytes();
+    std::vector<Pipeline> pipelines;
+    for (int i = 0; i < copies; i++) {
+        pipelines.push_back(deserialize_pipeline(filename, {}));
+    }
+    const size_t after = resident_bytes();
+    if (before != 0 && after > before) {
+        printf("Resident memory grew by %d KB per deserialized pipeline\n",
+               (int)((after - before) / copies / 1024));
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,130 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Measure how long it takes to compile one large pipeline with the
+// independent parts of its compilation run on one thread and on four (see
+// HL_COMPILE_THREADS). Those are the functions for its parallel tasks,
+// and, for a target with the split_codegen feature, the optimization and
+// code generation of each partition of its LLVM module. Each compile runs
+// in a process of its own, so that names made by earlier compiles don't
+// differ between them, and the outputs, which must not depend on the
+// number of threads, can be compared.
+
+namespace {
+
+void set_compile_threads(const char *value) {
+#ifdef _WIN32
+    _putenv_s("HL_COMPILE_THREADS", value);
+#else
+    setenv("HL_COMPILE_THREADS", value, 1);
+#endif
+}
+
+Func make_pipeline(int stages) {
+    ImageParam input(Float(32), 2, "input");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    std::vector<Func> fs;
+    fs.emplace_back("f0");
+    fs[0](x, y) = input(x, y);
+    for (int i = 1; i < stages; i++) {
+        Func f("f" + std::to_string(i));
+        const Func &g = fs.back();
+        f(x, y) = (g(x - 1, y) + 2 * g(x, y) + g(x + 1, y)) * 0.25f + g(x, y - 1) * 0.5f;
+        fs.push_back(f);
+    }
+    // Each compute_root stage has its own parallel loop, and so its own
+    // function for the body of the loop, with the stages computed within
+    // it inlined into that.
+    for (int i = 1; i < stages; i++) {
+        Func &f = fs[i];
+        if (i == stages - 1 || i % 4 == 0) {
+            f.compute_root().tile(x, y, xi, yi, 64, 16).parallel(y).vectorize(xi, 8);
+        } else {
+            f.compute_at(fs[(i / 4 + 1) * 4 < stages ? (i / 4 + 1) * 4 : stages - 1], x).vectorize(x, 8);
+        }
+    }
+    return fs.back();
+}
+
+struct Output {
+    const char *kind;
+    const char *extension;
+};
+
+const Output outputs[] = {
+    {"object", ".o"},
+    {"split_object", ".o"},
+    {"split_library", ".a"},
+};
+
+// Compile the pipeline to the given kind of output, and report how long
+// that took.
+int compile(const std::string &kind, const std::string &prefix) {
+    Func f = make_pipeline(128);
+    Target host = get_host_target();
+    Target split = host.with_feature(Target::SplitCodegen);
+    double t;
+    if (kind == "object") {
+        t = benchmark(1, 1, [&]() { f.compile_to_object(prefix + ".o", f.infer_arguments(), "pipeline", host); });
+    } else if (kind == "split_object") {
+        t = benchmark(1, 1, [&]() { f.compile_to_object(prefix + ".o", f.infer_arguments(), "pipeline", split); });
+    } else if (kind == "split_library") {
+        t = benchmark(1, 1, [&]() { f.compile_to_static_library(prefix, f.infer_arguments(), "pipeline", split); });
+    } else {
+        printf("Unknown kind of output %s\n", kind.c_str());
+        return 1;
+    }
+    const char *threads = getenv("HL_COMPILE_THREADS");
+    printf("Compiling to %s on %s threads: %f s\n", kind.c_str(), threads ? threads : "all", t);
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+    if (get_host_target().os == Target::Windows) {
+        printf("[SKIP] Static libraries are .lib files on Windows.\n");
+        return 0;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "--compile") == 0) {
+        return compile(argv[2], argv[3]);
+    }
+
+    std::string prefix = Internal::get_test_tmp_dir() + "halide_test_performance_parallel_compile";
+    for (const Output &o : outputs) {
+        std::vector<char> contents[2];
+        const char *threads[2] = {"1", "4"};
+        for (int i = 0; i < 2; i++) {
+            set_compile_threads(threads[i]);
+            // The same path both times, as a static library records the
+            // names of the objects in it, which are made from the path.
+            std::string out = prefix + "_" + o.kind;
+            std::string cmd = std::string(argv[0]) + " --compile " + o.kind + " " + out;
+            if (system(cmd.c_str()) != 0) {
+                printf("%s failed\n", cmd.c_str());
+                return 1;
+            }
+            contents[i] = Internal::read_entire_file(out + o.extension);
+        }
+        if (contents[0].empty() || contents[0] != contents[1]) {
+            printf("Compiling to %s on 1 and 4 threads gave different results\n", o.kind);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -149,6 +149,43 @@ int main(int argc, char **argv) {
         std::cout << std::to_string(i) << "-argument Func realize to Buffer time " << t * 1e6 << "us.\n";
     }
 
+    {
+        // Many tiny images, one call at a time and as a batch.
+        ImageParam in(UInt(8), 2);
+        Var x, y;
+        Func f;
+        f(x, y) = in(x, y) / 2 + 1;
+        f.vectorize(x, 8, TailStrategy::GuardWithIf).parallel(y);
+        Callable c = f.compile_to_callable({in});
+
+        const int n = 1000;
+        std::vector<Buffer<uint8_t>> inputs, outputs;
+        std::vector<std::tuple<Buffer<uint8_t>, Buffer<uint8_t>>> batch;
+        for (int i = 0; i < n; i++) {
+            inputs.emplace_back(8 + i % 5, 8 + i % 3);
+            inputs.back().fill((uint8_t)i);
+            outputs.emplace_back(inputs.back().width(), inputs.back().height());
+            batch.emplace_back(inputs.back(), outputs.back());
+        }
+
+        double t1 = benchmark([&]() {
+            for (int i = 0; i < n; i++) {
+                c(inputs[i], outputs[i]);
+            }
+        });
+        double t2 = benchmark([&]() { c.call_batch(batch); });
+        std::cout << "Per-image time for " << n << " tiny images: "
+                  << t1 / n * 1e6 << "us one at a time, "
+                  << t2 / n * 1e6 << "us as a batch.\n";
+
+        for (int i = 0; i < n; i++) {
+            if (outputs[i](0, 0) != (uint8_t)((uint8_t)i / 2 + 1)) {
+                std::cout << "Wrong output for image " << i << "\n";
+                return 1;
+            }
+        }
+    }
+
     std::cout << "Success!\n";
 
     return 0;
@@ -0,0 +1,86 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Compare the shared-queue and work-stealing thread pool schedulers on
+// nested parallel loops with an uneven amount of work per iteration, across
+// a range of thread counts.
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    Func f, g;
+    Var x, y, xo, xi;
+    RDom r(0, 64);
+
+    // The cost of each row varies with y, so a static partition of the outer
+    // loop would be badly imbalanced.
+    r.where(r <= y % 64);
+    f(x, y) = cast<float>(x + y);
+    g(x, y) = 0.0f;
+    g(x, y) += sqrt(f(x, y) + r);
+    f.compute_at(g, xo).vectorize(x, 8);
+    g.parallel(y);
+    g.update()
+        .split(x, xo, xi, 64)
+        .reorder(xi, r, xo, y)
+        .vectorize(xi, 8)
+        .parallel(xo)
+        .parallel(y);
+
+    Pipeline p(g);
+    p.compile_jit();
+
+    const int w = 1024, h = 256;
+    Buffer<float> reference = p.realize({w, h});
+
+    const int max_threads = 16;
+    double shared_time = 0, stealing_time = 0;
+    for (int t = 1; t <= max_threads; t *= 2) {
+        Halide::Internal::JITSharedRuntime::set_num_threads(t);
+
+        double times[2];
+        for (int s = 0; s < 2; s++) {
+            halide_thread_pool_scheduler_t scheduler =
+                s == 0 ? halide_thread_pool_scheduler_shared_queue : halide_thread_pool_scheduler_work_stealing;
+            Halide::Internal::JITSharedRuntime::set_thread_pool_scheduler(scheduler);
+
+            Buffer<float> out(w, h);
+            times[s] = benchmark([&]() { p.realize(out); });
+
+            for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                    if (out(i, j) != reference(i, j)) {
+                        printf("out(%d, %d) = %f instead of %f with %d threads\n",
+                               i, j, out(i, j), reference(i, j), t);
+                        return 1;
+                    }
+                }
+            }
+        }
+
+        printf("%2d threads: shared queue %f ms, work stealing %f ms\n",
+               t, times[0] * 1e3, times[1] * 1e3);
+        shared_time = times[0];
+        stealing_time = times[1];
+    }
+
+    Halide::Internal::JITSharedRuntime::set_thread_pool_scheduler(halide_thread_pool_scheduler_shared_queue);
+    Halide::Internal::JITSharedRuntime::set_num_threads(0);
+
+    if (stealing_time > shared_time * 3) {
+        printf("Work stealing is unacceptably slow: %f ms vs %f ms\n",
+               stealing_time * 1e3, shared_time * 1e3);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// The ring-buffer trace mode (HL_TRACE_RING) is meant to be cheap enough
+// to leave on. Report what tracing the realizations of a pipeline with it
+// costs at the granularity of a typical schedule. The cost is a few
+// percent at most, which is within the noise of a shared machine, so it
+// is not checked.
+
+namespace {
+
+Pipeline make_pipeline(ImageParam in, bool traced) {
+    Var x("x"), y("y"), yo("yo"), yi("yi");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (in(x, y) + in(x + 1, y) + in(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+
+    // Each strip of the output is a realization of blur_x.
+    blur_y.split(y, yo, yi, 32).vectorize(x, 8);
+    blur_x.compute_at(blur_y, yo).vectorize(x, 8);
+    if (traced) {
+        blur_x.trace_realizations();
+        blur_y.trace_realizations();
+    }
+    return Pipeline(blur_y);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+    return 0;
+#else
+    Internal::TemporaryFile ring_tmp("tracing_ring", ".bin");
+    setenv("HL_TRACE_RING", ring_tmp.pathname().c_str(), 1);
+
+    const int w = 2048, h = 1024;
+    ImageParam in(UInt(16), 2, "in");
+    Buffer<uint16_t> input(w + 2, h + 2), output(w, h);
+    input.fill([](int x, int y) { return (uint16_t)(x * 7 + y * 13); });
+    in.set(input);
+
+    Pipeline plain = make_pipeline(in, false);
+    Pipeline traced = make_pipeline(in, true);
+    plain.compile_jit(target);
+    traced.compile_jit(target);
+
+    // Alternate between the two, so that both see the same machine
+    // conditions, and keep the best time of each.
+    double t_plain = 1e10, t_traced = 1e10;
+    for (int i = 0; i < 5; i++) {
+        t_plain = std::min(t_plain, benchmark(10, 10, [&]() { plain.realize(output); }));
+        t_traced = std::min(t_traced, benchmark(10, 10, [&]() { traced.realize(output); }));
+    }
+    double overhead = t_traced / t_plain - 1;
+
+    printf("Untraced: %f ms\n"
+           "Traced into the rings: %f ms\n"
+           "Overhead: %.2f%%\n",
+           t_plain * 1e3, t_traced * 1e3, overhead * 100);
+
+    // Write the rings out now rather than at exit, after the temporary
+    // file is gone.
+    using ShutdownFn = int (*)();
+    auto shutdown = (ShutdownFn)Internal::JITSharedRuntime::find_symbol(target, "halide_shutdown_trace");
+    if (shutdown) {
+        shutdown();
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
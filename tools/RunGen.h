@@ -3,6 +3,9 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <iomanip>
@@ -13,6 +16,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <vector>
@@ -312,6 +316,29 @@ inline Shape parse_extents(const std::string &extent_list) {
     return result;
 }
 
+// Parse a list of thread counts, which should be of the form
+//
+//    [count0, count1...]
+//
+// Each count must be >= 0; zero means the thread pool's default.
+inline std::vector<int> parse_thread_counts(const std::string &count_list) {
+    if (count_list.size() < 2 || count_list[0] != '[' || count_list.back() != ']') {
+        fail() << "Invalid format for thread counts: " << count_list;
+    }
+    std::vector<int> result;
+    for (const std::string &s : split_string(count_list.substr(1, count_list.size() - 2), ",")) {
+        int count;
+        if (!parse_scalar(s, &count) || count < 0) {
+            fail() << "Invalid value for thread counts: " << s << " (" << count_list << ")";
+        }
+        result.push_back(count);
+    }
+    if (result.empty()) {
+        fail() << "Thread counts must not be empty: " << count_list;
+    }
+    return result;
+}
+
 // Parse the buffer_estimate list from a given argument's metadata into a Shape.
 // If no valid buffer_estimate exists, return false.
 inline bool try_parse_metadata_buffer_estimates(const halide_filter_argument_t *md, Shape *shape) {
@@ -1298,6 +1325,102 @@ public:
         }
     }
 
+    // Call the filter from num_callers threads at once for duration seconds,
+    // once for each size of the Halide thread pool in num_threads_list, and
+    // report the overall throughput and the distribution of latencies of
+    // individual calls. Unlike run_for_benchmark(), this measures how the
+    // filter behaves when many independent calls contend for one thread
+    // pool, as they would in a server.
+    void run_for_concurrent_benchmark(int num_callers, double duration, const std::vector<int> &num_threads_list) {
+        // Inputs are only read, so the callers can share them, but each
+        // caller needs outputs of its own.
+        // caller_outputs[c] is indexed like the filter's arguments, and
+        // must not be resized once caller_argv points into it.
+        std::vector<std::vector<void *>> caller_argv(num_callers);
+        std::vector<std::vector<Buffer<>>> caller_outputs(num_callers);
+        for (int c = 0; c < num_callers; c++) {
+            caller_argv[c] = build_filter_argv();
+            caller_outputs[c].resize(args.size());
+            for (auto &arg_pair : args) {
+                auto &arg = arg_pair.second;
+                if (arg.metadata->kind == halide_argument_kind_output_buffer) {
+                    Buffer<> &b = caller_outputs[c][arg.index];
+                    b = Buffer<>::make_with_shape_of(arg.buffer_value);
+                    caller_argv[c][arg.index] = b.raw_buffer();
+                }
+            }
+        }
+
+        const auto call = [this, &caller_argv, &caller_outputs](int c) {
+            // Ignore result since our halide_error() should catch everything.
+            (void)halide_argv_call(&caller_argv[c][0]);
+            for (Buffer<> &b : caller_outputs[c]) {
+                if (b.data()) {
+                    b.device_sync();
+                }
+            }
+        };
+
+        // Warm up each caller's outputs (and any device allocations) so
+        // that they don't land in the first measurement.
+        for (int c = 0; c < num_callers; c++) {
+            call(c);
+        }
+
+        info() << "Benchmarking filter with " << num_callers << " concurrent callers...";
+
+        const int previous_num_threads = halide_set_num_threads(0);
+        for (int requested_num_threads : num_threads_list) {
+            // halide_set_num_threads() returns the previous value, so
+            // setting it twice tells us what a request for zero (the
+            // default) resolved to.
+            halide_set_num_threads(requested_num_threads);
+            const int num_threads = halide_set_num_threads(requested_num_threads);
+
+            std::vector<std::vector<double>> caller_latencies(num_callers);
+            std::atomic<bool> go(false);
+            auto start = Halide::Tools::benchmark_now();
+            double elapsed = 0;
+            std::mutex elapsed_mutex;
+            std::vector<std::thread> callers;
+            for (int c = 0; c < num_callers; c++) {
+                callers.emplace_back([&, c]() {
+                    while (!go.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    std::vector<double> &latencies = caller_latencies[c];
+                    double end_time;
+                    do {
+                        auto t0 = Halide::Tools::benchmark_now();
+                        call(c);
+                        auto t1 = Halide::Tools::benchmark_now();
+                        latencies.push_back(Halide::Tools::benchmark_duration_seconds(t0, t1));
+                        end_time = Halide::Tools::benchmark_duration_seconds(start, t1);
+                    } while (end_time < duration);
+                    std::lock_guard<std::mutex> lock(elapsed_mutex);
+                    elapsed = std::max(elapsed, end_time);
+                });
+            }
+            start = Halide::Tools::benchmark_now();
+            go.store(true, std::memory_order_release);
+            for (std::thread &t : callers) {
+                t.join();
+            }
+
+            std::vector<double> latencies;
+            for (const auto &l : caller_latencies) {
+                latencies.insert(latencies.end(), l.begin(), l.end());
+            }
+            std::sort(latencies.begin(), latencies.end());
+            report_concurrent_benchmark(num_callers, num_threads, elapsed, latencies);
+        }
+        halide_set_num_threads(previous_num_threads);
+
+        if (parsable_output) {
+            out() << md->name << "  HALIDE_TARGET  " << md->target << "\n";
+        }
+    }
+
     struct Output {
         std::string name;
         Buffer<> actual;
@@ -1381,6 +1504,70 @@ private:
         // nothing
     }
 
+    // Print the results of one run of run_for_concurrent_benchmark(), with
+    // the latencies (in seconds) sorted in increasing order.
+    void report_concurrent_benchmark(int num_callers, int num_threads, double elapsed,
+                                     const std::vector<double> &latencies) const {
+        const auto percentile = [&latencies](double p) {
+            // Nearest-rank percentile.
+            size_t rank = (size_t)std::ceil(p / 100.0 * latencies.size());
+            return latencies[std::min(std::max(rank, (size_t)1), latencies.size()) - 1];
+        };
+        const double calls_per_sec = latencies.size() / elapsed;
+
+        // Bucket the latencies by powers of two microseconds, from the
+        // bucket holding the fastest call to the one holding the slowest.
+        const auto bucket_of = [](double latency) {
+            int b = 0;
+            while ((double)(1ULL << b) * 1e-6 < latency && b < 62) {
+                b++;
+            }
+            return b;
+        };
+        const int first_bucket = bucket_of(latencies.front());
+        const int last_bucket = bucket_of(latencies.back());
+        std::vector<uint64_t> histogram(last_bucket - first_bucket + 1, 0);
+        for (double l : latencies) {
+            histogram[bucket_of(l) - first_bucket]++;
+        }
+
+        if (!parsable_output) {
+            std::ostringstream o;
+            o << "Concurrent benchmark for " << md->name << " with " << num_callers << " callers and "
+              << num_threads << " threads: " << calls_per_sec << " calls/sec ("
+              << latencies.size() << " calls in " << elapsed << " sec).\n"
+              << "Latency in msec: p50 " << percentile(50) * 1000
+              << ", p90 " << percentile(90) * 1000
+              << ", p99 " << percentile(99) * 1000
+              << ", p99.9 " << percentile(99.9) * 1000
+              << ", max " << latencies.back() * 1000 << ".\n"
+              << "Output throughput is " << (megapixels_out() * calls_per_sec) << " mpix/sec.\n";
+            const uint64_t tallest = *std::max_element(histogram.begin(), histogram.end());
+            for (size_t i = 0; i < histogram.size(); i++) {
+                o << "  <= " << std::setw(10) << (1ULL << (first_bucket + i)) << " usec: "
+                  << std::setw(10) << histogram[i] << " "
+                  << std::string((size_t)(50 * histogram[i] / tallest), '#') << "\n";
+            }
+            out() << o.str();
+        } else {
+            const std::string prefix = std::string(md->name) + "  NUM_THREADS_" + std::to_string(num_threads) + "_";
+            std::ostringstream o;
+            o << prefix << "CONCURRENT_CALLERS  " << num_callers << "\n"
+              << prefix << "CALLS  " << latencies.size() << "\n"
+              << prefix << "CALLS_PER_SEC  " << calls_per_sec << "\n"
+              << prefix << "P50_MSEC  " << percentile(50) * 1000 << "\n"
+              << prefix << "P90_MSEC  " << percentile(90) * 1000 << "\n"
+              << prefix << "P99_MSEC  " << percentile(99) * 1000 << "\n"
+              << prefix << "P999_MSEC  " << percentile(99.9) * 1000 << "\n"
+              << prefix << "MAX_MSEC  " << latencies.back() * 1000 << "\n"
+              << prefix << "THROUGHPUT_MPIX_PER_SEC  " << (megapixels_out() * calls_per_sec) << "\n";
+            for (size_t i = 0; i < histogram.size(); i++) {
+                o << prefix << "LATENCY_LE_" << (1ULL << (first_bucket + i)) << "_USEC  " << histogram[i] << "\n";
+            }
+            out() << o.str();
+        }
+    }
+
     std::map<std::string, ShapePromise> bounds_query_input_shapes() const {
         assert(!output_shapes.empty());
         std::vector<void *> filter_argv(args.size(), nullptr);
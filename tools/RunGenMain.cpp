@@ -142,6 +142,27 @@ Flags:
         Override the default minimum desired benchmarking time; ignored if
         --benchmarks is not also specified.
 
+    --benchmarks=concurrent:
+        Call the filter from several threads at once for a fixed amount of
+        time, as a server handling independent requests would, and report
+        the throughput in calls/sec along with the p50/p90/p99/p99.9
+        latency of individual calls and a histogram of latencies. This is
+        repeated for each thread pool size given by --concurrent_num_threads.
+        Each caller gets its own output buffers; inputs are shared.
+
+    --concurrent_callers=NUM [default = 4]:
+        The number of threads calling the filter at once; ignored unless
+        --benchmarks=concurrent is specified.
+
+    --concurrent_duration=DURATION_SECONDS [default = 1]:
+        How long to call the filter for, for each thread pool size; ignored
+        unless --benchmarks=concurrent is specified.
+
+    --concurrent_num_threads=[NUM,NUM,...] [default = [0]]:
+        The sizes of the Halide thread pool to measure, set in turn with
+        halide_set_num_threads(); zero means the default size. Ignored
+        unless --benchmarks=concurrent is specified.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -399,6 +420,9 @@ int main(int argc, char **argv) {
     bool track_memory = false;
     bool describe = false;
     double benchmark_min_time = BenchmarkConfig().min_time;
+    int concurrent_callers = 4;
+    double concurrent_duration = 1.0;
+    std::vector<int> concurrent_num_threads = {0};
     std::string default_input_buffers;
     std::string default_input_scalars;
     std::string benchmarks_flag_value;
@@ -464,6 +488,16 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_min_time)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "concurrent_callers") {
+                if (!parse_scalar(flag_value, &concurrent_callers) || concurrent_callers < 1) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "concurrent_duration") {
+                if (!parse_scalar(flag_value, &concurrent_duration) || concurrent_duration <= 0) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "concurrent_num_threads") {
+                concurrent_num_threads = parse_thread_counts(flag_value);
             } else if (flag_name == "default_input_buffers") {
                 default_input_buffers = flag_value;
                 if (default_input_buffers.empty()) {
@@ -613,10 +647,13 @@ int main(int argc, char **argv) {
         if (benchmarks_flag_value.empty()) {
             benchmarks_flag_value = "all";
         }
-        if (benchmarks_flag_value != "all") {
-            fail() << "The only valid value for --benchmarks is 'all'";
+        if (benchmarks_flag_value == "all") {
+            r.run_for_benchmark(benchmark_min_time);
+        } else if (benchmarks_flag_value == "concurrent") {
+            r.run_for_concurrent_benchmark(concurrent_callers, concurrent_duration, concurrent_num_threads);
+        } else {
+            fail() << "Valid values for --benchmarks are 'all' and 'concurrent'";
         }
-        r.run_for_benchmark(benchmark_min_time);
     } else {
         r.run_for_output();
     }
@@ -36,6 +36,19 @@
 #include "jpeglib.h"
 #endif
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "HalideBuffer.h"   // for AllocationHeader
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -811,6 +824,83 @@ struct FileOpener {
     FILE *const f;
 };
 
+// A memory mapping of a whole file, owned by the Buffers that refer to it
+// (see load_mapped and create_mapped). The header must come first: when
+// the last Buffer lets go of the mapping, it passes the address of the
+// header to unmap().
+struct MappedFile {
+    Halide::Runtime::AllocationHeader header;
+    void *base;
+    size_t size;
+
+    // Map a file into memory. If writable, the file is first resized to
+    // size bytes, and stores to the mapping go to the file. Otherwise, the
+    // whole file is mapped, and stores to the mapping are private to it.
+    // Returns nullptr upon failure.
+    static MappedFile *map(const std::string &filename, bool writable, size_t size) {
+        void *base = nullptr;
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                                  FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        if (!writable) {
+            LARGE_INTEGER file_size;
+            size = GetFileSizeEx(file, &file_size) ? (size_t)file_size.QuadPart : 0;
+        }
+        if (size > 0) {
+            // A mapping larger than the file extends it.
+            HANDLE mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_WRITECOPY,
+                                                (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xffffffff), nullptr);
+            if (mapping != nullptr) {
+                base = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, size);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = open(filename.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        if (writable) {
+            if (ftruncate(fd, (off_t)size) != 0) {
+                size = 0;
+            }
+        } else {
+            struct stat st;
+            size = (fstat(fd, &st) == 0) ? (size_t)st.st_size : 0;
+        }
+        if (size > 0) {
+            base = mmap(nullptr, size, PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+            if (base == MAP_FAILED) {
+                base = nullptr;
+            }
+        }
+        close(fd);
+#endif
+        if (base == nullptr) {
+            return nullptr;
+        }
+        MappedFile *m = (MappedFile *)malloc(sizeof(MappedFile));
+        new (&m->header) Halide::Runtime::AllocationHeader(unmap);
+        m->base = base;
+        m->size = size;
+        return m;
+    }
+
+    static void unmap(void *header) {
+        MappedFile *m = (MappedFile *)header;
+#ifdef _WIN32
+        UnmapViewOfFile(m->base);
+#else
+        munmap(m->base, m->size);
+#endif
+        free(m);
+    }
+};
+
 constexpr int AnyDims = -1;
 
 // Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
@@ -1309,15 +1399,9 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_npy(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-
+// Read the header of a .npy file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_npy_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
     char magic_and_version[8];
     if (!check(f.read_bytes(magic_and_version, 8), "Could not read .npy header")) {
         return false;
@@ -1375,7 +1459,27 @@ bool load_npy(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    *im = ImageType(im_type, h.extents);
+    *type = im_type;
+    *extents = h.extents;
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t im_type;
+    std::vector<int> extents;
+    if (!read_npy_header<check>(f, &im_type, &extents)) {
+        return false;
+    }
+
+    *im = ImageType(im_type, extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
     if (!check(buffer_is_compact_planar(*im), "load_npy() requires compact planar images")) {
@@ -1410,15 +1514,25 @@ bool write_planar_payload(ImageType &im, FileOpener &f) {
     return true;
 }
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool save_npy(ImageType &im, const std::string &filename) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
-        return false;
+// Copy the elements of an image into memory in planar order; the
+// in-memory counterpart of write_planar_payload.
+template<typename ImageType>
+void copy_planar_payload(ImageType &im, uint8_t **dst) {
+    if (im.dimensions() == 0 || buffer_is_compact_planar(im)) {
+        memcpy(*dst, im.begin(), im.size_in_bytes());
+        *dst += im.size_in_bytes();
+    } else {
+        int d = im.dimensions() - 1;
+        for (int i = im.dim(d).min(); i <= im.dim(d).max(); i++) {
+            auto slice = im.sliced(d, i);
+            copy_planar_payload(slice, dst);
+        }
     }
+}
 
-    const halide_type_t im_type = ensure_abi_type(im.type());
+// Write the header of a .npy file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool write_npy_header(FileOpener &f, halide_type_t im_type, const std::vector<int> &extents) {
     npy_dtype_info_t di = {0, 0, 0};
     for (const auto &d : npy_dtypes) {
         if (d.first == im_type) {
@@ -1431,12 +1545,12 @@ bool save_npy(ImageType &im, const std::string &filename) {
     }
 
     std::string shape = "(";
-    for (int d = 0; d < im.dimensions(); ++d) {
+    for (size_t d = 0; d < extents.size(); ++d) {
         if (d > 0) {
             shape += ",";
         }
-        shape += std::to_string(im.dim(d).extent());
-        if (im.dimensions() == 1) {
+        shape += std::to_string(extents[d]);
+        if (extents.size() == 1) {
             shape += ",";  // special-case for single-element tuples
         }
     }
@@ -1457,7 +1571,6 @@ bool save_npy(ImageType &im, const std::string &filename) {
         (uint8_t)((header_len >> 0) & 0xff),
         (uint8_t)((header_len >> 8) & 0xff)};
 
-    FileOpener f(filename, "wb");
     if (!check(f.write_bytes(npy_magic_string.data(), npy_magic_string.size()), ".npy write failed")) {
         return false;
     }
@@ -1471,6 +1584,30 @@ bool save_npy(ImageType &im, const std::string &filename) {
         return false;
     }
 
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_npy(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
+        return false;
+    }
+
+    std::vector<int> extents(im.dimensions());
+    for (int d = 0; d < im.dimensions(); ++d) {
+        extents[d] = im.dim(d).extent();
+    }
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    if (!write_npy_header<check>(f, ensure_abi_type(im.type()), extents)) {
+        return false;
+    }
+
     if (!write_planar_payload<ImageType, check>(im, f)) {
         return false;
     }
@@ -1627,6 +1764,25 @@ inline const halide_type_t *tmp_code_to_halide_type() {
     return tmp_code_to_halide_type_;
 }
 
+// Read the header of a .tmp file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_tmp_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
+    int32_t header[5];
+    if (!check(f.read_array(header), "Count not read .tmp header")) {
+        return false;
+    }
+
+    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
+                   header[4] >= 0 && header[4] < kNumTmpCodes,
+               "Bad header on .tmp file")) {
+        return false;
+    }
+
+    *type = tmp_code_to_halide_type()[header[4]];
+    *extents = {header[0], header[1], header[2], header[3]};
+    return true;
+}
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
 template<typename ImageType, CheckFunc check = CheckReturn>
 bool load_tmp(const std::string &filename, ImageType *im) {
@@ -1637,19 +1793,11 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    int32_t header[5];
-    if (!check(f.read_array(header), "Count not read .tmp header")) {
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    if (!read_tmp_header<check>(f, &im_type, &im_dimensions)) {
         return false;
     }
-
-    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
-                   header[4] >= 0 && header[4] < kNumTmpCodes,
-               "Bad header on .tmp file")) {
-        return false;
-    }
-
-    const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
-    std::vector<int> im_dimensions = {header[0], header[1], header[2], header[3]};
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1682,22 +1830,16 @@ inline const std::set<FormatInfo> &query_tmp() {
     return info;
 }
 
-// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool save_tmp(ImageType &im, const std::string &filename) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
-        return false;
-    }
-
+// Write the header of a .tmp file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool write_tmp_header(FileOpener &f, halide_type_t type, const std::vector<int> &extents) {
     int32_t header[5] = {1, 1, 1, 1, -1};
-    for (int i = 0; i < im.dimensions(); ++i) {
-        header[i] = im.dim(i).extent();
+    for (size_t i = 0; i < extents.size() && i < 4; ++i) {
+        header[i] = extents[i];
     }
     const auto *table = tmp_code_to_halide_type();
     for (int i = 0; i < kNumTmpCodes; i++) {
-        if (im.type() == table[i]) {
+        if (type == table[i]) {
             header[4] = i;
             break;
         }
@@ -1706,11 +1848,31 @@ bool save_tmp(ImageType &im, const std::string &filename) {
         return false;
     }
 
+    if (!check(f.write_array(header), "Could not write .tmp header")) {
+        return false;
+    }
+    return true;
+}
+
+// ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_tmp(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
+        return false;
+    }
+
+    std::vector<int> extents(im.dimensions());
+    for (int d = 0; d < im.dimensions(); ++d) {
+        extents[d] = im.dim(d).extent();
+    }
+
     FileOpener f(filename, "wb");
     if (!check(f.f != nullptr, "File could not be opened for writing")) {
         return false;
     }
-    if (!check(f.write_array(header), "Could not write .tmp header")) {
+    if (!write_tmp_header<check>(f, ensure_abi_type(im.type()), extents)) {
         return false;
     }
 
@@ -1756,15 +1918,9 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_mat(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-
+// Read the header of a .mat file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_mat_header(FileOpener &f, halide_type_t *type_out, std::vector<int> *extents_out) {
     uint8_t header[128];
     if (!check(f.read_array(header), "Could not read .mat header\n")) {
         return false;
@@ -1875,6 +2031,26 @@ bool load_mat(const std::string &filename, ImageType *im) {
         return false;
     }
 
+    *type_out = type;
+    *extents_out = extents;
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t type;
+    std::vector<int> extents;
+    if (!read_mat_header<check>(f, &type, &extents)) {
+        return false;
+    }
+
     *im = ImageType(type, extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1912,18 +2088,21 @@ inline const std::set<FormatInfo> &query_mat() {
     return info;
 }
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool save_mat(ImageType &im, const std::string &filename) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
-        return false;
-    }
+// The number of bytes of padding that must follow a .mat payload of the
+// given size.
+inline uint32_t mat_padding_bytes(uint64_t payload_bytes) {
+    return 7 - ((payload_bytes - 1) & 7);
+}
 
+// Write the header of a .mat file holding one array, named after the
+// file, leaving f at the start of the payload. The payload must be
+// followed by mat_padding_bytes() of padding.
+template<CheckFunc check = CheckReturn>
+bool write_mat_header(FileOpener &f, const std::string &filename, halide_type_t type, const std::vector<int> &im_extents) {
     uint32_t class_code = 0, type_code = 0;
-    switch (im.raw_buffer()->type.code) {
+    switch (type.code) {
     case halide_type_int:
-        switch (im.raw_buffer()->type.bits) {
+        switch (type.bits) {
         case 8:
             class_code = mxINT8_CLASS;
             type_code = miINT8;
@@ -1945,7 +2124,7 @@ bool save_mat(ImageType &im, const std::string &filename) {
         };
         break;
     case halide_type_uint:
-        switch (im.raw_buffer()->type.bits) {
+        switch (type.bits) {
         case 8:
             class_code = mxUINT8_CLASS;
             type_code = miUINT8;
@@ -1967,7 +2146,7 @@ bool save_mat(ImageType &im, const std::string &filename) {
         };
         break;
     case halide_type_float:
-        switch (im.raw_buffer()->type.bits) {
+        switch (type.bits) {
         case 16:
             check(false, "float16 not supported by .mat");
             break;
@@ -1990,11 +2169,6 @@ bool save_mat(ImageType &im, const std::string &filename) {
         check(false, "unreachable");
     }
 
-    FileOpener f(filename, "wb");
-    if (!check(f.f != nullptr, "File could not be opened for writing")) {
-        return false;
-    }
-
     // Pick a name for the array
     size_t idx = filename.rfind('.');
     std::string name = filename.substr(0, idx);
@@ -2029,19 +2203,22 @@ bool save_mat(ImageType &im, const std::string &filename) {
     header[126] = 'I';
     header[127] = 'M';
 
-    uint64_t payload_bytes = im.size_in_bytes();
+    uint64_t payload_bytes = type.bytes();
+    for (int e : im_extents) {
+        payload_bytes *= e;
+    }
 
     if (!check((payload_bytes >> 32) == 0, "Buffer too large to save as .mat")) {
         return false;
     }
 
-    int dims = im.dimensions();
+    int dims = (int)im_extents.size();
     if (dims < 2) {
         dims = 2;
     }
     int padded_dims = dims + (dims & 1);
 
-    uint32_t padding_bytes = 7 - ((payload_bytes - 1) & 7);
+    uint32_t padding_bytes = mat_padding_bytes(payload_bytes);
 
     // Matrix header
     uint32_t matrix_header[2] = {
@@ -2054,12 +2231,9 @@ bool save_mat(ImageType &im, const std::string &filename) {
     // Shape
     int32_t shape[2] = {
         miINT32,
-        im.dimensions() * 4,
+        (int32_t)im_extents.size() * 4,
     };
-    std::vector<int> extents(im.dimensions());
-    for (int d = 0; d < im.dimensions(); d++) {
-        extents[d] = im.dim(d).extent();
-    }
+    std::vector<int> extents = im_extents;
     while ((int)extents.size() < dims) {
         extents.push_back(1);
     }
@@ -2089,11 +2263,36 @@ bool save_mat(ImageType &im, const std::string &filename) {
         return false;
     }
 
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_mat(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
+        return false;
+    }
+
+    std::vector<int> extents(im.dimensions());
+    for (int d = 0; d < im.dimensions(); d++) {
+        extents[d] = im.dim(d).extent();
+    }
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    if (!write_mat_header<check>(f, filename, im.raw_buffer()->type, extents)) {
+        return false;
+    }
+
     if (!write_planar_payload<ImageType, check>(im, f)) {
         return false;
     }
 
     // Padding
+    uint32_t padding_bytes = mat_padding_bytes(im.size_in_bytes());
     if (!check(padding_bytes < 8, "Too much padding!\n")) {
         return false;
     }
@@ -2471,6 +2670,78 @@ FormatInfo best_save_format(const ImageType &im, const std::set<FormatInfo> &inf
     return best;
 }
 
+inline size_t payload_size_in_bytes(halide_type_t type, const std::vector<int> &extents) {
+    size_t size = type.bytes();
+    for (int e : extents) {
+        size *= e;
+    }
+    return size;
+}
+
+// Read the header of a .npy, .tmp or .mat file, and find where its
+// payload starts. Sets *payload_offset to zero for other formats.
+template<CheckFunc check>
+bool read_mappable_header(const std::string &filename, halide_type_t *type, std::vector<int> *extents, size_t *payload_offset) {
+    *payload_offset = 0;
+    const std::string ext = get_lowercase_extension(filename);
+    if (ext != "npy" && ext != "tmp" && ext != "mat") {
+        return true;
+    }
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+    bool ok = (ext == "npy") ? read_npy_header<check>(f, type, extents) :
+              (ext == "tmp") ? read_tmp_header<check>(f, type, extents) :
+                               read_mat_header<check>(f, type, extents);
+    if (!ok) {
+        return false;
+    }
+    for (const int extent : *extents) {
+        if (!check(extent > 0, "Bad extent in file")) {
+            return false;
+        }
+    }
+    *payload_offset = (size_t)ftell(f.f);
+    return true;
+}
+
+// Create a .npy, .tmp or .mat file holding just the header for an image
+// of the given type and extents, and work out where its payload starts
+// and how big the whole file must be.
+template<CheckFunc check>
+bool write_mappable_header(const std::string &filename, halide_type_t type, const std::vector<int> &extents,
+                           size_t *payload_offset, size_t *file_size) {
+    const std::string ext = get_lowercase_extension(filename);
+    const std::set<FormatInfo> *info = (ext == "npy") ? &query_npy() :
+                                       (ext == "tmp") ? &query_tmp() :
+                                       (ext == "mat") ? &query_mat() :
+                                                        nullptr;
+    if (!check(info != nullptr, "Only .npy, .tmp and .mat files can be mapped")) {
+        return false;
+    }
+    type = ensure_abi_type(type);
+    if (!check(info->count({type, (int)extents.size()}) > 0, "Image cannot be saved in this format")) {
+        return false;
+    }
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    bool ok = (ext == "npy") ? write_npy_header<check>(f, type, extents) :
+              (ext == "tmp") ? write_tmp_header<check>(f, type, extents) :
+                               write_mat_header<check>(f, filename, type, extents);
+    if (!ok) {
+        return false;
+    }
+    const size_t payload_bytes = payload_size_in_bytes(type, extents);
+    *payload_offset = (size_t)ftell(f.f);
+    *file_size = *payload_offset + payload_bytes + ((ext == "mat") ? mat_padding_bytes(payload_bytes) : 0);
+    return true;
+}
+
 }  // namespace Internal
 
 struct ImageTypeConversion {
@@ -2719,6 +2990,113 @@ bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     return true;
 }
 
+// Load the Image from the given .npy, .tmp or .mat file by mapping the
+// file into memory rather than reading it, so that the image's storage is
+// the file's pages in the OS's file cache, and only the parts of the image
+// that are actually touched are ever read. The mapping is copy-on-write:
+// changes to the image are never written back to the file. It is unmapped
+// when the last Buffer referring to it is destroyed. Files in other
+// formats, and files whose payload is not aligned to the element size,
+// are loaded with load() instead.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mapped(const std::string &filename, ImageType *im) {
+    halide_type_t type;
+    std::vector<int> extents;
+    size_t payload_offset;
+    if (!Internal::read_mappable_header<check>(filename, &type, &extents, &payload_offset)) {
+        return false;
+    }
+    if (payload_offset == 0 || payload_offset % type.bytes() != 0) {
+        return load<ImageType, check>(filename, im);
+    }
+
+    Internal::MappedFile *m = Internal::MappedFile::map(filename, false, 0);
+    if (m == nullptr) {
+        return load<ImageType, check>(filename, im);
+    }
+    if (m->size < payload_offset + Internal::payload_size_in_bytes(type, extents)) {
+        Internal::MappedFile::unmap(m);
+        return check(false, "Could not read payload");
+    }
+
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    DynamicImageType im_d(type, (uint8_t *)m->base + payload_offset, extents);
+    im_d.adopt_host_allocation(&m->header);
+    // Allow statically-typed images to be passed as the out-param, but do
+    // a runtime check to ensure
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(im_d.type() == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+    *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    im->set_host_dirty();
+    return true;
+}
+
+// Create a .npy, .tmp or .mat file big enough to hold an image of the
+// given type and extents, and map it into memory as *im, so that whatever
+// is written to the image (e.g. by realizing a pipeline into it) goes
+// straight to the file, without staging the whole payload in memory. The
+// file is complete once the last Buffer referring to the mapping is
+// destroyed. Fails if the payload would not be aligned to the element
+// size (e.g. for 64-bit types in .tmp files); use save_mapped instead.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool create_mapped(const std::string &filename, halide_type_t type, const std::vector<int> &extents, ImageType *im) {
+    if (ImageType::has_static_halide_type) {
+        if (!check(type == ImageType::static_halide_type(), "Type does not match the type of the image")) {
+            return false;
+        }
+    }
+    size_t payload_offset, file_size;
+    if (!Internal::write_mappable_header<check>(filename, type, extents, &payload_offset, &file_size)) {
+        return false;
+    }
+    if (!check(payload_offset % type.bytes() == 0, "Payload would not be aligned to the element size")) {
+        return false;
+    }
+    Internal::MappedFile *m = Internal::MappedFile::map(filename, true, file_size);
+    if (!check(m != nullptr, "File could not be mapped for writing")) {
+        return false;
+    }
+
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    DynamicImageType im_d(type, (uint8_t *)m->base + payload_offset, extents);
+    im_d.adopt_host_allocation(&m->header);
+    *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    return true;
+}
+
+// Save the Image as a .npy, .tmp or .mat file by copying it into a mapping
+// of the file, rather than writing it through stdio.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_mapped(ImageType &im, const std::string &filename) {
+    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
+        return false;
+    }
+    std::vector<int> extents(im.dimensions());
+    for (int d = 0; d < im.dimensions(); d++) {
+        extents[d] = im.dim(d).extent();
+    }
+    size_t payload_offset, file_size;
+    if (!Internal::write_mappable_header<check>(filename, Internal::ensure_abi_type(im.type()), extents, &payload_offset, &file_size)) {
+        return false;
+    }
+    Internal::MappedFile *m = Internal::MappedFile::map(filename, true, file_size);
+    if (!check(m != nullptr, "File could not be mapped for writing")) {
+        return false;
+    }
+    uint8_t *dst = (uint8_t *)m->base + payload_offset;
+    auto im_d = im.template as<const void, Internal::AnyDims>();
+    Internal::copy_planar_payload(im_d, &dst);
+    Internal::MappedFile::unmap(m);
+    return true;
+}
+
 // Fancy wrapper to call load() with CheckFail, inferring the return type;
 // this allows you to simply use
 //
@@ -0,0 +1,334 @@
+#ifndef HALIDE_STREAMING_H
+#define HALIDE_STREAMING_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+/** \file
+ * Define a utility that runs a Halide pipeline over an image too tall to
+ * hold in memory, such as a satellite swath or a continuous document scan,
+ * a strip of rows at a time.
+ *
+ * The caller pushes strips of input rows as they arrive, in order, and
+ * the StreamingPipeline runs the pipeline once per strip of output rows as
+ * soon as all the input rows that strip needs have arrived, handing each
+ * output strip to a callback. Only the input rows still needed by the
+ * next output strip are kept, so peak memory is proportional to the strip
+ * height (plus the pipeline's vertical footprint), not the image height.
+ *
+ * Dimension 1 of the input and output is the row dimension. Within each
+ * strip, the pipeline's own schedule applies: intermediates scheduled with
+ * store_root().compute_at(output, y) slide down the strip with folded
+ * storage just as they do for a whole image. Without more, the rows of
+ * each intermediate in the halo between adjacent strips are computed
+ * again by the next strip. To compute them once, fold the storage of the
+ * intermediate explicitly and carry it across calls with
+ * Func::carry_storage, and give the StreamingPipeline one state buffer
+ * for each such intermediate: it passes the pipeline the same state
+ * buffers, in the same order, for every strip of the image.
+ *
+ * The pipeline is called with input and output buffers whose row
+ * coordinates are those of the whole image. It must not apply a boundary
+ * condition in y based on the bounds of its input, as those are the bounds
+ * of the strip. Instead, the StreamingPipeline supplies the rows above and
+ * below the image that the pipeline reads, as the given RowBoundary says.
+ * Boundary conditions in the other dimensions must use the image's
+ * constant bounds. The output has as many rows as the input.
+ *
+ * The pipeline must need a window of input rows that moves down the image
+ * as the output strip does. Methods return halide_error_code_success, or
+ * the error returned by the pipeline (or
+ * halide_error_code_bad_dimensions if the pipeline needs input columns or
+ * channels beyond the ones given, or rows beyond the image with
+ * RowBoundary::None).
+ */
+namespace Halide {
+namespace Tools {
+
+/** How a StreamingPipeline supplies the rows above and below the image
+ * that the pipeline reads. */
+enum class RowBoundary {
+    /** Repeat the first and last rows of the image, as
+     * BoundaryConditions::repeat_edge would. */
+    RepeatEdge,
+    /** Use rows filled with the given exterior value, as
+     * BoundaryConditions::constant_exterior would. */
+    ConstantExterior,
+    /** The pipeline must not read rows beyond the image. */
+    None
+};
+
+template<typename InT, typename OutT = InT>
+class StreamingPipeline {
+public:
+    /** The pipeline, called with the input and output buffers, and the
+     * array of state buffers. */
+    using PipelineFn = std::function<int(halide_buffer_t *input, halide_buffer_t *output, halide_buffer_t **state)>;
+    using StripFn = std::function<void(const Runtime::Buffer<OutT> &strip)>;
+
+private:
+    PipelineFn pipeline;
+    StripFn on_strip;
+    std::vector<int> input_shape, output_shape;
+    int strip_height;
+    RowBoundary boundary;
+    InT exterior;
+
+    // The buffers the pipeline carries the storage of intermediates
+    // across strips in. Zero-filled when allocated, so they start out
+    // holding nothing to resume from.
+    std::vector<Runtime::Buffer<uint8_t>> state;
+    std::vector<halide_buffer_t *> state_ptrs;
+
+    // The input rows still needed. Dimension 1 is outermost, so that rows
+    // are contiguous. Row (rows_min + i) of the image is stored at row i.
+    Runtime::Buffer<InT> rows;
+    int rows_min = 0, rows_count = 0;
+
+    // The number of rows of input pushed so far, and whether that's all of
+    // them.
+    int input_rows = 0;
+    bool finished = false;
+
+    // The first row of the next output strip.
+    int next_output_row = 0;
+
+    Runtime::Buffer<OutT> output;
+
+    int rows_end() const {
+        return rows_min + rows_count;
+    }
+
+    // Ask the pipeline which input rows it needs to produce the given
+    // output rows, and make sure the state buffers are large enough.
+    int query_rows(int y, int h, int *min_row, int *end_row) {
+        std::vector<int> in_shape = input_shape, out_shape = output_shape;
+        in_shape[1] = 1;
+        out_shape[1] = h;
+        Runtime::Buffer<InT> in_query(nullptr, in_shape);
+        Runtime::Buffer<OutT> out_query(nullptr, out_shape);
+        out_query.translate(1, y);
+        std::vector<Runtime::Buffer<uint8_t>> state_query(state.size());
+        std::vector<halide_buffer_t *> state_query_ptrs(state.size());
+        for (size_t i = 0; i < state.size(); i++) {
+            state_query[i] = Runtime::Buffer<uint8_t>(nullptr, std::vector<int>{1});
+            state_query_ptrs[i] = state_query[i].raw_buffer();
+        }
+        int result = pipeline(in_query.raw_buffer(), out_query.raw_buffer(), state_query_ptrs.data());
+        if (result != halide_error_code_success) {
+            return result;
+        }
+        for (int d = 0; d < in_query.dimensions(); d++) {
+            if (d != 1 && (in_query.dim(d).min() < 0 ||
+                           in_query.dim(d).max() >= input_shape[d])) {
+                return halide_error_code_bad_dimensions;
+            }
+        }
+        for (size_t i = 0; i < state.size(); i++) {
+            int bytes = state_query[i].dim(0).extent();
+            if (!state[i].data() || state[i].dim(0).extent() < bytes) {
+                state[i] = Runtime::Buffer<uint8_t>(bytes);
+                state[i].fill(0);
+                state_ptrs[i] = state[i].raw_buffer();
+            }
+        }
+        *min_row = in_query.dim(1).min();
+        *end_row = in_query.dim(1).max() + 1;
+        return halide_error_code_success;
+    }
+
+    size_t row_elems() const {
+        return rows.dim(1).stride();
+    }
+
+    // Make room for at least n more rows.
+    void reserve(int n) {
+        if (rows.data() && rows_count + n <= rows.dim(1).extent()) {
+            return;
+        }
+        std::vector<int> shape = input_shape, storage_order;
+        shape[1] = std::max(rows_count + n, rows.data() ? rows.dim(1).extent() * 2 : strip_height);
+        for (int d = 0; d < (int)shape.size(); d++) {
+            if (d != 1) {
+                storage_order.push_back(d);
+            }
+        }
+        storage_order.push_back(1);
+        Runtime::Buffer<InT> bigger(shape, storage_order);
+        if (rows_count > 0) {
+            memcpy(bigger.data(), rows.data(), rows_count * row_elems() * sizeof(InT));
+        }
+        rows = std::move(bigger);
+    }
+
+    // Forget the rows before the given one.
+    void discard_rows_before(int row) {
+        int n = std::min(row - rows_min, rows_count);
+        if (n <= 0) {
+            return;
+        }
+        memmove(rows.data(), rows.data() + n * row_elems(), (rows_count - n) * row_elems() * sizeof(InT));
+        rows_min += n;
+        rows_count -= n;
+    }
+
+    // Fill n rows starting at the given row of storage with the given row
+    // of the image, which must be stored, for RowBoundary::RepeatEdge, or
+    // with the exterior value, for RowBoundary::ConstantExterior.
+    void fill_rows(int at, int n, int row) {
+        InT *dst = rows.data() + at * row_elems();
+        if (boundary == RowBoundary::RepeatEdge) {
+            const InT *src = rows.data() + (row - rows_min) * row_elems();
+            for (int i = 0; i < n; i++) {
+                memcpy(dst + i * row_elems(), src, row_elems() * sizeof(InT));
+            }
+        } else {
+            std::fill(dst, dst + n * row_elems(), exterior);
+        }
+    }
+
+    // Run the pipeline for every output strip whose input rows are all here.
+    int run_ready_strips() {
+        while (!finished || next_output_row < input_rows) {
+            int h = strip_height;
+            if (finished) {
+                h = std::min(h, input_rows - next_output_row);
+            }
+            int min_row, end_row;
+            int result = query_rows(next_output_row, h, &min_row, &end_row);
+            if (result != halide_error_code_success) {
+                return result;
+            }
+            if (min_row < rows_min) {
+                // The window moved up the image.
+                return halide_error_code_bad_dimensions;
+            }
+            if (end_row > rows_end()) {
+                if (!finished) {
+                    return halide_error_code_success;
+                }
+                if (boundary == RowBoundary::None) {
+                    return halide_error_code_bad_dimensions;
+                }
+                int n = end_row - rows_end();
+                reserve(n);
+                fill_rows(rows_count, n, rows_end() - 1);
+                rows_count += n;
+            }
+
+            Runtime::Buffer<InT> window = rows.cropped(1, min_row - rows_min, end_row - min_row);
+            window.translate(1, rows_min);
+            Runtime::Buffer<OutT> out = output.cropped(1, 0, h);
+            out.translate(1, next_output_row);
+            result = pipeline(window.raw_buffer(), out.raw_buffer(), state_ptrs.data());
+            if (result != halide_error_code_success) {
+                return result;
+            }
+            on_strip(out);
+
+            next_output_row += h;
+            discard_rows_before(min_row);
+        }
+        return halide_error_code_success;
+    }
+
+public:
+    /** Make a StreamingPipeline for a pipeline that takes one input buffer,
+     * produces one output buffer, and carries the storage of the given
+     * number of intermediates across calls, with the given callback for
+     * the output strips. The shapes give the extent of each dimension of
+     * the input and output; the extents given for dimension 1 are
+     * ignored. Each output strip has the given number of rows, apart from
+     * the last, which may have fewer. The boundary says what the rows
+     * above and below the image that the pipeline reads hold; the exterior
+     * value is only used with RowBoundary::ConstantExterior. The strip
+     * passed to the callback is only valid until it returns. */
+    StreamingPipeline(PipelineFn pipeline, int state_buffers, std::vector<int> input_shape,
+                      std::vector<int> output_shape, int strip_height, RowBoundary boundary,
+                      StripFn on_strip, InT exterior = InT())
+        : pipeline(std::move(pipeline)), on_strip(std::move(on_strip)),
+          input_shape(std::move(input_shape)), output_shape(std::move(output_shape)),
+          strip_height(strip_height), boundary(boundary), exterior(exterior),
+          state(state_buffers), state_ptrs(state_buffers, nullptr) {
+        assert(this->input_shape.size() >= 2 && this->output_shape.size() >= 2 &&
+               strip_height > 0 && state_buffers >= 0);
+        std::vector<int> shape = this->output_shape;
+        shape[1] = strip_height;
+        output = Runtime::Buffer<OutT>(shape);
+    }
+
+    /** Push the next strip of input rows. Its coordinates are ignored, apart
+     * from its extent in dimension 1: its rows follow those already
+     * pushed. Runs the pipeline for any output strips that can now be
+     * produced. */
+    int push(const Runtime::Buffer<const InT> &strip) {
+        assert(!finished);
+        const int n = strip.dim(1).extent();
+        int done = 0;
+        while (done < n) {
+            if (input_rows == 0) {
+                // Start with the rows above the image the first strip reads.
+                int min_row, end_row;
+                int result = query_rows(0, strip_height, &min_row, &end_row);
+                if (result != halide_error_code_success) {
+                    return result;
+                }
+                if (min_row < 0 && boundary == RowBoundary::None) {
+                    return halide_error_code_bad_dimensions;
+                }
+                rows_min = std::min(min_row, 0);
+                rows_count = 0;
+            }
+
+            const int first = input_rows == 0 ? -rows_min : 0;
+            reserve(first + 1);
+            const int count = std::min(n - done, rows.dim(1).extent() - rows_count - first);
+            Runtime::Buffer<const InT> src = strip.cropped(1, strip.dim(1).min() + done, count);
+            std::vector<int> mins(src.dimensions(), 0);
+            mins[1] = rows_count + first;
+            src.set_min(mins);
+            rows.cropped(1, rows_count + first, count).copy_from(src);
+            if (first > 0) {
+                // Fill in the rows above the image that the pipeline reads.
+                fill_rows(0, first, 0);
+            }
+            rows_count += first + count;
+            input_rows += count;
+            done += count;
+
+            int result = run_ready_strips();
+            if (result != halide_error_code_success) {
+                return result;
+            }
+        }
+        return halide_error_code_success;
+    }
+
+    /** Say that all the input has been pushed, and produce the remaining
+     * output strips. */
+    int finish() {
+        assert(!finished);
+        finished = true;
+        if (input_rows == 0) {
+            return halide_error_code_success;
+        }
+        return run_ready_strips();
+    }
+
+    /** The number of rows of output produced so far. */
+    int output_rows() const {
+        return next_output_row;
+    }
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_STREAMING_H
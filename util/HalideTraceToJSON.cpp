@@ -0,0 +1,201 @@
+#include "HalideRuntime.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+/** \file
+ *
+ * A tool which reads the ring buffers written by Halide's ring-buffer
+ * trace mode (HL_TRACE_RING), and converts them to the Chrome trace event
+ * JSON format, which can be loaded into Perfetto (ui.perfetto.dev) or
+ * chrome://tracing. Each pipeline, realization, and production becomes
+ * a slice on the timeline of the thread that ran it.
+ */
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct Begin {
+    int32_t thread_id;
+    halide_trace_ring_event_t event;
+};
+
+void usage(char *const *argv) {
+    const string usage =
+        "Usage: " + string(argv[0]) +
+        " -i trace_ring_file [-o output.json]\n"
+        "\n"
+        "This tool reads the ring buffers written by Halide's ring-buffer\n"
+        "trace mode, and writes the events in them as Chrome trace event\n"
+        "JSON, for viewing in Perfetto or chrome://tracing. To generate a\n"
+        "suitable file, use Func::trace_realizations() or the target feature\n"
+        "trace_realizations, and run with HL_TRACE_RING=<filename>.\n";
+    fprintf(stderr, "%s\n", usage.c_str());
+    exit(1);
+}
+
+bool read_exactly(FILE *f, void *dst, size_t size) {
+    return fread(dst, 1, size, f) == size;
+}
+
+[[noreturn]] void truncated(const char *filename) {
+    fprintf(stderr, "Error: %s is truncated or not a trace ring file.\n", filename);
+    exit(1);
+}
+
+string json_escape(const string &s) {
+    string result;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            result += buf;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+const char *category(int32_t event) {
+    switch (event) {
+    case halide_trace_begin_pipeline:
+        return "pipeline";
+    case halide_trace_begin_realization:
+        return "realization";
+    case halide_trace_produce:
+        return "produce";
+    default:
+        return nullptr;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char *const *argv) {
+    const char *in_filename = nullptr;
+    const char *out_filename = nullptr;
+    for (int i = 1; i < argc - 1; i++) {
+        string arg = argv[i];
+        if (arg == "-i") {
+            i++;
+            in_filename = argv[i];
+        } else if (arg == "-o") {
+            i++;
+            out_filename = argv[i];
+        }
+    }
+    if (in_filename == nullptr) {
+        usage(argv);
+    }
+
+    FILE *in = fopen(in_filename, "rb");
+    if (in == nullptr) {
+        fprintf(stderr, "Error opening file: %s. Exiting.\n", in_filename);
+        exit(1);
+    }
+    FILE *out = out_filename ? fopen(out_filename, "w") : stdout;
+    if (out == nullptr) {
+        fprintf(stderr, "Error opening file: %s. Exiting.\n", out_filename);
+        exit(1);
+    }
+
+    halide_trace_ring_header_t header;
+    if (!read_exactly(in, &header, sizeof(header)) ||
+        header.magic != HALIDE_TRACE_RING_MAGIC) {
+        truncated(in_filename);
+    }
+
+    vector<string> names(header.num_names);
+    for (string &name : names) {
+        uint32_t len;
+        if (!read_exactly(in, &len, sizeof(len))) {
+            truncated(in_filename);
+        }
+        name.resize(len);
+        if (len && !read_exactly(in, &name[0], len)) {
+            truncated(in_filename);
+        }
+        name = json_escape(name);
+    }
+    auto name_of = [&](uint32_t index) -> string {
+        return index < names.size() ? names[index] : string("<unknown>");
+    };
+
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) {
+            fprintf(out, ",\n");
+        }
+        first = false;
+    };
+
+    // Begin events that have not yet been matched with an end, by id.
+    // Slices whose begin event was overwritten in the ring, or that were
+    // still running when the rings were written out, are dropped.
+    map<int32_t, Begin> open;
+    int slices = 0, unmatched = 0;
+    for (uint32_t t = 0; t < header.num_threads; t++) {
+        halide_trace_ring_thread_t thread;
+        if (!read_exactly(in, &thread, sizeof(thread))) {
+            truncated(in_filename);
+        }
+        separator();
+        fprintf(out,
+                "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %d, "
+                "\"args\": {\"name\": \"thread %d\"}}",
+                thread.thread_id, thread.thread_id);
+
+        vector<halide_trace_ring_event_t> events(thread.num_events);
+        if (!events.empty() &&
+            !read_exactly(in, events.data(), events.size() * sizeof(halide_trace_ring_event_t))) {
+            truncated(in_filename);
+        }
+        for (const halide_trace_ring_event_t &e : events) {
+            if (category(e.event)) {
+                open[e.id] = Begin{thread.thread_id, e};
+                continue;
+            }
+            auto it = open.find(e.parent_id);
+            if (it == open.end()) {
+                unmatched++;
+                continue;
+            }
+            const Begin &b = it->second;
+            // Timestamps and durations are in microseconds.
+            separator();
+            fprintf(out,
+                    "{\"ph\": \"X\", \"cat\": \"%s\", \"name\": \"%s\", \"pid\": 1, \"tid\": %d, "
+                    "\"ts\": %.3f, \"dur\": %.3f}",
+                    category(b.event.event), name_of(b.event.name).c_str(), b.thread_id,
+                    b.event.time / 1000.0, (e.time - b.event.time) / 1000.0);
+            slices++;
+            open.erase(it);
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+    fprintf(stderr, "Wrote %d slices from %u threads (%d unmatched end events, %d unmatched begin events).\n",
+            slices, header.num_threads, unmatched, (int)open.size());
+    if (header.num_dropped_events) {
+        fprintf(stderr, "Warning: %u events were dropped because all the rings were in use.\n",
+                header.num_dropped_events);
+    }
+    return 0;
+}